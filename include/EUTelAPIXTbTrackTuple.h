@@ -3,14 +3,14 @@
 
 #include "marlin/Processor.h"
 
+// eutelescope includes ".h"
+#include "EUTelTupleWriter.h"
+
 // system includes <>
+#include <map>
 #include <string>
 #include <vector>
 
-#include <TFile.h>
-#include <TTree.h>
-#include <TVectorT.h>
-
 namespace eutelescope {
   class EUTelAPIXTbTrackTuple : public marlin::Processor {
   
@@ -54,40 +54,52 @@ namespace eutelescope {
     int _evtNr;
 
     bool _isFirstEvent;
-    
-    TFile* _file;
 
-    TTree* _eutracks;
+    //output options of the n-tuple writer
+    int _compressionLevel;
+    int _basketSize;
+    int _rowsPerBlock;
+    bool _asyncOutput;
+
+    //buffered writer owning the output file and trees
+    EUTelTupleWriter _writer;
+
+    size_t _eutracks;
     int _nTrackParams;
-    std::vector<double> *_xPos;
-    std::vector<double> *_yPos;
-    std::vector<double> *_dxdz;
-    std::vector<double> *_dydz;
-    std::vector<int>    *_trackIden;
-    std::vector<int>    *_trackNum;
-    std::vector<double> *_chi2;
-    std::vector<double> *_ndof;    
-
-    TTree* _zstree;
+    std::vector<double> _xPos;
+    std::vector<double> _yPos;
+    std::vector<double> _dxdz;
+    std::vector<double> _dydz;
+    std::vector<int>    _trackIden;
+    std::vector<int>    _trackNum;
+    std::vector<double> _chi2;
+    std::vector<double> _ndof;
+
+    size_t _zstree;
     int _nPixHits;
-    std::vector<int> *p_col;
-    std::vector<int> *p_row;
-    std::vector<int> *p_tot;
-    std::vector<int> *p_iden;
-    std::vector<int> *p_lv1;
-    std::vector<int> *p_chip;
-    std::vector<int> *p_hitTime;
-    std::vector<double> *p_frameTime;
-
-    TTree* _euhits;
+    std::vector<int> p_col;
+    std::vector<int> p_row;
+    std::vector<int> p_tot;
+    std::vector<int> p_iden;
+    std::vector<int> p_lv1;
+    std::vector<int> p_chip;
+    std::vector<int> p_hitTime;
+    std::vector<double> p_frameTime;
+
+    size_t _euhits;
     int _nHits;
-    std::vector<double> *_hitXPos;
-    std::vector<double> *_hitYPos;
-    std::vector<double> *_hitZPos;
-    std::vector<int>    *_hitSensorId;
+    std::vector<double> _hitXPos;
+    std::vector<double> _hitYPos;
+    std::vector<double> _hitZPos;
+    std::vector<int>    _hitSensorId;
+
+    size_t _versionTree;
 
-    TTree* _versionTree;
-    std::vector<double>* _versionNo;
+    //column handles of the trees, in booking order
+    std::vector<size_t> _trackColumns;
+    std::vector<size_t> _zsColumns;
+    std::vector<size_t> _hitColumns;
+    size_t _versionColumn;
   };
 
   //! A global instance of the processor.
@@ -14,6 +14,7 @@
 // built only if GEAR is available
 #ifdef USE_GEAR
 // eutelescope includes ".h"
+#include "EUTelPlaneAlignmentLSQ.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -134,9 +135,23 @@ namespace eutelescope {
      */
     void bookHistos();
 
+    //! Alignment fit with MINUIT
+    /*! The original MIGRAD/MINOS sequence, kept to verify the least
+     *  squares fit.
+     *
+     *  @param start start values of the five alignment parameters
+     *  @param par fitted parameters
+     *  @param err parameter errors
+     */
+    void fitWithMinuit(const double * start, double * par, double * err);
+
   protected:
 
-    static std::vector<HitsForFit> _hitsForFit;
+    //! Measured and predicted hit pairs of the aligned plane
+    /*! Static only because the MINUIT verification fit needs a plain
+     *  function as FCN.
+     */
+    static EUTelPlaneAlignmentLSQ _alignmentFit;
 
     //! TrackerHit collection name
     /*! Input collection with measured hits.
@@ -160,6 +175,12 @@ namespace eutelescope {
 
     std::vector<float > _startValuesForAlignment;
 
+    //! Maximum number of least squares iterations
+    int _maxIterations;
+
+    //! Repeat the fit with MINUIT to verify the least squares result
+    bool _useMinuit;
+
   private:
 
     //! Run number
@@ -10,6 +10,7 @@
 #define EUTELCALIBRATEEVENTPROCESSOR_H 1
 
 // eutelescope includes ".h"
+#include "EUTelNZSFrameEngine.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -25,6 +26,7 @@
 // system includes <>
 #include <string>
 #include <map>
+#include <vector>
 
 namespace eutelescope {
 
@@ -88,6 +90,15 @@ namespace eutelescope {
    *  this output collection via the steering parameter
    *  DataCollectionName
    *
+   *  <br><b>SparsifiedDataCollection</b>. Optional collection of
+   *  sparse TrackerData (EUTelGenericSparsePixel), one per detector,
+   *  with all good pixels whose calibrated signal exceeds SigmaCut
+   *  times their noise. The zero suppression is done in the same pass
+   *  over the frame as the calibration, so that a separate
+   *  EUTelRawDataSparsifier step is not needed. Together with
+   *  WriteCalibratedData = false, the full frame calibrated
+   *  collection is not stored in the event at all.
+   *
    *  @param RawDataCollectionName Name of the input raw data collection
    *
    *  @param PedestalCollectionName Name of the input (condition)
@@ -116,6 +127,16 @@ namespace eutelescope {
    *  @param DataCollectionName The name of the output calibrated data
    *  collection
    *
+   *  @param SparsifiedDataCollectionName The name of the output zero
+   *  suppressed data collection. Empty (default) to switch off the
+   *  zero suppression.
+   *
+   *  @param SigmaCut Zero suppression threshold in units of the noise,
+   *  one value per detector
+   *
+   *  @param WriteCalibratedData Flag to store the full frame
+   *  calibrated data collection in the event
+   *
    *  @param HistoInfoFileName The name of the XML containing the
    *  histogram information file.
    *
@@ -247,6 +268,25 @@ namespace eutelescope {
      */
     std::string _calibratedDataCollectionName;
 
+    //! Zero suppressed data collection name.
+    /*! The name of the optional output sparsified data collection. If
+     *  empty, no zero suppression is done.
+     */
+    std::string _sparsifiedDataCollectionName;
+
+    //! Zero suppression thresholds
+    /*! The threshold of each detector in units of the pixel noise,
+     *  in the order of the input collection.
+     */
+    FloatVec _sigmaCutVec;
+
+    //! Store the full frame calibrated data
+    /*! If false, the calibrated data collection is not added to the
+     *  event. Only meaningful if the zero suppressed collection is
+     *  produced.
+     */
+    bool _writeCalibratedData;
+
     //! Current run number.
     /*! This number is used to store the current run number
      */
@@ -433,6 +473,15 @@ namespace eutelescope {
      */
     bool _isGeometryReady;
 
+    //! Pedestal subtraction, common mode and zero suppression kernels
+    EUTelNZSFrameEngine _frameEngine;
+
+    //! Calibrated frame of one detector when not stored in the event
+    std::vector<float> _calibratedBuffer;
+
+    //! Indices of the pixels passing the zero suppression
+    std::vector<unsigned int> _sparseIndices;
+
   };
 
   //! A global instance of the processor
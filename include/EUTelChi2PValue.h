@@ -0,0 +1,88 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELCHI2PVALUE_H
+#define EUTELCHI2PVALUE_H 1
+
+// system includes <>
+#include <cstddef>
+#include <vector>
+
+namespace eutelescope {
+
+  //! p-value (survival probability) of the chi2 distribution
+  /*! Returns the probability P( X > chi2 ) for X following a chi2
+   *  distribution with ndf degrees of freedom, as TMath::Prob does.
+   *
+   *  For integer ndf up to getMaxTableNdf() the p-value is read from a
+   *  precomputed table in t = sqrt(chi2). The table stores the p-value
+   *  and its derivative on an equidistant grid in t, which is smooth
+   *  for every ndf, and is interpolated with cubic Hermite polynomials.
+   *  The absolute error is below 1e-8. Beyond the end of a table, where
+   *  the p-value is below 1e-15, the exact value is computed.
+   *
+   *  Larger integer ndf use the Wilson-Hilferty normal approximation,
+   *  with an absolute error of at most 2.5e-4, decreasing with ndf.
+   *  Non-integer ndf, as given by
+   *  the DAF, are computed exactly from the regularised incomplete
+   *  gamma function.
+   *
+   *  The tables are built once per job and shared, get one with
+   *  getInstance().
+   */
+  class EUTelChi2PValue {
+
+  public:
+    //! The shared instance, built on the first call
+    static const EUTelChi2PValue& getInstance();
+
+    //! Builds the tables for ndf = 1 ... maxTableNdf
+    explicit EUTelChi2PValue( int maxTableNdf = 50 );
+
+    //! Largest ndf with a table
+    int getMaxTableNdf() const { return _maxTableNdf; }
+
+    //! p-value of chi2 with ndf degrees of freedom
+    /*! @return 1 for chi2 <= 0, 0 for ndf <= 0 and for NaN or
+     *  infinite arguments
+     */
+    double operator()( double chi2, double ndf ) const;
+
+    //! p-values of n chi2 / ndf pairs, e.g. of all tracks of an event
+    void evaluate( const float* chi2, const float* ndf, float* pValue, size_t n ) const;
+
+    //! p-value from the regularised incomplete gamma function, without tables
+    static double exact( double chi2, double ndf );
+
+  private:
+    //! Table node, p-value and derivative w.r.t. t times the grid spacing
+    struct Node {
+      double pValue;
+      double slope;
+    };
+
+    //! p-value for integer ndf from the table
+    double interpolate( double chi2, int ndf ) const;
+
+    //! Wilson-Hilferty approximation
+    static double approximate( double chi2, double ndf );
+
+    int _maxTableNdf;
+
+    //! Grid spacing in t = sqrt(chi2)
+    double _step;
+
+    //! Nodes of all tables, the table of ndf starts at _offset[ndf]
+    std::vector<Node> _nodes;
+
+    //! Start of each table in _nodes, and one past the end of the last one
+    std::vector<size_t> _offset;
+  };
+
+}
+#endif
@@ -10,6 +10,7 @@
 #define EUTELCLUSTERSEPARATIONPROCESSOR_H 1
 
 // eutelescope includes ".h" 
+#include "EUTelVirtualCluster.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -48,6 +49,12 @@ namespace eutelescope {
    *  clusters with a distance between the seed pixels lesser of equal
    *  to the sum of the two radii.
    *
+   *  Each cluster is decoded only once per event. The candidate pairs
+   *  are found sweeping along x over the clusters of each detector,
+   *  sorted by their center, so that only clusters within the reach
+   *  in x are compared. The merging pairs are then grouped with a
+   *  disjoint-set (union-find) over the cluster indices.
+   *
    *  Here comes a list of all implemented
    *  separation algorithm:
    *
@@ -102,6 +109,9 @@ namespace eutelescope {
     //! Default constructor 
     EUTelClusterSeparationProcessor ();
 
+    //! Default destructor
+    virtual ~EUTelClusterSeparationProcessor ();
+
     //! Called at the job beginning.
     /*! This is executed only once in the whole execution. It prints
      *  out the processor parameters and reset all needed data
@@ -153,7 +163,8 @@ namespace eutelescope {
 
     //! This is the real method
     /*! This is the method where the real separation algorithm is
-     *  written/called. 
+     *  written/called. The clusters are taken from the ones decoded
+     *  for the current event.
      *
      *  @param setVector A STL vector of STL set containing the
      *  cluster of clusters to be separated.
@@ -163,7 +174,7 @@ namespace eutelescope {
      *
      *  @return true if the algorithm was successfully applied.
      */ 
-    bool applySeparationAlgorithm(std::vector< std::set< int > > setVector, 
+    bool applySeparationAlgorithm(const std::vector< std::set< int > >& setVector, 
 				  LCCollectionVec * inputCollectionVec,
 				  LCCollectionVec * outputCollectionVec) const ;
 
@@ -180,6 +191,10 @@ namespace eutelescope {
      *  Of course this method is called if, and only if, at least a
      *  pair merging clusters have been found
      *
+     *  The pairs are merged with a disjoint-set over the cluster
+     *  indices, so the grouping is linear in the number of pairs. The
+     *  groups are ordered by their lowest cluster index.
+     *
      *  @param pairVector A STL vector of STL pairs. For each pairs,
      *  the two integers represent the cluster indices within the
      *  clusterCollection
@@ -189,10 +204,48 @@ namespace eutelescope {
      *  above and the int value_type of the set represents the cluster
      *  index in the clusterCollection
      */ 
-    void groupingMergingPairs(std::vector< std::pair<int , int> > pairVector, std::vector< std::set< int > > * setVector) const;
+    void groupingMergingPairs(const std::vector< std::pair<int , int> >& pairVector, std::vector< std::set< int > > * setVector) const;
 
   protected:
 
+    //! A cluster decoded for the current event
+    struct DecodedCluster {
+      //! The decoded cluster, owned by the processor
+      EUTelVirtualCluster * cluster;
+
+      //! Detector of the cluster
+      int detectorID;
+
+      //! Cluster center in pixel units
+      int xCenter, yCenter;
+
+      //! External radius in pixel units
+      float radius;
+    };
+
+    //! Decodes all clusters of the collection
+    /*! The clusters of the previous event are deleted.
+     *
+     *  @throw UnknownDataTypeException if the cluster or pixel type is
+     *  unknown.
+     */
+    void decodeClusters(LCEvent * evt, LCCollectionVec * clusterCollectionVec);
+
+    //! Deletes the decoded clusters
+    void clearDecodedClusters();
+
+    //! Finds the pairs of merging clusters among the decoded clusters
+    /*! The clusters of each detector are sorted by their x center and
+     *  each one is compared only to the following clusters closer in
+     *  x than the largest merging distance.
+     *
+     *  @param pairVector The pairs of indices of merging clusters
+     */
+    void findMergingPairs(std::vector< std::pair<int , int> > * pairVector) const;
+
+    //! Clusters of the current event, in collection order
+    std::vector< DecodedCluster > _decodedClusters;
+
     //! Input cluster collection name.
     /*! This is the name of the input cluster collection.
      */
@@ -17,6 +17,7 @@
 #include "EUTelExceptions.h"
 #include "EUTELESCOPE.h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
+#include "EUTelNZSFrameEngine.h"
 
 // marlin includes ".h"
 #include "marlin/EventModifier.h"
@@ -436,19 +437,17 @@ namespace eutelescope {
      *  candidates. A seed candidate is defined as a pixel with a
      *  signal to noise ratio in excess the
      *  EUTelClusteringProcessor::_seedPixelCut defined by the
-     *  user. All candidates are added to a vector< pair< float, int > >
-     *  (EUTelClusteringProcessor::_seedCandidateMap) where the first
-     *  template element is the (float) pixel charge and the second is
-     *  the pixel index.
-     *
-     *  \li This is the sorted using the std::algorithm library by the first element of the pair
-     *  i.e. the pixel signal. In this way, at the end of
-     *  the matrix crossing, the last element of the map is the pixel
-     *  seed candidate with the highest signal. The seed candidate map has to be compulsory sorted,
-     *  because the cluster building procedure has to start from a
-     *  seed pixel.
-     *
-     *  \li Starting from the last entry of the seed candidate map
+     *  user. The scan is done by the
+     *  EUTelClusteringProcessor::_frameEngine (see
+     *  EUTelNZSFrameEngine) with a threshold mask over the full
+     *  matrix, the candidates are then compacted into a heap of
+     *  (pixel charge, pixel index) pairs.
+     *
+     *  \li The candidates are taken from the heap in order of
+     *  decreasing signal. The order is compulsory, because the
+     *  cluster building procedure has to start from the seed pixel.
+     *
+     *  \li Starting from the first seed candidate
      *  (i.e. the pixel with the highest signal in the matrix), a
      *  candidate cluster is built around this seed. The clustering is
      *  done with two nested loops in way that the seed pixel is the
@@ -742,10 +741,12 @@ namespace eutelescope {
      */
     void readCollections(LCEvent *evt);
 
-    //! The seed candidate pixel map.
-    /*! This is a vector which stores the seed index and the size of the signal. The signal is the floating point and the unsigned integer is the
+    //! Seed finding on the NZS frames
+    /*! Collects the seed candidates of one sensor and hands them out
+     *  in order of decreasing signal. It is kept as member to reuse
+     *  its buffers from event to event.
      */
-    std::vector< std::pair<float,unsigned int> > _seedCandidateMap;
+    EUTelNZSFrameEngine _frameEngine;
 
     //! Total cluster found
     /*! This is a map correlating the sensorID number and the
@@ -58,6 +58,8 @@ namespace eutelescope {
     virtual void dafEnd();
     //! Set fitter specific params
     virtual void dafParams();
+    //! The LCIO event is not used in dafEvent
+    virtual bool dafEventIsDeferrable() const { return(true); }
 
   protected:
     //params
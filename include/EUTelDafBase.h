@@ -40,6 +40,7 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <deque>
 #include <map>
 
 namespace eutelescope {
@@ -106,6 +107,12 @@ namespace eutelescope {
      * measurement to be included in the fit.
      */
     float _chi2cutoff;
+    //! Fit track candidates with the batched DAF
+    bool _batchedDaf;
+    //! Number of threads for track finding and fitting
+    int _nThreads;
+    //! Number of events processed together in parallel, 0 for 16 per thread
+    int _eventBufferSize;
     float _nXdz, _nYdz, _nXdzMaxDeviance, _nYdzMaxDeviance;
     int _nDutHits;
    
@@ -120,6 +127,13 @@ namespace eutelescope {
     virtual void dafEvent(LCEvent * /*evt*/){;}  //evt commented out because it causes a warning, function doesn't seem to do anything here but is probably used in another file through inheritance
     virtual void dafEnd(){;}
     virtual void dafParams(){;}
+    //! True if dafEvent does not use the LCIO event
+    /*! Events of such processors are buffered when running with more than
+     *  one thread. Track finding and fitting run in parallel for all buffered
+     *  events, dafEvent is then called for each of them in event order with
+     *  a NULL event.
+     */
+    virtual bool dafEventIsDeferrable() const { return false; }
     
 
     size_t getPlaneIndex(float zPos);
@@ -129,6 +143,10 @@ namespace eutelescope {
     void bookDetailedHistos();
     void fillPlots(daffitter::TrackCandidate<float,4>& track);
     void fillDetailPlots(daffitter::TrackCandidate<float,4>& track);
+    void fitTrackCandidate(size_t index);
+    void fitTrackCandidatesParallel();
+    void processEventBuffer();
+    void initWorkerSystems();
     bool checkTrack(daffitter::TrackCandidate<float,4>& track);
     int checkInTime(daffitter::TrackCandidate<float,4>& track);
     void printStats();
@@ -139,6 +157,19 @@ namespace eutelescope {
     void getPlaneNorm(daffitter::FitPlane<float>& pl);
 
     daffitter::TrackerSystem<float,4> _system;
+
+    //! Hits and track candidates of one event, for the parallel fit
+    struct DafEventData {
+      DafEventData() : measurements(), tracks() {}
+      std::vector< std::vector< daffitter::Measurement<float> > > measurements;
+      std::vector< daffitter::TrackCandidate<float,4> > tracks;
+    };
+    //! Copies of _system, one per thread
+    std::vector< daffitter::TrackerSystem<float,4> > _workerSystems;
+    //! Events waiting for the parallel track finding and fitting
+    std::deque<DafEventData> _eventBuffer;
+    //! The candidates of _system are fitted already, fitTrackCandidate only restores them
+    bool _candidatesFitted;
     std::map<float, int> _zSort;
     std::map<int, int> _indexIDMap;
     std::vector<float> _radLength;
@@ -0,0 +1,436 @@
+#include "EUTelDafTrackerSystem.h"
+#include <Eigen/Core>
+#include <float.h>
+#include <cmath>
+#include <limits>
+
+// Batched DAF. Up to dafBatchSize track candidates are fitted together, with the
+// information filter state stored as structure of arrays. All loops over candidates
+// ("lanes") have a fixed trip count and no branches, so that the compiler can
+// vectorize them. The arithmetic per lane is the same as for fitPlanesInfoDaf.
+
+namespace daffitter{
+  template <typename T, size_t N>
+  const size_t TrackerSystem<T, N>::dafBatchSize;
+
+  template <typename T, size_t K>
+  void BatchEstimate<T, K>::setZero(){
+    //Zero information vector and weight matrix in all lanes
+    for(size_t k = 0; k < K; k++){
+      x[k] = 0; y[k] = 0; xdz[k] = 0; ydz[k] = 0;
+      c00[k] = 0; c11[k] = 0; c22[k] = 0; c33[k] = 0; c02[k] = 0; c13[k] = 0;
+    }
+  }
+
+  template <typename T, size_t K>
+  void BatchEstimate<T, K>::copyLane(const BatchEstimate<T, K>& from, size_t k){
+    x[k] = from.x[k]; y[k] = from.y[k]; xdz[k] = from.xdz[k]; ydz[k] = from.ydz[k];
+    c00[k] = from.c00[k]; c11[k] = from.c11[k]; c22[k] = from.c22[k]; c33[k] = from.c33[k];
+    c02[k] = from.c02[k]; c13[k] = from.c13[k];
+  }
+
+  template <typename T, size_t K> template <size_t N>
+  void BatchEstimate<T, K>::setLane(size_t k, const TrackEstimate<T, N>& e){
+    x[k] = e.params(0); y[k] = e.params(1); xdz[k] = e.params(2); ydz[k] = e.params(3);
+    c00[k] = e.cov(0,0); c11[k] = e.cov(1,1); c22[k] = e.cov(2,2); c33[k] = e.cov(3,3);
+    c02[k] = e.cov(0,2); c13[k] = e.cov(1,3);
+  }
+
+  template <typename T, size_t K> template <size_t N>
+  void BatchEstimate<T, K>::getLane(size_t k, TrackEstimate<T, N>& e) const{
+    e.params.setZero();
+    e.cov.setZero();
+    e.params(0) = x[k]; e.params(1) = y[k]; e.params(2) = xdz[k]; e.params(3) = ydz[k];
+    e.cov(0,0) = c00[k]; e.cov(1,1) = c11[k]; e.cov(2,2) = c22[k]; e.cov(3,3) = c33[k];
+    e.cov(0,2) = e.cov(2,0) = c02[k];
+    e.cov(1,3) = e.cov(3,1) = c13[k];
+  }
+
+  template <typename T, size_t K>
+  void DafBatch<T, K>::init(size_t nPlanes){
+    //Size the storage for nPlanes planes, keeps allocated memory
+    forward.resize(nPlanes);
+    backward.resize(nPlanes);
+    smoothed.resize(nPlanes);
+    weights.resize(nPlanes);
+    totWeight.resize(nPlanes * K);
+    measZ.resize(nPlanes * K);
+  }
+
+  template <typename T, size_t K>
+  void DafBatch<T, K>::copyLane(const DafBatch<T, K>& from, size_t k){
+    //Copy the state of one lane in all planes
+    for(size_t plane = 0; plane < forward.size(); plane++){
+      forward[plane].copyLane(from.forward[plane], k);
+      backward[plane].copyLane(from.backward[plane], k);
+      smoothed[plane].copyLane(from.smoothed[plane], k);
+      for(size_t m = k; m < weights[plane].size(); m += K){
+	weights[plane][m] = from.weights[plane][m];
+      }
+      totWeight[plane * K + k] = from.totWeight[plane * K + k];
+      measZ[plane * K + k] = from.measZ[plane * K + k];
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::predictInfoBatch(size_t prev, size_t cur, BatchEstimate<T, dafBatchSize>& e){
+  //Information filter prediction from plane prev to plane cur, see EigenFitter::predictInfo
+  const size_t K = dafBatchSize;
+  const T* zPrev = &m_batch.measZ[prev * K];
+  const T* zCur = &m_batch.measZ[cur * K];
+  for(size_t k = 0; k < K; k++){
+    T dz = zPrev[k] - zCur[k];
+    T c02 = e.c02[k];
+    T c13 = e.c13[k];
+    e.c02[k] += dz * e.c00[k];
+    e.c13[k] += dz * e.c11[k];
+    e.c22[k] += dz * c02 + dz * e.c02[k];
+    e.c33[k] += dz * c13 + dz * e.c13[k];
+    e.xdz[k] += dz * e.x[k];
+    e.ydz[k] += dz * e.y[k];
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::updateInfoDafBatch(size_t plane, BatchEstimate<T, dafBatchSize>& e){
+  //Read the weighted measurements of a plane into the information filter, see EigenFitter::updateInfoDaf
+  const size_t K = dafBatchSize;
+  const FitPlane<T>& pl = planes.at(plane);
+  if(pl.isExcluded()) { return; }
+  const T invVarX = pl.invMeasVar(0);
+  const T invVarY = pl.invMeasVar(1);
+  const T* totWeight = &m_batch.totWeight[plane * K];
+  for(size_t k = 0; k < K; k++){
+    e.c00[k] += invVarX * totWeight[k];
+    e.c11[k] += invVarY * totWeight[k];
+  }
+  const std::vector<T>& weights = m_batch.weights[plane];
+  T x[K], y[K];
+  for(size_t k = 0; k < K; k++){ x[k] = e.x[k]; y[k] = e.y[k]; }
+  for(size_t m = 0; m < pl.meas.size(); m++){
+    const T mx = pl.meas[m].getX() * invVarX;
+    const T my = pl.meas[m].getY() * invVarY;
+    const T* w = &weights[m * K];
+    for(size_t k = 0; k < K; k++){
+      x[k] += w[k] * mx;
+      y[k] += w[k] * my;
+    }
+  }
+  for(size_t k = 0; k < K; k++){ e.x[k] = x[k]; e.y[k] = y[k]; }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::addScatteringInfoBatch(size_t plane, BatchEstimate<T, dafBatchSize>& e){
+  //Add scattering in plane to the weight matrix, see EigenFitter::addScatteringInfo
+  const size_t K = dafBatchSize;
+  const T invTheta = 1.0f / planes.at(plane).getScatterThetaSqr();
+  for(size_t k = 0; k < K; k++){
+    T scattervar2 = 1.0f/(e.c22[k] + invTheta);
+    T scattervar3 = 1.0f/(e.c33[k] + invTheta);
+    T c20 = e.c02[k];
+    T c31 = e.c13[k];
+    T c22 = e.c22[k];
+    T c33 = e.c33[k];
+    e.c00[k] -= c20 * c20 * scattervar2;
+    e.c02[k] -= c22 * c20 * scattervar2;
+    e.c11[k] -= c31 * c31 * scattervar3;
+    e.c13[k] -= c31 * c33 * scattervar3;
+    e.c22[k] -= c22 * c22 * scattervar2;
+    e.c33[k] -= c33 * c33 * scattervar3;
+
+    T p2 = e.xdz[k];
+    T p3 = e.ydz[k];
+    e.x[k] -= scattervar2 * c20 * p2;
+    e.y[k] -= scattervar3 * c31 * p3;
+    e.xdz[k] -= scattervar2 * c22 * p2;
+    e.ydz[k] -= scattervar3 * c33 * p3;
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::smoothInfoBatch(){
+  //Weighted average of forward and backward estimates in all planes, see EigenFitter::getAvgInfo
+  const size_t K = dafBatchSize;
+  for(size_t plane = 0; plane < planes.size(); plane++){
+    const BatchEstimate<T, K>& f = m_batch.forward[plane];
+    const BatchEstimate<T, K>& b = m_batch.backward[plane];
+    BatchEstimate<T, K>& s = m_batch.smoothed[plane];
+    for(size_t k = 0; k < K; k++){
+      //Invert the [x, dx/dz] and [y, dy/dz] blocks of the summed weight matrix
+      T a0 = f.c00[k] + b.c00[k], d0 = f.c22[k] + b.c22[k], b0 = f.c02[k] + b.c02[k];
+      T det0 = 1.0f / (a0 * d0 - b0 * b0);
+      s.c00[k] = det0 * d0;
+      s.c22[k] = det0 * a0;
+      s.c02[k] = det0 * -b0;
+      T a1 = f.c11[k] + b.c11[k], d1 = f.c33[k] + b.c33[k], b1 = f.c13[k] + b.c13[k];
+      T det1 = 1.0f / (a1 * d1 - b1 * b1);
+      s.c11[k] = det1 * d1;
+      s.c33[k] = det1 * a1;
+      s.c13[k] = det1 * -b1;
+
+      T x = f.x[k] + b.x[k], y = f.y[k] + b.y[k], dx = f.xdz[k] + b.xdz[k], dy = f.ydz[k] + b.ydz[k];
+      s.x[k] = s.c00[k] * x + s.c02[k] * dx;
+      s.y[k] = s.c11[k] * y + s.c13[k] * dy;
+      s.xdz[k] = s.c02[k] * x + s.c22[k] * dx;
+      s.ydz[k] = s.c13[k] * y + s.c33[k] * dy;
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::calculateWeightsBatch(T t, T chi2cut){
+  //Measurement weights in all planes from the smoothed estimates, see EigenFitter::calculatePlaneWeight
+  const size_t K = dafBatchSize;
+  const T cutWeight = exp( -1 * chi2cut / (2 * t));
+  //exp of arguments below this is exactly zero
+  const T minExpArg = log( std::numeric_limits<T>::denorm_min() ) - 1;
+  for(size_t plane = 0; plane < planes.size(); plane++){
+    const FitPlane<T>& pl = planes.at(plane);
+    const BatchEstimate<T, K>& e = m_batch.smoothed[plane];
+    std::vector<T>& weights = m_batch.weights[plane];
+    size_t nMeas = pl.meas.size();
+    weights.resize(nMeas * K);
+    const T varX = pl.getSigmaX() * pl.getSigmaX();
+    const T varY = pl.getSigmaY() * pl.getSigmaY();
+    T sum[K], ex[K], ey[K], errX[K], errY[K], arg[K];
+    for(size_t k = 0; k < K; k++){
+      sum[k] = 0;
+      ex[k] = e.x[k]; ey[k] = e.y[k];
+      errX[k] = varX + e.c00[k]; errY[k] = varY + e.c11[k];
+    }
+    for(size_t m = 0; m < nMeas; m++){
+      const T mx = pl.meas[m].getX();
+      const T my = pl.meas[m].getY();
+      T* w = &weights[m * K];
+      int nNear = 0;
+      for(size_t k = 0; k < K; k++){
+	T rx = ex[k] - mx;
+	T ry = ey[k] - my;
+	T chi2 = rx * rx / errX[k] + ry * ry / errY[k];
+	arg[k] = -1 * chi2 / (2 * t);
+	nNear += arg[k] >= minExpArg;
+      }
+      //Most measurements are far from all candidates of the batch, skip the exp for those
+      if(nNear == 0){
+	for(size_t k = 0; k < K; k++){ w[k] = 0; }
+	continue;
+      }
+      for(size_t k = 0; k < K; k++){
+	w[k] = exp( arg[k] );
+	sum[k] += w[k];
+      }
+    }
+    T* totWeight = &m_batch.totWeight[plane * K];
+    for(size_t k = 0; k < K; k++){
+      sum[k] = cutWeight + sum[k] + FLT_MIN;
+      totWeight[k] = 0;
+    }
+    for(size_t m = 0; m < nMeas; m++){
+      T* w = &weights[m * K];
+      for(size_t k = 0; k < K; k++){
+	w[k] /= sum[k];
+	totWeight[k] += w[k];
+      }
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::intersectBatch(){
+  //Update the track z position of all lanes to the track/plane intersection, see intersect
+  const size_t K = dafBatchSize;
+  for(size_t plane = 0; plane < planes.size(); plane++){
+    FitPlane<T>& pl = planes.at(plane);
+    const BatchEstimate<T, K>& e = m_batch.smoothed[plane];
+    const Eigen::Matrix<T, 3, 1>& refPoint = pl.getRef0();
+    const Eigen::Matrix<T, 3, 1>& normVec = pl.getPlaneNorm();
+    T* measZ = &m_batch.measZ[plane * K];
+    for(size_t k = 0; k < K; k++){
+      T len = std::sqrt(e.xdz[k] * e.xdz[k] + e.ydz[k] * e.ydz[k] + 1.0f);
+      T lx = e.xdz[k] / len, ly = e.ydz[k] / len, lz = 1.0f / len;
+      T d = ( normVec(0) * (refPoint(0) - e.x[k]) +
+	      normVec(1) * (refPoint(1) - e.y[k]) +
+	      normVec(2) * (refPoint(2) - measZ[k]) ) /
+	( normVec(0) * lx + normVec(1) * ly + normVec(2) * lz );
+      measZ[k] += d * lz;
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::fitPlanesInfoDafInnerBatch(T* ndof){
+  //Weighted information filter for all lanes, see fitPlanesInfoDafInner
+  const size_t K = dafBatchSize;
+  size_t nPlanes = planes.size();
+  BatchEstimate<T, K> e;
+  e.setZero();
+
+  //Forward fitter
+  m_batch.forward.at(0) = e;
+  updateInfoDafBatch(0, e);
+  for(size_t k = 0; k < K; k++){
+    ndof[k] = -1.0f * N + 2 * m_batch.totWeight[k];
+  }
+  for(size_t ii = 1; ii < nPlanes ; ii++ ){
+    if(not planes.at(ii).isExcluded()){
+      for(size_t k = 0; k < K; k++){ ndof[k] += 2 * m_batch.totWeight[ii * K + k]; }
+    }
+    predictInfoBatch(ii - 1, ii, e);
+    m_batch.forward.at(ii) = e;
+    updateInfoDafBatch(ii, e);
+    addScatteringInfoBatch(ii, e);
+  }
+
+  //No reason to complete unless >1 measurements are in, such lanes keep their previous estimates
+  size_t nDegenerate = 0;
+  for(size_t k = 0; k < K; k++){
+    if(ndof[k] < -2.1) { nDegenerate++; }
+  }
+  if(nDegenerate == K) { return; }
+  std::vector<BatchEstimate<T, K> > prevBackward, prevSmoothed;
+  if(nDegenerate > 0){
+    prevBackward = m_batch.backward;
+    prevSmoothed = m_batch.smoothed;
+  }
+
+  //Backward fitter, never bias
+  e.setZero();
+  m_batch.backward.at(nPlanes - 1) = e;
+  updateInfoDafBatch(nPlanes - 1, e);
+  for(int ii = nPlanes -2; ii >= 0; ii-- ){
+    predictInfoBatch(ii + 1, ii, e);
+    addScatteringInfoBatch(ii, e);
+    m_batch.backward.at(ii) = e;
+    updateInfoDafBatch(ii, e);
+  }
+  smoothInfoBatch();
+
+  if(nDegenerate > 0){
+    for(size_t k = 0; k < K; k++){
+      if(ndof[k] >= -2.1) { continue; }
+      for(size_t ii = 0; ii < nPlanes; ii++){
+	m_batch.backward[ii].copyLane(prevBackward[ii], k);
+	m_batch.smoothed[ii].copyLane(prevSmoothed[ii], k);
+      }
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::runTweightBatch(T t, const bool* active, T* ndof){
+  //A DAF iteration with temperature t for the active lanes, see runTweight
+  const size_t K = dafBatchSize;
+  size_t nActive = 0;
+  for(size_t k = 0; k < K; k++){
+    if(active[k]) { nActive++; }
+  }
+  if(nActive == 0) { return; }
+  //All lanes are computed, inactive ones are put back afterwards
+  if(nActive < K) { m_batchSaved = m_batch; }
+
+  calculateWeightsBatch(t, getDAFChi2Cut());
+  T newNdof[K];
+  fitPlanesInfoDafInnerBatch(newNdof);
+  intersectBatch();
+
+  for(size_t k = 0; k < K; k++){
+    if(active[k]) {
+      ndof[k] = newNdof[k];
+    } else {
+      m_batch.copyLane(m_batchSaved, k);
+    }
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::fitPlanesInfoDafBatch(size_t first, size_t n){
+  // Get smoothed estimates for all planes using the unbiased DAF, for n candidates at once.
+  // Equivalent to calling fitPlanesInfoDaf for each candidate, except that all candidates
+  // start from the plane z positions at the start of the batch.
+  const size_t K = dafBatchSize;
+  size_t nPlanes = planes.size();
+  if(first >= m_nTracks or nPlanes == 0) { return; }
+  if(n > K) { n = K; }
+  if(n > m_nTracks - first) { n = m_nTracks - first; }
+
+  m_batch.init(nPlanes);
+  T ndof[K];
+  for(size_t k = 0; k < K; k++){ ndof[k] = -4.0f; }
+  for(size_t plane = 0; plane < nPlanes; plane++){
+    size_t nMeas = planes.at(plane).meas.size();
+    std::vector<T>& weights = m_batch.weights[plane];
+    weights.assign(nMeas * K, 0.0f);
+    for(size_t k = 0; k < K; k++){
+      //Unused lanes repeat the first candidate, and are discarded
+      const Eigen::Matrix<T, Eigen::Dynamic, 1>& w = tracks.at(first + (k < n ? k : 0)).weights.at(plane);
+      T totWeight = w.size() > 0 ? w.sum() : 0.0f;
+      T scale = 1.0f;
+      if(totWeight > 1.0f){
+	scale = 1.0f / totWeight;
+	totWeight = 1.0f;
+      }
+      for(size_t m = 0; m < nMeas and m < static_cast<size_t>(w.size()); m++){
+	weights[m * K + k] = scale == 1.0f ? w(m) : w(m) * scale;
+      }
+      m_batch.totWeight[plane * K + k] = totWeight;
+      m_batch.measZ[plane * K + k] = planes.at(plane).getMeasZ();
+      ndof[k] += totWeight * 2.0;
+      m_batch.backward[plane].setLane(k, m_fitter.backward.at(plane));
+      m_batch.smoothed[plane].setLane(k, m_fitter.smoothed.at(plane));
+    }
+  }
+  T innerNdof[K];
+  fitPlanesInfoDafInnerBatch(innerNdof);
+  for(size_t k = 0; k < K; k++){
+    if(isnan(ndof[k])) { ndof[k] = -10.0; }
+  }
+
+  // Running with fixed annealing schedule.
+  const T temperatures[] = {25.0, 20.0, 14.0, 8.0, 4.0, 1.0};
+  const T minNdof[] = {-1.0f, -1.0f, -1.9f, -1.9f, -1.9f, -1.9f};
+  bool reweighted[K];
+  for(size_t k = 0; k < K; k++){ reweighted[k] = false; }
+  for(size_t step = 0; step < 6; step++){
+    bool active[K];
+    for(size_t k = 0; k < K; k++){
+      active[k] = ndof[k] > minNdof[step];
+      reweighted[k] = reweighted[k] or active[k];
+    }
+    runTweightBatch(temperatures[step], active, ndof);
+  }
+
+  //Store weights, estimates and results in the candidates
+  for(size_t k = 0; k < n; k++){
+    TrackCandidate<T,N>& candidate = tracks.at(first + k);
+    for(size_t plane = 0; plane < nPlanes; plane++){
+      Eigen::Matrix<T, Eigen::Dynamic, 1>& w = candidate.weights.at(plane);
+      size_t nMeas = planes.at(plane).meas.size();
+      if(reweighted[k]) { w.resize(nMeas); }
+      for(size_t m = 0; m < nMeas and m < static_cast<size_t>(w.size()); m++){
+	w(m) = m_batch.weights[plane][m * K + k];
+      }
+      candidate.measZ.at(plane) = m_batch.measZ[plane * K + k];
+    }
+    if(ndof[k] > -1.9f) {
+      for(size_t plane = 0; plane < nPlanes; plane++){
+	m_batch.smoothed[plane].getLane(k, candidate.estimates.at(plane));
+	m_batch.forward[plane].getLane(k, m_fitter.forward.at(plane));
+      }
+      getChi2UnBiasedInfoDaf(candidate);
+      weightToIndex(candidate);
+    } else {
+      candidate.ndof = ndof[k];
+      candidate.chi2 = 0;
+    }
+  }
+
+  //Leave the system as the scalar fit of the last candidate would
+  for(size_t plane = 0; plane < nPlanes; plane++){
+    planes.at(plane).setMeasZ( m_batch.measZ[plane * K + n - 1] );
+    planes.at(plane).setTotWeight( m_batch.totWeight[plane * K + n - 1] );
+    m_batch.forward[plane].getLane(n - 1, m_fitter.forward.at(plane));
+    m_batch.backward[plane].getLane(n - 1, m_fitter.backward.at(plane));
+    m_batch.smoothed[plane].getLane(n - 1, m_fitter.smoothed.at(plane));
+  }
+}
@@ -53,6 +53,8 @@ namespace eutelescope {
     virtual void dafEnd();
     //! Set fitter specific params
     virtual void dafParams();
+    //! Only the LCIO output needs the event
+    virtual bool dafEventIsDeferrable() const { return(not _addToLCIO); }
     //! Calculate Z coordinate for a pair X:Y on a plane define by refhit collection and "plane" id 
     /* input - plane and pos[0] and pos[1]
      * output - pos[2] to be overwritten with the right value
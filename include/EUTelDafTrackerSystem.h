@@ -58,6 +58,8 @@ namespace daffitter{
     //Results from fit
     T chi2, ndof;
     std::vector<TrackEstimate<T,N> > estimates;
+    //Plane z positions where the fitted track intersects the planes
+    std::vector<T> measZ;
     void print();
     void init(int nPlanes);
     TrackCandidate(int nPlanes);
@@ -183,8 +185,38 @@ namespace daffitter{
     void predictB(const FitPlane<T>  &prev, const FitPlane<T>  &cur, TrackEstimate<T,N>& e);
   };
 
+  template <typename T, size_t K>
+  class BatchEstimate{
+    // Information filter estimates of K track candidates at one plane, one lane per candidate.
+    // Only the entries of the weight matrix populated by the information filter are stored.
+  public:
+    T x[K], y[K], xdz[K], ydz[K];
+    T c00[K], c11[K], c22[K], c33[K], c02[K], c13[K];
+    void setZero();
+    void copyLane(const BatchEstimate<T,K>& from, size_t lane);
+    template <size_t N> void setLane(size_t lane, const TrackEstimate<T,N>& e);
+    template <size_t N> void getLane(size_t lane, TrackEstimate<T,N>& e) const;
+  };
+
+  template <typename T, size_t K>
+  class DafBatch{
+    // Structure of arrays state of the DAF for K track candidates
+  public:
+    std::vector<BatchEstimate<T,K> > forward, backward, smoothed;
+    //Weights per plane, measurement m of lane k is at m * K + k. Storage is reused between batches.
+    std::vector<std::vector<T> > weights;
+    //Sum of weights and track z position, plane p of lane k is at p * K + k
+    std::vector<T> totWeight, measZ;
+    void init(size_t nPlanes);
+    void copyLane(const DafBatch<T,K>& from, size_t lane);
+  };
+
   template <typename T, size_t N>
   class TrackerSystem{
+  public:
+    //Number of track candidates fitted together by the batched DAF
+    static const size_t dafBatchSize = 8;
+  private:
     bool m_inited;
     size_t m_nTracks, m_maxCandidates, m_minClusterSize;
 
@@ -201,6 +233,16 @@ namespace daffitter{
     //CKF
     void finalizeCKFTrack(TrackEstimate<T,N>& est, std::vector<int>& indexes, int nMeas, T chi2);
     void fitPermutation(int plane, TrackEstimate<T,N>& est, size_t nSkipped, std::vector<int> &indexes, int nMeas, T chi2);
+    //Batched DAF
+    DafBatch<T, dafBatchSize> m_batch, m_batchSaved;
+    void runTweightBatch(T t, const bool* active, T* ndof);
+    void fitPlanesInfoDafInnerBatch(T* ndof);
+    void calculateWeightsBatch(T t, T chi2cut);
+    void predictInfoBatch(size_t prev, size_t cur, BatchEstimate<T, dafBatchSize>& e);
+    void updateInfoDafBatch(size_t plane, BatchEstimate<T, dafBatchSize>& e);
+    void addScatteringInfoBatch(size_t plane, BatchEstimate<T, dafBatchSize>& e);
+    void smoothInfoBatch();
+    void intersectBatch();
     
   public: 
     EigenFitter<T,N> m_fitter;
@@ -216,6 +258,8 @@ namespace daffitter{
     void clear();
     void setMaxCandidates(int nCandidates);
     size_t getNtracks() const { return(m_nTracks); };
+    //Exchange the track candidates with cands, e.g. with candidates found and fitted by a copy of the system
+    void swapTracks(std::vector<daffitter::TrackCandidate<T,N> >& cands);
     void weightToIndex(daffitter::TrackCandidate<T,N>& cnd);
     void indexToWeight(daffitter::TrackCandidate<T,N>& cnd);
     Eigen::Matrix<T, 2, 1> getBiasedResidualErrors(FitPlane<T>& pl, TrackEstimate<T,N>& estim);
@@ -253,6 +297,10 @@ namespace daffitter{
     void fitPlanesInfoBiased(daffitter::TrackCandidate<T,N>& candidate);
     void fitPlanesInfoUnBiased(daffitter::TrackCandidate<T,N>& candidate);
     void fitPlanesInfoDaf(daffitter::TrackCandidate<T,N>& candidate);
+    //DAF fit of the candidates first ... first + n - 1, n <= dafBatchSize, as one batch
+    void fitPlanesInfoDafBatch(size_t first, size_t n);
+    //Set the plane z positions to the ones found in the fit of candidate
+    void restoreMeasZ(const daffitter::TrackCandidate<T,N>& candidate);
     void fitPlanesKF(daffitter::TrackCandidate<T,N>& candidate);
     //partial fitters
     void fitInfoFWBiased(TrackCandidate<T,N>& candidate);
@@ -294,5 +342,6 @@ namespace daffitter{
 }
 #include <EUTelDafTrackerSystem.tcc>
 #include <EUTelDafEigenFitter.tcc>
+#include <EUTelDafBatchFitter.tcc>
 
 #endif
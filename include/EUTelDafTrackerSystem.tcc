@@ -71,6 +71,7 @@ void TrackCandidate<T,N>::init(int nPlanes){
   indexes.resize(nPlanes);
   weights.resize(nPlanes);
   estimates.resize(nPlanes);
+  measZ.resize(nPlanes);
 }
 
 template<typename T, size_t N>
@@ -231,6 +232,15 @@ void TrackerSystem<T, N>::clear(){
   m_nTracks = 0;
 }
 
+template <typename T,size_t N>
+void TrackerSystem<T, N>::swapTracks(std::vector<TrackCandidate<T, N> >& cands){
+  // Exchange track candidates with another list, all of cands become candidates of this system.
+  size_t nOld = m_nTracks;
+  tracks.swap(cands);
+  m_nTracks = tracks.size();
+  if(cands.size() > nOld) { cands.erase(cands.begin() + nOld, cands.end()); }
+}
+
 template <typename T,size_t N>
 inline void TrackerSystem<T, N>::addMeasurement(size_t planeIndex, T x, T y, T z,  bool goodRegion, size_t measiden){
   // Add a measurement to the tracker system
@@ -620,6 +630,17 @@ void TrackerSystem<T, N>::fitPlanesInfoDaf(TrackCandidate<T, N>& candidate){
     candidate.ndof = ndof;
     candidate.chi2 = 0;
   }
+  for(size_t ii = 0; ii < planes.size(); ii++){
+    candidate.measZ.at(ii) = planes.at(ii).getMeasZ();
+  }
+}
+
+template <typename T,size_t N>
+void TrackerSystem<T, N>::restoreMeasZ(const TrackCandidate<T, N>& candidate){
+  //Set the plane z positions to the track/plane intersections found in the fit of candidate
+  for(size_t ii = 0; ii < planes.size() and ii < candidate.measZ.size(); ii++){
+    planes.at(ii).setMeasZ( candidate.measZ.at(ii) );
+  }
 }
 
 template <typename T,size_t N>
@@ -0,0 +1,125 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELEVENTINDEX_H
+#define EUTELEVENTINDEX_H 1
+
+// system includes <>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Event index of one LCIO file
+  /*! For every event of the file the index holds the run and event
+   *  number, the EUTelescope event type, the byte offset of the event
+   *  header record in the file and the number of elements of a few
+   *  key collections (zero if the collection is not in the event).
+   *
+   *  The index is built once by reading the whole file and is stored
+   *  as a small text file next to the data (indexFileName()). Readers
+   *  can then select events by position, type or collection size
+   *  without opening the data file at all.
+   *
+   *  The byte offsets are found by scanning the SIO record headers of
+   *  the file, the rest with the standard LCIO reader. If the two
+   *  scans do not agree, the offsets are set to -1.
+   */
+  class EUTelEventIndex {
+
+  public:
+    //! Version of the index file format
+    static const int VERSION = 1;
+
+    //! Default constructor, empty index
+    EUTelEventIndex();
+
+    //! Name of the index file belonging to a data file
+    static std::string indexFileName( const std::string& dataFile );
+
+    //! Builds the index by reading the whole data file
+    /*! @param dataFile the LCIO file
+     *  @param collections names of the collections to count
+     */
+    void build( const std::string& dataFile, const std::vector<std::string>& collections );
+
+    //! Writes the index to the given file
+    void write( const std::string& indexFile ) const;
+
+    //! Reads the index of dataFile from indexFile
+    /*! @return false if the index file does not exist
+     */
+    bool read( const std::string& dataFile, const std::string& indexFile );
+
+    //! Reads the index of dataFile, building and writing it if needed
+    /*! The index is rebuilt if it is missing, if the data file has
+     *  changed in size or if one of the collections is not indexed.
+     *
+     *  @param writeIndex store a rebuilt index next to the data
+     */
+    void load( const std::string& dataFile, const std::vector<std::string>& collections, bool writeIndex );
+
+    //! True if the size of the data file matches the index
+    bool isUpToDate() const;
+
+    //! Name of the indexed data file
+    const std::string& getDataFile() const { return _dataFile; }
+
+    //! Size of the indexed data file in bytes
+    long long getFileSize() const { return _fileSize; }
+
+    //! Number of events
+    size_t size() const { return _run.size(); }
+
+    //! Run number of event i
+    int getRunNumber( size_t i ) const { return _run[i]; }
+
+    //! Event number of event i
+    int getEventNumber( size_t i ) const { return _event[i]; }
+
+    //! EUTelescope event type of event i
+    int getEventType( size_t i ) const { return _type[i]; }
+
+    //! Byte offset of event i, -1 if unknown
+    long long getOffset( size_t i ) const { return _offset[i]; }
+
+    //! Bytes of event i in the file, -1 if unknown
+    long long getEventBytes( size_t i ) const;
+
+    //! Names of the counted collections
+    const std::vector<std::string>& getCollectionNames() const { return _collections; }
+
+    //! Position of a collection in getCollectionNames(), -1 if not indexed
+    int getCollectionIndex( const std::string& name ) const;
+
+    //! Number of elements of collection iCol in event i
+    int getCollectionSize( size_t i, int iCol ) const { return _sizes[ i * _collections.size() + iCol ]; }
+
+  private:
+    //! Removes all entries
+    void clear();
+
+    //! Byte offsets of all LCEventHeader records of the data file
+    std::vector<long long> scanEventOffsets() const;
+
+    std::string _dataFile;
+    long long _fileSize;
+    std::vector<std::string> _collections;
+
+    std::vector<int> _run;
+    std::vector<int> _event;
+    std::vector<int> _type;
+    std::vector<long long> _offset;
+
+    //! Collection sizes, size() x number of collections
+    std::vector<int> _sizes;
+  };
+
+}
+#endif
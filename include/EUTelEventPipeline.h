@@ -0,0 +1,241 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELEVENTPIPELINE_H
+#define EUTELEVENTPIPELINE_H 1
+
+// system includes <>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Ordered reader / workers / writer pipeline
+  /*! Runs a stream of independent work items through three stages:
+   *
+   *  - a single reader thread producing items in input order,
+   *  - N worker threads transforming an Input into an Output,
+   *  - an ordered writer, executed on the calling thread, which
+   *    receives the outputs strictly in the order they were read.
+   *
+   *  The amount of in-flight items is bounded by the queue depth so
+   *  the memory footprint stays constant for arbitrarily long runs.
+   *  Workers are passed their index so that callers can keep one
+   *  copy of any non thread-safe helper (fitters, geometry caches,
+   *  ...) per worker. The first exception thrown in any stage stops
+   *  the pipeline and is re-thrown from run().
+   *
+   *  \b Usage:
+   *  \code{.cpp}
+   *  EUTelEventPipeline< Event, Result > pipeline( nThreads );
+   *  pipeline.run( readNext, processOne, writeOne );
+   *  \endcode
+   */
+  template < typename Input, typename Output >
+  class EUTelEventPipeline {
+
+  public:
+    //! Fills the next input, returns false at the end of the stream
+    typedef std::function< bool ( Input& ) > Reader;
+
+    //! Transforms an input into an output on worker number iWorker
+    typedef std::function< void ( std::size_t iWorker, Input&, Output& ) > Worker;
+
+    //! Consumes outputs in input order
+    typedef std::function< void ( Output& ) > Writer;
+
+    //! Constructor
+    /*! @param nWorkers number of worker threads, at least one is used
+     *  @param queueDepth maximum number of items in flight; zero
+     *  means four items per worker
+     */
+    explicit EUTelEventPipeline( std::size_t nWorkers, std::size_t queueDepth = 0 ) :
+      _nWorkers( nWorkers > 0 ? nWorkers : 1 ),
+      _queueDepth( queueDepth > 0 ? queueDepth : 4 * ( nWorkers > 0 ? nWorkers : 1 ) ),
+      _mutex(),
+      _inputReady(),
+      _outputReady(),
+      _slotFree(),
+      _inputs(),
+      _outputs(),
+      _inFlight( 0 ),
+      _readerDone( false ),
+      _stop( false ),
+      _nextToWrite( 0 ),
+      _nRead( 0 ),
+      _error() {
+    }
+
+    //! Number of worker threads
+    std::size_t getNWorkers() const { return _nWorkers; }
+
+    //! Runs the pipeline until the reader is exhausted
+    /*! @return the number of items written
+     */
+    unsigned long run( Reader reader, Worker worker, Writer writer ) {
+
+      reset();
+
+      std::thread readerThread( &EUTelEventPipeline::readLoop, this, reader );
+      std::vector< std::thread > workerThreads;
+      for ( std::size_t iWorker = 0; iWorker < _nWorkers; ++iWorker ) {
+        workerThreads.push_back( std::thread( &EUTelEventPipeline::workLoop, this, iWorker, worker ) );
+      }
+
+      writeLoop( writer );
+
+      readerThread.join();
+      for ( std::size_t iWorker = 0; iWorker < workerThreads.size(); ++iWorker ) {
+        workerThreads[ iWorker ].join();
+      }
+
+      if ( _error ) std::rethrow_exception( _error );
+      return _nextToWrite;
+    }
+
+  private:
+    void reset() {
+      _inputs.clear();
+      _outputs.clear();
+      _inFlight    = 0;
+      _readerDone  = false;
+      _stop        = false;
+      _nextToWrite = 0;
+      _nRead       = 0;
+      _error       = std::exception_ptr();
+    }
+
+    //! Stores the first error and wakes every stage up
+    void fail( std::exception_ptr error ) {
+      std::lock_guard< std::mutex > lock( _mutex );
+      if ( ! _error ) _error = error;
+      _stop = true;
+      _inputReady.notify_all();
+      _outputReady.notify_all();
+      _slotFree.notify_all();
+    }
+
+    void readLoop( Reader reader ) {
+      try {
+        while ( true ) {
+          {
+            std::unique_lock< std::mutex > lock( _mutex );
+            _slotFree.wait( lock, [this] { return _stop || _inFlight < _queueDepth; } );
+            if ( _stop ) break;
+          }
+          Input input;
+          if ( ! reader( input ) ) break;
+
+          std::lock_guard< std::mutex > lock( _mutex );
+          _inputs.push_back( std::make_pair( _nRead++, std::move( input ) ) );
+          ++_inFlight;
+          _inputReady.notify_one();
+        }
+      } catch ( ... ) {
+        fail( std::current_exception() );
+      }
+      std::lock_guard< std::mutex > lock( _mutex );
+      _readerDone = true;
+      _inputReady.notify_all();
+      _outputReady.notify_all();
+    }
+
+    void workLoop( std::size_t iWorker, Worker worker ) {
+      try {
+        while ( true ) {
+          std::pair< unsigned long, Input > item;
+          {
+            std::unique_lock< std::mutex > lock( _mutex );
+            _inputReady.wait( lock, [this] { return _stop || _readerDone || ! _inputs.empty(); } );
+            if ( _stop || _inputs.empty() ) break;
+            item = std::move( _inputs.front() );
+            _inputs.pop_front();
+          }
+
+          Output output;
+          worker( iWorker, item.second, output );
+
+          std::lock_guard< std::mutex > lock( _mutex );
+          _outputs.insert( std::make_pair( item.first, std::move( output ) ) );
+          if ( item.first == _nextToWrite ) _outputReady.notify_all();
+        }
+      } catch ( ... ) {
+        fail( std::current_exception() );
+      }
+    }
+
+    void writeLoop( Writer writer ) {
+      try {
+        while ( true ) {
+          Output output;
+          {
+            std::unique_lock< std::mutex > lock( _mutex );
+            _outputReady.wait( lock, [this] {
+                return _stop || _outputs.count( _nextToWrite ) > 0 ||
+                  ( _readerDone && _nextToWrite == _nRead );
+              } );
+            if ( _stop ) break;
+            typename std::map< unsigned long, Output >::iterator next = _outputs.find( _nextToWrite );
+            if ( next == _outputs.end() ) break;
+            output = std::move( next->second );
+            _outputs.erase( next );
+          }
+
+          writer( output );
+
+          std::lock_guard< std::mutex > lock( _mutex );
+          ++_nextToWrite;
+          --_inFlight;
+          _slotFree.notify_one();
+        }
+      } catch ( ... ) {
+        fail( std::current_exception() );
+      }
+    }
+
+    //! Number of worker threads
+    std::size_t _nWorkers;
+
+    //! Maximum number of items between reader and writer
+    std::size_t _queueDepth;
+
+    std::mutex _mutex;
+    std::condition_variable _inputReady;
+    std::condition_variable _outputReady;
+    std::condition_variable _slotFree;
+
+    //! Read but not yet processed items, tagged with their sequence number
+    std::deque< std::pair< unsigned long, Input > > _inputs;
+
+    //! Processed items waiting for their turn in the writer
+    std::map< unsigned long, Output > _outputs;
+
+    std::size_t _inFlight;
+    bool _readerDone;
+    bool _stop;
+    unsigned long _nextToWrite;
+    unsigned long _nRead;
+
+    //! First exception thrown by any of the stages
+    std::exception_ptr _error;
+
+    EUTelEventPipeline( const EUTelEventPipeline& );
+    EUTelEventPipeline& operator=( const EUTelEventPipeline& );
+  };
+
+}
+
+#endif
@@ -20,6 +20,9 @@
 // lcio includes <.h>
 #include "lcio.h"
 
+// eutelescope includes ".h"
+#include "EUTelTupleWriter.h"
+
 // AIDA includes <.h>
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 #include <AIDA/IBaseHistogram.h>
@@ -72,6 +75,11 @@ namespace eutelescope {
    * \param MissingValue Value (double) which is used for missing
    *        measurements.
    *
+   * \param OutputFile If set, the n-tuple is written as tree EUFit
+   *        into this ROOT file by an EUTelTupleWriter (buffered and,
+   *        with AsyncOutput, in a background thread) instead of the
+   *        AIDA tuple.
+   *
 
    * \author A.F.Zarnecki, University of Warsaw
    * @version $Id$
@@ -143,6 +151,30 @@ namespace eutelescope {
     virtual void end() ;
 
   protected:
+    //! Fills one column of the current row into the active output
+    void fillColumn( int column, int value );
+    void fillColumn( int column, long int value );
+    void fillColumn( int column, float value );
+    void fillColumn( int column, double value );
+
+    //! Finishes the current row of the active output
+    void addRow();
+
+    //! Output ROOT file, empty to use the AIDA tuple
+    std::string _outputFileName;
+
+    //! Output options of the n-tuple writer
+    int _compressionLevel;
+    int _basketSize;
+    int _rowsPerBlock;
+    bool _asyncOutput;
+
+    //! Buffered writer used if _outputFileName is set
+    EUTelTupleWriter _writer;
+
+    //! Handle of the EUFit tree in _writer
+    size_t _fitTree;
+
 
     //! Silicon planes parameters as described in GEAR
     /*! This structure actually contains the following:
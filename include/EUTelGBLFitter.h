@@ -69,7 +69,7 @@ namespace eutelescope {
 			void setPairMeasurementStateAndPointLabelVec(std::vector< gbl::GblPoint >& pointList);
 			void setAlignmentToMeasurementJacobian(std::vector< gbl::GblPoint >& pointList);
 			void setScattererGBL(gbl::GblPoint& point,EUTelState & state );
-			void setScattererGBL(gbl::GblPoint& point,EUTelState & state,  float variance, TVectorD scat );
+			void setScattererGBL(gbl::GblPoint& point,EUTelState & state,  float variance, const TVectorD& scat );
 			void setLocalDerivativesToPoint(gbl::GblPoint& point, float distanceFromKinkTargetToNextPlane );
 			void setPointListWithNewScatterers(std::vector< gbl::GblPoint >& pointList,EUTelState & state, std::vector<float> variance );
 			void setMeasurementCov(EUTelState& state);
@@ -129,7 +129,7 @@ namespace eutelescope {
 			//OTHER FUNCTIONS
 			void resetPerTrack();
 			void findScattersZPositionBetweenTwoStates();
-			TMatrixD findScattersJacobians(EUTelState state, EUTelState nextTrack);
+			TMatrixD findScattersJacobians(const EUTelState& state, const EUTelState& nextTrack);
 			void updateTrackFromGBLTrajectory(gbl::GblTrajectory* traj, EUTelTrack& track, std::map<int,std::vector<double> >& mapSensorIDToCorrectionVec );
 			void prepareLCIOTrack( gbl::GblTrajectory*, std::vector<const IMPL::TrackImpl*>::const_iterator&, double, int); 
 			void prepareMilleOut( gbl::GblTrajectory* );
@@ -349,8 +349,29 @@ class EUTelGeometryTelescopeGeoDescription
 
 	double FindRad(Eigen::Vector3d const & startPt, Eigen::Vector3d const & endPt);
 
+	/** Radiation length X/X0 of a plane for a given incidence
+	 * direction in the global or the local frame. Taken from the
+	 * material model built at geometry load, i.e. the plane thickness
+	 * over its radiation length scaled with the path length through
+	 * the plane. With material validation switched on the value is
+	 * compared with the TGeo stepping of FindRad.
+	 */
 	double planeRadLengthGlobalIncidence(int planeID, Eigen::Vector3d incidenceDir);
 	double planeRadLengthLocalIncidence(int planeID, Eigen::Vector3d incidenceDir);
+
+	/** Radiation length X/X0 of a plane at normal incidence */
+	double planeRadLengthNormalIncidence(int planeID) const { return _planeRadMap.at(planeID); };
+
+	/** Radiation length X/X0 of the air between a plane and the next
+	 * plane along the beam, for a given global incidence direction.
+	 * Zero for the last plane.
+	 */
+	double airRadLengthGlobalIncidence(int planeID, Eigen::Vector3d incidenceDir);
+
+	/** Compare the material model with the TGeo description on each
+	 * query (slow, for validation only)
+	 */
+	void setMaterialValidation(bool validate) { _validateMaterial = validate; };
 	
 	void local2Master( int sensorID, std::array<double,3> const & localPos, std::array<double,3>& globalPos);
 	void master2Local( int sensorID, std::array<double,3> const & globalPos, std::array<double,3>& localPos);
@@ -423,11 +444,21 @@ private:
 
 	void translateSiPlane2TGeo(TGeoVolume*,int );
 
-	void clearMemoizedValues() { _planeNormalMap.clear(); _planeXMap.clear(); _planeYMap.clear(); _planeRadMap.clear(); }
+	/** Fills the normal incidence radiation lengths of all planes and
+	 * of the air gaps between consecutive planes from the plane setup
+	 */
+	void buildMaterialModel();
+
+	/** TGeo radiation length of a plane at normal incidence */
+	double planeRadLengthTGeo(int planeID);
+
+	void clearMemoizedValues() { _planeNormalMap.clear(); _planeXMap.clear(); _planeYMap.clear(); buildMaterialModel(); }
 	std::map<int, TVector3> _planeNormalMap;
 	std::map<int, TVector3> _planeXMap;
 	std::map<int, TVector3> _planeYMap;
 	std::map<int, double> _planeRadMap;
+	std::map<int, double> _airGapRadMap;
+	bool _validateMaterial;
 };
         
 inline EUTelGeometryTelescopeGeoDescription& gGeometry( gear::GearMgr* _g = marlin::Global::GEAR )
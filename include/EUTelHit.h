@@ -18,7 +18,7 @@ namespace eutelescope {
 			EUTelHit(EUTelHit* hit);
             void setPosition(const double * position);
             void setID(int id);
-            void setTrackFromLCIOVec(std::vector<double> input);
+            void setTrackFromLCIOVec(const std::vector<double>& input);
 
             //get
             int getID() const;
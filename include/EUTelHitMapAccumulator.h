@@ -0,0 +1,105 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELHITMAPACCUMULATOR_H
+#define EUTELHITMAPACCUMULATOR_H
+
+// system includes <>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Per-pixel hit counter for a set of sensors
+  /*! Every sensor owns one contiguous array of 32 bit counters laid
+   *  out row by row (x fastest), indexed relative to the smallest
+   *  pixel index of the sensor. Pixels are filled in batches straight
+   *  from the TrackerData charge values: the coordinates of a whole
+   *  sensor are first converted into array indices in a branch-free
+   *  loop and only then the counters are incremented.
+   *
+   *  The accumulated state can be written to and merged from binary
+   *  checkpoint files, so a hit map can be built over several run
+   *  segments (or jobs) and combined afterwards.
+   */
+  class EUTelHitMapAccumulator {
+
+  public:
+    //! Pixel layout and counters of one sensor
+    struct SensorMap {
+      int offX, offY;
+      int sizeX, sizeY;
+      std::vector<uint32_t> counts;
+
+      //! Counter of pixel (x, y), given in sensor pixel indices
+      uint32_t count(int x, int y) const {
+        return counts[ static_cast<size_t>( y - offY ) * sizeX + ( x - offX ) ];
+      }
+    };
+
+    //! Default constructor
+    EUTelHitMapAccumulator();
+
+    //! Adds a sensor with pixel indices [offX, offX+sizeX) x [offY, offY+sizeY)
+    void addSensor(int sensorID, int offX, int sizeX, int offY, int sizeY);
+
+    //! Checks whether a sensor has been added
+    bool hasSensor(int sensorID) const { return _sensors.count(sensorID) > 0; }
+
+    //! Fills all pixels of one sparse TrackerData
+    /*! @param sensorID the sensor the data belongs to
+     *  @param chargeValues the sparse pixel data, x and y being the
+     *  first two of @c stride values per pixel
+     *  @param stride number of values per sparse pixel
+     *  @return number of pixels outside of the sensor range, which
+     *  are not counted
+     */
+    size_t fill(int sensorID, const std::vector<float>& chargeValues, unsigned int stride);
+
+    //! Increments the number of accumulated events
+    void addEvents(uint64_t nEvents = 1) { _nEvents += nEvents; }
+
+    //! Number of accumulated events
+    uint64_t getNEvents() const { return _nEvents; }
+
+    //! Access to the hit map of one sensor
+    const SensorMap& getSensorMap(int sensorID) const;
+
+    //! Pixels of one sensor which fired in more than @c threshold events
+    /*! @return (x, y) pixel index pairs in row order
+     */
+    std::vector< std::pair<int, int> > getPixelsAbove(int sensorID, uint64_t threshold) const;
+
+    //! Writes the complete state into a binary checkpoint file
+    void writeCheckpoint(const std::string& fileName) const;
+
+    //! Adds the state stored in a checkpoint file
+    /*! Sensors unknown to this accumulator are added, sensors with a
+     *  different pixel layout cause an IncompatibleDataSetException.
+     */
+    void mergeCheckpoint(const std::string& fileName);
+
+    //! Clears all counters and the event count, keeping the sensors
+    void reset();
+
+  private:
+    //! Hit maps by sensor ID
+    std::map<int, SensorMap> _sensors;
+
+    //! Accumulated number of events
+    uint64_t _nEvents;
+
+    //! Scratch buffer for the array indices of one batch
+    std::vector<uint32_t> _indexBuffer;
+  };
+
+}
+#endif
@@ -0,0 +1,109 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELINDEXEDLCIOREADER_H
+#define EUTELINDEXEDLCIOREADER_H 1
+
+// eutelescope includes ".h"
+#include "EUTelEventIndex.h"
+
+// marlin includes ".h"
+#include "marlin/DataSourceProcessor.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Reads a selection of events from a chain of LCIO files
+  /*! The reader uses the event index of each input file (see
+   *  EUTelEventIndex) to select the events before reading any data:
+   *
+   *  \li a range of events over the whole chain of files,
+   *  \li only events where a collection has a minimum size,
+   *  \li a number of events sampled uniformly over the selection,
+   *  \li one of several contiguous shards of the selection, so that
+   *  independent jobs can share the input.
+   *
+   *  Only the selected events are then read; the events in between
+   *  are skipped without unpacking them. The end of run events of the
+   *  input files are never selected, a single one is added after the
+   *  last event. Missing or outdated indices are built on the fly and
+   *  stored next to the data; the lcioindex tool builds them in
+   *  advance.
+   *
+   *  Make sure to not specify any LCIOInputFiles in the steering.
+   *
+   *  <h4>Output</h4>
+   *  The selected events of the input files
+   *
+   *  @param InputFiles The LCIO files to read
+   *  @param IndexCollections Collections whose sizes are stored in the index
+   *  @param WriteIndex Store indices built on the fly next to the data
+   *  @param FirstEvent First event of the range, counted over the chain
+   *  @param LastEvent Last event of the range, -1 for the last event
+   *  @param RequiredCollection Only events where this collection has at least MinCollectionSize elements
+   *  @param MinCollectionSize Minimum size of the RequiredCollection
+   *  @param SampledEvents Number of events to sample uniformly, 0 for all
+   *  @param NumberOfShards Number of shards the selection is split into
+   *  @param ShardIndex Shard to read, from 0 to NumberOfShards-1
+   */
+  class EUTelIndexedLCIOReader : public marlin::DataSourceProcessor {
+
+  public:
+    //! Default constructor
+    EUTelIndexedLCIOReader();
+
+    //! New processor
+    virtual EUTelIndexedLCIOReader* newProcessor();
+
+    //! Init method
+    /*! Loads the indices and selects the events
+     */
+    virtual void init();
+
+    //! Reads the selected events
+    virtual void readDataSource( int numEvents );
+
+    //! End method
+    virtual void end();
+
+  protected:
+    //! Selects the events from the loaded indices
+    void selectEvents();
+
+    //! Adds an end of run event
+    void addEORE();
+
+    EVENT::StringVec _inputFiles;
+    EVENT::StringVec _indexCollections;
+    bool _writeIndex;
+    int _firstEvent;
+    int _lastEvent;
+    std::string _requiredCollection;
+    int _minCollectionSize;
+    int _sampledEvents;
+    int _nShards;
+    int _shardIndex;
+
+    //! Index of every input file
+    std::vector<EUTelEventIndex> _indices;
+
+    //! Selected positions in each file, sorted
+    std::vector< std::vector<size_t> > _selected;
+  };
+
+  //! A global instance of the processor
+  EUTelIndexedLCIOReader gEUTelIndexedLCIOReader;
+
+}
+#endif
@@ -0,0 +1,163 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELINSTRUMENTATION_H
+#define EUTELINSTRUMENTATION_H 1
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+
+// lcio includes <.h>
+#include <EVENT/LCEvent.h>
+
+// system includes <>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Per processor cost accounting of the EUTelescope processors
+  /*! Every EUTelescope processor opens a Scope at the beginning of
+   *  processEvent(). While the instrumentation is disabled, which is
+   *  the default, this costs a single flag test. It is enabled by
+   *  EUTelProcessorInstrumentation, which also fills the histograms
+   *  and writes the summary.
+   *
+   *  For each measured (sampled) event a Scope records the wall and
+   *  CPU time of the processor, the collections it added to the
+   *  event with their sizes and, if memory statistics are enabled,
+   *  the growth of the heap and the number of minor page faults.
+   *  CPU time is the one of the whole process, so that it includes
+   *  the worker threads of a processor.
+   *
+   *  Scopes must only be opened by the Marlin thread.
+   */
+  class EUTelInstrumentation {
+
+  public:
+    //! Accumulated cost of one processor over the sampled events
+    struct ProcessorStats {
+      ProcessorStats();
+
+      //! Processor name as given in the steering file
+      std::string name;
+
+      //! Number of events the processor was called for
+      size_t nEvents;
+
+      //! Number of events measured
+      size_t nSampled;
+
+      //! Wall time in s
+      double wallTime;
+      double maxWallTime;
+
+      //! Process CPU time in s
+      double cpuTime;
+
+      //! Growth of the heap in bytes, only with memory statistics
+      long long heapGrowth;
+      long long maxHeapGrowth;
+
+      //! Minor page faults, only with memory statistics
+      long long minorFaults;
+
+      //! Largest number of elements of each collection added by the processor
+      std::map<std::string, int> peakCollectionSizes;
+    };
+
+    //! Cost of one processor in one sampled event
+    struct Measurement {
+      const ProcessorStats* processor;
+      int runNumber;
+      int eventNumber;
+      double wallTime;
+      double cpuTime;
+      long long heapGrowth;
+    };
+
+    //! Measures one call of a processor
+    class Scope {
+
+    public:
+      Scope( const marlin::Processor* processor, EVENT::LCEvent* event );
+      ~Scope();
+
+    private:
+      //! Not copyable
+      Scope( const Scope& );
+      Scope& operator=( const Scope& );
+
+      //! NULL if this event is not measured
+      ProcessorStats* _stats;
+      EVENT::LCEvent* _event;
+      std::vector<std::string> _collectionNames;
+      std::chrono::steady_clock::time_point _wallStart;
+      std::clock_t _cpuStart;
+      long long _heapStart;
+      long long _faultsStart;
+    };
+
+    //! The instance shared by all processors
+    static EUTelInstrumentation& getInstance();
+
+    //! Starts measuring
+    /*! @param samplingInterval only events whose number is a multiple
+     *  of it are measured, 1 measures all events
+     *  @param memoryStatistics also record the heap growth and minor
+     *  page faults, which costs a few microseconds per processor call
+     */
+    void enable( int samplingInterval, bool memoryStatistics );
+
+    //! True once enable() was called
+    bool isEnabled() const { return _enabled; }
+
+    int getSamplingInterval() const { return _samplingInterval; }
+
+    bool hasMemoryStatistics() const { return _memoryStatistics; }
+
+    //! All processors seen so far, in the order of their first call
+    const std::vector<ProcessorStats*>& getProcessorStats() const { return _processorOrder; }
+
+    //! Moves the measurements since the last call into @c measurements
+    void takeMeasurements( std::vector<Measurement>& measurements );
+
+    //! Heap in use in bytes, 0 where malloc does not report it
+    static long long getHeapInUse();
+
+    //! Minor page faults of the process so far
+    static long long getMinorFaults();
+
+    //! Peak resident set size of the process in bytes
+    static long long getPeakResidentSize();
+
+  private:
+    EUTelInstrumentation();
+
+    //! Not copyable
+    EUTelInstrumentation( const EUTelInstrumentation& );
+    EUTelInstrumentation& operator=( const EUTelInstrumentation& );
+
+    //! Stats of a processor, created on its first call
+    ProcessorStats& getStats( const marlin::Processor* processor );
+
+    bool _enabled;
+    int _samplingInterval;
+    bool _memoryStatistics;
+
+    std::map<const marlin::Processor*, ProcessorStats> _stats;
+    std::vector<ProcessorStats*> _processorOrder;
+    std::vector<Measurement> _measurements;
+  };
+
+}
+#endif
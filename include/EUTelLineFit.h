@@ -211,6 +211,31 @@ namespace eutelescope {
     double * _xFitPos;
     double * _yFitPos;
 
+    //! Prepares the fit weights for the current plane positions
+    /*! The straight line fit is linear in the measured positions:
+     *  the fitted position at the weighted mean z and the slope are
+     *  weighted sums of the hit positions, with weights which only
+     *  depend on the plane z positions and resolutions. They are
+     *  computed here once and reused as long as the geometry does
+     *  not change, so that each fit is reduced to a few multiply
+     *  adds per plane.
+     */
+    void prepareFitWeights();
+
+    //! Plane z positions the fit weights were computed for
+    std::vector<double> _fitWeightZ;
+
+    //! Weighted mean z in X and Y
+    double _fitZbar[2];
+
+    //! Weights of the fitted position at the mean z in X and Y
+    std::vector<double> _meanWeightX;
+    std::vector<double> _meanWeightY;
+
+    //! Weights of the fitted slope in X and Y
+    std::vector<double> _slopeWeightX;
+    std::vector<double> _slopeWeightY;
+
     //! Fill histogram switch
     /*! Only for debug reason
      */
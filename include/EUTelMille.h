@@ -21,8 +21,8 @@
 // marlin includes ".h"
 #include "marlin/Processor.h"
 
-// marlin util includes
-#include "mille/Mille.h"
+// eutelescope includes ".h"
+#include "EUTelMilleFile.h"
 
 // lcio includes <.h>
 #include <EVENT/LCRunHeader.h>
@@ -254,6 +254,32 @@ namespace eutelescope {
                             );
 
 
+    //! Iterative road search for track candidates - with omits
+    /*! The hits of every plane are sorted by x and the hits compatible
+     *  with the road are looked up by binary search in the window given
+     *  by the residual cuts w.r.t. the last plane with a hit. A plane
+     *  is only omitted if none of its hits is compatible with the road,
+     *  at most AllowedMissingHits times. The search stops once
+     *  MaxTrackCandidates candidates have been found.
+     *
+     *  @param indexarray resulting vector of hit indices, one entry per
+     *  plane with -1 for omitted planes
+     *  @param hitsArray contains all hits for each plane
+     */
+    void findTrackCandidates(
+                            std::vector<IntVec >& indexarray,
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> >& hitsArray
+                            );
+
+    //! Checks a hit against the road of the current candidate
+    bool isHitOnRoad(
+                    const std::vector<std::vector<EUTelMille::HitsInPlane> >& hitsArray,
+                    const IntVec& candidate,
+                    int lastHitPlane,
+                    unsigned int plane,
+                    int hit
+                    ) const;
+
     //recursive method which searches for track candidates
     virtual void findtracks(
                             std::vector<IntVec > &indexarray, //resulting vector of hit indizes
@@ -421,6 +447,15 @@ namespace eutelescope {
 
     std::string _binaryFilename;
 
+    //! Size of the write blocks of the Millepede binary in MB
+    int _binaryBufferSize;
+
+    //! Write only every n-th track to the Millepede binary
+    int _binaryTrackSampling;
+
+    //! Write only tracks with at least this number of measurements
+    int _binaryMinMeasurements;
+
     float _telescopeResolution;
     bool _onlySingleHitEvents;
     bool _onlySingleTrackEvents;
@@ -453,6 +488,16 @@ namespace eutelescope {
 
     int _inputMode;
     int _allowedMissingHits;
+    bool _useRecursiveTrackFinder;
+
+    //! Hits per plane, kept between events to reuse their memory
+    std::vector<std::vector<EUTelMille::HitsInPlane> > _allHitsArrayBuffer;
+
+    //! Hit indices per plane sorted by x, used by findTrackCandidates
+    std::vector<IntVec> _sortedHitIndex;
+
+    //! Sorted x positions per plane, used by findTrackCandidates
+    std::vector<DoubleVec> _sortedHitX;
     int _mimosa26ClusterChargeMin;
 
     float _testModeSensorResolution;
@@ -488,7 +533,7 @@ namespace eutelescope {
     int _nMilleTracks;
 
     // Mille
-    Mille * _mille;
+    EUTelMilleWriter * _mille;
 
     //! Conversion ID map.
     /*! In the data file, each cluster is tagged with a detector ID
@@ -0,0 +1,132 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELMILLEFILE_H
+#define EUTELMILLEFILE_H 1
+
+// system includes <>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! One Millepede record (usually one track) in the C binary format
+  /*! The record consists of a float and an int array of equal length.
+   *  Entry 0 is reserved, then each measurement is stored as
+   *  (residual, 0), the local derivatives (derivative, local index),
+   *  (sigma, 0) and the global derivatives (derivative, global label),
+   *  exactly as written by Mille.
+   */
+  class EUTelMilleRecord {
+
+  public:
+    //! Default constructor, empty record
+    EUTelMilleRecord();
+
+    //! Removes all measurements
+    void clear();
+
+    //! Appends a measurement, same arguments as Mille::mille
+    void addMeasurement( int nLC, const float* derLC, int nGL, const float* derGL,
+                         const int* label, float residual, float sigma );
+
+    //! True if no measurement was added
+    bool empty() const { return _floats.size() < 2; }
+
+    //! Number of measurements
+    size_t getNMeasurements() const { return _nMeasurements; }
+
+    //! Float array of the record
+    const std::vector<float>& getFloats() const { return _floats; }
+
+    //! Int array of the record
+    const std::vector<int>& getInts() const { return _ints; }
+
+  private:
+    std::vector<float> _floats;
+    std::vector<int> _ints;
+    size_t _nMeasurements;
+  };
+
+  //! Buffered writer of Millepede binary files
+  /*! Drop-in replacement of Mille for writing tracks: mille() adds a
+   *  measurement to the current record, end() closes the record and
+   *  kill() discards it. Records are collected in memory and written
+   *  in large blocks, instead of one unbuffered write per record.
+   *
+   *  If the file name ends with .gz the output is gzip compressed,
+   *  which pede reads directly when built with zlib support. This
+   *  requires Eutelescope to be built with zlib (USE_ZLIB).
+   *
+   *  At write time records can be sampled (only every n-th record is
+   *  written) and preselected by their number of measurements.
+   */
+  class EUTelMilleWriter {
+
+  public:
+    //! Opens the output file
+    /*! @param fileName name of the binary file, .gz for compression
+     *  @param bufferSize size of the write blocks in bytes
+     */
+    EUTelMilleWriter( const std::string& fileName, size_t bufferSize = 8*1024*1024 );
+
+    //! Closes the file if close() was not called, errors are only logged
+    ~EUTelMilleWriter();
+
+    //! Writes the pending records and closes the file
+    /*! @throw lcio::IOException if writing or closing fails
+     */
+    void close();
+
+    //! Adds a measurement to the current record
+    void mille( int nLC, const float* derLC, int nGL, const float* derGL,
+                const int* label, float residual, float sigma );
+
+    //! Discards the current record
+    void kill();
+
+    //! Closes the current record
+    void end();
+
+    //! Writes the buffered records to the file
+    void flush();
+
+    //! Write only every n-th record, 1 writes all
+    void setSampling( unsigned int everyNth ) { _sampling = ( everyNth > 0 ) ? everyNth : 1; }
+
+    //! Skip records with less measurements
+    void setMinMeasurements( unsigned int minMeasurements ) { _minMeasurements = minMeasurements; }
+
+    //! Number of closed records
+    unsigned long getNRecords() const { return _nRecords; }
+
+    //! Number of records written to the file
+    unsigned long getNWritten() const { return _nWritten; }
+
+  private:
+    EUTelMilleWriter( const EUTelMilleWriter& );
+    EUTelMilleWriter& operator=( const EUTelMilleWriter& );
+
+    EUTelMilleRecord _record;
+    std::vector<char> _buffer;
+    size_t _bufferSize;
+
+    //! Output, FILE* or gzFile
+    void* _file;
+    bool _compressed;
+
+    unsigned int _sampling;
+    unsigned int _minMeasurements;
+    unsigned long _nRecords;
+    unsigned long _nWritten;
+  };
+
+}
+#endif
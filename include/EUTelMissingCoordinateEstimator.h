@@ -38,6 +38,12 @@ namespace eutelescope {
      *  the estimated position in one axis on your sensor you want.
      *  No promises that this will work with tilted sensors and/or with magnetic field
      *  One needs to used this with merged hits and after pre-alignment
+     *
+     *  By default the DUT hits are sorted by their known coordinate and,
+     *  for every pair of reference hits, only the DUT hits in the window
+     *  around the interpolated position are tested. With MaxReferenceSlope
+     *  also the pairs of reference hits are found by binary search, so the
+     *  work grows about linearly with the number of hits.
      */
     
     class EUTelMissingCoordinateEstimator : public marlin::Processor {
@@ -156,11 +162,33 @@ namespace eutelescope {
          */
         float _maxResidual;
         
+        //! Sorted hit search
+        /*! If true, the DUT hits are sorted by their known coordinate and
+         *  found by binary search in the window around the position
+         *  interpolated from the reference hits. The created hits are the
+         *  same as when testing every DUT hit against every pair.
+         */
+        bool _sortedHitSearch;
+        
+        //! Max reference slope
+        /*! If positive, only pairs of reference hits whose known
+         *  coordinates differ by less than MaxReferenceSlope times their
+         *  distance in z are used. With the sorted hit search these pairs
+         *  are found by binary search as well.
+         */
+        float _maxReferenceSlope;
+        
         //! Clone Hit
         /*! This method is used to clone TrackerHitImpl object
          */
         TrackerHitImpl* cloneHit(TrackerHitImpl *inputHit);
         
+        //! Creates the DUT hit with the missing coordinate from the line through two reference hits
+        /*! @param t position of the DUT hit on the line, 0 at the first
+         *  and 1 at the second reference hit
+         */
+        void addEstimatedHit(TrackerHitImpl* dutHit, const double* refHit1Pos, const double* refHit2Pos, double t, LCCollectionVec* outputHitCollection);
+        
         
     private:
         
@@ -0,0 +1,117 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELNZSFRAMEENGINE_H
+#define EUTELNZSFRAMEENGINE_H 1
+
+// system includes <>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Per-frame kernels shared by the non zero suppressed processors
+  /*! A non zero suppressed frame is stored as contiguous arrays with
+   *  one entry per pixel (signal, pedestal, noise and status), row by
+   *  row. The kernels of this class run over these arrays in simple
+   *  loops without data dependent branches, so that the compiler can
+   *  vectorise them.
+   *
+   *  The seed search is split in two steps: first a threshold mask is
+   *  computed for the whole frame, then the indices of the pixels
+   *  above threshold are compacted into a reused candidate buffer.
+   *  The candidates are kept in a heap and handed out by nextSeed()
+   *  with the highest signal first, i.e. only the candidates which are
+   *  actually used as seeds are fully ordered.
+   *
+   *  \b Usage:
+   *  \code{.cpp}
+   *  EUTelNZSFrameEngine engine;
+   *  engine.findSeeds( data, noise, status, seedCut );
+   *  unsigned int index;
+   *  while ( engine.nextSeed( index ) ) {
+   *    // build the cluster around index
+   *  }
+   *  \endcode
+   */
+  class EUTelNZSFrameEngine {
+
+  public:
+    //! Default constructor
+    EUTelNZSFrameEngine();
+
+    //! Collects the seed candidates of one frame
+    /*! A pixel is a seed candidate if its status is GOODPIXEL and its
+     *  signal is larger than @c seedCut times its noise.
+     *
+     *  @param signal pedestal subtracted signal of all pixels
+     *  @param noise noise of all pixels
+     *  @param status status of all pixels
+     *  @param seedCut seed threshold in units of the noise
+     *  @return number of seed candidates
+     */
+    size_t findSeeds( const std::vector<float>& signal, const std::vector<float>& noise,
+                      const std::vector<short>& status, float seedCut );
+
+    //! Number of candidates not yet returned by nextSeed()
+    size_t getNSeedCandidates() const { return _candidates.size(); }
+
+    //! Access to the candidates not yet returned, in heap order
+    const std::vector< std::pair<float, unsigned int> >& getSeedCandidates() const { return _candidates; }
+
+    //! Returns the next seed candidate, highest signal first
+    /*! Candidates with the same signal are returned with the highest
+     *  pixel index first.
+     *
+     *  @return false if there are no candidates left
+     */
+    bool nextSeed( unsigned int& index );
+
+    //! Selects the pixels above threshold of a part of a frame
+    /*! A pixel is selected if its status is GOODPIXEL and its signal
+     *  is larger than @c cut times its noise. The indices of the
+     *  selected pixels, counted from @c firstIndex, are appended to
+     *  @c indices in increasing order.
+     *
+     *  @return number of selected pixels
+     */
+    size_t selectPixels( const float* signal, const float* noise, const short* status, size_t n,
+                         float cut, unsigned int firstIndex, std::vector<unsigned int>& indices );
+
+    //! Subtracts pedestal and a constant offset from the raw data
+    /*! out[i] = raw[i] - pedestal[i] - offset
+     */
+    static void subtractPedestal( const short* raw, const float* pedestal, size_t n, double offset, float* out );
+
+    //! Sums used to calculate the common mode of a frame or of a row
+    /*! Pixels whose pedestal subtracted signal is above @c hitCut
+     *  times their noise are counted as hits, the signal of good
+     *  pixels which are not hits is summed.
+     *
+     *  @param pixelSum sum of the signal of the good, non hit pixels
+     *  @param nGood number of good, non hit pixels
+     *  @param nHit number of hit pixels
+     */
+    static void commonModeSums( const short* raw, const float* pedestal, const float* noise,
+                                const short* status, size_t n, double hitCut,
+                                double& pixelSum, int& nGood, int& nHit );
+
+  private:
+    //! Seed candidates of the current frame as (signal, index) heap
+    std::vector< std::pair<float, unsigned int> > _candidates;
+
+    //! Selected pixel indices of the current frame
+    std::vector<unsigned int> _indices;
+
+    //! Threshold mask of the current frame
+    std::vector<unsigned char> _mask;
+  };
+
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELNOISYPIXELMASK_H
+#define EUTELNOISYPIXELMASK_H 1
+
+// lcio includes <.h>
+#include <LCIOTypes.h>
+#include <EVENT/LCEvent.h>
+#include <EVENT/LCCollection.h>
+
+// system includes <>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Noisy pixel mask of all sensors
+  /*! The noisy pixels of each sensor are stored in a dense bitset
+   *  covering the pixel range of the sensor's noisy pixels, so that
+   *  testing a pixel is a bounds check and a bit lookup. Pixels
+   *  outside the range are never noisy.
+   *
+   *  The mask is filled from a noisy pixel DB collection (one
+   *  TrackerData of sparse pixels per sensor, as written by
+   *  EUTelProcessorNoisyPixelFinder). getShared() keeps one mask per
+   *  collection name for the whole job, so that all processors using
+   *  the same collection share a single copy, loaded once.
+   */
+  class EUTelNoisyPixelMask {
+
+  public:
+    //! Default constructor, no noisy pixels
+    EUTelNoisyPixelMask();
+
+    //! Mask of a noisy pixel collection, loaded on the first call
+    /*! @return NULL if the collection is not in the event
+     */
+    static const EUTelNoisyPixelMask* getShared( EVENT::LCEvent* event, const std::string& collectionName );
+
+    //! Removes all noisy pixels
+    void clear();
+
+    //! Adds all noisy pixels of a noisy pixel DB collection
+    void load( EVENT::LCCollection* collection );
+
+    //! Adds the noisy pixels of a sensor
+    /*! @param sensorID the sensor
+     *  @param data sparse pixel data, x and y are the first two of
+     *  @c stride values per pixel
+     *  @param stride number of values per pixel
+     */
+    void addPixels( int sensorID, const EVENT::FloatVec& data, unsigned int stride );
+
+    //! Adds the noisy pixels of a sensor given by their coordinates
+    void addPixels( int sensorID, const std::vector<int>& x, const std::vector<int>& y );
+
+    //! True if no sensor has noisy pixels
+    bool empty() const { return _sensors.empty(); }
+
+    //! Number of noisy pixels of a sensor
+    size_t getNNoisyPixels( int sensorID ) const;
+
+    //! True if the pixel is noisy
+    bool isNoisy( int sensorID, int x, int y ) const {
+      const SensorMask* mask = getSensorMask( sensorID );
+      return mask != NULL && mask->test( x, y ) != 0;
+    }
+
+    //! True if any pixel of a sparse pixel buffer is noisy
+    /*! The pixels are tested without branches and without stopping
+     *  at the first noisy one, which for the few pixels of a cluster
+     *  is faster than an early exit.
+     *
+     *  @param sensorID the sensor of the cluster
+     *  @param data sparse pixel data, x and y are the first two of
+     *  @c stride values per pixel
+     *  @param stride number of values per pixel
+     */
+    bool anyNoisy( int sensorID, const EVENT::FloatVec& data, unsigned int stride ) const;
+
+    //! True if any pixel with xMin <= x <= xMax and yMin <= y <= yMax is noisy
+    bool anyNoisy( int sensorID, int xMin, int xMax, int yMin, int yMax ) const;
+
+  private:
+    //! Bitset of one sensor
+    struct SensorMask {
+      SensorMask() : width( 0 ), height( 0 ), nPixels( 0 ), bits() { }
+
+      //! Bit of the pixel, 0 outside the covered range
+      unsigned long long test( int x, int y ) const {
+        const bool inside = static_cast< unsigned int >( x ) < width && static_cast< unsigned int >( y ) < height;
+        const size_t index = inside ? static_cast< size_t >( y ) * width + x : 0;
+        return ( bits[ index >> 6 ] >> ( index & 63 ) ) & static_cast< unsigned long long >( inside );
+      }
+
+      unsigned int width;
+      unsigned int height;
+      size_t nPixels;
+      std::vector<unsigned long long> bits;
+    };
+
+    //! Mask of a sensor, NULL if it has no noisy pixels
+    const SensorMask* getSensorMask( int sensorID ) const {
+      std::map<int, SensorMask>::const_iterator iter = _sensors.find( sensorID );
+      return iter != _sensors.end() ? &iter->second : NULL;
+    }
+
+    std::map<int, SensorMask> _sensors;
+  };
+
+}
+#endif
@@ -0,0 +1,149 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELPEDESTALNOISEUPDATER_H
+#define EUTELPEDESTALNOISEUPDATER_H 1
+
+// system includes <>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace eutelescope {
+
+  //! History of fixed capacity, the oldest entry is overwritten
+  template <class T>
+  class EUTelRingBuffer {
+
+  public:
+    //! Empty buffer holding at most capacity entries
+    explicit EUTelRingBuffer( size_t capacity = 0 ) : _data(), _capacity( capacity ), _next( 0 ) {
+      _data.reserve( capacity );
+    }
+
+    //! Adds an entry, replacing the oldest one if the buffer is full
+    void push( const T& value ) {
+      if ( _capacity == 0 ) return;
+      if ( _data.size() < _capacity ) _data.push_back( value );
+      else _data[_next] = value;
+      _next = ( _next + 1 ) % _capacity;
+    }
+
+    //! Number of entries
+    size_t size() const { return _data.size(); }
+
+    //! Maximum number of entries
+    size_t capacity() const { return _capacity; }
+
+    //! Entry i, 0 is the oldest
+    const T& operator[]( size_t i ) const {
+      return _data.size() < _capacity ? _data[i] : _data[ ( _next + i ) % _capacity ];
+    }
+
+  private:
+    std::vector<T> _data;
+    size_t _capacity;
+    size_t _next;
+  };
+
+  //! Fixed weight update of pedestal and noise
+  /*! With the weight w the pedestal and noise of each good pixel are
+   *  updated with the raw signal s as
+   *
+   *  ped = ( (w-1) ped + s ) / w
+   *  noise = sqrt( ( (w-1) noise^2 + (s - ped)^2 ) / w )
+   *
+   *  The two weights are computed once, the update runs in place over
+   *  the contiguous arrays of a sensor. Pixels which are not good are
+   *  masked with a select instead of a branch, so that the loop has no
+   *  control flow.
+   */
+  class EUTelPedestalNoiseUpdater {
+
+  public:
+    //! Updater with the given fixed weight
+    explicit EUTelPedestalNoiseUpdater( int fixedWeight = 100 );
+
+    //! Sets the fixed weight and precomputes the update weights
+    void setFixedWeight( int fixedWeight );
+
+    //! The fixed weight
+    int getFixedWeight() const { return _fixedWeight; }
+
+    //! Updates n pixels in place
+    /*! @param adc raw signals
+     *  @param status pixel status, only GOODPIXEL pixels are updated
+     *  @param pedestal pedestals, updated
+     *  @param noise noises, updated
+     *  @param n number of pixels
+     */
+    void update( const short* adc, const short* status, float* pedestal, float* noise, size_t n ) const;
+
+  private:
+    int _fixedWeight;
+
+    //! ( w - 1 ) / w
+    float _oldWeight;
+
+    //! 1 / w
+    float _newWeight;
+  };
+
+  //! Drift statistics of one sensor region at one update
+  struct EUTelPedestalDrift {
+    //! Event of the update
+    int event;
+
+    //! Mean pedestal minus the mean pedestal of the first update
+    float pedestalShift;
+
+    //! Mean noise
+    float meanNoise;
+
+    //! Number of good pixels
+    int nGood;
+  };
+
+  //! Pedestal drift monitoring per sensor region
+  /*! Each sensor is split into regions of consecutive pixels (rows for
+   *  the usual pixel ordering). At every fill the mean pedestal shift
+   *  and mean noise of the good pixels of each region are added to a
+   *  ring buffer of fixed capacity, so that the memory does not grow
+   *  with the run length.
+   */
+  class EUTelPedestalDriftMonitor {
+
+  public:
+    //! Monitor with nRegions regions per sensor and capacity entries per region
+    EUTelPedestalDriftMonitor( size_t nRegions = 1, size_t capacity = 1000 );
+
+    //! Adds the statistics of all regions of a sensor
+    void fill( int sensorID, int event, const short* status, const float* pedestal, const float* noise, size_t n );
+
+    //! Number of monitored sensors
+    size_t getNSensors() const { return _history.size(); }
+
+    //! Writes all entries, one line per sensor, region and update
+    /*! Columns: sensorID region event pedestalShift meanNoise nGood
+     */
+    void write( std::ostream& os ) const;
+
+  private:
+    size_t _nRegions;
+    size_t _capacity;
+
+    //! Mean pedestal of the first fill, per sensor and region
+    std::map< int, std::vector<float> > _reference;
+
+    //! History per sensor and region
+    std::map< int, std::vector< EUTelRingBuffer<EUTelPedestalDrift> > > _history;
+  };
+
+}
+#endif
@@ -0,0 +1,153 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELPLANEALIGNMENTLSQ_H
+#define EUTELPLANEALIGNMENTLSQ_H 1
+
+// system includes <>
+#include <cstddef>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Least squares alignment of one plane against predicted positions
+  /*! The measured hit (X, Y) of the plane to be aligned is transformed
+   *  with two offsets and three rotation angles
+   *
+   *  x = cos(ty)cos(tz) X + ( -sin(tx)sin(ty)cos(tz) + cos(tx)sin(tz) ) Y + off_x
+   *  y = -cos(ty)sin(tz) X + ( sin(tx)sin(ty)sin(tz) + cos(tx)cos(tz) ) Y + off_y
+   *
+   *  and compared with the predicted position (px, py). The fit
+   *  minimises chi2 = sum( (x-px)^2 + (y-py)^2 ) / 100, the same
+   *  objective as the MINUIT fit of EUTelAlign, optionally only over
+   *  the hits with a contribution below a cut.
+   *
+   *  Since the transformation is linear in the offsets and, for small
+   *  angles, in the angles, the minimum is found by Gauss-Newton
+   *  iterations on the analytic normal equations, usually in very few
+   *  steps. Per iteration the hits are visited once: they are stored
+   *  as structure of arrays and only the moments of the hit positions
+   *  and residuals enter the 5x5 normal matrix. A step which increases
+   *  the chi2 is halved, so also large rotations converge.
+   *
+   *  Parameters which are not constrained by the data (like tx and ty
+   *  at zero angles, where they enter only quadratically) are kept at
+   *  their current value and get an error of zero.
+   */
+  class EUTelPlaneAlignmentLSQ {
+
+  public:
+    //! Fit parameters
+    enum Parameter {
+      kOffX,
+      kOffY,
+      kThetaX,
+      kThetaY,
+      kThetaZ,
+      NPARAMETERS
+    };
+
+    //! Default constructor
+    EUTelPlaneAlignmentLSQ();
+
+    //! Removes all hits
+    void clear();
+
+    //! Adds a measured hit and the corresponding predicted position
+    void addHit( double measuredX, double measuredY, double predictedX, double predictedY );
+
+    //! Number of hits
+    size_t size() const { return _measuredX.size(); }
+
+    //! Measured X of hit i
+    double getMeasuredX( size_t i ) const { return _measuredX[i]; }
+
+    //! Measured Y of hit i
+    double getMeasuredY( size_t i ) const { return _measuredY[i]; }
+
+    //! Predicted X of hit i
+    double getPredictedX( size_t i ) const { return _predictedX[i]; }
+
+    //! Predicted Y of hit i
+    double getPredictedY( size_t i ) const { return _predictedY[i]; }
+
+    //! Transforms a measured position with the given parameters
+    static void transform( const double* par, double measuredX, double measuredY, double& x, double& y );
+
+    //! Chi2 of the hits for the given parameters
+    /*! Only hits with a contribution smaller than @c cut are summed,
+     *  a cut of zero sums all hits.
+     */
+    double chi2( const double* par, double cut ) const;
+
+    //! Offsets with fixed angles
+    /*! Sets the offsets of @c par to the mean difference of predicted
+     *  and transformed measured positions of all hits.
+     */
+    void fitOffsets( double* par ) const;
+
+    //! Full fit
+    /*! Starts with the offsets only, then fits all parameters using
+     *  all hits. If @c cut is positive, the hits with a contribution
+     *  above the cut are removed and the fit is repeated until the
+     *  hit selection is stable.
+     *
+     *  @param start start values of the NPARAMETERS parameters
+     *  @param cut chi2 cut per hit, zero for no cut
+     *  @param maxIterations maximum number of Gauss-Newton iterations
+     *  per selection, and maximum number of selections
+     *  @return true if the fit converged
+     */
+    bool fit( const double* start, double cut, int maxIterations );
+
+    //! Fitted parameter
+    double getParameter( int i ) const { return _par[i]; }
+
+    //! Error of a fitted parameter
+    double getError( int i ) const { return _err[i]; }
+
+    //! Offsets of the first (offsets only) step of fit()
+    double getSimpleOffset( int i ) const { return _simpleOffset[i]; }
+
+    //! Chi2 of the last fit, over the used hits
+    double getChi2() const { return _chi2; }
+
+    //! Number of hits used in the last fit
+    size_t getNUsed() const { return _nUsed; }
+
+    //! Number of Gauss-Newton iterations of the last fit
+    int getNIterations() const { return _nIterations; }
+
+  private:
+    //! Gauss-Newton iterations over the selected hits
+    bool iterate( int maxIterations );
+
+    //! Selects the hits with a chi2 contribution below cut
+    /*! @return true if the selection changed
+     */
+    bool select( double cut );
+
+    //! Measured and predicted positions of all hits
+    std::vector<double> _measuredX;
+    std::vector<double> _measuredY;
+    std::vector<double> _predictedX;
+    std::vector<double> _predictedY;
+
+    //! 1 for the hits used in the fit, 0 otherwise
+    std::vector<double> _used;
+
+    double _par[NPARAMETERS];
+    double _err[NPARAMETERS];
+    double _simpleOffset[2];
+    double _chi2;
+    size_t _nUsed;
+    int _nIterations;
+  };
+
+}
+#endif
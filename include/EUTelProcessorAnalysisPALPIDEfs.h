@@ -23,6 +23,7 @@
 #include "TProfile2D.h"
 #include "cluster.h"
 #include "CrossSection.hpp"
+#include "EUTelNoisyPixelMask.h"
 
 class EUTelProcessorAnalysisPALPIDEfs : public marlin::Processor {
 public:
@@ -210,6 +211,12 @@ private:
   TH1I* nTrackPerEventHisto;
   TH1I* nClusterAssociatedToTrackPerEventHisto;
   TH1I* nClusterPerEventHisto;
+  //! Hot pixels of all sensors, shared with the other processors using the collection
+  const eutelescope::EUTelNoisyPixelMask* _hotPixelMask;
+  //! Sensor of the hot pixel data of the DUT layer
+  int _hotPixelSensorID;
+  //! Pixels of the noise mask file
+  eutelescope::EUTelNoisyPixelMask _noiseMask;
 };
 
 #endif
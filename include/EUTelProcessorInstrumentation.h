@@ -0,0 +1,125 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELPROCESSORINSTRUMENTATION_H
+#define EUTELPROCESSORINSTRUMENTATION_H 1
+
+// eutelescope includes ".h"
+#include "EUTelInstrumentation.h"
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+
+// AIDA includes <.h>
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+#include <AIDA/IHistogram1D.h>
+#include <AIDA/IProfile1D.h>
+#endif
+
+// system includes <>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Reports the cost of each EUTelescope processor of the job
+  /*! Enables EUTelInstrumentation, so that every EUTelescope
+   *  processor measures its wall and CPU time, the collections it
+   *  adds to the event and optionally its heap growth, see there.
+   *
+   *  For each processor two histograms are booked, the per event
+   *  wall time and the wall time versus the occupancy of the event.
+   *  The occupancy is the number of elements (hits, clusters, ...)
+   *  of the OccupancyCollectionName collection per plane, counting
+   *  every plane seen in that collection so far.
+   *
+   *  At end() a table is printed and a JSON summary written. It also
+   *  contains the total time of the event loop, so that the time
+   *  spent outside of the EUTelescope processors (reading, writing,
+   *  other Marlin processors) can be read off.
+   *
+   *  The processor should be the last one of the steering file, so
+   *  that it sees the measurements of all other processors of an
+   *  event and the final occupancy collection.
+   *
+   *  @param SamplingInterval Measure only every n-th event
+   *  @param MemoryStatistics Record heap growth and page faults
+   *  @param OccupancyCollectionName Collection defining the occupancy
+   *  @param MaxOccupancy Upper edge of the occupancy axis
+   *  @param SummaryFileName JSON summary, empty for none
+   */
+  class EUTelProcessorInstrumentation : public marlin::Processor {
+
+  public:
+    //! Returns a new instance of EUTelProcessorInstrumentation
+    virtual Processor* newProcessor() {
+      return new EUTelProcessorInstrumentation;
+    }
+
+    //! Default constructor
+    EUTelProcessorInstrumentation();
+
+    //! Enables the instrumentation
+    virtual void init();
+
+    //! Fills the histograms with the measurements of this event
+    virtual void processEvent( LCEvent* evt );
+
+    //! Prints and writes the summary
+    virtual void end();
+
+  protected:
+    //! Number of elements per plane of the occupancy collection
+    double getOccupancy( LCEvent* evt );
+
+    //! Fills the histograms with all pending measurements
+    void fillHistograms();
+
+    //! Writes the JSON summary
+    void writeSummary( double loopWallTime, double loopCpuTime ) const;
+
+    int _samplingInterval;
+    bool _memoryStatistics;
+    std::string _occupancyCollectionName;
+    float _maxOccupancy;
+    std::string _summaryFileName;
+
+    //! Planes seen in the occupancy collection
+    std::set<int> _planes;
+
+    //! Occupancy of the current and the previous event
+    int _eventNumber;
+    double _occupancy;
+    int _previousEventNumber;
+    double _previousOccupancy;
+
+    //! Start of the event loop, taken at init()
+    std::chrono::steady_clock::time_point _loopWallStart;
+    std::clock_t _loopCpuStart;
+
+    std::vector<EUTelInstrumentation::Measurement> _measurements;
+
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+    //! Histograms of each processor
+    std::map<const EUTelInstrumentation::ProcessorStats*, AIDA::IHistogram1D*> _wallTimeHistos;
+    std::map<const EUTelInstrumentation::ProcessorStats*, AIDA::IProfile1D*> _wallTimeVsOccupancyHistos;
+#endif
+  };
+
+  //! A global instance of the processor
+  EUTelProcessorInstrumentation gEUTelProcessorInstrumentation;
+
+}
+#endif
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTelEventImpl.h"
 #include "EUTelGenericSparsePixel.h"
+#include "EUTelNoisyPixelMask.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -102,10 +103,6 @@ class EUTelProcessorNoisyClusterMasker : public marlin::Processor {
 
 	void readNoisyPixelList (LCEvent * event); 
 
-	//! Encoding function to encode the two pixel indices in a unique way
-	/*! Uses Cantor's pairing function */ 
-	inline int encode (int X, int Y); 
-
 	//! Input collection name for data	
 	std::string _inputCollectionName;
 
@@ -142,8 +139,8 @@ class EUTelProcessorNoisyClusterMasker : public marlin::Processor {
 	/*! False is everything is OK, true otherwise */
 	bool  _wrongDataFormat;
 
-	//! Map linking the noise vectors of each plane to the plane ID
-	std::map<int, std::vector<int> > _noisyPixelMap;
+	//! Noisy pixels of all planes, shared with the other processors using the collection
+	const EUTelNoisyPixelMask* _noisyPixelMask;
 
 	//! Map counting the removed hot pixels per plane
 	std::map<int, int> _maskedNoisyClusters;
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTelEventImpl.h"
 #include "EUTelGenericSparsePixel.h"
+#include "EUTelHitMapAccumulator.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -65,6 +66,16 @@ struct sensor {
  *  @param ExcludedPlanes Planes to be excluded from processing
  *
  *  @param HotPixelCollectionName The name of the collection in the output file
+ *
+ *  @param CheckpointFile Binary file the accumulated hit maps are written to
+ *  at the end of the job (and periodically, see CheckpointEveryNEvents)
+ *
+ *  @param CheckpointEveryNEvents Also write the checkpoint every n-th event,
+ *  0 disables periodic checkpoints
+ *
+ *  @param InputCheckpoints Checkpoint files from previous run segments which
+ *  are merged before processing; their events count towards NoOfEvents, so a
+ *  job reading no events at all can produce the DB from the merged segments
  */
 class EUTelProcessorNoisyPixelFinder : public marlin::Processor {
 
@@ -190,13 +201,11 @@ protected:
      */
     std::map<int, sensor> _sensorMap;
 
-    //! Map holding the 2D-"array" which counts the hits
-    /*! The key is the sensorID and the array is implemented as
-     *  a vector of vectors. They are resized initially so there 
-     *  is no real overhead with using std::vectors instead of
-     * arrays.
-     */
-    std::map<int, std::vector<std::vector<int>>> _hitVecMap;
+    //! Per-pixel hit counters of all sensors
+    EUTelHitMapAccumulator _hitMaps;
+
+    //! Number of charge values per sparse pixel, by sparse pixel type
+    std::map<int, unsigned int> _pixelStrideMap;
     
     //! Map for storing the hot pixels in a std::vector as a value
     /*! The key is once again the sensorID.
@@ -223,9 +232,21 @@ protected:
     //! Hot Pixel DB output file
     std::string _noisyPixelDBFile;
 
+    //! Hit map checkpoint output file
+    std::string _checkpointFile;
+
+    //! Write the checkpoint every n-th event
+    int _checkpointEveryNEvents;
+
+    //! Hit map checkpoints to be merged at init
+    std::vector<std::string> _inputCheckpoints;
+
     //! write out the list of hot pixels
     void noisyPixelDBWriter();
 
+    //! apply the firing frequency cut and write DB and histograms
+    void findNoisyPixels();
+
     //! Flag which will be set once we're done finding noisy pixels
     bool _finished;
 };
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTelEventImpl.h"
 #include "EUTelGenericSparsePixel.h"
+#include "EUTelNoisyPixelMask.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -181,11 +182,8 @@ protected:
      */
     std::vector<int> _sensorIDVec;
 
-	int cantorEncode(int x, int y);
-
-	void initialiseNoisyPixels( LCCollectionVec* const);
-
-	std::map<int, std::vector<int>> _noisyPixelVecMap;
+	//! Noisy pixels of all planes, shared with the other processors using the collection
+	const EUTelNoisyPixelMask* _noisyPixelMask;
 };
 
 //! A global instance of the processor
@@ -66,6 +66,10 @@ namespace eutelescope {
 		AIDA::IHistogram1D * _beamEnergy;
 		AIDA::IProfile1D *_pValueVsBeamEnergy;
         std::string _histoInfoFileName;
+		//! Tracks of the current event, kept to reuse their memory
+		std::vector<EUTelTrack> _tracks;
+		//! p-values of _tracks
+		std::vector<float> _pValues;
 	};
 
     EUTelProcessorTrackAnalysis gEUTelProcessorTrackAnalysis;
@@ -26,25 +26,72 @@
 #include "marlin/Processor.h"
 #include "marlin/VerbosityLevels.h"
 
+#include <vector>
 
+namespace eutelescope {
 
+	//! Read access to the tracks of one packed track record
+	/*! The record is a single LCGenericObject per event. Its int
+	 *  values hold the structure, its float values the track, state
+	 *  and hit parameters:
+	 *
+	 *  ints:   version, nTracks, then per track nStates followed by
+	 *          (location, dimension, hasHit, hitID) per state
+	 *  floats: per track chi2, ndf, variance; per state momentum
+	 *          (3), arc length, local position (3), kinks (2), radiation
+	 *          fractions air and sensor, kinks of both media (2+2) and,
+	 *          if the state has a hit, the hit position (3)
+	 *
+	 *  The view only scans the int values to locate the tracks; an
+	 *  EUTelTrack is decoded straight from the generic object when it
+	 *  is requested.
+	 */
+	class EUTelPackedTracks {
+		public:
+			//! Version of the record layout written by EUTelReaderGenericLCIO
+			static const int VERSION = 1;
+			static const int NTRACKFLOATS = 3;
+			static const int NSTATEFLOATS = 15;
+			static const int NHITFLOATS = 3;
+			static const int NSTATEINTS = 4;
 
+			EUTelPackedTracks();
+			explicit EUTelPackedTracks(const EVENT::LCGenericObject* record);
 
+			//! Number of tracks in the record
+			size_t size() const { return _intOffsets.size(); }
+			//! Number of states of track i, without decoding it
+			int getNStates(size_t i) const;
+			//! Decodes track i
+			EUTelTrack getTrack(size_t i) const;
+			//! Decodes track i into an existing track, reusing its state memory
+			void getTrack(size_t i, EUTelTrack& track) const;
 
-
-
-
-
-
-namespace eutelescope {
+		private:
+			const EVENT::LCGenericObject* _record;
+			//! First int and float value of every track
+			std::vector<int> _intOffsets;
+			std::vector<int> _floatOffsets;
+	};
 
 	class  EUTelReaderGenericLCIO{
 		public: 
 			EUTelReaderGenericLCIO();
-            void getColVec( std::vector<EUTelTrack> tracks,LCEvent* evt,std::string colName );
+            //! Stores the tracks as one packed record in collection "PackedTracksFOR"+colName
+            void getColVec( const std::vector<EUTelTrack>& tracks,LCEvent* evt,std::string colName );
+            //! Returns the tracks of colName, packed or in the old generic object format
             std::vector<EUTelTrack> getTracks( LCEvent* evt, std::string colName);
+            //! As above, filling a vector kept by the caller between events
+            /*! Tracks already in the vector are overwritten in place, so
+             *  once the vector has grown to the typical event size no
+             *  memory is allocated for tracks or states any more.
+             */
+            void getTracks( LCEvent* evt, std::string colName, std::vector<EUTelTrack>& tracks);
+            //! Returns a lazy view of packed tracks, empty if colName was not stored packed
+            EUTelPackedTracks getPackedTracks( LCEvent* evt, std::string colName);
 
   	private:
+            std::vector<EUTelTrack> getTracksFromGenericObjects( LCEvent* evt, std::string colName);
 	};
 
 }
@@ -15,17 +15,22 @@
 
 namespace eutelescope {
 
+	//! Track state on one plane
+	/*! All members are stored inline (the kinks as plain arrays), so a
+	 *  state holds no heap memory and is copied or moved with a plain
+	 *  member-wise copy.
+	 */
 	class  EUTelState{
 		public: 
 			EUTelState();
 			EUTelState(EUTelState *state);
 			//getters
-			EUTelHit getHit();
+			const EUTelHit& getHit() const;
 			int getDimensionSize() const ;
 			int	getLocation() const;
 			TMatrixDSym getStateCov() const;
-			TVectorD getStateVec();
-            TVector3 getMomLocal();
+			TVectorD getStateVec() const;
+            TVector3 getMomLocal() const;
 			float getMomLocalX() const {return _momLocalX;}
 			float getMomLocalY() const {return _momLocalY;}
 			float getMomLocalZ() const {return _momLocalZ;}
@@ -37,24 +42,28 @@ namespace eutelescope {
 			void getCombinedHitAndStateCovMatrixInLocalFrame(double (&cov)[4]) const;
 			bool getStateHasHit() const;
 			TMatrixD getProjectionMatrix() const;
-			TVector3 getIncidenceUnitMomentumVectorInLocalFrame();
-			TMatrixDSym getScatteringVarianceInLocalFrame();
-			TMatrixDSym getScatteringVarianceInLocalFrame(float variance);
+			TVector3 getIncidenceUnitMomentumVectorInLocalFrame() const;
+			TMatrixDSym getScatteringVarianceInLocalFrame() const;
+			TMatrixDSym getScatteringVarianceInLocalFrame(float variance) const;
 			TVectorD getKinks() const;
 			TVectorD getKinksMedium1() const;
 			TVectorD getKinksMedium2() const;
+			//! Kink component i (0: d(dx/dz), 1: d(dy/dz)) without creating a TVectorD
+			double getKink(int i) const { return _kinks[i]; }
+			double getKinkMedium1(int i) const { return _kinksMedium1[i]; }
+			double getKinkMedium2(int i) const { return _kinksMedium2[i]; }
 			double getRadFracAir() const ;
 			double getRadFracSensor() const ;
 			//setters
-            void setHit(EUTelHit hit);
+            void setHit(const EUTelHit& hit);
             void setHit(EVENT::TrackerHit* hit);
 			void setDimensionSize(int dimension);
 			void setLocation(int location);
 			void setMomLocalX(float momX);
 			void setMomLocalY(float momY);
 			void setMomLocalZ(float momZ);
-			void setLocalMomentumGlobalMomentum(TVector3 momentumIn);
-            void setTrackFromLCIOVec(std::vector<double> input);
+			void setLocalMomentumGlobalMomentum(const TVector3& momentumIn);
+            void setTrackFromLCIOVec(const std::vector<double>& input);
             //!Template input for setting local position of hit  
             /*!
              * @param position of hit on plane
@@ -63,11 +72,14 @@ namespace eutelescope {
 			void setPositionLocal(double position[]);
 			void setPositionGlobal(float positionGlobal[]);
 			void setCombinedHitAndStateCovMatrixInLocalFrame(double cov[4]);
-			void setStateUsingCorrection(TVectorD stateVec);
+			void setStateUsingCorrection(const TVectorD& stateVec);
 			void setArcLengthToNextState(float arcLength){_arcLength = arcLength;} 
-			void setKinks(TVectorD kinks);
-			void setKinksMedium1(TVectorD kinks);
-			void setKinksMedium2(TVectorD kinks);
+			void setKinks(const TVectorD& kinks);
+			void setKinksMedium1(const TVectorD& kinks);
+			void setKinksMedium2(const TVectorD& kinks);
+			void setKinks(double kinkX, double kinkY);
+			void setKinksMedium1(double kinkX, double kinkY);
+			void setKinksMedium2(double kinkX, double kinkY);
 			void setRadFrac(double plane, double air);
 
 			//initialise
@@ -83,9 +95,12 @@ namespace eutelescope {
             int _location; 
             float _position[3];
             bool _stateHasHit;
-            TVectorD _kinks;
-            TVectorD _kinksMedium1;
-            TVectorD _kinksMedium2;
+            //! Kinks as plain arrays rather than Eigen::Vector2d: fixed size, vectorisable
+            //! Eigen 2 types need 16 byte alignment, which std::vector<EUTelState> and the
+            //! classes holding states do not guarantee without aligned allocators throughout
+            double _kinks[2];
+            double _kinksMedium1[2];
+            double _kinksMedium2[2];
             float _momLocalX;
             float _momLocalY;
             float _momLocalZ; 
@@ -94,13 +109,13 @@ namespace eutelescope {
             float _arcLength;
 
 			//print
-			void print();
+			void print() const;
             //clear
             void clear();
 
-			bool operator<(const EUTelState compareState ) const;
-			bool operator==(const EUTelState compareState ) const;
-			bool operator!=(const EUTelState compareState ) const;
+			bool operator<(const EUTelState& compareState ) const;
+			bool operator==(const EUTelState& compareState ) const;
+			bool operator!=(const EUTelState& compareState ) const;
 
   	private:
 			float _covCombinedMatrix[4];
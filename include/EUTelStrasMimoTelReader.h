@@ -55,6 +55,14 @@ namespace eutelescope {
    *
    *   @param CDSCollectionName Name of the CDS collection
    *
+   *   @param WriteFrames Also write the frame 0 and frame 1
+   *   collections, by default only the CDS is written
+   *
+   *   The data files are mapped in memory and the CDS of each sensor
+   *   is computed in a single pass over the mapped words, with the
+   *   sign correction for the rolling shutter position applied in the
+   *   same pass.
+   *
    *   @author  Antonio Bulgheroni, INFN <mailto:antonio.bulgheroni@gmail.com>
    *   @version $Id$
    *
@@ -88,7 +96,7 @@ namespace eutelescope {
     virtual void init ();
 
     //! End method
-    /*! It deletes the EUTelStrasMimoTelReader::_buffer array
+    /*! It prints only a goodbye message
      */
     virtual void end ();
 
@@ -345,13 +353,11 @@ namespace eutelescope {
 
   protected:
 
-    //! Data block
-    /*! This is used to read the data block in between the event
-     *  header and the trailer. It has a size that is variable and
-     *  defined once forever in the StrasRunHeader::DataSz.
-     *
-     */ 
-    int * _dataBuffer;
+    //! Write the frame collections
+    /*! If true, also the frame 0 and frame 1 collections are written
+     *  next to the CDS one.
+     */
+    bool _writeFrames;
 
     //! Input run number
     /*! This is the run number and it is read directly from the
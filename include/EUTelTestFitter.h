@@ -404,9 +404,21 @@ namespace eutelescope {
     /*! Fit track in two planes: XZ and YZ. When nominal position errors
      * are used, only one matrix equation has to be solved and the
      * inverse matrix can be applied to the second equation.
+     *
+     * The matrix then only depends on the planes used in the fit, so
+     * the inverse is kept for each plane pattern and the fit of a
+     * hit combination is a matrix times vector product.
      */
     double SingleFit();
 
+    //! Inverse fit matrix for the planes used in the current fit
+    /*! Returns the inverse matrix followed by the fitted position
+     * errors, as left by DoAnalFit, for the plane pattern of the
+     * current hit combination. The matrix is inverted only when the
+     * pattern is seen for the first time. NULL if the fit fails.
+     */
+    const double * GetSingleFitArray();
+
 
     //! Find track in all planes assuming nominal errors
     /*! Fit track in two planes: XZ and YZ. When nominal position errors
@@ -598,6 +610,15 @@ namespace eutelescope {
     double * _nominalFitArrayY ;
     double * _nominalErrorY ;
 
+    //! Inverse fit matrices and errors of SingleFit per plane pattern
+    std::map<unsigned int, std::vector<double> > _singleFitArrays ;
+    std::vector<double> _singleFitArrayBuffer ;
+
+    //! Work space of GaussjSolve
+    std::vector<int> _gaussjPivot ;
+    std::vector<int> _gaussjRow ;
+    std::vector<int> _gaussjColumn ;
+
     // few counter to show the final summary
 
     //! Number of event w/o input hit
@@ -20,7 +20,10 @@ namespace eutelescope {
 		public: 
 			EUTelTrack();
 			EUTelTrack( const EUTelTrack& track);
+			EUTelTrack( EUTelTrack&& track);
 			EUTelTrack( const EUTelTrack& track,bool);
+			EUTelTrack& operator=( const EUTelTrack& track);
+			EUTelTrack& operator=( EUTelTrack&& track);
 			//getters
             float getChi2() const ;
             float getNdf() const;
@@ -28,18 +31,22 @@ namespace eutelescope {
 			unsigned int getNumberOfHitsOnTrack() const;
             //Must return reference to change the contents.
 			std::vector<EUTelState>& getStates();
+			const std::vector<EUTelState>& getStates() const;
             std::vector<EUTelState> getStatesCopy() const;
             std::vector<double> getLCIOOutput();
 			//setters
-            void setState(EUTelState state);
-            void setStates(std::vector<EUTelState> states);
+            void setState(const EUTelState& state);
+            void setStates(const std::vector<EUTelState>& states);
+            void setStates(std::vector<EUTelState>&& states);
+            //! Resets the track keeping the memory of the state vector
+            void clear();
 			void setTotalVariance(double rad);
             void setChi2(float chi2);
             void setNdf(float nDF);
-            void setTrackFromLCIOVec(std::vector<double> input);
+            void setTrackFromLCIOVec(const std::vector<double>& input);
 
 			//print
-			void print();
+			void print() const;
             //
             std::vector<EUTelState> _states;
             double _var;
@@ -37,12 +37,16 @@ namespace eutelescope {
 
 		template<typename T>
 		std::string numberToString(T number);
-		void plotResidualVsPosition(EUTelTrack);
-		void plotBeamEnergy(EUTelTrack);
-		void plotIncidenceAngles(EUTelTrack track);
-		void plotPValueWithPosition(EUTelTrack track);
-		void plotPValueWithIncidenceAngles(EUTelTrack track);
-		void plotPValueVsBeamEnergy(EUTelTrack track);
+		void plotResidualVsPosition(const EUTelTrack& track);
+		void plotBeamEnergy(const EUTelTrack& track);
+		void plotIncidenceAngles(const EUTelTrack& track);
+		void plotPValueWithPosition(const EUTelTrack& track);
+		void plotPValueWithIncidenceAngles(const EUTelTrack& track);
+		void plotPValueVsBeamEnergy(const EUTelTrack& track);
+		//! Same as above, with the p-value of the track already calculated
+		void plotPValueWithPosition(const EUTelTrack& track, float pValue);
+		void plotPValueWithIncidenceAngles(const EUTelTrack& track, float pValue);
+		void plotPValueVsBeamEnergy(const EUTelTrack& track, float pValue);
 		void setBeamEnergy(AIDA::IHistogram1D *  beamEnergy){ _beamEnergy = beamEnergy; }
 		void setPValueBeamEnergy(AIDA::IProfile1D *  pValueVsBeamEnergy){ _pValueVsBeamEnergy = pValueVsBeamEnergy; }
 		void setSensorIDTo2DResidualHistogramX(std::map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramX){_mapFromSensorIDToHistogramX=mapFromSensorIDToHistogramX;}
@@ -57,7 +61,9 @@ namespace eutelescope {
 		AIDA::IHistogram1D * _beamEnergy;
 		AIDA::IProfile1D   * _pValueBeamEnergy;
 		AIDA::IProfile1D * _pValueVsBeamEnergy;
-		float calculatePValueForChi2(EUTelTrack track);
+		float calculatePValueForChi2(const EUTelTrack& track);
+		//! p-values of all tracks, e.g. of an event
+		void calculatePValuesForChi2(const std::vector<EUTelTrack>& tracks, std::vector<float>& pValues);
  //       std::string _histoInfoFileName;
 
 
@@ -0,0 +1,211 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELTUPLEWRITER_H
+#define EUTELTUPLEWRITER_H 1
+
+// system includes <>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TFile;
+class TTree;
+
+namespace eutelescope {
+
+  //! Buffered n-tuple writer with a background I/O thread
+  /*! Rows are not filled into the ROOT trees directly. Instead they
+   *  are collected in memory in columnar blocks, one contiguous array
+   *  per column (variable length columns are stored flat together
+   *  with the row offsets). Once a block holds RowsPerBlock rows it is
+   *  handed to a background thread which owns the TFile and the TTrees
+   *  and performs the filling, compression and disk I/O. The calling
+   *  thread only blocks when more than a few blocks are waiting to be
+   *  written.
+   *
+   *  All ROOT objects of the output file are created and accessed by
+   *  the writer thread only. With ROOT versions older than 6, which
+   *  are not thread safe, the blocks are written synchronously.
+   *
+   *  Columns which are not filled in a row are written as zero
+   *  (scalars) or empty (vectors).
+   *
+   *  \b Usage:
+   *  \code{.cpp}
+   *  EUTelTupleWriter writer;
+   *  size_t tree = writer.bookTree( "tracks", "tracks" );
+   *  size_t chi2 = writer.bookColumn( tree, "chi2", EUTelTupleWriter::kDouble );
+   *  writer.open( "NTuple.root" );
+   *  // for every row
+   *  writer.fill( tree, chi2, track->getChi2() );
+   *  writer.addRow( tree );
+   *  // at the end
+   *  writer.close();
+   *  \endcode
+   */
+  class EUTelTupleWriter {
+
+  public:
+    //! Column types
+    enum ColumnType {
+      kInt,
+      kLong,
+      kDouble,
+      kIntVector,
+      kDoubleVector
+    };
+
+    //! Default constructor
+    EUTelTupleWriter();
+
+    //! Destructor, closes the file if still open
+    ~EUTelTupleWriter();
+
+    //! Books a new tree, returns its handle
+    size_t bookTree( const std::string& name, const std::string& title );
+
+    //! Books a new column in a tree, returns its handle
+    size_t bookColumn( size_t tree, const std::string& name, ColumnType type );
+
+    //! Makes tree friend of tree, as TTree::AddFriend
+    void addFriend( size_t tree, size_t friendTree );
+
+    //! Sets the output options, to be called before open()
+    /*! @param compression ROOT compression setting of the file, a
+     *  negative value keeps the ROOT default
+     *  @param basketSize basket size of all branches in bytes, zero
+     *  keeps the ROOT default
+     *  @param rowsPerBlock number of rows collected before a block is
+     *  passed to the writer thread
+     *  @param async write in a background thread if possible
+     */
+    void setOptions( int compression, int basketSize, size_t rowsPerBlock, bool async );
+
+    //! Freezes the booking and opens the output file
+    void open( const std::string& fileName );
+
+    //! Checks whether the writer is open
+    bool isOpen() const { return _isOpen; }
+
+    //! Fills a scalar column of the current row
+    void fill( size_t tree, size_t column, int value );
+
+    //! Fills a scalar column of the current row
+    void fill( size_t tree, size_t column, long long value );
+
+    //! Fills a scalar column of the current row
+    void fill( size_t tree, size_t column, double value );
+
+    //! Fills a vector column of the current row
+    void fill( size_t tree, size_t column, const std::vector<int>& values );
+
+    //! Fills a vector column of the current row
+    void fill( size_t tree, size_t column, const std::vector<double>& values );
+
+    //! Finishes the current row of a tree
+    void addRow( size_t tree );
+
+    //! Total number of rows added to a tree
+    unsigned long getNRows( size_t tree ) const;
+
+    //! Writes all pending rows and closes the file
+    /*! Errors which occurred in the writer thread are re-thrown here
+     *  (or already from fill() / addRow()).
+     */
+    void close();
+
+  private:
+    //! Booking information of one column
+    struct ColumnSpec {
+      std::string name;
+      ColumnType type;
+    };
+
+    //! Booking information of one tree
+    struct TreeSpec {
+      std::string name;
+      std::string title;
+      std::vector<ColumnSpec> columns;
+      std::vector<size_t> friends;
+      unsigned long nRows;
+    };
+
+    //! Values of one column within a block
+    struct ColumnData {
+      std::vector<int> ints;
+      std::vector<long long> longs;
+      std::vector<double> doubles;
+      //! End of every row in the flat value arrays of vector columns
+      std::vector<size_t> offsets;
+    };
+
+    //! A block of rows of one tree
+    struct Block {
+      size_t tree;
+      size_t nRows;
+      std::vector<ColumnData> columns;
+    };
+
+    //! ROOT side state of one tree, owned by the writer thread
+    struct TreeOutput {
+      TTree* tree;
+      std::vector<int> ints;
+      std::vector<long long> longs;
+      std::vector<double> doubles;
+      std::vector< std::vector<int>* > intVectors;
+      std::vector< std::vector<double>* > doubleVectors;
+    };
+
+    ColumnData& columnData( size_t tree, size_t column, ColumnType type );
+    void padRow( Block& block );
+    void submit( Block& block );
+    void rethrowError();
+
+    void openFile();
+    void writeBlock( const Block& block );
+    void closeFile();
+    void writeLoop();
+
+    std::vector<TreeSpec> _trees;
+    std::vector<Block> _current;
+
+    int _compression;
+    int _basketSize;
+    size_t _rowsPerBlock;
+    bool _async;
+    bool _isOpen;
+    std::string _fileName;
+
+    //! Blocks waiting for the writer thread
+    std::deque<Block> _queue;
+
+    //! Written blocks kept to reuse their memory
+    std::vector<Block> _freeBlocks;
+
+    std::mutex _mutex;
+    std::condition_variable _queueChanged;
+    std::thread _thread;
+    bool _closing;
+    std::exception_ptr _error;
+
+    TFile* _file;
+    std::vector<TreeOutput> _outputs;
+
+    EUTelTupleWriter( const EUTelTupleWriter& );
+    EUTelTupleWriter& operator=( const EUTelTupleWriter& );
+  };
+
+}
+#endif
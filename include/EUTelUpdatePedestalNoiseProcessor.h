@@ -10,6 +10,7 @@
 #define EUTELUPDATEPEDESTALNOISEPROCESSOR 1
 
 // eutelescope includes ".h"
+#include "EUTelPedestalNoiseUpdater.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -60,7 +61,14 @@ namespace eutelescope {
    *  <code>P[i+1] = [(W - 1) / W] * P[i] + (1 / W) * D </code>. It
    *  looks like having a on-line average where the number of
    *  elements is kept constant to weight value. An analogous approach
-   *  is used for the noise calculation.
+   *  is used for the noise calculation. The update runs in place over
+   *  the pixel arrays of each sensor, see EUTelPedestalNoiseUpdater.
+   *
+   *  The drift of the pedestal is monitored per sensor region: at
+   *  every update the mean pedestal shift and mean noise of each
+   *  region are stored in a history of fixed length, which is written
+   *  to DriftMonitorFileName at the end of the job. Also the monitored
+   *  pixels keep only the last MonitorHistoryLength updates.
    *
    *  <h4>Input collections</h4>
    *
@@ -85,6 +93,10 @@ namespace eutelescope {
    *  @param UpdateAlgorithm name of the algorithm to be used
    *  @param UpdateFrequency update frequency in events
    *  @param FixedWeightValue the value of the fixed weight
+   *  @param PixelMonitored pixel to be monitored (detectorID, xCoord, yCoord)
+   *  @param MonitorHistoryLength number of updates kept per monitored pixel and region
+   *  @param DriftMonitorRegions number of regions per sensor for the drift monitoring
+   *  @param DriftMonitorFileName output file of the drift monitoring, empty for none
    *
    *  @author Antonio Bulgheroni, INFN <mailto:antonio.bulgheroni@gmail.com>
    *  @version $Id$
@@ -263,21 +275,38 @@ namespace eutelescope {
      */
     IntVec _monitoredPixel;
 
+    //! Detector and pixel index of each monitored pixel
+    /*! Computed from _monitoredPixel on the first event, so that the
+     *  monitoring does not decode the cell IDs at every update.
+     */
+    std::vector< std::pair<int, int> > _monitoredPixelIndex;
+
     //! Pedestal monitor
-    /*! This is a vector of float vectors. There is a FloatVec for
-     *  each monitored pixels and the size of this FloatVec is equal
-     *  to the number of times the update pedestal algorithm has been
-     *  called + 1.
+    /*! There is a history for each monitored pixel holding the value
+     *  at the last _monitorHistoryLength updates.
      */
-    std::vector<FloatVec > _monitoredPixelPedestal;
+    std::vector< EUTelRingBuffer<float> > _monitoredPixelPedestal;
 
     //! Noise monitor
-    /*! This is a vector of float vectors. There is a FloatVec for
-     *  each monitored pixels and the size of this FloatVec is equal
-     *  to the number of times the update pedestal algorithm has been
-     *  called + 1.
+    /*! There is a history for each monitored pixel holding the value
+     *  at the last _monitorHistoryLength updates.
      */
-    std::vector<FloatVec > _monitoredPixelNoise;
+    std::vector< EUTelRingBuffer<float> > _monitoredPixelNoise;
+
+    //! Number of updates kept in the monitoring histories
+    int _monitorHistoryLength;
+
+    //! Number of regions per sensor for the drift monitoring
+    int _driftMonitorRegions;
+
+    //! Output file of the drift monitoring
+    std::string _driftMonitorFileName;
+
+    //! In place pedestal and noise update
+    EUTelPedestalNoiseUpdater _updater;
+
+    //! Pedestal drift per sensor region
+    EUTelPedestalDriftMonitor _driftMonitor;
 
     //! Update frequency
     /*! This is an integer number representing how often this
@@ -188,6 +188,9 @@ namespace eutelescope {
 	std::unique_ptr<EUTelTrackerDataInterfacer> getSparseData(IMPL::TrackerDataImpl* const data, SparsePixelType type);
 	std::unique_ptr<EUTelTrackerDataInterfacer> getSparseData(IMPL::TrackerDataImpl* const data, int type);
 
+        /** Number of charge values stored per sparse pixel of the given type */
+        unsigned int getSparsePixelNoOfElements(SparsePixelType type);
+
         std::map<std::string, bool > FillHotPixelMap(EVENT::LCEvent *event, const std::string& hotPixelCollectionName);
 
         bool HitContainsHotPixels(const IMPL::TrackerHitImpl * hit, const std::map<std::string, bool >& hotPixelMap);
@@ -381,6 +381,204 @@ def submitLXPLUS(filenamebase, jobtask, bsubfile, runnr):
         exit(1)
     return 0
 
+# Processors writing results of the whole run at the end of the job (alignment constants, pede steering
+# files, noisy pixel databases, pedestals, ...). Run by every shard they would overwrite each other's
+# output with results of a part of the run only, so steering files containing them are not sharded.
+# The parameters listed are those naming the affected outputs, for the error message.
+JOBLEVELOUTPUTS = {
+    "EUTelProcessorNoisyPixelFinder": ["HotPixelDBFile", "CheckpointFile"],
+    "EUTelProcessorDeadColumnFinder": ["DeadColumnFileName"],
+    "EUTelPreAlign": ["AlignmentConstantLCIOFile"],
+    "EUTelMille": ["AlignmentConstantLCIOFile", "PedeSteerfileName"],
+    "EUTelDafAlign": ["AlignmentConstantLCIOFile", "PedeSteerfileName"],
+    "EUTelProcessorGBLAlign": ["AlignmentConstantLCIOFile", "MilleSteeringFilename", "MilleResultFilename"],
+    "EUTelPedeGEAR": ["PedeSteerfileName"],
+    "EUTelPedestalNoiseProcessor": ["OutputPedeFile"],
+    "EUTelCalculateEtaProcessor": ["OutputEtaFileName"],
+    "EUTelProcessorAnalysisPALPIDEfs": ["ShapeOutputFileName"],
+    "EUTelUpdatePedestalNoiseProcessor": ["DriftMonitorFileName"],
+    "EUTelProcessorInstrumentation": ["SummaryFileName"],
+    "AlibavaPedestalNoiseProcessor": ["PedestalOutputFile"],
+}
+
+def shardParamValue(param):
+    """ Value of a steering file parameter element, given as attribute or text """
+    if param.get("value") is not None:
+        return param.get("value").strip()
+    return (param.text or "").strip()
+
+def jobLevelOutputs(steeringString):
+    """ Returns a description of every processor of the steering file with outputs that cannot be
+    produced by shards, see JOBLEVELOUTPUTS. Processors nested in groups are included. """
+    import xml.etree.ElementTree as ET
+    found = []
+    for processor in ET.fromstring(steeringString).iter("processor"):
+        ptype = processor.get("type")
+        if ptype not in JOBLEVELOUTPUTS:
+            continue
+        params = dict((param.get("name"), shardParamValue(param)) for param in processor.iter("parameter"))
+        if ptype == "EUTelMille" and params.get("RunPede", "true").lower() in ("false", "0") and params.get("GeneratePedeSteerfile", "0") == "0":
+            continue # only writes the Mille binary, which is merged
+        if ptype == "EUTelUpdatePedestalNoiseProcessor" and not params.get("DriftMonitorFileName"):
+            continue # drift monitor off by default
+        found.append("%s (%s: %s)" % (processor.get("name"), ptype, ', '.join(JOBLEVELOUTPUTS[ptype])))
+    return found
+
+def shardSteering(steeringString, shard, nShards, firstEvent, nEvents):
+    """ Creates the steering for one shard of a run: restricts the global event range and appends a
+    shard suffix to all output file names (LCIO, AIDA/ROOT histogram and Mille binary files).
+    Returns the new steering string and a list of (type, merged file name, shard file name) tuples. """
+    import xml.etree.ElementTree as ET
+    import os.path
+    log = logging.getLogger('jobsub')
+    suffix = "-shard%02d" % shard
+    outputs = []
+
+    def setParamValue(param, value):
+        if param.get("value") is not None:
+            param.set("value", value)
+        else:
+            param.text = " " + value + " "
+
+    def getGlobalParam(glob, name):
+        for param in glob.findall("parameter"):
+            if param.get("name") == name:
+                return param
+        param = ET.SubElement(glob, "parameter")
+        param.set("name", name)
+        param.set("value", "")
+        return param
+
+    root = ET.fromstring(steeringString)
+    glob = root.find("global")
+    if glob is None:
+        glob = ET.SubElement(root, "global")
+    setParamValue(getGlobalParam(glob, "SkipNEvents"), str(firstEvent))
+    # MaxRecordNumber counts run headers as well as events. Only the first shard reads the run header,
+    # later shards skip it together with the events in front of their range. The last shard reads
+    # until the end of the file so that it picks up any remaining events.
+    if shard == 0 and nShards > 1:
+        setParamValue(getGlobalParam(glob, "MaxRecordNumber"), str(nEvents + 1))
+    elif shard < nShards - 1:
+        setParamValue(getGlobalParam(glob, "MaxRecordNumber"), str(nEvents))
+    else:
+        setParamValue(getGlobalParam(glob, "MaxRecordNumber"), "0")
+
+    for processor in root.iter("processor"):
+        ptype = processor.get("type")
+        for param in processor.findall("parameter"):
+            name = param.get("name")
+            value = shardParamValue(param)
+            if not value:
+                continue
+            if name == "FileName" and ptype == "AIDAProcessor":
+                setParamValue(param, value + suffix)
+                outputs.append(("histo", value + ".root", value + suffix + ".root"))
+            elif name == "LCIOOutputFile":
+                base, ext = os.path.splitext(value)
+                setParamValue(param, base + suffix + ext)
+                outputs.append(("lcio", value, base + suffix + ext))
+            elif name == "BinaryFilename":
+                base, ext = os.path.splitext(value)
+                setParamValue(param, base + suffix + ext)
+                outputs.append(("mille", value, base + suffix + ext))
+    log.debug("Shard %d: events %d-%s, outputs %s", shard, firstEvent,
+              str(firstEvent + nEvents - 1) if shard < nShards - 1 else "end", ', '.join(o[2] for o in outputs))
+    return ET.tostring(root), outputs
+
+def mergeShards(jobtask, outputs):
+    """ Merges the shard outputs in shard order: histograms with hadd, LCIO files with lcio_merge_files
+    and Mille binaries by concatenation (every Mille record is self-contained). Shard files are removed
+    after a successful merge and kept otherwise. Returns the number of failed merges. """
+    import os
+    import shutil
+    from subprocess import call
+    log = logging.getLogger('jobsub.' + jobtask)
+    targets = []
+    for kind, target, shardfile in outputs:
+        if (kind, target) not in targets:
+            targets.append((kind, target))
+    nFailed = 0
+    for kind, target in targets:
+        shardfiles = [o[2] for o in outputs if o[0] == kind and o[1] == target and os.path.isfile(o[2])]
+        if not shardfiles:
+            log.warning("No shard output found for "+target)
+            continue
+        log.info("Merging %d shards into %s", len(shardfiles), target)
+        rcode = 1
+        if kind == "mille":
+            out = open(target, "wb")
+            try:
+                for shardfile in shardfiles:
+                    inp = open(shardfile, "rb")
+                    try:
+                        shutil.copyfileobj(inp, out, 16*1024*1024)
+                    finally:
+                        inp.close()
+                rcode = 0
+            finally:
+                out.close()
+        else:
+            tool = {"histo":"hadd", "lcio":"lcio_merge_files"}[kind]
+            cmd = check_program(tool)
+            if not cmd:
+                log.error(tool+" executable not found in PATH! Shard files for "+target+" are kept.")
+                nFailed += 1
+                continue
+            if kind == "histo":
+                rcode = call([cmd, "-f", target] + shardfiles)
+            else:
+                if os.path.exists(target):
+                    os.remove(target)
+                rcode = call([cmd, target] + shardfiles)
+        if rcode == 0:
+            for shardfile in shardfiles:
+                os.remove(shardfile)
+        else:
+            log.error("Merging into "+target+" failed with error code "+str(rcode)+"; shard files are kept.")
+            nFailed += 1
+    return nFailed
+
+def runShards(basefilename, jobtask, silent, steeringString, nShards, nEvents):
+    """ Splits the run into nShards disjoint event ranges processed by concurrent local Marlin instances
+    and merges their outputs afterwards. Returns a non-zero code if any shard or merge failed. """
+    from threading import Thread
+    log = logging.getLogger('jobsub.' + jobtask)
+    jobOutputs = jobLevelOutputs(steeringString)
+    if jobOutputs:
+        log.error("Cannot shard a run whose steering file contains processors writing results of the whole run: "
+                  + '; '.join(jobOutputs) + ". Run without --shards.")
+        return 1, []
+    eventsPerShard = (nEvents + nShards - 1) // nShards
+    outputs = []
+    shardnames = []
+    for shard in range(nShards):
+        shardString, shardOutputs = shardSteering(steeringString, shard, nShards, shard * eventsPerShard, eventsPerShard)
+        outputs += shardOutputs
+        shardname = basefilename + "-shard%02d" % shard
+        steeringFile = open(shardname+".xml", "w")
+        try:
+            steeringFile.write(shardString)
+        finally:
+            steeringFile.close()
+        shardnames.append(shardname)
+
+    log.info("Running %d shards of %d events each", nShards, eventsPerShard)
+    rcodes = [None] * nShards
+    def runOne(shard):
+        rcodes[shard] = runMarlin(shardnames[shard], jobtask, silent)
+    threads = [Thread(target=runOne, args=(shard,)) for shard in range(nShards)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    failed = [shard for shard in range(nShards) if rcodes[shard] != 0]
+    if failed:
+        log.error("Marlin failed for shard(s) "+', '.join(map(str, failed))+"; outputs are not merged.")
+        return 1, shardnames
+    return mergeShards(jobtask, outputs), shardnames
+
 def zipLogs(path, filename):
     """  stores output from Marlin in zip file; enables compression if necessary module is available """
     import zipfile
@@ -464,6 +662,8 @@ def main(argv=None):
     parser.add_argument("--dry-run", action="store_true", default=False, help="Write steering files but skip actual Marlin execution")
     parser.add_argument("--subdir", action="store_true", default=False, help="Execute every job in its own subdirectory instead of all in the base path")
     parser.add_argument("--plain", action="store_true", default=False, help="Output written to stdout/stderr and log file in prefix-less format i.e. without time stamping")
+    parser.add_argument("--shards", type=int, default=1, metavar="K", help="Split every run into K disjoint event ranges processed by concurrent local Marlin instances; histograms, LCIO and Mille outputs are merged in shard order afterwards. Steering files with processors writing results of the whole run (alignment constants, noisy pixel databases, ...) are refused. Requires --shard-events.")
+    parser.add_argument("--shard-events", type=int, default=0, metavar="N", help="Number of events per run to be distributed over the shards; the last shard also processes any events beyond N")
     parser.add_argument("jobtask", help="Which task to submit (e.g. convert, hitmaker, align); task names are arbitrary and can be set up by the user; they determine e.g. the config section and default steering file names.")
     parser.add_argument("runs", help="The runs to be analyzed; can be a list of single runs and/or a range, e.g. 1056-1060.", nargs='*')
     parser.add_argument("-g", "--graphic", action="store_true", default=False)
@@ -514,6 +714,14 @@ def main(argv=None):
         log.error("At least one run is specified multiple times!")
         return 2
 
+    if args.shards > 1:
+        if args.naf_file or args.lxplus_file:
+            log.error("Sharding runs is only supported for local Marlin execution!")
+            return 2
+        if args.shard_events < args.shards:
+            log.error("Please specify the number of events per run to be sharded using --shard-events!")
+            return 2
+
     # dictionary keeping our parameters
     # here you can set some minimal default config values that will (possibly) be overwritten by the config file
     parameters = {"templatepath":".", "templatefile":args.jobtask+"-tmp.xml", "logpath":"."}
@@ -710,6 +918,15 @@ def main(argv=None):
                 log.info("LXPLUS job submitted")
             else:
                 log.error("LXPLUS submission returned with error code "+str(rcode))
+        elif args.shards > 1:
+            rcode, shardnames = runShards(basefilename, args.jobtask, args.silent, steeringString, args.shards, args.shard_events)
+            if rcode == 0:
+                log.info("Marlin execution of all shards done")
+            else:
+                log.error("Sharded execution returned with error code "+str(rcode))
+            for shardname in shardnames:
+                zipLogs(parameters["logpath"], shardname)
+            os.remove(basefilename+".xml")
         else:
             rcode = runMarlin(basefilename, args.jobtask, args.silent) # start Marlin execution
             if rcode == 0:
@@ -21,6 +21,7 @@
 #ifdef USE_GEAR
 
 #include "CMSPixelCalibrateEvent.h"
+#include "EUTelInstrumentation.h"
 
 // EUTelescope includes
 #include "EUTELESCOPE.h"
@@ -291,6 +292,7 @@ void CMSPixelCalibrateEventProcessor::processRunHeader (LCRunHeader * rdr) {
 
 
 void CMSPixelCalibrateEventProcessor::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
 
     EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
 
@@ -24,6 +24,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "CMSPixelClusteringProcessor.h"
@@ -270,6 +271,7 @@ void CMSPixelClusteringProcessor::modifyEvent( LCEvent * /* event */ ){
 }
 
 void CMSPixelClusteringProcessor::processEvent (LCEvent * event) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 	++_iEvt;
 
@@ -1,5 +1,6 @@
 // eutelescope inlcudes
 #include "EUTelAPIXTbTrackTuple.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
 #include "EUTelExceptions.h"
@@ -36,32 +37,19 @@ EUTelAPIXTbTrackTuple::EUTelAPIXTbTrackTuple()
   _runNr(0),
   _evtNr(0),
   _isFirstEvent(false),
-  _file(NULL),
-  _eutracks(NULL),
+  _compressionLevel(-1),
+  _basketSize(0),
+  _rowsPerBlock(1000),
+  _asyncOutput(true),
+  _writer(),
+  _eutracks(0),
   _nTrackParams(0),
-  _xPos(NULL),
-  _yPos(NULL),
-  _dxdz(NULL),
-  _dydz(NULL),
-  _trackIden(NULL),
-  _trackNum(NULL),
-  _chi2(NULL),
-  _ndof(NULL),
-  _zstree(NULL),
+  _zstree(0),
   _nPixHits(0),
-  p_col(NULL),
-  p_row(NULL),
-  p_tot(NULL),
-  p_iden(NULL),
-  p_lv1(NULL),
-  p_hitTime(NULL),
-  p_frameTime(NULL),
-  _euhits(NULL),
+  _euhits(0),
   _nHits(0),
-  _hitXPos(NULL),
-  _hitYPos(NULL),
-  _hitZPos(NULL),
-  _hitSensorId(NULL)
+  _versionTree(0),
+  _versionColumn(0)
  {
   //processor description
   _description = "Prepare tbtrack style n-tuple with track fit results" ;
@@ -82,6 +70,18 @@ EUTelAPIXTbTrackTuple::EUTelAPIXTbTrackTuple()
   registerProcessorParameter ("DUTIDs", "Int std::vector containing the IDs of the DUTs",
 		  		_DUTIDs, std::vector<int>());
 
+  registerOptionalParameter ("CompressionLevel", "ROOT compression setting of the output file (algorithm*100+level), -1 for the ROOT default",
+				_compressionLevel, static_cast<int>(-1));
+
+  registerOptionalParameter ("BasketSize", "Basket size of all branches in bytes, 0 for the ROOT default",
+				_basketSize, static_cast<int>(0));
+
+  registerOptionalParameter ("RowsPerBlock", "Number of events buffered in memory before they are handed to the writer",
+				_rowsPerBlock, static_cast<int>(1000));
+
+  registerOptionalParameter ("AsyncOutput", "Compress and write the n-tuple in a background thread",
+				_asyncOutput, static_cast<bool>(true));
+
 }
 
 
@@ -127,6 +127,7 @@ void EUTelAPIXTbTrackTuple::processRunHeader( LCRunHeader* runHeader)
 
 void EUTelAPIXTbTrackTuple::processEvent( LCEvent * event )
 {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	_nEvt ++;
 	_evtNr = event->getEventNumber();
 	EUTelEventImpl* euEvent = static_cast<EUTelEventImpl*> ( event );
@@ -159,9 +160,38 @@ void EUTelAPIXTbTrackTuple::processEvent( LCEvent * event )
 	}
  
         //fill the trees	
-	_zstree->Fill();
-	_eutracks->Fill();
-	_euhits->Fill();
+	size_t icol = 0;
+	_writer.fill( _zstree, _zsColumns[icol++], _nPixHits );
+	_writer.fill( _zstree, _zsColumns[icol++], _nEvt );
+	_writer.fill( _zstree, _zsColumns[icol++], p_col );
+	_writer.fill( _zstree, _zsColumns[icol++], p_row );
+	_writer.fill( _zstree, _zsColumns[icol++], p_tot );
+	_writer.fill( _zstree, _zsColumns[icol++], p_lv1 );
+	_writer.fill( _zstree, _zsColumns[icol++], p_iden );
+	_writer.fill( _zstree, _zsColumns[icol++], p_hitTime );
+	_writer.fill( _zstree, _zsColumns[icol++], p_frameTime );
+	_writer.addRow( _zstree );
+
+	icol = 0;
+	_writer.fill( _eutracks, _trackColumns[icol++], _nTrackParams );
+	_writer.fill( _eutracks, _trackColumns[icol++], _nEvt );
+	_writer.fill( _eutracks, _trackColumns[icol++], _xPos );
+	_writer.fill( _eutracks, _trackColumns[icol++], _yPos );
+	_writer.fill( _eutracks, _trackColumns[icol++], _dxdz );
+	_writer.fill( _eutracks, _trackColumns[icol++], _dydz );
+	_writer.fill( _eutracks, _trackColumns[icol++], _trackNum );
+	_writer.fill( _eutracks, _trackColumns[icol++], _trackIden );
+	_writer.fill( _eutracks, _trackColumns[icol++], _chi2 );
+	_writer.fill( _eutracks, _trackColumns[icol++], _ndof );
+	_writer.addRow( _eutracks );
+
+	icol = 0;
+	_writer.fill( _euhits, _hitColumns[icol++], _nHits );
+	_writer.fill( _euhits, _hitColumns[icol++], _hitXPos );
+	_writer.fill( _euhits, _hitColumns[icol++], _hitYPos );
+	_writer.fill( _euhits, _hitColumns[icol++], _hitZPos );
+	_writer.fill( _euhits, _hitColumns[icol++], _hitSensorId );
+	_writer.addRow( _euhits );
 
 	_isFirstEvent = false;
 }
@@ -169,10 +199,10 @@ void EUTelAPIXTbTrackTuple::processEvent( LCEvent * event )
 void EUTelAPIXTbTrackTuple::end()
 {
 	//write version number
-	_versionNo->push_back(1.3);
-	_versionTree->Fill();
+	_writer.fill( _versionTree, _versionColumn, std::vector<double>(1, 1.3) );
+	_writer.addRow( _versionTree );
 	//Maybe some stats output?
-	_file->Write();
+	_writer.close();
 }
 
 //Read in TrackerHit(Impl) to later dump them
@@ -213,10 +243,10 @@ bool EUTelAPIXTbTrackTuple::readHits( std::string hitColName, LCEvent* event )
     		double z = pos[2];
 
 	       	//offset by half sensor/sensitive size
-			_hitXPos->push_back(x + _xSensSize.at(sensorID)/2.0);
-    		_hitYPos->push_back(y + _ySensSize.at(sensorID)/2.0);
-    		_hitZPos->push_back(z);
-    		_hitSensorId->push_back(sensorID);
+			_hitXPos.push_back(x + _xSensSize.at(sensorID)/2.0);
+    		_hitYPos.push_back(y + _ySensSize.at(sensorID)/2.0);
+    		_hitZPos.push_back(z);
+    		_hitSensorId.push_back(sensorID);
 	}
 
 	return true;
@@ -280,14 +310,14 @@ bool EUTelAPIXTbTrackTuple::readTracks(LCEvent* event)
 			double y = pos_loc[1];
 
 			//eutrack tree
-      			_xPos->push_back(x);
-      			_yPos->push_back(y);
-      			_dxdz->push_back(dxdz);
-      			_dydz->push_back(dydz);
-      			_trackIden->push_back(sensorID);
-      			_trackNum->push_back(itrack);
-      			_chi2->push_back(chi2);
-      			_ndof->push_back(ndof);
+      			_xPos.push_back(x);
+      			_yPos.push_back(y);
+      			_dxdz.push_back(dxdz);
+      			_dydz.push_back(dydz);
+      			_trackIden.push_back(sensorID);
+      			_trackNum.push_back(itrack);
+      			_chi2.push_back(chi2);
+      			_ndof.push_back(ndof);
     		}
   	}
 
@@ -328,11 +358,11 @@ bool EUTelAPIXTbTrackTuple::readZsHits( std::string colName, LCEvent* event)
 		     {
 		       sparseData->getSparsePixelAt( iHit, &apixPixel);
 		       _nPixHits++;
-		       p_iden->push_back( sensorID );
-		       p_row->push_back( apixPixel.getYCoord() );
-		       p_col->push_back( apixPixel.getXCoord() );
-		       p_tot->push_back( static_cast< int >(apixPixel.getSignal()) );
-		       p_lv1->push_back( static_cast< int >(apixPixel.getTime()) );
+		       p_iden.push_back( sensorID );
+		       p_row.push_back( apixPixel.getYCoord() );
+		       p_col.push_back( apixPixel.getXCoord() );
+		       p_tot.push_back( static_cast< int >(apixPixel.getSignal()) );
+		       p_lv1.push_back( static_cast< int >(apixPixel.getTime()) );
 		     }
 		   
 		  }
@@ -345,11 +375,11 @@ bool EUTelAPIXTbTrackTuple::readZsHits( std::string colName, LCEvent* event)
 		     {
 		       sparseData->getSparsePixelAt( iHit, &binaryPixel);
 		       _nPixHits++;
-		       p_iden->push_back( sensorID );
-		       p_row->push_back( binaryPixel.getYCoord() );
-		       p_col->push_back( binaryPixel.getXCoord() );
-		       p_hitTime->push_back( binaryPixel.getHitTime() );
-		       p_frameTime->push_back( binaryPixel.getFrameTime() );
+		       p_iden.push_back( sensorID );
+		       p_row.push_back( binaryPixel.getYCoord() );
+		       p_col.push_back( binaryPixel.getXCoord() );
+		       p_hitTime.push_back( binaryPixel.getHitTime() );
+		       p_frameTime.push_back( binaryPixel.getFrameTime() );
 		     }
 		  }
 		else
@@ -363,95 +393,69 @@ bool EUTelAPIXTbTrackTuple::readZsHits( std::string colName, LCEvent* event)
 void EUTelAPIXTbTrackTuple::clear()
 {
 	/* Clear zsdata */
-	p_col->clear();
-	p_row->clear();
-	p_tot->clear();
-	p_iden->clear();
-	p_lv1->clear();
-	p_hitTime->clear();
-	p_frameTime->clear();
+	p_col.clear();
+	p_row.clear();
+	p_tot.clear();
+	p_iden.clear();
+	p_lv1.clear();
+	p_hitTime.clear();
+	p_frameTime.clear();
 	_nPixHits = 0;
 	/* Clear hittrack */
-	_xPos->clear();
-	_yPos->clear();
-	_dxdz->clear();
-	_dydz->clear();
-	_trackNum->clear();
-	_trackIden->clear();
-	_chi2->clear();
-	_ndof->clear();
+	_xPos.clear();
+	_yPos.clear();
+	_dxdz.clear();
+	_dydz.clear();
+	_trackNum.clear();
+	_trackIden.clear();
+	_chi2.clear();
+	_ndof.clear();
 	//Clear hits
-	_hitXPos->clear();
-	_hitYPos->clear();
-	_hitZPos->clear();
-	_hitSensorId->clear();
+	_hitXPos.clear();
+	_hitYPos.clear();
+	_hitZPos.clear();
+	_hitSensorId.clear();
 }
 
 void EUTelAPIXTbTrackTuple::prepareTree()
 {
-	_file = new TFile(_path2file.c_str(),"RECREATE");
-
-	_xPos = new std::vector<double>();	     
-	_yPos = new std::vector<double>();	   
-	_dxdz = new std::vector<double>();	   
-	_dydz = new std::vector<double>();	   
-	_trackIden  = new std::vector<int>();
-	_trackNum = new std::vector<int>();
-	_chi2 = new std::vector<double>();	   
-	_ndof = new std::vector<double>();    
-
-	p_col = new std::vector<int>();
-	p_row = new std::vector<int>();
-	p_tot = new std::vector<int>();
-	p_iden = new std::vector<int>();
-	p_lv1 = new std::vector<int>();
-	p_hitTime = new std::vector<int>();
-	p_frameTime = new std::vector<double>();
-
-	_hitXPos = new std::vector<double>();
-	_hitYPos = new std::vector<double>();
-	_hitZPos = new std::vector<double>();
-	_hitSensorId  = new std::vector<int>();
-
-	_versionNo = new std::vector<double>();
-	_versionTree = new TTree("version","version");
-	_versionTree->Branch("no", &_versionNo);
-
-	_euhits = new TTree("fitpoints","fitpoints");
-	_euhits->SetAutoSave(1000000000);
-	
-	_euhits->Branch("nHits", &_nHits);
-	_euhits->Branch("xPos", &_hitXPos);
-	_euhits->Branch("yPos", &_hitYPos);
-	_euhits->Branch("zPos", &_hitZPos);
-	_euhits->Branch("sensorId", &_hitSensorId);
-
-	_zstree = new TTree("rawdata", "rawdata");
-	_zstree->SetAutoSave(1000000000);
-	_zstree->Branch("nPixHits", &_nPixHits);
-	_zstree->Branch("euEvt",    &_nEvt);
-	_zstree->Branch("col",      &p_col);
-	_zstree->Branch("row",      &p_row);
-	_zstree->Branch("tot",      &p_tot);
-	_zstree->Branch("lv1",      &p_lv1);
-	_zstree->Branch("iden",     &p_iden);
-	_zstree->Branch("hitTime",  &p_hitTime);
-	_zstree->Branch("frameTime",&p_frameTime);
+	_versionTree = _writer.bookTree("version","version");
+	_versionColumn = _writer.bookColumn(_versionTree, "no", EUTelTupleWriter::kDoubleVector);
+
+	_euhits = _writer.bookTree("fitpoints","fitpoints");
+	_hitColumns.push_back( _writer.bookColumn(_euhits, "nHits", EUTelTupleWriter::kInt) );
+	_hitColumns.push_back( _writer.bookColumn(_euhits, "xPos", EUTelTupleWriter::kDoubleVector) );
+	_hitColumns.push_back( _writer.bookColumn(_euhits, "yPos", EUTelTupleWriter::kDoubleVector) );
+	_hitColumns.push_back( _writer.bookColumn(_euhits, "zPos", EUTelTupleWriter::kDoubleVector) );
+	_hitColumns.push_back( _writer.bookColumn(_euhits, "sensorId", EUTelTupleWriter::kIntVector) );
+
+	_zstree = _writer.bookTree("rawdata", "rawdata");
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "nPixHits", EUTelTupleWriter::kInt) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "euEvt", EUTelTupleWriter::kInt) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "col", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "row", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "tot", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "lv1", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "iden", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "hitTime", EUTelTupleWriter::kIntVector) );
+	_zsColumns.push_back( _writer.bookColumn(_zstree, "frameTime", EUTelTupleWriter::kDoubleVector) );
 
 	//Tree for storing all track param info
-	_eutracks = new TTree("tracks", "tracks");
-	_eutracks->SetAutoSave(1000000000);
-	_eutracks->Branch("nTrackParams", &_nTrackParams);
-	_eutracks->Branch("euEvt", &_nEvt);
-	_eutracks->Branch("xPos", &_xPos);
-	_eutracks->Branch("yPos", &_yPos);
-	_eutracks->Branch("dxdz", &_dxdz);
-	_eutracks->Branch("dydz", &_dydz);
-	_eutracks->Branch("trackNum", &_trackNum);
-	_eutracks->Branch("iden", &_trackIden);
-	_eutracks->Branch("chi2", &_chi2);
-	_eutracks->Branch("ndof", &_ndof);
-
-	_euhits->AddFriend(_zstree);
-	_euhits->AddFriend(_eutracks);
+	_eutracks = _writer.bookTree("tracks", "tracks");
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "nTrackParams", EUTelTupleWriter::kInt) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "euEvt", EUTelTupleWriter::kInt) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "xPos", EUTelTupleWriter::kDoubleVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "yPos", EUTelTupleWriter::kDoubleVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "dxdz", EUTelTupleWriter::kDoubleVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "dydz", EUTelTupleWriter::kDoubleVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "trackNum", EUTelTupleWriter::kIntVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "iden", EUTelTupleWriter::kIntVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "chi2", EUTelTupleWriter::kDoubleVector) );
+	_trackColumns.push_back( _writer.bookColumn(_eutracks, "ndof", EUTelTupleWriter::kDoubleVector) );
+
+	_writer.addFriend(_euhits, _zstree);
+	_writer.addFriend(_euhits, _eutracks);
+
+	_writer.setOptions(_compressionLevel, _basketSize, static_cast<size_t>(_rowsPerBlock > 0 ? _rowsPerBlock : 1), _asyncOutput);
+	_writer.open(_path2file);
 }
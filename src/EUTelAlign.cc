@@ -19,6 +19,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelAlign.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -80,7 +81,7 @@ void fitFunctionWrapper(Int_t &npar, Double_t *gin, Double_t &f, Double_t *par,
   EUTelAlign::Chi2Function(npar,gin,f,par,iflag);
 }
 
-vector<EUTelAlign::HitsForFit > EUTelAlign::_hitsForFit;
+EUTelPlaneAlignmentLSQ EUTelAlign::_alignmentFit;
 
 EUTelAlign::EUTelAlign () : Processor("EUTelAlign") {
 
@@ -142,6 +143,12 @@ EUTelAlign::EUTelAlign () : Processor("EUTelAlign") {
   registerOptionalParameter("NHitsMax","Maximal number of Hits per plane.",
                             _nHitsMax, static_cast <int> (100));
 
+  registerOptionalParameter("MaxIterations","Maximal number of iterations of the least squares alignment fit.",
+                            _maxIterations, static_cast <int> (50));
+
+  registerOptionalParameter("UseMinuit","Repeat the alignment fit with MINUIT (MIGRAD and MINOS) to verify the least squares result.",
+                            _useMinuit, static_cast <bool> (false));
+
   FloatVec constantsSecondLayer;
   constantsSecondLayer.push_back(0.0);
   constantsSecondLayer.push_back(0.0);
@@ -346,6 +353,7 @@ void EUTelAlign::FitTrack(int nPlanesFit, double xPosFit[], double yPosFit[], do
 }
 
 void EUTelAlign::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event) ;
 
@@ -708,7 +716,8 @@ void EUTelAlign::processEvent (LCEvent * event) {
             hitsForFit.firstLayerResolution = allHitsFirstLayerResolution[firsthit];
             hitsForFit.secondLayerResolution = allHitsSecondLayerResolution[take];
 
-            _hitsForFit.push_back(hitsForFit);
+            _alignmentFit.addHit( hitsForFit.secondLayerMeasuredX, hitsForFit.secondLayerMeasuredY,
+                                  hitsForFit.secondLayerPredictedX, hitsForFit.secondLayerPredictedY );
 
           }
 
@@ -760,7 +769,8 @@ void EUTelAlign::processEvent (LCEvent * event) {
             hitsForFit.firstLayerResolution = allHitsFirstLayerResolution[firsthit];
             hitsForFit.secondLayerResolution = allHitsSecondLayerResolution[take];
 
-            _hitsForFit.push_back(hitsForFit);
+            _alignmentFit.addHit( hitsForFit.secondLayerMeasuredX, hitsForFit.secondLayerMeasuredY,
+                                  hitsForFit.secondLayerPredictedX, hitsForFit.secondLayerPredictedY );
 
           }
 
@@ -785,7 +795,7 @@ void EUTelAlign::processEvent (LCEvent * event) {
   streamlog_out ( MESSAGE2 ) << "Read event: " << _iEvt << endl;
   streamlog_out ( MESSAGE2 ) << "Number of hits in first plane: " << nHitsFirstPlane << endl;
   streamlog_out ( MESSAGE2 ) << "Number of hits in the last plane: " << nHitsSecondPlane << endl;
-  streamlog_out ( MESSAGE2 ) << "Hit pairs found so far: " << _hitsForFit.size() << endl;
+  streamlog_out ( MESSAGE2 ) << "Hit pairs found so far: " << _alignmentFit.size() << endl;
 
 }
 
@@ -801,45 +811,148 @@ void EUTelAlign::Chi2Function(Int_t &npar, Double_t *gin, Double_t &f, Double_t
   // par[3]:       theta_y
   // par[4]:       theta_z
 
-  double x, y, distance;
-  double chi2 = 0.0;
-  int usedevents = 0;
+  // the chi2 cut is par[5], zero meaning no cut
+  f = _alignmentFit.chi2( par, par[5] );
+
+}
+
+void EUTelAlign::end() {
+
+  streamlog_out ( MESSAGE2 ) << "Number of Events used in the fit: " << _alignmentFit.size() << endl;
+
+  double start[EUTelPlaneAlignmentLSQ::NPARAMETERS];
+  for ( int iPar = 0; iPar < EUTelPlaneAlignmentLSQ::NPARAMETERS; ++iPar ) {
+    start[iPar] = _startValuesForAlignment[iPar];
+  }
+
+  // least squares fit: offsets only, then all parameters, then all
+  // parameters with the chi2 cut
+  // ------------------------------------------------------------------
+
+  streamlog_out ( MESSAGE2 ) << endl << "Least squares alignment" << endl;
+  streamlog_out ( MESSAGE2 ) << "-----------------------" << endl << endl;
+
+  if ( !_alignmentFit.fit( start, _chi2Cut, _maxIterations ) ) {
+    streamlog_out ( WARNING2 ) << "The alignment fit did not converge within " << _maxIterations << " iterations" << endl;
+  }
+
+  streamlog_out ( MESSAGE2 ) << "Iterations: " << _alignmentFit.getNIterations()
+                             << ", hits used: " << _alignmentFit.getNUsed() << " of " << _alignmentFit.size()
+                             << ", chi2: " << _alignmentFit.getChi2() << endl;
+
+  double off_x_simple = _alignmentFit.getSimpleOffset( 0 );
+  double off_y_simple = _alignmentFit.getSimpleOffset( 1 );
+
+  // fill histograms
+  double residual_x_simple = 1000.0;
+  double residual_y_simple = 1000.0;
 
   // loop over all events
-  for (size_t i = 0; i < _hitsForFit.size(); i++) {
+  double simplePar[EUTelPlaneAlignmentLSQ::NPARAMETERS] = { off_x_simple, off_y_simple, start[2], start[3], start[4] };
+  double x,y;
+  for (size_t i = 0; i < _alignmentFit.size(); i++) {
 
-    // just to be sure
-    distance = 0.0;
+    EUTelPlaneAlignmentLSQ::transform( simplePar, _alignmentFit.getMeasuredX(i), _alignmentFit.getMeasuredY(i), x, y );
+    residual_x_simple = x - _alignmentFit.getPredictedX(i);
+    residual_y_simple = y - _alignmentFit.getPredictedY(i);
 
-    x = (cos(par[3])*cos(par[4])) * _hitsForFit[i].secondLayerMeasuredX + ((-1)*sin(par[2])*sin(par[3])*cos(par[4]) + cos(par[2])*sin(par[4])) * _hitsForFit[i].secondLayerMeasuredY + par[0];
-    y = ((-1)*cos(par[3])*sin(par[4])) * _hitsForFit[i].secondLayerMeasuredX + (sin(par[2])*sin(par[3])*sin(par[4]) + cos(par[2])*cos(par[4])) * _hitsForFit[i].secondLayerMeasuredY + par[1];
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 
-    distance = ((x - _hitsForFit[i].secondLayerPredictedX) * (x - _hitsForFit[i].secondLayerPredictedX) + (y - _hitsForFit[i].secondLayerPredictedY) * (y - _hitsForFit[i].secondLayerPredictedY)) / 100;
+    if ( AIDA::IHistogram1D* residx_simple_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualXSimpleLocalname]) )
+      residx_simple_histo->fill(residual_x_simple);
+    else {
+      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualXSimpleLocalname << endl;
+    }
 
-    // add chi2 cut here later?
-    if (par[5] == 0.0) {
+    if ( AIDA::IHistogram1D* residy_simple_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualYSimpleLocalname]) )
+      residy_simple_histo->fill(residual_y_simple);
+    else {
+      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualYSimpleLocalname << endl;
+    }
 
-      chi2 = chi2 + distance;
-      usedevents++;
+#endif
 
-    } else if (distance < par[5]) {
+  } // end loop over all events
 
-      chi2 = chi2 + distance;
-      usedevents++;
+  double par[EUTelPlaneAlignmentLSQ::NPARAMETERS];
+  double err[EUTelPlaneAlignmentLSQ::NPARAMETERS];
+  for ( int iPar = 0; iPar < EUTelPlaneAlignmentLSQ::NPARAMETERS; ++iPar ) {
+    par[iPar] = _alignmentFit.getParameter( iPar );
+    err[iPar] = _alignmentFit.getError( iPar );
+  }
 
+  double off_x   = par[EUTelPlaneAlignmentLSQ::kOffX];
+  double off_y   = par[EUTelPlaneAlignmentLSQ::kOffY];
+  double theta_x = par[EUTelPlaneAlignmentLSQ::kThetaX];
+  double theta_y = par[EUTelPlaneAlignmentLSQ::kThetaY];
+  double theta_z = par[EUTelPlaneAlignmentLSQ::kThetaZ];
+
+  streamlog_out ( MESSAGE2 ) << endl << "Alignment constants from the fit:" << endl;
+  streamlog_out ( MESSAGE2 ) << "---------------------------------" << endl;
+  streamlog_out ( MESSAGE2 ) << "off_x: " << off_x << " +/- " << err[EUTelPlaneAlignmentLSQ::kOffX] << endl;
+  streamlog_out ( MESSAGE2 ) << "off_y: " << off_y << " +/- " << err[EUTelPlaneAlignmentLSQ::kOffY] << endl;
+  streamlog_out ( MESSAGE2 ) << "theta_x: " << theta_x << " +/- " << err[EUTelPlaneAlignmentLSQ::kThetaX] << endl;
+  streamlog_out ( MESSAGE2 ) << "theta_y: " << theta_y << " +/- " << err[EUTelPlaneAlignmentLSQ::kThetaY] << endl;
+  streamlog_out ( MESSAGE2 ) << "theta_z: " << theta_z << " +/- " << err[EUTelPlaneAlignmentLSQ::kThetaZ] << endl;
+  streamlog_out ( MESSAGE2 ) << "For copy and paste to line fit xml-file: " << off_x << " " << off_y << " " << theta_x << " " << theta_y << " " << theta_z << endl;
+
+  if ( _useMinuit ) {
+    double minuitPar[EUTelPlaneAlignmentLSQ::NPARAMETERS];
+    double minuitErr[EUTelPlaneAlignmentLSQ::NPARAMETERS];
+    fitWithMinuit( start, minuitPar, minuitErr );
+
+    const char * names[EUTelPlaneAlignmentLSQ::NPARAMETERS] = { "off_x", "off_y", "theta_x", "theta_y", "theta_z" };
+    streamlog_out ( MESSAGE2 ) << endl << "MINUIT verification (MINUIT - least squares):" << endl;
+    streamlog_out ( MESSAGE2 ) << "---------------------------------------------" << endl;
+    for ( int iPar = 0; iPar < EUTelPlaneAlignmentLSQ::NPARAMETERS; ++iPar ) {
+      streamlog_out ( MESSAGE2 ) << names[iPar] << ": " << minuitPar[iPar] << " +/- " << minuitErr[iPar]
+                                 << " (" << minuitPar[iPar] - par[iPar] << ")" << endl;
     }
+  }
+
+  // fill histograms
+  // ---------------
+
+  double residual_x = 1000.0;
+  double residual_y = 1000.0;
+
+  // loop over all events
+  for (size_t i = 0; i < _alignmentFit.size(); i++) {
+
+    EUTelPlaneAlignmentLSQ::transform( par, _alignmentFit.getMeasuredX(i), _alignmentFit.getMeasuredY(i), x, y );
+
+    residual_x = x - _alignmentFit.getPredictedX(i);
+    residual_y = y - _alignmentFit.getPredictedY(i);
+
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+
+    if ( AIDA::IHistogram1D* residx_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualXLocalname]) )
+      residx_histo->fill(residual_x);
+    else {
+      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualXLocalname << endl;
+    }
+
+    if ( AIDA::IHistogram1D* residy_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualYLocalname]) )
+      residy_histo->fill(residual_y);
+    else {
+      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualYLocalname << endl;
+    }
+
+#endif
 
   } // end loop over all events
 
-  // streamlog_out ( MESSAGE2) << usedevents << " ";
+  delete [] _intrResolY;
+  delete [] _intrResolX;
+  delete [] _xMeasPos;
+  delete [] _yMeasPos;
+  delete [] _zMeasPos;
 
-  f = chi2;
+  streamlog_out ( MESSAGE2 ) << "Successfully finished" << endl;
 
 }
 
-void EUTelAlign::end() {
-
-  streamlog_out ( MESSAGE2 ) << "Number of Events used in the fit: " << _hitsForFit.size() << endl;
+void EUTelAlign::fitWithMinuit(const double * start, double * par, double * err) {
 
   streamlog_out ( MESSAGE2 ) << "Minuit will soon be started" << endl;
 
@@ -868,19 +981,14 @@ void EUTelAlign::end() {
   arglist[0] = 1;
   gMinuit->mnexcm("SET ERR",arglist,1,ierflag);
 
-  double start_off_x = _startValuesForAlignment[0];
-  double start_off_y = _startValuesForAlignment[1];
-  double start_theta_x = _startValuesForAlignment[2];
-  double start_theta_y = _startValuesForAlignment[3];
-  double start_theta_z = _startValuesForAlignment[4];
   double start_chi2 = _chi2Cut;
 
   // set starting values and step sizes
-  gMinuit->mnparm(0,"off_x",start_off_x,1,0,0,ierflag);
-  gMinuit->mnparm(1,"off_y",start_off_y,1,0,0,ierflag);
-  gMinuit->mnparm(2,"theta_x",start_theta_x,0.001,0,0,ierflag);
-  gMinuit->mnparm(3,"theta_y",start_theta_y,0.001,0,0,ierflag);
-  gMinuit->mnparm(4,"theta_z",start_theta_z,0.001,0,0,ierflag);
+  gMinuit->mnparm(0,"off_x",start[0],1,0,0,ierflag);
+  gMinuit->mnparm(1,"off_y",start[1],1,0,0,ierflag);
+  gMinuit->mnparm(2,"theta_x",start[2],0.001,0,0,ierflag);
+  gMinuit->mnparm(3,"theta_y",start[3],0.001,0,0,ierflag);
+  gMinuit->mnparm(4,"theta_z",start[4],0.001,0,0,ierflag);
   gMinuit->mnparm(5,"chi2",0.0,1,0,0,ierflag);
 
   gMinuit->FixParameter(2);
@@ -901,48 +1009,6 @@ void EUTelAlign::end() {
   arglist[1] = 0.1;
   gMinuit->mnexcm("MINOS",arglist,1,ierflag);
 
-  double off_x_simple = 0.0;
-  double off_y_simple = 0.0;
-
-  double off_x_simple_error = 0.0;
-  double off_y_simple_error = 0.0;
-
-  // get results from migrad
-  gMinuit->GetParameter(0,off_x_simple,off_x_simple_error);
-  gMinuit->GetParameter(1,off_y_simple,off_y_simple_error);
-
-  // fill histograms
-  double residual_x_simple = 1000.0;
-  double residual_y_simple = 1000.0;
-
-  // loop over all events
-  for (size_t i = 0; i < _hitsForFit.size(); i++) {
-
-    residual_x_simple = off_x_simple + _hitsForFit[i].secondLayerMeasuredX - _hitsForFit[i].secondLayerPredictedX;
-    residual_y_simple = off_y_simple + _hitsForFit[i].secondLayerMeasuredY - _hitsForFit[i].secondLayerPredictedY;
-
-#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
-
-    if ( AIDA::IHistogram1D* residx_simple_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualXSimpleLocalname]) )
-      residx_simple_histo->fill(residual_x_simple);
-    else {
-      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualXSimpleLocalname << endl;
-    }
-
-    if ( AIDA::IHistogram1D* residy_simple_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualYSimpleLocalname]) )
-      residy_simple_histo->fill(residual_y_simple);
-    else {
-      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualYSimpleLocalname << endl;
-    }
-
-#endif
-
-  } // end loop over all events
-
-  // get results from migrad
-  gMinuit->GetParameter(0,off_x_simple,off_x_simple_error);
-  gMinuit->GetParameter(1,off_y_simple,off_y_simple_error);
-
   // release angles
   gMinuit->Release(2);
   gMinuit->Release(3);
@@ -979,76 +1045,12 @@ void EUTelAlign::end() {
 
   streamlog_out ( MESSAGE2) << endl;
 
-  double off_x = 0.0;
-  double off_y = 0.0;
-  double theta_x = 0.0;
-  double theta_y = 0.0;
-  double theta_z = 0.0;
-
-  double off_x_error = 0.0;
-  double off_y_error = 0.0;
-  double theta_x_error = 0.0;
-  double theta_y_error = 0.0;
-  double theta_z_error = 0.0;
-
   // get results from migrad
-  gMinuit->GetParameter(0,off_x,off_x_error);
-  gMinuit->GetParameter(1,off_y,off_y_error);
-  gMinuit->GetParameter(2,theta_x,theta_x_error);
-  gMinuit->GetParameter(3,theta_y,theta_y_error);
-  gMinuit->GetParameter(4,theta_z,theta_z_error);
-
-  streamlog_out ( MESSAGE2 ) << endl << "Alignment constants from the fit:" << endl;
-  streamlog_out ( MESSAGE2 ) << "---------------------------------" << endl;
-  streamlog_out ( MESSAGE2 ) << "off_x: " << off_x << " +/- " << off_x_error << endl;
-  streamlog_out ( MESSAGE2 ) << "off_y: " << off_y << " +/- " << off_y_error << endl;
-  streamlog_out ( MESSAGE2 ) << "theta_x: " << theta_x << " +/- " << theta_x_error << endl;
-  streamlog_out ( MESSAGE2 ) << "theta_y: " << theta_y << " +/- " << theta_y_error << endl;
-  streamlog_out ( MESSAGE2 ) << "theta_z: " << theta_z << " +/- " << theta_z_error << endl;
-  streamlog_out ( MESSAGE2 ) << "For copy and paste to line fit xml-file: " << off_x << " " << off_y << " " << theta_x << " " << theta_y << " " << theta_z << endl;
-
-  // fill histograms
-  // ---------------
-
-  double x,y;
-  double residual_x = 1000.0;
-  double residual_y = 1000.0;
-
-  // loop over all events
-  for (size_t i = 0; i < _hitsForFit.size(); i++) {
-
-    x = (cos(theta_y)*cos(theta_z)) * _hitsForFit[i].secondLayerMeasuredX + ((-1)*sin(theta_x)*sin(theta_y)*cos(theta_z) + cos(theta_x)*sin(theta_z)) * _hitsForFit[i].secondLayerMeasuredY + off_x;
-    y = ((-1)*cos(theta_y)*sin(theta_z)) * _hitsForFit[i].secondLayerMeasuredX + (sin(theta_x)*sin(theta_y)*sin(theta_z) + cos(theta_x)*cos(theta_z)) * _hitsForFit[i].secondLayerMeasuredY + off_y;
-
-    residual_x = x - _hitsForFit[i].secondLayerPredictedX;
-    residual_y = y - _hitsForFit[i].secondLayerPredictedY;
-
-#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
-
-    if ( AIDA::IHistogram1D* residx_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualXLocalname]) )
-      residx_histo->fill(residual_x);
-    else {
-      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualXLocalname << endl;
-    }
-
-    if ( AIDA::IHistogram1D* residy_histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[_residualYLocalname]) )
-      residy_histo->fill(residual_y);
-    else {
-      streamlog_out ( ERROR2 ) << "Not able to retrieve histogram pointer for " <<  _residualYLocalname << endl;
-    }
-
-#endif
-
-  } // end loop over all events
-
-  delete [] _intrResolY;
-  delete [] _intrResolX;
-  delete [] _xMeasPos;
-  delete [] _yMeasPos;
-  delete [] _zMeasPos;
-
-  streamlog_out ( MESSAGE2 ) << "Successfully finished" << endl;
+  for ( int iPar = 0; iPar < EUTelPlaneAlignmentLSQ::NPARAMETERS; ++iPar ) {
+    gMinuit->GetParameter(iPar, par[iPar], err[iPar]);
+  }
 
+  delete gMinuit;
 }
 
 void EUTelAlign::bookHistos() {
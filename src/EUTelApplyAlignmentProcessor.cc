@@ -11,6 +11,7 @@
 #ifdef USE_GEAR
 // eutelescope includes ".h"
 #include "EUTelApplyAlignmentProcessor.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelAlignmentConstant.h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
@@ -463,6 +464,7 @@ void EUTelApplyAlignmentProcessor::processRunHeader (LCRunHeader * runHeader)
 
 //........................................................................................................................
 void EUTelApplyAlignmentProcessor::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
 
     if( _alignmentCollectionNames.size() <= 0 )
     {
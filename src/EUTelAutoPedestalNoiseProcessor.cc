@@ -10,6 +10,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelAutoPedestalNoiseProcessor.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -142,6 +143,7 @@ void EUTelAutoPedestalNoiseProcessor::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelAutoPedestalNoiseProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   ++_iEvt;
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event) ;
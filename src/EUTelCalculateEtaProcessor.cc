@@ -10,6 +10,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelCalculateEtaProcessor.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -234,6 +235,7 @@ void EUTelCalculateEtaProcessor::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelCalculateEtaProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   ++_iEvt;
 
@@ -12,10 +12,12 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelCalibrateEventProcessor.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTelHistogramManager.h"
+#include "EUTelNZSFrameEngine.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -41,6 +43,7 @@
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <algorithm>
 
 using namespace std;
 using namespace lcio;
@@ -114,6 +117,24 @@ EUTelCalibrateEventProcessor::EUTelCalibrateEventProcessor () :Processor("EUTelC
 
   registerProcessorParameter("HistoInfoFileName", "This is the name of the histogram information file",
                              _histoInfoFileName, string( "histoinfo.xml" ) );
+
+  registerOptionalParameter("SparsifiedDataCollectionName",
+                            "Name of the output zero suppressed data collection. Leave empty to switch off the zero suppression",
+                            _sparsifiedDataCollectionName, string("") );
+
+  FloatVec sigmaCutVecExample;
+  sigmaCutVecExample.push_back(2.5);
+  sigmaCutVecExample.push_back(2.5);
+  sigmaCutVecExample.push_back(2.5);
+  sigmaCutVecExample.push_back(2.5);
+  sigmaCutVecExample.push_back(2.5);
+
+  registerOptionalParameter("SigmaCut", "Zero suppression threshold of each detector in units of the noise",
+                            _sigmaCutVec, sigmaCutVecExample );
+
+  registerOptionalParameter("WriteCalibratedData",
+                            "Flag to add the full frame calibrated data collection to the event (only with zero suppression)",
+                            _writeCalibratedData, static_cast<bool> (true) );
 }
 
 
@@ -126,6 +147,17 @@ void EUTelCalibrateEventProcessor::init () {
     streamlog_out( WARNING2 ) << "Filling debug histograms is slowing down the procedure" << endl;
   }
 
+  if ( _sparsifiedDataCollectionName.empty() ) {
+    _writeCalibratedData = true;
+  } else {
+    if ( _sigmaCutVec.empty() ) {
+      throw InvalidParameterException( "SigmaCut needs at least one value for the zero suppression" );
+    }
+    streamlog_out( MESSAGE2 ) << "Zero suppressed data written to " << _sparsifiedDataCollectionName
+                              << ( _writeCalibratedData ? ", calibrated data to " + _calibratedDataCollectionName
+                                                        : ", calibrated data not stored" ) << endl;
+  }
+
   // set to zero the run counter
   _iRun = 0;
 
@@ -182,6 +214,7 @@ void EUTelCalibrateEventProcessor::initializeGeometry(LCEvent * event) throw ( m
 }
 
 void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 
   if ( !_isGeometryReady ) {
@@ -436,7 +469,11 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
       _isFirstEvent = false;
     }
 
-    LCCollectionVec * correctedDataCollection = new LCCollectionVec(LCIO::TRACKERDATA);
+    auto_ptr<LCCollectionVec> correctedDataCollection( new LCCollectionVec(LCIO::TRACKERDATA) );
+    auto_ptr<LCCollectionVec> sparsifiedDataCollection;
+    if ( !_sparsifiedDataCollectionName.empty() ) {
+      sparsifiedDataCollection.reset( new LCCollectionVec(LCIO::TRACKERDATA) );
+    }
 
     _minX.clear();
     _maxX.clear();
@@ -444,8 +481,8 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
     _maxY.clear();
 
     for (unsigned int iDetector = 0; iDetector < inputCollectionVec->size(); iDetector++) {
-      vector< float > commonModeCorVec;
-      commonModeCorVec.clear();
+      // common mode of every row (ROWWISE only)
+      vector< double > rowCommonMode;
 
       // reset quantity for the common mode.
       double pixelSum      = 0.;
@@ -465,7 +502,8 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
       TrackerRawDataImpl  * status    = dynamic_cast < TrackerRawDataImpl * >(statusCollectionVec->getElementAt( ancillaryPos ));
 
       TrackerDataImpl     * corrected = new TrackerDataImpl;
-      CellIDEncoder<TrackerDataImpl> idDataEncoder(EUTELESCOPE::MATRIXDEFAULTENCODING, correctedDataCollection);
+      correctedDataCollection->push_back(corrected);
+      CellIDEncoder<TrackerDataImpl> idDataEncoder(EUTELESCOPE::MATRIXDEFAULTENCODING, correctedDataCollection.get());
       idDataEncoder["sensorID"] = sensorID;
       idDataEncoder["xMin"]     = static_cast<int > (cellDecoder(rawData)["xMin"]);
       idDataEncoder["xMax"]     = static_cast<int > (cellDecoder(rawData)["xMax"]);
@@ -478,31 +516,21 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
 
       idDataEncoder.setCellID(corrected);
 
-      ShortVec::const_iterator rawIter     = rawData->getADCValues().begin();
-      FloatVec::const_iterator pedIter     = pedestal->getChargeValues().begin();
-      FloatVec::const_iterator noiseIter   = noise->getChargeValues().begin();
-      ShortVec::const_iterator statusIter  = status->getADCValues().begin();
+      const ShortVec& adcValues    = rawData->getADCValues();
+      const FloatVec& pedValues    = pedestal->getChargeValues();
+      const FloatVec& noiseValues  = noise->getChargeValues();
+      const ShortVec& statusValues = status->getADCValues();
+      const size_t    nPixel       = adcValues.size();
+      const int       rowLength    = _maxX[iDetector] - _minX[iDetector] + 1;
+      const int       nRow         = _maxY[iDetector] - _minY[iDetector] + 1;
 
 
       bool isEventValid = true;
       if ( _doCommonMode == 1 ) {
 
         // FULLFRAME common mode
-        while ( rawIter != rawData->getADCValues().end() ) {
-          bool isHit   = ( ((*rawIter) - (*pedIter)) > _hitRejectionCut * (*noiseIter) );
-          bool isGood  = ( (*statusIter) == EUTELESCOPE::GOODPIXEL );
-
-          if ( !isHit && isGood ) {
-            pixelSum += (*rawIter) - (*pedIter);
-            ++goodPixel;
-          } else if ( isHit ) {
-            ++skippedPixel;
-          }
-          ++rawIter;
-          ++pedIter;
-          ++noiseIter;
-          ++statusIter;
-        }
+        EUTelNZSFrameEngine::commonModeSums( adcValues.data(), pedValues.data(), noiseValues.data(), statusValues.data(),
+                                             nPixel, _hitRejectionCut, pixelSum, goodPixel, skippedPixel );
 
         if ( ( ( _maxNoOfRejectedPixels == -1 )  ||  ( skippedPixel < _maxNoOfRejectedPixels ) ) &&
              ( goodPixel != 0 ) ) {
@@ -527,52 +555,34 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
       } else if ( _doCommonMode == 2 ) {
 
         // ROWWISE common mode
-        ShortVec adcValues = rawData->getADCValues ();
-        FloatVec _pedestal     = pedestal->getChargeValues();
-        ShortVec _status  = status->getADCValues();
-        FloatVec  _noise   = noise->getChargeValues();
-        int    iPixel       = 0;
-        int    colCounter   = 0;
-        int    rowLength    = _maxX[iDetector] -  _minX[iDetector] + 1;
-
-        for (int yPixel = _minY[iDetector]; yPixel <= _maxY[iDetector]; yPixel++) {
-
-          double pixelSum           = 0.;
-          double commonMode         = 0.;
-          int    goodPixel          = 0;
-          int    skippedPixelPerRow = 0;
-
-          for ( int xPixel = _minX[iDetector]; xPixel <= _maxX[iDetector]; xPixel++) {
-            bool isHit  = ( ( adcValues[iPixel] - _pedestal[iPixel] ) > _hitRejectionCut * _noise[iPixel] );
-            bool isGood = ( _status[iPixel] == EUTELESCOPE::GOODPIXEL );
-            if ( !isHit && isGood ) {
-              pixelSum += adcValues[iPixel] - _pedestal[iPixel];
-              ++goodPixel;
-            } else if ( isHit ) {
-              ++skippedPixelPerRow;
-              ++skippedPixel;
-            }
-            ++iPixel;
-          }
+        rowCommonMode.assign( nRow, 0. );
+
+        for ( int iRow = 0; iRow < nRow; ++iRow ) {
+
+          const size_t rowStart           = static_cast< size_t >( iRow ) * rowLength;
+          double       pixelSum           = 0.;
+          int          goodPixel          = 0;
+          int          skippedPixelPerRow = 0;
+
+          EUTelNZSFrameEngine::commonModeSums( adcValues.data() + rowStart, pedValues.data() + rowStart,
+                                               noiseValues.data() + rowStart, statusValues.data() + rowStart,
+                                               rowLength, _hitRejectionCut, pixelSum, goodPixel, skippedPixelPerRow );
+          skippedPixel += skippedPixelPerRow;
 
           // we are now at the end of the row, so let's calculate the
           // common mode
           if ( ( skippedPixelPerRow < _maxNoOfRejectedPixelPerRow ) &&
                ( goodPixel != 0 ) ) {
-            commonMode = pixelSum / goodPixel ;
-            commonModeCorVec.insert( commonModeCorVec.begin() + colCounter * rowLength, rowLength, commonMode );
+            rowCommonMode[ iRow ] = pixelSum / goodPixel ;
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
             string tempHistoName = _commonModeDistHistoName + "_d" + to_string( sensorID );
             if ( AIDA::IHistogram1D* histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[tempHistoName]) )
-              histo->fill(commonMode);
+              histo->fill( rowCommonMode[ iRow ] );
 #endif
           } else {
-            commonModeCorVec.insert( commonModeCorVec.begin() + colCounter * rowLength, rowLength, 0. );
             ++skippedRow;
           }
-
-          ++colCounter;
         }
         if ( skippedRow > _maxNoOfSkippedRow ) {
           isEventValid = false;
@@ -581,84 +591,79 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
       } // end if on _doCommonMode
 
       if(isEventValid) {
-        if(_doCommonMode == 2) {
-          ShortVec adcValues = rawData->getADCValues ();
-          FloatVec _pedestal = pedestal->getChargeValues();
-
-          int iPixel = 0;
-
-          for (int yPixel = _minY[iDetector]; yPixel <= _maxY[iDetector]; yPixel++) {
-            for ( int xPixel = _minX[iDetector]; xPixel <= _maxX[iDetector]; xPixel++) {
-
-              double correctedValue = adcValues[iPixel] - _pedestal[iPixel] - commonModeCorVec[iPixel];
-              corrected->chargeValues().push_back(correctedValue);
-
-              ++iPixel;
-#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
-              if (_fillDebugHisto == 1) {
-                string tempHistoName = _rawDataDistHistoName + "_d" + to_string( sensorID );
-                if ( AIDA::IHistogram1D* histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[tempHistoName]) ) {
-                  histo->fill(adcValues[iPixel]);
-                } else {
-                  streamlog_out ( ERROR1 ) << "Not able to retrieve histogram pointer for " << tempHistoName
-                                           << ".\nDisabling histogramming from now on " << endl;
-                  _fillDebugHisto = 0 ;
-                }
-
-                tempHistoName = _dataDistHistoName + "_d" + to_string( sensorID );
-                if ( AIDA::IHistogram1D * histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[tempHistoName]) ) {
-                  histo->fill(correctedValue);
-                } else {
-                  streamlog_out ( ERROR1 ) << "Not able to retrieve histogram pointer for " << tempHistoName
-                                           << ".\nDisabling histogramming from now on " << endl;
-                  _fillDebugHisto = 0 ;
-                }
-              }
-#endif
-            }
+        // the calibrated frame goes directly into the output data, or
+        // into a scratch buffer if only the zero suppressed data are
+        // kept
+        vector< float >& correctedValues = _writeCalibratedData ? corrected->chargeValues() : _calibratedBuffer;
+        correctedValues.resize( nPixel );
+
+        // with the row wise common mode every row has its own
+        // offset. Otherwise the user wants to apply the FullFrame
+        // common mode or doesn't want to apply any correction at
+        // all. In this last case the value of the commonMode
+        // variable is taken directly from the initialization ( = 0 ).
+        const bool   isRowWise   = ( _doCommonMode == 2 );
+        const int    nBlock      = isRowWise ? nRow : 1;
+        const size_t blockLength = isRowWise ? static_cast< size_t >( rowLength ) : nPixel;
+        const float  sigmaCut    = _sigmaCutVec.empty() ? 0.f : _sigmaCutVec[ min< size_t >( iDetector, _sigmaCutVec.size() - 1 ) ];
+
+        // calibrate and zero suppress block by block, so that every
+        // block is still in cache when it is checked against the
+        // threshold
+        _sparseIndices.clear();
+        for ( int iBlock = 0; iBlock < nBlock; ++iBlock ) {
+          const size_t blockStart = iBlock * blockLength;
+          EUTelNZSFrameEngine::subtractPedestal( adcValues.data() + blockStart, pedValues.data() + blockStart, blockLength,
+                                                 isRowWise ? rowCommonMode[ iBlock ] : commonMode,
+                                                 correctedValues.data() + blockStart );
+          if ( sparsifiedDataCollection.get() ) {
+            _frameEngine.selectPixels( correctedValues.data() + blockStart, noiseValues.data() + blockStart,
+                                       statusValues.data() + blockStart, blockLength, sigmaCut,
+                                       static_cast< unsigned int >( blockStart ), _sparseIndices );
           }
-        } else {
-
-          // that's the case the user wants to apply the FullFrame
-          // common mode or doesn't want to apply any correction at
-          // all. In this last case the value of the commonMode
-          // variable is taken directly from the initialization ( = 0 ).
-
-          rawIter     = rawData->getADCValues().begin();
-          pedIter     = pedestal->getChargeValues().begin();
-
-          while ( rawIter != rawData->getADCValues().end() )  {
-
-            double correctedValue = (*rawIter) - (*pedIter) - commonMode;
-            corrected->chargeValues().push_back(correctedValue);
+        }
 
+        if ( sparsifiedDataCollection.get() ) {
+          TrackerDataImpl * sparsified = new TrackerDataImpl;
+          sparsifiedDataCollection->push_back( sparsified );
+          CellIDEncoder<TrackerDataImpl> sparseDataEncoder(EUTELESCOPE::ZSDATADEFAULTENCODING, sparsifiedDataCollection.get());
+          sparseDataEncoder["sensorID"]        = sensorID;
+          sparseDataEncoder["sparsePixelType"] = static_cast<int> ( kEUTelGenericSparsePixel );
+          sparseDataEncoder.setCellID( sparsified );
+
+          // same layout as written by EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>:
+          // x, y, signal and time for every pixel
+          FloatVec& sparseValues = sparsified->chargeValues();
+          sparseValues.resize( 4 * _sparseIndices.size() );
+          for ( size_t iSparse = 0; iSparse < _sparseIndices.size(); ++iSparse ) {
+            const unsigned int iPixel = _sparseIndices[ iSparse ];
+            sparseValues[ 4 * iSparse     ] = static_cast< float >( _minX[ iDetector ] + static_cast< int >( iPixel % rowLength ) );
+            sparseValues[ 4 * iSparse + 1 ] = static_cast< float >( _minY[ iDetector ] + static_cast< int >( iPixel / rowLength ) );
+            sparseValues[ 4 * iSparse + 2 ] = static_cast< short >( correctedValues[ iPixel ] );
+            sparseValues[ 4 * iSparse + 3 ] = 0.;
+          }
+          streamlog_out ( DEBUG0 ) << "Detector " << sensorID << ": " << _sparseIndices.size() << " pixels above threshold" << endl;
+        }
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
-            if (_fillDebugHisto == 1) {
-              string tempHistoName = _rawDataDistHistoName + "_d" + to_string( sensorID );
-              if ( AIDA::IHistogram1D* histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[tempHistoName]) ) {
-                histo->fill(*rawIter);
-              } else {
-                streamlog_out ( ERROR1 ) << "Not able to retrieve histogram pointer for " << tempHistoName
-                                         << ".\nDisabling histogramming from now on " << endl;
-                _fillDebugHisto = 0 ;
-              }
-
-              tempHistoName = _dataDistHistoName + "_d" + to_string( sensorID );
-              if ( AIDA::IHistogram1D * histo = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[tempHistoName]) ) {
-                histo->fill(correctedValue);
-              } else {
-                streamlog_out ( ERROR1 ) << "Not able to retrieve histogram pointer for " << tempHistoName
-                                         << ".\nDisabling histogramming from now on " << endl;
-                _fillDebugHisto = 0 ;
-              }
+        if (_fillDebugHisto == 1) {
+          string rawHistoName  = _rawDataDistHistoName + "_d" + to_string( sensorID );
+          string dataHistoName = _dataDistHistoName + "_d" + to_string( sensorID );
+          AIDA::IHistogram1D * rawHisto  = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[rawHistoName]);
+          AIDA::IHistogram1D * dataHisto = dynamic_cast<AIDA::IHistogram1D*>(_aidaHistoMap[dataHistoName]);
+          if ( rawHisto && dataHisto ) {
+            for ( size_t iPixel = 0; iPixel < nPixel; ++iPixel ) {
+              rawHisto->fill( adcValues[ iPixel ] );
+              dataHisto->fill( correctedValues[ iPixel ] );
             }
-#endif
-            ++rawIter;
-            ++pedIter;
+          } else {
+            streamlog_out ( ERROR1 ) << "Not able to retrieve histogram pointer for "
+                                     << ( rawHisto ? dataHistoName : rawHistoName )
+                                     << ".\nDisabling histogramming from now on " << endl;
+            _fillDebugHisto = 0 ;
           }
         }
-
+#endif
       } else {
         // this is the case the event is not valid because of common
         // mode. This is the right place to throw a SkipEventException
@@ -678,9 +683,13 @@ void EUTelCalibrateEventProcessor::processEvent (LCEvent * event) {
 
 
 
-      correctedDataCollection->push_back(corrected);
     }
-    evt->addCollection(correctedDataCollection, _calibratedDataCollectionName);
+    if ( _writeCalibratedData ) {
+      evt->addCollection(correctedDataCollection.release(), _calibratedDataCollectionName);
+    }
+    if ( sparsifiedDataCollection.get() ) {
+      evt->addCollection(sparsifiedDataCollection.release(), _sparsifiedDataCollectionName);
+    }
 
 
   } catch (DataNotAvailableException& e) {
@@ -0,0 +1,164 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelChi2PValue.h"
+
+// system includes <>
+#include <cmath>
+
+using namespace std;
+using namespace eutelescope;
+
+namespace {
+
+  const double kPrecision = 1e-15;
+  const int kMaxIterations = 1000;
+
+  //! Tables end where the p-value drops below this
+  const double kTableEnd = 1e-15;
+
+  //! Regularised upper incomplete gamma function Q(a, x)
+  /*! Series expansion of P = 1 - Q below x = a + 1, continued fraction
+   *  of Q (modified Lentz) above.
+   */
+  double upperGammaQ( double a, double x ) {
+    if ( x <= 0 ) return 1.;
+    const double prefactor = exp( a * log( x ) - x - lgamma( a ) );
+
+    if ( x < a + 1 ) {
+      double term = 1. / a;
+      double sum = term;
+      for ( int n = 1; n < kMaxIterations; ++n ) {
+        term *= x / ( a + n );
+        sum += term;
+        if ( fabs( term ) < fabs( sum ) * kPrecision ) break;
+      }
+      return 1. - sum * prefactor;
+    }
+
+    const double tiny = 1e-300;
+    double b = x + 1. - a;
+    double c = 1. / tiny;
+    double d = 1. / b;
+    double h = d;
+    for ( int n = 1; n < kMaxIterations; ++n ) {
+      const double an = -n * ( n - a );
+      b += 2.;
+      d = an * d + b;
+      if ( fabs( d ) < tiny ) d = tiny;
+      c = b + an / c;
+      if ( fabs( c ) < tiny ) c = tiny;
+      d = 1. / d;
+      const double delta = d * c;
+      h *= delta;
+      if ( fabs( delta - 1. ) < kPrecision ) break;
+    }
+    return prefactor * h;
+  }
+
+  //! Derivative of the p-value w.r.t. t = sqrt(chi2), -2 t f(t^2) for the chi2 density f
+  double pValueSlope( double t, int ndf ) {
+    const double a = 0.5 * ndf;
+    if ( t <= 0 ) return ndf == 1 ? -sqrt( 2. / M_PI ) : 0.;
+    const double x = t * t;
+    return -2. * t * exp( ( a - 1. ) * log( x ) - 0.5 * x - a * log( 2. ) - lgamma( a ) );
+  }
+
+  //! p-value of the arguments not needing a computation, returns false for all others
+  /*! NaN arguments, e.g. of a failed fit, and infinite ones give 0, so
+   *  that they never reach the table index computation.
+   */
+  bool trivialPValue( double chi2, double ndf, double& pValue ) {
+    if ( std::isnan( chi2 ) || std::isnan( ndf ) || std::isinf( ndf ) || ndf <= 0 ) {
+      pValue = 0.;
+    } else if ( chi2 <= 0 ) {
+      pValue = 1.;
+    } else if ( std::isinf( chi2 ) ) {
+      pValue = 0.;
+    } else {
+      return false;
+    }
+    return true;
+  }
+}
+
+const EUTelChi2PValue& EUTelChi2PValue::getInstance() {
+  static const EUTelChi2PValue instance;
+  return instance;
+}
+
+EUTelChi2PValue::EUTelChi2PValue( int maxTableNdf ) :
+  _maxTableNdf( maxTableNdf > 0 ? maxTableNdf : 0 ),
+  _step( 1. / 32. ),
+  _nodes(),
+  _offset( _maxTableNdf + 2, 0 ) {
+
+  for ( int ndf = 1; ndf <= _maxTableNdf; ++ndf ) {
+    _offset[ ndf ] = _nodes.size();
+    for ( int i = 0; ; ++i ) {
+      const double t = i * _step;
+      Node node;
+      node.pValue = upperGammaQ( 0.5 * ndf, 0.5 * t * t );
+      node.slope = _step * pValueSlope( t, ndf );
+      _nodes.push_back( node );
+      if ( node.pValue < kTableEnd ) break;
+    }
+  }
+  _offset[ _maxTableNdf + 1 ] = _nodes.size();
+}
+
+double EUTelChi2PValue::operator()( double chi2, double ndf ) const {
+  double pValue = 0.;
+  if ( trivialPValue( chi2, ndf, pValue ) ) return pValue;
+
+  const double rounded = floor( ndf + 0.5 );
+  if ( fabs( ndf - rounded ) > 1e-6 * ndf ) return exact( chi2, ndf );
+  if ( rounded > _maxTableNdf ) return approximate( chi2, rounded );
+  return interpolate( chi2, static_cast< int >( rounded ) );
+}
+
+void EUTelChi2PValue::evaluate( const float* chi2, const float* ndf, float* pValue, size_t n ) const {
+  for ( size_t i = 0; i < n; ++i ) {
+    pValue[i] = static_cast< float >( ( *this )( chi2[i], ndf[i] ) );
+  }
+}
+
+double EUTelChi2PValue::exact( double chi2, double ndf ) {
+  double pValue = 0.;
+  if ( trivialPValue( chi2, ndf, pValue ) ) return pValue;
+  return upperGammaQ( 0.5 * ndf, 0.5 * chi2 );
+}
+
+double EUTelChi2PValue::interpolate( double chi2, int ndf ) const {
+  const size_t begin = _offset[ ndf ];
+  const size_t nNodes = _offset[ ndf + 1 ] - begin;
+
+  const double u = sqrt( chi2 ) / _step;
+  if ( u >= nNodes - 1 ) return exact( chi2, ndf );
+
+  const size_t i = static_cast< size_t >( u );
+  const double s = u - i;
+  const Node& n0 = _nodes[ begin + i ];
+  const Node& n1 = _nodes[ begin + i + 1 ];
+
+  // cubic Hermite basis
+  const double r = 1. - s;
+  const double h00 = ( 1. + 2. * s ) * r * r;
+  const double h10 = s * r * r;
+  const double h01 = s * s * ( 3. - 2. * s );
+  const double h11 = -s * s * r;
+  return h00 * n0.pValue + h10 * n0.slope + h01 * n1.pValue + h11 * n1.slope;
+}
+
+double EUTelChi2PValue::approximate( double chi2, double ndf ) {
+  const double h = 2. / ( 9. * ndf );
+  const double z = ( pow( chi2 / ndf, 1. / 3. ) - ( 1. - h ) ) / sqrt( h );
+  return 0.5 * erfc( z / sqrt( 2. ) );
+}
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelVirtualCluster.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelFFClusterImpl.h"
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
@@ -708,6 +709,7 @@ void EUTelClusterFilter::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelClusterFilter::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
 
     ++_iEvt;
 
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelFFClusterImpl.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelSparseClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelEventImpl.h"
@@ -32,6 +33,9 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <iostream>
 #include <iomanip>
@@ -41,7 +45,53 @@ using namespace lcio;
 using namespace marlin;
 using namespace eutelescope;
 
-EUTelClusterSeparationProcessor::EUTelClusterSeparationProcessor () :Processor("EUTelClusterSeparationProcessor") {
+namespace {
+
+  //! Disjoint-set over the indices 0 ... n-1
+  class DisjointSet {
+
+  public:
+    explicit DisjointSet(size_t n) : _parent(n), _rank(n, 0) {
+      for ( size_t i = 0; i < n; ++i ) _parent[i] = i;
+    }
+
+    //! Representative of the set containing i
+    size_t find(size_t i) {
+      while ( _parent[i] != i ) {
+        // path halving
+        _parent[i] = _parent[ _parent[i] ];
+        i = _parent[i];
+      }
+      return i;
+    }
+
+    //! Merges the sets containing i and j
+    void unite(size_t i, size_t j) {
+      i = find(i);
+      j = find(j);
+      if ( i == j ) return;
+      if ( _rank[i] < _rank[j] ) swap(i, j);
+      _parent[j] = i;
+      if ( _rank[i] == _rank[j] ) ++_rank[i];
+    }
+
+  private:
+    vector<size_t> _parent;
+    vector<unsigned char> _rank;
+  };
+
+  //! Orders cluster indices by the x center of the decoded clusters
+  template <class DecodedCluster>
+  struct XCenterLess {
+    explicit XCenterLess(const vector<DecodedCluster>& clusters) : _clusters(clusters) { }
+    bool operator()(int i, int j) const { return _clusters[i].xCenter < _clusters[j].xCenter; }
+    const vector<DecodedCluster>& _clusters;
+  };
+
+}
+
+EUTelClusterSeparationProcessor::EUTelClusterSeparationProcessor () :Processor("EUTelClusterSeparationProcessor"),
+  _decodedClusters() {
 
   // modify processor description
   _description = "EUTelClusterSeparationProcessor separates merging clusters";
@@ -69,6 +119,10 @@ EUTelClusterSeparationProcessor::EUTelClusterSeparationProcessor () :Processor("
 }
 
 
+EUTelClusterSeparationProcessor::~EUTelClusterSeparationProcessor () {
+  clearDecodedClusters();
+}
+
 void EUTelClusterSeparationProcessor::init () {
   // this method is called only once even when the rewind is active
   // usually a good idea to
@@ -91,6 +145,7 @@ void EUTelClusterSeparationProcessor::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelClusterSeparationProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> ( event );
 
@@ -114,9 +169,61 @@ void EUTelClusterSeparationProcessor::processEvent (LCEvent * event) {
 
   LCCollectionVec * outputCollectionVec  =  new LCCollectionVec(LCIO::TRACKERPULSE);
   CellIDEncoder<TrackerPulseImpl> outputEncoder(EUTELESCOPE::PULSEDEFAULTENCODING, outputCollectionVec);
-  CellIDDecoder<TrackerPulseImpl> cellDecoder(clusterCollectionVec);
+
+  // decode all clusters once, they are used by both the pair
+  // finding and the separation algorithm
+  decodeClusters(evt, clusterCollectionVec);
 
   vector< pair<int, int > >       mergingPairVector;
+  findMergingPairs(&mergingPairVector);
+
+  // at this point we have inserted into the mergingPairVector all the
+  // pairs of merging clusters. we can try to put together all groups
+  // of clusters, but only in the case the mergingPairVector has a non
+  // null size
+  if ( mergingPairVector.empty() ) {
+    // if the mergingPairVector is empty, then there are no merging
+    // clusters, i.e. that the input and the output collections are
+    // exactly the same
+    for ( int iPulse = 0; iPulse < clusterCollectionVec->getNumberOfElements() ; iPulse++ ) {
+      TrackerPulseImpl * pulse    = dynamic_cast<TrackerPulseImpl *> ( clusterCollectionVec->getElementAt( iPulse ) );
+      TrackerPulseImpl * newPulse = new TrackerPulseImpl;
+      newPulse->setCellID0( pulse->getCellID0() );
+      newPulse->setCellID1( pulse->getCellID1() );
+      newPulse->setTime   ( pulse->getTime() );
+      newPulse->setCharge ( pulse->getCharge() );
+      newPulse->setQuality( pulse->getQuality() );
+      newPulse->setTrackerData( pulse->getTrackerData() );
+
+      outputCollectionVec->push_back( newPulse );
+    }
+    evt->addCollection( outputCollectionVec, _clusterOutputCollectionName );
+    return ;
+  }
+
+  // all merging clusters are collected into a vector of set. Each set
+  // is a group of clusters all merging.
+  vector< set<int > > mergingSetVector;
+  groupingMergingPairs(mergingPairVector, &mergingSetVector) ;
+
+  applySeparationAlgorithm(mergingSetVector, clusterCollectionVec, outputCollectionVec);
+  evt->addCollection( outputCollectionVec, _clusterOutputCollectionName );
+
+
+}
+
+
+void EUTelClusterSeparationProcessor::decodeClusters(LCEvent * evt, LCCollectionVec * clusterCollectionVec) {
+
+  clearDecodedClusters();
+
+  CellIDDecoder<TrackerPulseImpl> cellDecoder(clusterCollectionVec);
+
+  // the pixel type of sparse clusters is looked up only once
+  bool            isPixelTypeKnown = false;
+  SparsePixelType pixelType        = kEUTelGenericSparsePixel;
+
+  _decodedClusters.reserve( clusterCollectionVec->getNumberOfElements() );
 
   for ( int iCluster = 0 ; iCluster < clusterCollectionVec->getNumberOfElements() ; iCluster++) {
 
@@ -140,11 +247,13 @@ void EUTelClusterSeparationProcessor::processEvent (LCEvent * event) {
       // ok the cluster is of sparse type, but we also need to know
       // the kind of pixel description used. This information is
       // stored in the corresponding original data collection.
-
-      LCCollectionVec * sparseClusterCollectionVec = dynamic_cast < LCCollectionVec * > (evt->getCollection("original_zsdata"));
-      TrackerDataImpl * oneCluster = dynamic_cast<TrackerDataImpl*> (sparseClusterCollectionVec->getElementAt( 0 ));
-      CellIDDecoder<TrackerDataImpl > anotherDecoder(sparseClusterCollectionVec);
-      SparsePixelType pixelType = static_cast<SparsePixelType> ( static_cast<int> ( anotherDecoder( oneCluster )["sparsePixelType"] ));
+      if ( !isPixelTypeKnown ) {
+        LCCollectionVec * sparseClusterCollectionVec = dynamic_cast < LCCollectionVec * > (evt->getCollection("original_zsdata"));
+        TrackerDataImpl * oneCluster = dynamic_cast<TrackerDataImpl*> (sparseClusterCollectionVec->getElementAt( 0 ));
+        CellIDDecoder<TrackerDataImpl > anotherDecoder(sparseClusterCollectionVec);
+        pixelType = static_cast<SparsePixelType> ( static_cast<int> ( anotherDecoder( oneCluster )["sparsePixelType"] ));
+        isPixelTypeKnown = true;
+      }
 
       // now we know the pixel type. So we can properly create a new
       // instance of the sparse cluster
@@ -161,94 +270,67 @@ void EUTelClusterSeparationProcessor::processEvent (LCEvent * event) {
       throw UnknownDataTypeException("Cluster type unknown");
     }
 
-    int  iOtherCluster     = iCluster + 1;
-    bool isExisisting      = (iOtherCluster < clusterCollectionVec->getNumberOfElements() );
-    bool isOnSameDetector  = true;
+    DecodedCluster decoded;
+    decoded.cluster    = cluster;
+    decoded.detectorID = cluster->getDetectorID();
+    cluster->getCenterCoord( decoded.xCenter, decoded.yCenter );
+    decoded.radius     = cluster->getExternalRadius();
+    _decodedClusters.push_back( decoded );
+  }
+}
 
+void EUTelClusterSeparationProcessor::clearDecodedClusters() {
+  for ( size_t iCluster = 0; iCluster < _decodedClusters.size(); ++iCluster ) {
+    delete _decodedClusters[iCluster].cluster;
+  }
+  _decodedClusters.clear();
+}
 
-    while ( isOnSameDetector && isExisisting ) {
+void EUTelClusterSeparationProcessor::findMergingPairs(std::vector< std::pair<int , int> > * pairVector) const {
 
-      // get the next cluster in the collection
-      TrackerPulseImpl    * otherPulse   = dynamic_cast<TrackerPulseImpl *> (clusterCollectionVec->getElementAt(iOtherCluster)) ;
-      EUTelVirtualCluster * otherCluster;
+  // cluster indices per detector, sorted by the x center below
+  map< int, vector<int > > detectorClusters;
+  for ( size_t iCluster = 0; iCluster < _decodedClusters.size(); ++iCluster ) {
+    detectorClusters[ _decodedClusters[iCluster].detectorID ].push_back( iCluster );
+  }
 
-      if ( type == kEUTelFFClusterImpl )
-        otherCluster = new EUTelFFClusterImpl( static_cast<TrackerDataImpl*> (otherPulse->getTrackerData()) );
-      else if ( type == kEUTelBrickedClusterImpl )
-        otherCluster = new EUTelBrickedClusterImpl( static_cast<TrackerDataImpl*> (otherPulse->getTrackerData()) );
-      else
-      {
-        streamlog_out ( ERROR4 ) << "Unknown cluster type. Sorry for quitting" << endl;
-        throw UnknownDataTypeException("Cluster type unknown");
-      }
+  map< int, vector<int > >::iterator detIter = detectorClusters.begin();
+  while ( detIter != detectorClusters.end() ) {
 
-      // check if the two are on the same detector
-      if ( cluster->getDetectorID() == otherCluster->getDetectorID() ) {
+    vector<int >& indices = detIter->second;
+    stable_sort( indices.begin(), indices.end(), XCenterLess<DecodedCluster>( _decodedClusters ) );
 
-        if ( _minimumDistance == 0 ) {
-          // ok we need to calculate the touching distance
-          float radius      = cluster->getExternalRadius();
-          float otherRadius = otherCluster->getExternalRadius();
-          _minimumDistance  = radius + otherRadius;
-        }
+    // with a zero minimum distance two clusters are merging when
+    // closer than the sum of their radii
+    float maxRadius = 0;
+    for ( size_t i = 0; i < indices.size(); ++i ) maxRadius = max( maxRadius, _decodedClusters[ indices[i] ].radius );
+
+    for ( size_t i = 0; i < indices.size(); ++i ) {
+      const DecodedCluster& cluster = _decodedClusters[ indices[i] ];
+      const float reach = ( _minimumDistance == 0 ) ? cluster.radius + maxRadius : _minimumDistance;
+
+      // the distance is at least the distance in x, so the sweep can
+      // stop at the first cluster out of reach
+      for ( size_t j = i + 1; j < indices.size(); ++j ) {
+        const DecodedCluster& otherCluster = _decodedClusters[ indices[j] ];
+        if ( otherCluster.xCenter - cluster.xCenter >= reach ) break;
 
-        // ok they are on the same plane, so it makes sense check it
-        // they are merging
-        float distance = cluster->getDistance(otherCluster);
+        const float minimumDistance = ( _minimumDistance == 0 ) ? cluster.radius + otherCluster.radius : _minimumDistance;
+        const float distance = sqrt( pow( static_cast<double> ( cluster.xCenter - otherCluster.xCenter ), 2 ) +
+                                     pow( static_cast<double> ( cluster.yCenter - otherCluster.yCenter ), 2 ) );
 
-        if ( distance < _minimumDistance ) {
+        if ( distance < minimumDistance ) {
           // they are merging! we need to apply the separation
           // algorithm
-          mergingPairVector.push_back( make_pair(iCluster, iOtherCluster) );
+          pairVector->push_back( make_pair( min( indices[i], indices[j] ), max( indices[i], indices[j] ) ) );
         }
-
-      } else {
-        isOnSameDetector = false;
       }
-      isExisisting = (++iOtherCluster <  clusterCollectionVec->getNumberOfElements() );
-      delete otherCluster;
-    }
-
-    delete cluster;
-  }
-
-  // at this point we have inserted into the mergingPairVector all the
-  // pairs of merging clusters. we can try to put together all groups
-  // of clusters, but only in the case the mergingPairVector has a non
-  // null size
-  if ( mergingPairVector.empty() ) {
-    // if the mergingPairVector is empty, then there are no merging
-    // clusters, i.e. that the input and the output collections are
-    // exactly the same
-    for ( int iPulse = 0; iPulse < clusterCollectionVec->getNumberOfElements() ; iPulse++ ) {
-      TrackerPulseImpl * pulse    = dynamic_cast<TrackerPulseImpl *> ( clusterCollectionVec->getElementAt( iPulse ) );
-      TrackerPulseImpl * newPulse = new TrackerPulseImpl;
-      newPulse->setCellID0( pulse->getCellID0() );
-      newPulse->setCellID1( pulse->getCellID1() );
-      newPulse->setTime   ( pulse->getTime() );
-      newPulse->setCharge ( pulse->getCharge() );
-      newPulse->setQuality( pulse->getQuality() );
-      newPulse->setTrackerData( pulse->getTrackerData() );
-
-      outputCollectionVec->push_back( newPulse );
     }
-    evt->addCollection( outputCollectionVec, _clusterOutputCollectionName );
-    return ;
+    ++detIter;
   }
-
-  // all merging clusters are collected into a vector of set. Each set
-  // is a group of clusters all merging.
-  vector< set<int > > mergingSetVector;
-  groupingMergingPairs(mergingPairVector, &mergingSetVector) ;
-
-  applySeparationAlgorithm(mergingSetVector, clusterCollectionVec, outputCollectionVec);
-  evt->addCollection( outputCollectionVec, _clusterOutputCollectionName );
-
-
 }
 
-
-bool EUTelClusterSeparationProcessor::applySeparationAlgorithm(std::vector<std::set <int > > setVector,
+bool EUTelClusterSeparationProcessor::applySeparationAlgorithm(const std::vector<std::set <int > >& setVector,
                                                                LCCollectionVec * inputCollectionVec,
                                                                LCCollectionVec * outputCollectionVec) const {
 
@@ -279,33 +361,18 @@ bool EUTelClusterSeparationProcessor::applySeparationAlgorithm(std::vector<std::
     }
 
 
-    CellIDDecoder<TrackerPulseImpl> cellDecoder(outputCollectionVec);
-
-
     int iCounter = 0;
 
-    vector<set <int > >::iterator vectorIterator = setVector.begin();
+    vector<set <int > >::const_iterator vectorIterator = setVector.begin();
     while ( vectorIterator != setVector.end() ) {
 
 
       streamlog_out ( DEBUG4 )  <<  "     Group " << (iCounter++) << " with the following clusters " << endl;
 
-      set <int >::iterator setIterator = (*vectorIterator).begin();
+      set <int >::const_iterator setIterator = (*vectorIterator).begin();
       while ( setIterator != (*vectorIterator).end() ) {
         TrackerPulseImpl    * pulse   = dynamic_cast<TrackerPulseImpl * > ( outputCollectionVec->getElementAt( *setIterator ) ) ;
-        ClusterType           type    = static_cast<ClusterType> (static_cast<int>( cellDecoder(pulse)["type"] ) );
-
-        EUTelVirtualCluster * cluster;
-
-        if ( type == kEUTelFFClusterImpl )
-          cluster = new EUTelFFClusterImpl( static_cast<TrackerDataImpl*> (pulse->getTrackerData()) );
-        else if ( type == kEUTelBrickedClusterImpl )
-          cluster = new EUTelBrickedClusterImpl( static_cast<TrackerDataImpl*> (pulse->getTrackerData()) );
-        else
-        {
-          message<ERROR5> ( "Unknown cluster type. Sorry for quitting" ) ;
-          throw UnknownDataTypeException("Cluster type unknown");
-        }
+        EUTelVirtualCluster * cluster = _decodedClusters[ *setIterator ].cluster;
 
         streamlog_out ( DEBUG4 ) << ( * cluster ) << endl;
 
@@ -318,7 +385,6 @@ bool EUTelClusterSeparationProcessor::applySeparationAlgorithm(std::vector<std::
         }
         pulse->setQuality ( static_cast<int> (ClusterQuality( pulse->getQuality() | kMergedCluster )) );
         ++setIterator;
-        delete cluster;
       }
       ++vectorIterator;
     }
@@ -330,42 +396,36 @@ bool EUTelClusterSeparationProcessor::applySeparationAlgorithm(std::vector<std::
 
 }
 
-void EUTelClusterSeparationProcessor::groupingMergingPairs(std::vector< std::pair<int , int> > pairVector,
+void EUTelClusterSeparationProcessor::groupingMergingPairs(const std::vector< std::pair<int , int> >& pairVector,
                                                            std::vector< std::set<int > > * setVector) const {
 
   streamlog_out ( DEBUG0 ) << "Grouping merging pairs of clusters " << endl;
 
-  vector< pair<int, int> >::iterator iter = pairVector.begin();
+  int nClusters = 0;
+  vector< pair<int, int> >::const_iterator iter = pairVector.begin();
   while ( iter != pairVector.end() ) {
+    nClusters = max( nClusters, max( iter->first, iter->second ) + 1 );
+    ++iter;
+  }
 
-    set<int > tempSet;
-    // add the pair to the tempSet
-    tempSet.insert(pairVector.front().first);
-    tempSet.insert(pairVector.front().second);
-
-    vector<vector< pair<int, int> >::iterator > tempIterVec;
-    tempIterVec.push_back(iter);
-
-    if ( iter + 1 != pairVector.end() ) {
-      vector< pair<int, int> >::iterator otherIter = iter + 1;
-      while (otherIter != pairVector.end() ) {
-        if ( ( tempSet.find(otherIter->first)  != tempSet.end() ) ||
-             ( tempSet.find(otherIter->second) != tempSet.end() ) ) {
-          tempSet.insert(otherIter->first);
-          tempSet.insert(otherIter->second);
-          tempIterVec.push_back(otherIter);
-        }
-        ++otherIter;
-      }
-    }
-    setVector->push_back(tempSet);
+  DisjointSet mergingClusters( nClusters );
+  vector<bool > isMerging( nClusters, false );
+  for ( iter = pairVector.begin(); iter != pairVector.end(); ++iter ) {
+    mergingClusters.unite( iter->first, iter->second );
+    isMerging[ iter->first ]  = true;
+    isMerging[ iter->second ] = true;
+  }
 
-    // remove the pairs already grouped starting from the last
-    vector<vector< pair<int, int> >::iterator >::reverse_iterator iterIter = tempIterVec.rbegin();
-    while ( iterIter != tempIterVec.rend() ) {
-      pairVector.erase(*iterIter);
-      ++iterIter;
+  // one set per representative, in order of the lowest cluster index
+  vector<int > setIndex( nClusters, -1 );
+  for ( int iCluster = 0; iCluster < nClusters; ++iCluster ) {
+    if ( !isMerging[ iCluster ] ) continue;
+    const size_t root = mergingClusters.find( iCluster );
+    if ( setIndex[ root ] < 0 ) {
+      setIndex[ root ] = setVector->size();
+      setVector->push_back( set<int >() );
     }
+    (*setVector)[ setIndex[ root ] ].insert( iCluster );
   }
 }
 
@@ -375,6 +435,7 @@ void EUTelClusterSeparationProcessor::check (LCEvent * /* evt */ ) {
 
 
 void EUTelClusterSeparationProcessor::end() {
+  clearDecodedClusters();
   streamlog_out ( MESSAGE2 ) << "Successfully finished" << endl;
 }
 
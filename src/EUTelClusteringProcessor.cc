@@ -18,6 +18,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTelClusteringProcessor.h"
@@ -94,7 +95,7 @@ EUTelClusteringProcessor::EUTelClusteringProcessor ()
       _iEvt(0),
       _fillHistos(false),
       _histoInfoFileName(""),
-      _seedCandidateMap(),
+      _frameEngine(),
       _totClusterMap(),
       _noOfDetector(0),
       _ExcludedPlanes(),
@@ -676,6 +677,7 @@ void EUTelClusteringProcessor::readCollections (LCEvent * event)
 
 void EUTelClusteringProcessor::processEvent (LCEvent * event)
 {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
     ID = 0;
     ++_iEvt;
 
@@ -2300,33 +2302,20 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
         short clusterCounter = 0;
         short limitExceed    = 0;
 
-        _seedCandidateMap.clear();
+        _frameEngine.findSeeds( nzsData->getChargeValues(), noise->getChargeValues(), status->getADCValues(), _ffSeedCut );
 
-        for (unsigned int iPixel = 0; iPixel < nzsData->getChargeValues().size(); iPixel++)
-        {
-            if (status->getADCValues()[iPixel] == EUTELESCOPE::GOODPIXEL)
-            {
-                if ( nzsData->getChargeValues()[iPixel] > _ffSeedCut * noise->getChargeValues()[iPixel])
-                {
-                    _seedCandidateMap.push_back(make_pair( nzsData->getChargeValues()[iPixel], iPixel));
-                }
-            }
-        }
+        // continue only if there are seed candidates!
+        if ( _frameEngine.getNSeedCandidates() != 0 ) {
 
-        // continue only if seed candidate map is not empty!
-        if ( !_seedCandidateMap.empty() ) {
+            streamlog_out ( DEBUG0 ) << "There are << " << _frameEngine.getNSeedCandidates() << " seed candidates." << endl;
 
-            streamlog_out ( DEBUG0 ) << "There are << " << _seedCandidateMap.size() << " seed candidates." << endl;
-
-            // now built up a cluster for each seed candidate
-            //Start by sorting the vector in order of smallest to largest seed signal
-            std::sort(_seedCandidateMap.begin(),_seedCandidateMap.end());
-            vector< pair< float, unsigned int > >::iterator mapIter = _seedCandidateMap.end();
-            while ( mapIter != _seedCandidateMap.begin() ) {
-                --mapIter;
+            // now built up a cluster for each seed candidate, the frame
+            // engine returns them from the highest to the smallest signal
+            unsigned int seedIndex;
+            while ( _frameEngine.nextSeed( seedIndex ) ) {
                 // check if this seed candidate has not been already added to a
                 // cluster
-                if ( status->adcValues()[(*mapIter).second] == EUTELESCOPE::GOODPIXEL ) {
+                if ( status->adcValues()[seedIndex] == EUTELESCOPE::GOODPIXEL ) {
                     // if we enter here, this means that at least the seed pixel
                     // wasn't added yet to another cluster.  Note that now we need
                     // to build a candidate cluster that has to pass the
@@ -2336,7 +2325,7 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
                     FloatVec clusterCandidateCharges;
                     IntVec   clusterCandidateIndeces;
                     int seedX, seedY;
-                    matrixDecoder.getXYFromIndex((*mapIter).second,seedX, seedY);
+                    matrixDecoder.getXYFromIndex(seedIndex,seedX, seedY);
 
                     // start looping around the seed pixel. Remember that the seed
                     // pixel has to stay in the center of cluster
@@ -2554,49 +2543,41 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
         // reset the status
         resetStatus(status);
 
-        // prepare a multimap for the seed candidates
-        vector< pair <float, int> > seedCandidateMap;
+        // collect the seed candidates
+        //! CUT 1
+        _frameEngine.findSeeds( nzsData->getChargeValues(), noise->getChargeValues(), status->getADCValues(), _ffSeedCut );
 
-        // fill the seed candidate map
-        for (unsigned int iPixel = 0; iPixel < nzsData->getChargeValues().size(); iPixel++)
+        const vector< pair<float, unsigned int> >& seedCandidates = _frameEngine.getSeedCandidates();
+        for ( size_t iCandidate = 0; iCandidate < seedCandidates.size(); ++iCandidate )
         {
-            if (status->getADCValues()[iPixel] == EUTELESCOPE::GOODPIXEL)
-            {
-                //! CUT 1
-                if ( nzsData->getChargeValues()[iPixel] > _ffSeedCut * noise->getChargeValues()[iPixel])
-                {
-                    seedCandidateMap.push_back(make_pair( nzsData->getChargeValues()[iPixel], iPixel));
-                    streamlog_out ( MESSAGE2 )
-                        << "Added pixel at (index=" << iPixel
-                        << ") with signal " << nzsData->getChargeValues()[iPixel]
-                        << " to the seedCandidateMap" << endl;
+            const unsigned int iPixel = seedCandidates[ iCandidate ].second;
+            streamlog_out ( MESSAGE2 )
+                << "Added pixel at (index=" << iPixel
+                << ") with signal " << nzsData->getChargeValues()[iPixel]
+                << " to the seed candidates" << endl;
 
-                    if ( noise->getChargeValues()[ iPixel ] < 0.01 )
-                    {
-                        streamlog_out ( ERROR2 )    << "ZERO NOISE SEED PIXEL ADDED (nszBrickedClustering)!"
-                                                    << "\n index=" << iPixel
-                                                    << "\n amp=" << nzsData->getChargeValues()[ iPixel ]
-                                                    << "\n status=" << status->getADCValues()[ iPixel ]
-                                                    <<    " GOODP   =  0,"
-                                                    <<    " BAD     =  1,"
-                                                    <<    " HIT     = -1,"
-                                                    <<    " MISSING =  2,"
-                                                    <<    " FIRING  =  3.";
-                    }
-                }
+            if ( noise->getChargeValues()[ iPixel ] < 0.01 )
+            {
+                streamlog_out ( ERROR2 )    << "ZERO NOISE SEED PIXEL ADDED (nszBrickedClustering)!"
+                                            << "\n index=" << iPixel
+                                            << "\n amp=" << nzsData->getChargeValues()[ iPixel ]
+                                            << "\n status=" << status->getADCValues()[ iPixel ]
+                                            <<    " GOODP   =  0,"
+                                            <<    " BAD     =  1,"
+                                            <<    " HIT     = -1,"
+                                            <<    " MISSING =  2,"
+                                            <<    " FIRING  =  3.";
             }
         }
 
-        streamlog_out ( DEBUG0 ) << "The number of seed candidates is: " << seedCandidateMap.size() << endl;
-        std::sort(seedCandidateMap.begin(),seedCandidateMap.end());
-        if ( !seedCandidateMap.empty() )
+        streamlog_out ( DEBUG0 ) << "The number of seed candidates is: " << _frameEngine.getNSeedCandidates() << endl;
+        if ( _frameEngine.getNSeedCandidates() != 0 )
         {
-            // now build up a cluster for each seed candidate
-            vector< pair<float, int> >::iterator rMapIter = seedCandidateMap.end();
-            while ( rMapIter != seedCandidateMap.begin() )
+            // now build up a cluster for each seed candidate, highest signal first
+            unsigned int seedIndex;
+            while ( _frameEngine.nextSeed( seedIndex ) )
             {
-                rMapIter--;
-                if ( status->adcValues()[ (*rMapIter).second ] == EUTELESCOPE::GOODPIXEL )
+                if ( status->adcValues()[ seedIndex ] == EUTELESCOPE::GOODPIXEL )
                 {
                     // if we enter here, this means that at least the seed pixel
                     // wasn't added yet to another cluster.  Note that now we need
@@ -2613,7 +2594,7 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
                     // start looping around the seed pixel. Remember that the seed
                     // pixel has to stay in the center of cluster
                     int seedX, seedY;
-                    matrixDecoder.getXYFromIndex ( (*rMapIter).second, seedX, seedY );
+                    matrixDecoder.getXYFromIndex ( seedIndex, seedX, seedY );
 
                     for (int yPixel = seedY - (_ffYClusterSize / 2); yPixel <= seedY + (_ffYClusterSize / 2); yPixel++)
                     {
@@ -2817,8 +2798,8 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
                     delete brickedClusterCandidate;
 
                 } //END: if ( currentSeedpixelcandidate == EUTELESCOPE::GOODPIXEL )
-            } //END: while (not all seed candidates in the map have been processed) ((while ( rMapIter != seedCandidateMap.rend() )))
-        } //END: if ( seedCandidateMap.size() != 0 )
+            } //END: while (not all seed candidates have been processed)
+        } //END: if ( there are seed candidates )
     } //for ( unsigned int i = 0 ; i < zsInputDataCollectionVec->size(); i++ )
 
     // if the sparseClusterCollectionVec isn't empty add it to the
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelCopyPedestalProcessor.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -92,6 +93,7 @@ void EUTelCopyPedestalProcessor::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelCopyPedestalProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
 
@@ -15,6 +15,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelHistogramManager.h"
  
 #include "EUTelCorrelator.h"
@@ -221,6 +222,7 @@ void EUTelCorrelator::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelCorrelator::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 
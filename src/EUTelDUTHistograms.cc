@@ -14,6 +14,7 @@
 
 // eutelescope includes
 #include "EUTelDUTHistograms.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
 #include "EUTelRunHeaderImpl.h"
@@ -283,6 +284,7 @@ void EUTelDUTHistograms::processRunHeader( LCRunHeader* runHeader) {
 }
 
 void EUTelDUTHistograms::processEvent( LCEvent * event ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   streamlog_out( DEBUG5 ) << "EUTelDUTHistograms::processEvent " << endl;
 
@@ -238,7 +238,7 @@ void EUTelDafAlign::dafEvent (LCEvent* /*event*/) {
   for(size_t ii = 0; ii < _system.getNtracks(); ii++ ){
     //run track fitter
     _nCandidates++;
-    _system.fitPlanesInfoDaf(_system.tracks.at(ii));
+    fitTrackCandidate(ii);
     //Check resids, intime, angles
     if(not checkTrack( _system.tracks.at(ii))) { continue;};
     //This guy includes DUT planes and adds weights to measurements based on resid cuts
@@ -37,6 +37,8 @@
 // built only if GEAR and MARLINUTIL are used
 #if defined(USE_GEAR)
 // eutelescope includes ".h"
+#include "EUTelEventPipeline.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelDafBase.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
@@ -98,6 +100,19 @@ using namespace lcio;
 using namespace marlin;
 using namespace eutelescope;
 
+namespace {
+  //! DAF fit of all track candidates of a tracker system
+  void fitAllCandidates(daffitter::TrackerSystem<float,4>& system, bool batched){
+    size_t batchSize = daffitter::TrackerSystem<float,4>::dafBatchSize;
+    for(size_t ii = 0; ii < system.getNtracks(); ii += batched ? batchSize : 1){
+      if(batched){
+	system.fitPlanesInfoDafBatch(ii, batchSize);
+      } else {
+	system.fitPlanesInfoDaf(system.tracks.at(ii));
+      }
+    }
+  }
+}
 
 EUTelDafBase::EUTelDafBase(std::string name) : marlin::Processor(name) {
   //Universal DAF params
@@ -147,6 +162,9 @@ EUTelDafBase::EUTelDafBase(std::string name) : marlin::Processor(name) {
   //registerOptionalParameter("FinderRadius","Track finding: The maximum allowed distance between to hits in the xy plane for inclusion in track candidate", _clusterRadius, static_cast<float>(300.0));
   registerOptionalParameter("FinderRadius","Track finding: The maximum allowed normalized distance between to hits in the xy plane for inclusion in track candidate.", _normalizedRadius, static_cast<float>(300.0));
   registerOptionalParameter("Chi2Cutoff","DAF fitter: The cutoff value for a measurement to be included in the fit.", _chi2cutoff, static_cast<float>(300.0f));
+  registerOptionalParameter("BatchedDaf","DAF fitter: Fit track candidates in batches, faster for events with many candidates.", _batchedDaf, static_cast<bool>(false));
+  registerOptionalParameter("NumberOfThreads","Number of threads for track finding and fitting. Results do not depend on it.", _nThreads, static_cast<int>(1));
+  registerOptionalParameter("EventBufferSize","Number of events processed together when running with several threads, 0 for 16 per thread. Only used by processors which do not write to the event.", _eventBufferSize, static_cast<int>(0));
   registerOptionalParameter("RequireNTelPlanes","How many telescope planes do we require to be included in the fit?",_nSkipMax ,static_cast <float> (0.0f));
   registerOptionalParameter("NominalDxdz", "dx/dz assumed by track finder", _nXdz, static_cast<float>(0.0f));
   registerOptionalParameter("NominalDydz", "dy/dz assumed by track finder", _nYdz, static_cast<float>(0.0f));
@@ -322,6 +340,9 @@ void EUTelDafBase::init() {
   n_passedNdof =0; n_passedChi2OverNdof = 0; n_passedIsnan = 0;
   n_failedNdof =0; n_failedChi2OverNdof = 0; n_failedIsnan = 0;
   _initializedSystem = false;
+  _candidatesFitted = false;
+  _workerSystems.clear();
+  _eventBuffer.clear();
 
   //Geometry description
   _siPlanesParameters  = const_cast<gear::SiPlanesParameters* > (&(Global::GEAR->getSiPlanesParameters()));
@@ -539,6 +560,7 @@ int EUTelDafBase::checkInTime(daffitter::TrackCandidate<float, 4>& track){
 }
 
 void EUTelDafBase::processEvent(LCEvent * event){
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
   //Called once per event, read data, fit, save
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
   if(event->getEventNumber() % 1000 == 0){
@@ -610,12 +632,27 @@ void EUTelDafBase::processEvent(LCEvent * event){
     }
   }
   
+  if(_nThreads > 1 and dafEventIsDeferrable()){
+    //Track finding, fitting and dafEvent of buffered events are done in processEventBuffer
+    _eventBuffer.push_back(DafEventData());
+    DafEventData& data = _eventBuffer.back();
+    data.measurements.resize(_system.planes.size());
+    for(size_t ii = 0; ii < _system.planes.size(); ii++){
+      data.measurements.at(ii).swap(_system.planes.at(ii).meas);
+    }
+    size_t bufferSize = _eventBufferSize > 0 ? _eventBufferSize : 16 * _nThreads;
+    if(_eventBuffer.size() >= bufferSize) { processEventBuffer(); }
+    return;
+  }
+
   //Run track finder
   //_system.clusterTracker(); //Please remove when done testing
   _system.combinatorialKF();
+  if(_nThreads > 1) { fitTrackCandidatesParallel(); }
  
   //Child specific actions
   dafEvent(event);
+  _candidatesFitted = false;
 
   streamlog_out(MESSAGE1) << " dafEvent is OVER " <<std::endl;
 
@@ -624,6 +661,119 @@ void EUTelDafBase::processEvent(LCEvent * event){
   }
 }
 
+void EUTelDafBase::fitTrackCandidate(size_t index){
+  //Run the DAF on candidate index. In batched mode the candidates are fitted in batches
+  //when the first candidate of a batch is requested, and the plane z positions of the
+  //candidate are restored afterwards.
+  if(_candidatesFitted){
+    _system.restoreMeasZ(_system.tracks.at(index));
+    return;
+  }
+  if(not _batchedDaf){
+    _system.fitPlanesInfoDaf(_system.tracks.at(index));
+    return;
+  }
+  size_t batchSize = daffitter::TrackerSystem<float,4>::dafBatchSize;
+  if(index % batchSize == 0){
+    _system.fitPlanesInfoDafBatch(index, batchSize);
+  }
+  _system.restoreMeasZ(_system.tracks.at(index));
+}
+
+void EUTelDafBase::initWorkerSystems(){
+  //One copy of the tracker system per thread. Made on first use, when the system is fully defined.
+  if(not _workerSystems.empty()) { return; }
+  _workerSystems.assign(_nThreads > 1 ? _nThreads : 1, _system);
+  for(size_t ww = 0; ww < _workerSystems.size(); ww++){
+    for(size_t ii = 0; ii < _system.planes.size(); ii++){
+      daffitter::FitPlane<float>& pl = _system.planes.at(ii);
+      daffitter::FitPlane<float>& copy = _workerSystems.at(ww).planes.at(ii);
+      copy.setRef0( pl.getRef0() );
+      copy.setRef1( pl.getRef1() );
+      copy.setRef2( pl.getRef2() );
+      copy.setPlaneNorm( pl.getPlaneNorm() );
+    }
+  }
+}
+
+void EUTelDafBase::fitTrackCandidatesParallel(){
+  //DAF fit of the candidates of the current event in chunks of dafBatchSize candidates,
+  //one chunk per thread. The chunks do not depend on the number of threads.
+  const size_t chunkSize = daffitter::TrackerSystem<float,4>::dafBatchSize;
+  const size_t nTracks = _system.getNtracks();
+  if(nTracks <= chunkSize) { return; }
+  initWorkerSystems();
+
+  size_t nRead = 0, nWritten = 0;
+  EUTelEventPipeline<DafEventData, DafEventData>::Reader reader = [&] (DafEventData& chunk) -> bool {
+    if(nRead >= nTracks) { return(false); }
+    size_t last = min(nRead + chunkSize, nTracks);
+    chunk.tracks.assign(_system.tracks.begin() + nRead, _system.tracks.begin() + last);
+    nRead = last;
+    return(true);
+  };
+  EUTelEventPipeline<DafEventData, DafEventData>::Worker worker =
+    [&] (size_t iWorker, DafEventData& in, DafEventData& out) {
+    daffitter::TrackerSystem<float,4>& system = _workerSystems.at(iWorker);
+    for(size_t ii = 0; ii < system.planes.size(); ii++){
+      system.planes.at(ii).meas = _system.planes.at(ii).meas;
+      system.planes.at(ii).setMeasZ( _system.planes.at(ii).getMeasZ() );
+    }
+    system.swapTracks(in.tracks);
+    fitAllCandidates(system, _batchedDaf);
+    system.swapTracks(out.tracks);
+  };
+  EUTelEventPipeline<DafEventData, DafEventData>::Writer writer = [&] (DafEventData& chunk) {
+    for(size_t ii = 0; ii < chunk.tracks.size(); ii++, nWritten++){
+      swap(_system.tracks.at(nWritten), chunk.tracks.at(ii));
+    }
+  };
+  EUTelEventPipeline<DafEventData, DafEventData> pipeline(_workerSystems.size());
+  pipeline.run(reader, worker, writer);
+  _candidatesFitted = true;
+}
+
+void EUTelDafBase::processEventBuffer(){
+  //Track finding and DAF fit of all buffered events in parallel, then dafEvent for each
+  //event in the order the events were read.
+  if(_eventBuffer.empty()) { return; }
+  initWorkerSystems();
+
+  EUTelEventPipeline<DafEventData, DafEventData>::Reader reader = [&] (DafEventData& data) -> bool {
+    if(_eventBuffer.empty()) { return(false); }
+    swap(data, _eventBuffer.front());
+    _eventBuffer.pop_front();
+    return(true);
+  };
+  EUTelEventPipeline<DafEventData, DafEventData>::Worker worker =
+    [&] (size_t iWorker, DafEventData& in, DafEventData& out) {
+    daffitter::TrackerSystem<float,4>& system = _workerSystems.at(iWorker);
+    system.clear();
+    for(size_t ii = 0; ii < system.planes.size(); ii++){
+      system.planes.at(ii).meas.swap( in.measurements.at(ii) );
+    }
+    system.combinatorialKF();
+    fitAllCandidates(system, _batchedDaf);
+    system.swapTracks(out.tracks);
+    out.measurements.resize(system.planes.size());
+    for(size_t ii = 0; ii < system.planes.size(); ii++){
+      out.measurements.at(ii).swap( system.planes.at(ii).meas );
+    }
+  };
+  EUTelEventPipeline<DafEventData, DafEventData>::Writer writer = [&] (DafEventData& data) {
+    _system.clear();
+    for(size_t ii = 0; ii < _system.planes.size(); ii++){
+      _system.planes.at(ii).meas.swap( data.measurements.at(ii) );
+    }
+    _system.swapTracks(data.tracks);
+    _candidatesFitted = true;
+    dafEvent(NULL);
+    _candidatesFitted = false;
+  };
+  EUTelEventPipeline<DafEventData, DafEventData> pipeline(_workerSystems.size());
+  pipeline.run(reader, worker, writer);
+}
+
 bool EUTelDafBase::checkTrack(daffitter::TrackCandidate<float,4>& track){
   //Check the track quality
   if( track.ndof < _ndofMin) {n_failedNdof++; return(false); }
@@ -803,6 +953,7 @@ void EUTelDafBase::bookDetailedHistos(){
 }
 
 void EUTelDafBase::end() {
+  processEventBuffer();
   dafEnd();
   
   streamlog_out ( MESSAGE5 ) << endl;
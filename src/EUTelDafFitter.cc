@@ -139,7 +139,7 @@ void EUTelDafFitter::dafEvent (LCEvent * event) {
     //run track fitte
     _nCandidates++;
     //Prepare track for DAF fit
-    _system.fitPlanesInfoDaf(_system.tracks.at(ii));
+    fitTrackCandidate(ii);
     //Check resids, intime, angles
     if(not checkTrack( _system.tracks.at(ii))) { continue;};
     int inTimeHits = checkInTime(_system.tracks.at(ii));
@@ -204,7 +204,7 @@ void EUTelDafMaterial::dafEvent (LCEvent * /*event*/) {
   for(size_t ii = 0; ii < _system.getNtracks(); ii++ ){
     //run track fitte
     _nCandidates++;
-    _system.fitPlanesInfoDaf(_system.tracks.at(ii));
+    fitTrackCandidate(ii);
     _system.weightToIndex(_system.tracks.at(ii));
     _system.fitInfoFWBiased(_system.tracks.at(ii));
     _system.getChi2BiasedInfo(_system.tracks.at(ii));
@@ -0,0 +1,255 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelEventIndex.h"
+#include "EUTELESCOPE.h"
+
+// marlin includes ".h"
+#include "marlin/Global.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <Exceptions.h>
+#include <IO/LCReader.h>
+#include <EVENT/LCEvent.h>
+#include <EVENT/LCCollection.h>
+
+// system includes <>
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+using namespace eutelescope;
+
+namespace {
+
+  //! Size of a file in bytes, -1 if it does not exist
+  long long fileSize( const string& fileName ) {
+    struct stat buffer;
+    if ( stat( fileName.c_str(), &buffer ) != 0 ) return -1;
+    return static_cast< long long >( buffer.st_size );
+  }
+
+  //! Reads a big endian (XDR) 32 bit word
+  bool readWord( FILE* file, unsigned int& word ) {
+    unsigned char bytes[4];
+    if ( fread( bytes, 1, 4, file ) != 4 ) return false;
+    word = ( static_cast< unsigned int >( bytes[0] ) << 24 ) | ( bytes[1] << 16 ) | ( bytes[2] << 8 ) | bytes[3];
+    return true;
+  }
+
+  const unsigned int SIO_RECORD_MARKER = 0xabadcafe;
+
+}
+
+EUTelEventIndex::EUTelEventIndex() :
+  _dataFile(),
+  _fileSize( -1 ),
+  _collections(),
+  _run(),
+  _event(),
+  _type(),
+  _offset(),
+  _sizes() {
+}
+
+string EUTelEventIndex::indexFileName( const string& dataFile ) {
+  return dataFile + ".idx";
+}
+
+void EUTelEventIndex::clear() {
+  _run.clear();
+  _event.clear();
+  _type.clear();
+  _offset.clear();
+  _sizes.clear();
+}
+
+vector<long long> EUTelEventIndex::scanEventOffsets() const {
+
+  vector<long long> offsets;
+
+  FILE* file = fopen( _dataFile.c_str(), "rb" );
+  if ( file == NULL ) return offsets;
+
+  // SIO record header: header length, marker, options, data length,
+  // uncompressed length, name length, name (padded to 4 bytes). The
+  // data, padded to 4 bytes, follows the header.
+  long long offset = 0;
+  unsigned int header[6];
+  while ( readWord( file, header[0] ) ) {
+    bool valid = readWord( file, header[1] ) && header[1] == SIO_RECORD_MARKER;
+    for ( int i = 2; valid && i < 6; ++i ) valid = readWord( file, header[i] );
+
+    const unsigned int nameLength = header[5];
+    if ( !valid || nameLength > 256 || header[0] < 24 + nameLength ) {
+      offsets.clear();
+      break;
+    }
+
+    char name[256];
+    if ( fread( name, 1, nameLength, file ) != nameLength ) {
+      offsets.clear();
+      break;
+    }
+
+    if ( string( name, nameLength ) == "LCEventHeader" ) offsets.push_back( offset );
+
+    const long long dataLength = ( header[3] + 3u ) & ~3u;
+    offset += header[0] + dataLength;
+    if ( fseek( file, offset, SEEK_SET ) != 0 ) {
+      offsets.clear();
+      break;
+    }
+  }
+
+  fclose( file );
+  return offsets;
+}
+
+void EUTelEventIndex::build( const string& dataFile, const vector<string>& collections ) {
+
+  _dataFile = dataFile;
+  _fileSize = fileSize( dataFile );
+  _collections = collections;
+  clear();
+
+  auto_ptr< lcio::LCReader > reader( lcio::LCFactory::getInstance()->createLCReader() );
+  reader->open( _dataFile );
+
+  EVENT::LCEvent* event = NULL;
+  while ( ( event = reader->readNextEvent() ) != NULL ) {
+    _run.push_back( event->getRunNumber() );
+    _event.push_back( event->getEventNumber() );
+    _type.push_back( event->getParameters().getIntVal( EUTELESCOPE::EVENTTYPE ) );
+
+    const vector<string>* names = event->getCollectionNames();
+    for ( size_t iCol = 0; iCol < _collections.size(); ++iCol ) {
+      int nElements = 0;
+      for ( size_t iName = 0; iName < names->size(); ++iName ) {
+        if ( (*names)[iName] == _collections[iCol] ) {
+          nElements = event->getCollection( _collections[iCol] )->getNumberOfElements();
+          break;
+        }
+      }
+      _sizes.push_back( nElements );
+    }
+  }
+  reader->close();
+
+  _offset = scanEventOffsets();
+  if ( _offset.size() != _run.size() ) {
+    if ( !_run.empty() ) {
+      streamlog_out( WARNING2 ) << "Cannot locate the events in the SIO records of " << _dataFile
+                                << ", the index has no byte offsets" << endl;
+    }
+    _offset.assign( _run.size(), -1 );
+  }
+}
+
+void EUTelEventIndex::write( const string& indexFile ) const {
+
+  ofstream out( indexFile.c_str() );
+  if ( !out ) {
+    throw lcio::IOException( "Cannot write the event index " + indexFile );
+  }
+
+  out << "EUTelEventIndex " << VERSION << "\n"
+      << "bytes " << _fileSize << "\n"
+      << "collections " << _collections.size();
+  for ( size_t iCol = 0; iCol < _collections.size(); ++iCol ) out << " " << _collections[iCol];
+  out << "\n"
+      << "events " << size() << "\n";
+
+  for ( size_t i = 0; i < size(); ++i ) {
+    out << _run[i] << " " << _event[i] << " " << _type[i] << " " << _offset[i];
+    for ( size_t iCol = 0; iCol < _collections.size(); ++iCol ) {
+      out << " " << getCollectionSize( i, iCol );
+    }
+    out << "\n";
+  }
+
+  if ( !out ) {
+    throw lcio::IOException( "Writing the event index " + indexFile + " failed" );
+  }
+}
+
+bool EUTelEventIndex::read( const string& dataFile, const string& indexFile ) {
+
+  ifstream in( indexFile.c_str() );
+  if ( !in ) return false;
+
+  _dataFile = dataFile;
+  _collections.clear();
+  clear();
+
+  string key;
+  int version = 0;
+  size_t nCollections = 0, nEvents = 0;
+
+  in >> key >> version;
+  if ( !in || key != "EUTelEventIndex" || version != VERSION ) {
+    throw lcio::IOException( "Unknown format of the event index " + indexFile );
+  }
+  in >> key >> _fileSize >> key >> nCollections;
+  _collections.resize( nCollections );
+  for ( size_t iCol = 0; iCol < nCollections; ++iCol ) in >> _collections[iCol];
+  in >> key >> nEvents;
+
+  _run.resize( nEvents );
+  _event.resize( nEvents );
+  _type.resize( nEvents );
+  _offset.resize( nEvents );
+  _sizes.resize( nEvents * nCollections );
+  for ( size_t i = 0; i < nEvents && in; ++i ) {
+    in >> _run[i] >> _event[i] >> _type[i] >> _offset[i];
+    for ( size_t iCol = 0; iCol < nCollections; ++iCol ) in >> _sizes[ i * nCollections + iCol ];
+  }
+
+  if ( !in ) {
+    throw lcio::IOException( "Corrupted event index " + indexFile );
+  }
+  return true;
+}
+
+void EUTelEventIndex::load( const string& dataFile, const vector<string>& collections, bool writeIndex ) {
+
+  const string indexFile = indexFileName( dataFile );
+
+  bool valid = read( dataFile, indexFile ) && isUpToDate();
+  for ( size_t iCol = 0; valid && iCol < collections.size(); ++iCol ) {
+    valid = getCollectionIndex( collections[iCol] ) >= 0;
+  }
+  if ( valid ) return;
+
+  streamlog_out( MESSAGE4 ) << "Building the event index of " << dataFile << endl;
+  build( dataFile, collections );
+  if ( writeIndex ) write( indexFile );
+}
+
+bool EUTelEventIndex::isUpToDate() const {
+  return _fileSize >= 0 && fileSize( _dataFile ) == _fileSize;
+}
+
+long long EUTelEventIndex::getEventBytes( size_t i ) const {
+  if ( _offset[i] < 0 ) return -1;
+  const long long next = ( i + 1 < size() ) ? _offset[i + 1] : _fileSize;
+  return next - _offset[i];
+}
+
+int EUTelEventIndex::getCollectionIndex( const string& name ) const {
+  for ( size_t iCol = 0; iCol < _collections.size(); ++iCol ) {
+    if ( _collections[iCol] == name ) return iCol;
+  }
+  return -1;
+}
@@ -16,6 +16,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelRunHeaderImpl.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelEventImpl.h"
 #include "EUTelEventViewer.h"
 #include "EUTelAlignmentConstant.h"
@@ -136,6 +137,7 @@ void EUTelEventViewer::processRunHeader( LCRunHeader * rdr ) {
 }
 
 void EUTelEventViewer::processEvent( LCEvent * evt ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 
 
   EUTelEventImpl * event = static_cast<EUTelEventImpl *> ( evt );
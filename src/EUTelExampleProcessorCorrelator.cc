@@ -13,6 +13,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelExampleProcessorCorrelator.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -154,6 +155,7 @@ void EUTelExampleProcessorCorrelator::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelExampleProcessorCorrelator::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 
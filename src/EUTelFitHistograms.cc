@@ -17,6 +17,7 @@
 
 // eutelescope includes
 #include "EUTelFitHistograms.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelVirtualCluster.h"
 #include "EUTelFFClusterImpl.h"
 #include "EUTELESCOPE.h"
@@ -358,6 +359,7 @@ void EUTelFitHistograms::processRunHeader( LCRunHeader* runHeader) {
 }
 
 void EUTelFitHistograms::processEvent( LCEvent * event ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * euEvent = static_cast<EUTelEventImpl*> ( event );
   if ( euEvent->getEventType() == kEORE ) {
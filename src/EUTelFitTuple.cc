@@ -17,6 +17,7 @@
 
 // eutelescope inlcudes
 #include "EUTelFitTuple.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelVirtualCluster.h"
 #include "EUTelFFClusterImpl.h"
 #include "EUTELESCOPE.h"
@@ -118,6 +119,26 @@ EUTelFitTuple::EUTelFitTuple() : Processor("EUTelFitTuple") {
                               "Alignment corrections for DUT: shift in X, Y and rotation around Z",
                               _DUTalign, initAlign);
 
+  registerOptionalParameter ("OutputFile",
+                             "ROOT file for the n-tuple, written by a buffered writer instead of the AIDA tuple if set",
+                             _outputFileName, std::string(""));
+
+  registerOptionalParameter ("CompressionLevel",
+                             "ROOT compression setting of OutputFile (algorithm*100+level), -1 for the ROOT default",
+                             _compressionLevel, static_cast < int > (-1));
+
+  registerOptionalParameter ("BasketSize",
+                             "Basket size of the OutputFile branches in bytes, 0 for the ROOT default",
+                             _basketSize, static_cast < int > (0));
+
+  registerOptionalParameter ("RowsPerBlock",
+                             "Number of rows buffered in memory before they are handed to the OutputFile writer",
+                             _rowsPerBlock, static_cast < int > (1000));
+
+  registerOptionalParameter ("AsyncOutput",
+                             "Compress and write OutputFile in a background thread",
+                             _asyncOutput, static_cast < bool > (true));
+
 }
 
 
@@ -330,6 +351,7 @@ void EUTelFitTuple::processRunHeader( LCRunHeader* runHeader) {
 }
 
 void EUTelFitTuple::processEvent( LCEvent * event ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * euEvent = static_cast<EUTelEventImpl*> ( event );
   if ( euEvent->getEventType() == kEORE ) {
@@ -495,22 +517,22 @@ void EUTelFitTuple::processEvent( LCEvent * event ) {
       // Fill n-tuple
 
       int icol=0;
-      _FitTuple->fill(icol++,_nEvt);
-      _FitTuple->fill(icol++,_runNr);
-      _FitTuple->fill(icol++,_evtNr);
-      _FitTuple->fill(icol++,_tluTimeStamp); // new! TLU timestamp
-      _FitTuple->fill(icol++,nTrack); // new! TLU timestamp
-      _FitTuple->fill(icol++,fittrack->getNdf());
-      _FitTuple->fill(icol++,fittrack->getChi2());
+      fillColumn(icol++,_nEvt);
+      fillColumn(icol++,_runNr);
+      fillColumn(icol++,_evtNr);
+      fillColumn(icol++,_tluTimeStamp); // new! TLU timestamp
+      fillColumn(icol++,nTrack); // new! TLU timestamp
+      fillColumn(icol++,fittrack->getNdf());
+      fillColumn(icol++,fittrack->getChi2());
 
       for(int ipl=0; ipl<_nTelPlanes;ipl++)
         {
-          _FitTuple->fill(icol++,_measuredX[ipl]);
-          _FitTuple->fill(icol++,_measuredY[ipl]);
-          _FitTuple->fill(icol++,_measuredZ[ipl]);
-          _FitTuple->fill(icol++,_measuredQ[ipl]);
-          _FitTuple->fill(icol++,_fittedX[ipl]);
-          _FitTuple->fill(icol++,_fittedY[ipl]);
+          fillColumn(icol++,_measuredX[ipl]);
+          fillColumn(icol++,_measuredY[ipl]);
+          fillColumn(icol++,_measuredZ[ipl]);
+          fillColumn(icol++,_measuredQ[ipl]);
+          fillColumn(icol++,_fittedX[ipl]);
+          fillColumn(icol++,_fittedY[ipl]);
         }
 
       //  Look for closest DUT hit
@@ -591,12 +613,12 @@ void EUTelFitTuple::processEvent( LCEvent * event ) {
         }
 
 
-      _FitTuple->fill(icol++,dutX);
-      _FitTuple->fill(icol++,dutY);
-      _FitTuple->fill(icol++,dutR);
-      _FitTuple->fill(icol++,dutQ);
+      fillColumn(icol++,dutX);
+      fillColumn(icol++,dutY);
+      fillColumn(icol++,dutR);
+      fillColumn(icol++,dutQ);
 
-      _FitTuple->addRow();
+      addRow();
 
       // End of loop over tracks
     }
@@ -619,8 +641,14 @@ void EUTelFitTuple::end(){
   //        << std::endl ;
 
 
-  message<MESSAGE5> ( log() << "N-tuple with "
-                     << _FitTuple->rows() << " rows created" );
+  if( _outputFileName.empty() ) {
+    message<MESSAGE5> ( log() << "N-tuple with "
+                       << _FitTuple->rows() << " rows created" );
+  } else {
+    _writer.close();
+    message<MESSAGE5> ( log() << "N-tuple with "
+                       << _writer.getNRows(_fitTree) << " rows written to " << _outputFileName );
+  }
 
 
   // Clean memory
@@ -644,6 +672,31 @@ void EUTelFitTuple::end(){
 
 
 
+void EUTelFitTuple::fillColumn( int column, int value ) {
+  if( _outputFileName.empty() ) _FitTuple->fill(column, value);
+  else _writer.fill(_fitTree, column, value);
+}
+
+void EUTelFitTuple::fillColumn( int column, long int value ) {
+  if( _outputFileName.empty() ) _FitTuple->fill(column, value);
+  else _writer.fill(_fitTree, column, static_cast<long long>(value));
+}
+
+void EUTelFitTuple::fillColumn( int column, float value ) {
+  if( _outputFileName.empty() ) _FitTuple->fill(column, value);
+  else _writer.fill(_fitTree, column, static_cast<double>(value));
+}
+
+void EUTelFitTuple::fillColumn( int column, double value ) {
+  if( _outputFileName.empty() ) _FitTuple->fill(column, value);
+  else _writer.fill(_fitTree, column, value);
+}
+
+void EUTelFitTuple::addRow() {
+  if( _outputFileName.empty() ) _FitTuple->addRow();
+  else _writer.addRow(_fitTree);
+}
+
 void EUTelFitTuple::bookHistos()
 {
 
@@ -700,7 +753,20 @@ void EUTelFitTuple::bookHistos()
   _columnType.push_back("double");
 
 
-  _FitTuple=AIDAProcessor::tupleFactory(this)->create(_FitTupleName, _FitTupleName, _columnNames, _columnType, "");
+  if( _outputFileName.empty() ) {
+    _FitTuple=AIDAProcessor::tupleFactory(this)->create(_FitTupleName, _FitTupleName, _columnNames, _columnType, "");
+  } else {
+    _fitTree = _writer.bookTree(_FitTupleName, _FitTupleName);
+    for(size_t icol=0; icol<_columnNames.size(); icol++)
+      {
+        EUTelTupleWriter::ColumnType type = EUTelTupleWriter::kDouble;
+        if( _columnType[icol] == "int" ) type = EUTelTupleWriter::kInt;
+        else if( _columnType[icol] == "long int" ) type = EUTelTupleWriter::kLong;
+        _writer.bookColumn(_fitTree, _columnNames[icol], type);
+      }
+    _writer.setOptions(_compressionLevel, _basketSize, static_cast<size_t>(_rowsPerBlock > 0 ? _rowsPerBlock : 1), _asyncOutput);
+    _writer.open(_outputFileName);
+  }
 
 
   message<DEBUG5> ( log() << "Booking completed \n\n");
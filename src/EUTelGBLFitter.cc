@@ -92,7 +92,7 @@ namespace eutelescope {
 		streamlog_out(DEBUG1) << "  setScattererGBL  ------------- END ----------------- " << std::endl;
 	}
 		//This is used when the we know the radiation length already
-		void EUTelGBLFitter::setScattererGBL(gbl::GblPoint& point,EUTelState & state, float variance,TVectorD scat ) {
+		void EUTelGBLFitter::setScattererGBL(gbl::GblPoint& point,EUTelState & state, float variance,const TVectorD& scat ) {
 		streamlog_out(MESSAGE1) << " setScattererGBL ------------- BEGIN --------------  " << std::endl;
 		TMatrixDSym precisionMatrix =  state.getScatteringVarianceInLocalFrame(variance);
 		streamlog_out(MESSAGE1) << "The precision matrix being used for the scatter:  " << std::endl;
@@ -471,7 +471,7 @@ namespace eutelescope {
      * \return Jacobain 5x5  from scatter->plane 
      */
 
-	TMatrixD EUTelGBLFitter::findScattersJacobians(EUTelState state, EUTelState nextState){
+	TMatrixD EUTelGBLFitter::findScattersJacobians(const EUTelState& state, const EUTelState& nextState){
 		streamlog_out(DEBUG1) << "CREATE JACOBIAN LINKS: Plane->scatter->scatter->plane  " << std::endl;
 
         double min = 1e-4;
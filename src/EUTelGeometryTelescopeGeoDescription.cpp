@@ -41,6 +41,13 @@
 using namespace eutelescope;
 using namespace geo;
 
+namespace {
+	// Air of the world volume
+	// see http://pdg.lbl.gov/2013/AtomicNuclearProperties/HTML_PAGES/104.html
+	const double airDensity   = 1.2e-3;     // g/cm^3
+	const double airRadLength = 36.62;      // g/cm^2
+}
+
 unsigned EUTelGeometryTelescopeGeoDescription::_counter = 0;
 
 /**TODO: Replace me: NOP*/
@@ -270,7 +277,8 @@ _trackerPlanesLayerLayout(nullptr),
 _sensorIDVec(),
 _nPlanes(0),
 _isGeoInitialized(false),
-_geoManager(nullptr)
+_geoManager(nullptr),
+_validateMaterial(false)
 {
 	//Set ROOTs verbosity to only display error messages or higher (so info will not be streamed to stderr)
 	gErrorIgnoreLevel =  kError;  
@@ -306,6 +314,52 @@ void EUTelGeometryTelescopeGeoDescription::readGear() {
 		streamlog_out(ERROR5) << "Your GEAR file neither contains SiPlanes nor TrackerPlanes and thus is not valid" << std::endl;
 		throw eutelescope::InvalidGeometryException("GEAR file invalid, does not contain SiPlanes nor TrackerPlanes");
 	}
+	buildMaterialModel();
+}
+
+void EUTelGeometryTelescopeGeoDescription::buildMaterialModel() {
+	_planeRadMap.clear();
+	_airGapRadMap.clear();
+
+	//Planes are homogeneous boxes of thickness zSize [mm] with the radiation length radLength [cm],
+	//exactly as they are put into TGeo by translateSiPlane2TGeo
+	std::vector<int> sensorIDs;
+	for(std::map<int, EUTelPlane>::const_iterator it = _planeSetup.begin(); it != _planeSetup.end(); ++it) {
+		const EUTelPlane& plane = it->second;
+		_planeRadMap[it->first] = ( plane.radLength > 0 ) ? plane.zSize/(plane.radLength*10) : 0.;
+		sensorIDs.push_back(it->first);
+	}
+	std::sort(sensorIDs.begin(), sensorIDs.end(), doCompare(*this));
+
+	//Air between the surfaces of consecutive planes along the beam, the gap is attached to the upstream plane
+	const double airX0 = airRadLength/airDensity*10; // mm
+	for(size_t i = 0; i < sensorIDs.size(); ++i) {
+		double gap = 0.;
+		if( i+1 < sensorIDs.size() ) {
+			const EUTelPlane& plane = _planeSetup[sensorIDs[i]];
+			const EUTelPlane& next = _planeSetup[sensorIDs[i+1]];
+			gap = std::max(0., next.zPos - plane.zPos - 0.5*(next.zSize + plane.zSize));
+		}
+		_airGapRadMap[sensorIDs[i]] = gap/airX0;
+	}
+}
+
+double EUTelGeometryTelescopeGeoDescription::planeRadLengthTGeo(int planeID) {
+	TVector3 planeNormalT = siPlaneNormal(planeID);
+	Eigen::Vector3d planeNormal(planeNormalT(0), planeNormalT(1), planeNormalT(2));
+	Eigen::Vector3d planePosition(siPlaneXPosition(planeID), siPlaneYPosition(planeID), siPlaneZPosition(planeID));
+
+	//We have to propagate halfway to to front and halfway back + a minor safety margin
+	Eigen::Vector3d startPoint = planePosition - 0.51*siPlaneZSize(planeID)*planeNormal;
+	Eigen::Vector3d endPoint = planePosition + 0.51*siPlaneZSize(planeID)*planeNormal;
+
+	double normRad = FindRad(startPoint, endPoint);
+	double modelRad = _planeRadMap.at(planeID);
+	if( std::abs(normRad - modelRad) > 0.01*modelRad ) {
+		streamlog_out(WARNING2) << "Radiation length of plane " << planeID << " from TGeo (" << normRad
+		                        << ") differs from the material model (" << modelRad << ")" << std::endl;
+	}
+	return normRad;
 }
 
 EUTelGeometryTelescopeGeoDescription::~EUTelGeometryTelescopeGeoDescription() {
@@ -486,8 +540,8 @@ void EUTelGeometryTelescopeGeoDescription::initializeTGeoDescription( std::strin
     
     // Create air mixture
     // see http://pdg.lbl.gov/2013/AtomicNuclearProperties/HTML_PAGES/104.html
-    double air_density = 1.2e-3;         // g/cm^3
-    double air_radlen  = 36.62;          // g/cm^2 //Must be -ve to use this value rather than internal one calculated.
+    double air_density = airDensity;     // g/cm^3
+    double air_radlen  = airRadLength;   // g/cm^2 //Must be -ve to use this value rather than internal one calculated.
 
     TGeoMixture* pMatAir = new TGeoMixture("AIR",3,air_density);
     pMatAir->DefineElement(0, 14.007, 7.,  0.755267 );     //Nitrogen
@@ -973,24 +1027,11 @@ double EUTelGeometryTelescopeGeoDescription::FindRad(Eigen::Vector3d const & sta
 double EUTelGeometryTelescopeGeoDescription::planeRadLengthGlobalIncidence(int planeID, Eigen::Vector3d incidenceDir) {
 	
 	incidenceDir.normalize();
-	double normRad;
 	
 	TVector3 planeNormalT = siPlaneNormal(planeID);
 	Eigen::Vector3d planeNormal(planeNormalT(0), planeNormalT(1), planeNormalT(2));
 	
-	std::map<int, double>::iterator mapIt = _planeRadMap.find(planeID);
-	if( mapIt != _planeRadMap.end() ) {
-		normRad = mapIt->second;
-	} else {
-		Eigen::Vector3d planePosition(siPlaneXPosition(planeID), siPlaneYPosition(planeID), siPlaneZPosition(planeID));
-
-		//We have to propagate halfway to to front and halfway back + a minor safety margin
-		Eigen::Vector3d startPoint = planePosition - 0.51*siPlaneZSize(planeID)*planeNormal;
-		Eigen::Vector3d endPoint = planePosition + 0.51*siPlaneZSize(planeID)*planeNormal;
-
-		normRad = FindRad(startPoint, endPoint);
-		_planeRadMap[planeID] = normRad;
-	}
+	double normRad = ( _validateMaterial && _isGeoInitialized ) ? planeRadLengthTGeo(planeID) : _planeRadMap.at(planeID);
 	double scale = std::abs(incidenceDir.dot(planeNormal));
 	return normRad/scale;
 }
@@ -998,26 +1039,19 @@ double EUTelGeometryTelescopeGeoDescription::planeRadLengthGlobalIncidence(int p
 double EUTelGeometryTelescopeGeoDescription::planeRadLengthLocalIncidence(int planeID, Eigen::Vector3d incidenceDir) {
 	
 	incidenceDir.normalize();
-	double normRad;
 
-	std::map<int, double>::iterator mapIt = _planeRadMap.find(planeID);
-	if( mapIt != _planeRadMap.end() ) {
-		normRad = mapIt->second;
-	} else {
-		Eigen::Vector3d planePosition(siPlaneXPosition(planeID), siPlaneYPosition(planeID), siPlaneZPosition(planeID));
+	double normRad = ( _validateMaterial && _isGeoInitialized ) ? planeRadLengthTGeo(planeID) : _planeRadMap.at(planeID);
+	double scale = std::abs(incidenceDir(2));
+	return normRad/scale;
+}
 
-		TVector3 planeNormalT = siPlaneNormal(planeID);
-		Eigen::Vector3d planeNormal(planeNormalT(0), planeNormalT(1), planeNormalT(2));
-	
-		//We have to propagate halfway to to front and halfway back + a minor safety margin
-		Eigen::Vector3d startPoint = planePosition - 0.51*siPlaneZSize(planeID)*planeNormal;
-		Eigen::Vector3d endPoint = planePosition + 0.51*siPlaneZSize(planeID)*planeNormal;
+double EUTelGeometryTelescopeGeoDescription::airRadLengthGlobalIncidence(int planeID, Eigen::Vector3d incidenceDir) {
 
-		normRad = FindRad(startPoint, endPoint);
-		_planeRadMap[planeID] = normRad;
-	}
+	incidenceDir.normalize();
+
+	//The gaps are measured along the beam (global z)
 	double scale = std::abs(incidenceDir(2));
-	return normRad/scale;
+	return _airGapRadMap.at(planeID)/scale;
 }
 
 bool EUTelGeometryTelescopeGeoDescription::testOutput(std::map< const int,double> & mapSensor,std::map<const int,double> & mapAir){
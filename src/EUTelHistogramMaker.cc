@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelEventImpl.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelVirtualCluster.h"
 #include "EUTelFFClusterImpl.h"
@@ -190,6 +191,7 @@ void EUTelHistogramMaker::initializeGeometry( LCEvent * event ) {
 
 
 void EUTelHistogramMaker::processEvent (LCEvent * evt) {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 
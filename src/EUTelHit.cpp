@@ -1,7 +1,10 @@
 #include "EUTelHit.h"
 using namespace eutelescope;
 
-EUTelHit::EUTelHit(){
+EUTelHit::EUTelHit():
+_id(0)
+{
+    _position[0] = _position[1] = _position[2] = 0;
 } 
 
 EUTelHit::EUTelHit(EUTelHit* hit){
@@ -38,7 +41,7 @@ std::vector<double> EUTelHit::getLCIOOutput(){
 
     return output;
 }
-void EUTelHit::setTrackFromLCIOVec(std::vector<double> input){
+void EUTelHit::setTrackFromLCIOVec(const std::vector<double>& input){
     setID(input.at(0));
     const double pos[3] = {input.at(1),input.at(2),input.at(3)};
     setPosition(pos);
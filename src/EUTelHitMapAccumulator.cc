@@ -0,0 +1,181 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelHitMapAccumulator.h"
+#include "EUTelExceptions.h"
+
+// system includes <>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace eutelescope {
+
+  namespace {
+    //! Identifies hit map checkpoint files and their layout version
+    const char CHECKPOINTMAGIC[8] = { 'E', 'U', 'T', 'H', 'M', 'A', 'P', '1' };
+
+    template<typename T>
+    void writeValue(std::ofstream& out, T value) {
+      out.write( reinterpret_cast<const char*>( &value ), sizeof(T) );
+    }
+
+    template<typename T>
+    T readValue(std::ifstream& in) {
+      T value = T();
+      in.read( reinterpret_cast<char*>( &value ), sizeof(T) );
+      return value;
+    }
+  }
+
+  EUTelHitMapAccumulator::EUTelHitMapAccumulator():
+    _sensors(),
+    _nEvents(0),
+    _indexBuffer()
+  {}
+
+  void EUTelHitMapAccumulator::addSensor(int sensorID, int offX, int sizeX, int offY, int sizeY) {
+    SensorMap& map = _sensors[sensorID];
+    map.offX = offX;
+    map.offY = offY;
+    map.sizeX = sizeX;
+    map.sizeY = sizeY;
+    map.counts.assign( static_cast<size_t>(sizeX) * sizeY, 0 );
+  }
+
+  size_t EUTelHitMapAccumulator::fill(int sensorID, const std::vector<float>& chargeValues, unsigned int stride) {
+    std::map<int, SensorMap>::iterator it = _sensors.find(sensorID);
+    if( it == _sensors.end() || stride < 2 ) return 0;
+    SensorMap& map = it->second;
+
+    const size_t nPixels = chargeValues.size() / stride;
+    _indexBuffer.resize(nPixels);
+
+    //first pass: compute the array index of every pixel, out of range
+    //pixels are flagged with the size of the array as index
+    const uint32_t outOfRange = static_cast<uint32_t>( map.counts.size() );
+    const float* values = chargeValues.data();
+    uint32_t* indices = _indexBuffer.data();
+    for( size_t iPixel = 0; iPixel < nPixels; ++iPixel ) {
+      const int x = static_cast<int>( values[ iPixel * stride ] ) - map.offX;
+      const int y = static_cast<int>( values[ iPixel * stride + 1 ] ) - map.offY;
+      const bool inside = ( static_cast<unsigned int>(x) < static_cast<unsigned int>(map.sizeX) ) &
+                          ( static_cast<unsigned int>(y) < static_cast<unsigned int>(map.sizeY) );
+      indices[iPixel] = inside ? static_cast<uint32_t>( y * map.sizeX + x ) : outOfRange;
+    }
+
+    //second pass: increment the counters
+    size_t nOutOfRange = 0;
+    uint32_t* counts = map.counts.data();
+    for( size_t iPixel = 0; iPixel < nPixels; ++iPixel ) {
+      if( indices[iPixel] != outOfRange ) {
+        ++counts[ indices[iPixel] ];
+      } else {
+        ++nOutOfRange;
+      }
+    }
+    return nOutOfRange;
+  }
+
+  const EUTelHitMapAccumulator::SensorMap& EUTelHitMapAccumulator::getSensorMap(int sensorID) const {
+    std::map<int, SensorMap>::const_iterator it = _sensors.find(sensorID);
+    if( it == _sensors.end() ) {
+      std::stringstream ss;
+      ss << "No hit map for sensor " << sensorID;
+      throw InvalidParameterException( ss.str() );
+    }
+    return it->second;
+  }
+
+  std::vector< std::pair<int, int> > EUTelHitMapAccumulator::getPixelsAbove(int sensorID, uint64_t threshold) const {
+    const SensorMap& map = getSensorMap(sensorID);
+    std::vector< std::pair<int, int> > pixels;
+    for( size_t index = 0; index < map.counts.size(); ++index ) {
+      if( map.counts[index] > threshold ) {
+        pixels.push_back( std::make_pair( static_cast<int>( index % map.sizeX ) + map.offX,
+                                          static_cast<int>( index / map.sizeX ) + map.offY ) );
+      }
+    }
+    return pixels;
+  }
+
+  void EUTelHitMapAccumulator::writeCheckpoint(const std::string& fileName) const {
+    std::ofstream out( fileName.c_str(), std::ios::binary | std::ios::trunc );
+    if( !out ) {
+      throw InvalidParameterException( "Unable to open hit map checkpoint " + fileName + " for writing" );
+    }
+    out.write( CHECKPOINTMAGIC, sizeof(CHECKPOINTMAGIC) );
+    writeValue<uint64_t>( out, _nEvents );
+    writeValue<uint32_t>( out, static_cast<uint32_t>( _sensors.size() ) );
+    for( std::map<int, SensorMap>::const_iterator it = _sensors.begin(); it != _sensors.end(); ++it ) {
+      writeValue<int32_t>( out, it->first );
+      writeValue<int32_t>( out, it->second.offX );
+      writeValue<int32_t>( out, it->second.sizeX );
+      writeValue<int32_t>( out, it->second.offY );
+      writeValue<int32_t>( out, it->second.sizeY );
+      out.write( reinterpret_cast<const char*>( it->second.counts.data() ), it->second.counts.size() * sizeof(uint32_t) );
+    }
+    if( !out ) {
+      throw InvalidParameterException( "Error writing hit map checkpoint " + fileName );
+    }
+  }
+
+  void EUTelHitMapAccumulator::mergeCheckpoint(const std::string& fileName) {
+    std::ifstream in( fileName.c_str(), std::ios::binary );
+    if( !in ) {
+      throw InvalidParameterException( "Unable to open hit map checkpoint " + fileName );
+    }
+    char magic[ sizeof(CHECKPOINTMAGIC) ];
+    in.read( magic, sizeof(magic) );
+    if( !in || !std::equal( magic, magic + sizeof(magic), CHECKPOINTMAGIC ) ) {
+      throw IncompatibleDataSetException( fileName + " is not a hit map checkpoint" );
+    }
+
+    const uint64_t nEvents = readValue<uint64_t>( in );
+    const uint32_t nSensors = readValue<uint32_t>( in );
+    std::vector<uint32_t> counts;
+    for( uint32_t iSensor = 0; iSensor < nSensors; ++iSensor ) {
+      const int sensorID = readValue<int32_t>( in );
+      const int offX = readValue<int32_t>( in );
+      const int sizeX = readValue<int32_t>( in );
+      const int offY = readValue<int32_t>( in );
+      const int sizeY = readValue<int32_t>( in );
+      if( !in || sizeX < 0 || sizeY < 0 ) {
+        throw IncompatibleDataSetException( "Corrupted hit map checkpoint " + fileName );
+      }
+
+      if( !hasSensor(sensorID) ) addSensor( sensorID, offX, sizeX, offY, sizeY );
+      SensorMap& map = _sensors[sensorID];
+      if( map.offX != offX || map.sizeX != sizeX || map.offY != offY || map.sizeY != sizeY ) {
+        std::stringstream ss;
+        ss << "Pixel layout of sensor " << sensorID << " in " << fileName << " differs from the current one";
+        throw IncompatibleDataSetException( ss.str() );
+      }
+
+      counts.resize( map.counts.size() );
+      in.read( reinterpret_cast<char*>( counts.data() ), counts.size() * sizeof(uint32_t) );
+      if( !in ) {
+        throw IncompatibleDataSetException( "Truncated hit map checkpoint " + fileName );
+      }
+      for( size_t index = 0; index < counts.size(); ++index ) {
+        map.counts[index] += counts[index];
+      }
+    }
+    _nEvents += nEvents;
+  }
+
+  void EUTelHitMapAccumulator::reset() {
+    for( std::map<int, SensorMap>::iterator it = _sensors.begin(); it != _sensors.end(); ++it ) {
+      std::fill( it->second.counts.begin(), it->second.counts.end(), 0 );
+    }
+    _nEvents = 0;
+  }
+
+}
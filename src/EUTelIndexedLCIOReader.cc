@@ -0,0 +1,218 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelIndexedLCIOReader.h"
+#include "EUTelEventImpl.h"
+#include "EUTelExceptions.h"
+#include "EUTELESCOPE.h"
+
+// marlin includes ".h"
+#include "marlin/Global.h"
+#include "marlin/ProcessorMgr.h"
+
+// lcio includes <.h>
+#include <IO/LCReader.h>
+#include <EVENT/LCEvent.h>
+#include <EVENT/LCRunHeader.h>
+
+// system includes <>
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+using namespace marlin;
+using namespace eutelescope;
+
+EUTelIndexedLCIOReader::EUTelIndexedLCIOReader() :
+  DataSourceProcessor( "EUTelIndexedLCIOReader" ),
+  _inputFiles(),
+  _indexCollections(),
+  _writeIndex( true ),
+  _firstEvent( 0 ),
+  _lastEvent( -1 ),
+  _requiredCollection(),
+  _minCollectionSize( 1 ),
+  _sampledEvents( 0 ),
+  _nShards( 1 ),
+  _shardIndex( 0 ),
+  _indices(),
+  _selected() {
+
+  _description =
+    "Reads a selection of events (range, sample, shard) from a chain of LCIO files using an event index.\n"
+    "Make sure to not specify any LCIOInputFiles in the steering.";
+
+  registerProcessorParameter( "InputFiles", "The LCIO files to read",
+                              _inputFiles, StringVec() );
+
+  registerOptionalParameter( "IndexCollections", "Collections whose number of elements is stored in the index",
+                             _indexCollections, StringVec() );
+
+  registerOptionalParameter( "WriteIndex", "Store indices built on the fly next to the data",
+                             _writeIndex, true );
+
+  registerOptionalParameter( "FirstEvent", "First event of the range, counted over the chain of files",
+                             _firstEvent, static_cast< int >( 0 ) );
+
+  registerOptionalParameter( "LastEvent", "Last event of the range, counted over the chain of files, -1 for the last event",
+                             _lastEvent, static_cast< int >( -1 ) );
+
+  registerOptionalParameter( "RequiredCollection", "Only read events where this collection has at least MinCollectionSize elements, empty for all events",
+                             _requiredCollection, string( "" ) );
+
+  registerOptionalParameter( "MinCollectionSize", "Minimum number of elements of the RequiredCollection",
+                             _minCollectionSize, static_cast< int >( 1 ) );
+
+  registerOptionalParameter( "SampledEvents", "Number of events sampled uniformly over the selection, 0 for all",
+                             _sampledEvents, static_cast< int >( 0 ) );
+
+  registerOptionalParameter( "NumberOfShards", "Number of contiguous shards the selection is split into",
+                             _nShards, static_cast< int >( 1 ) );
+
+  registerOptionalParameter( "ShardIndex", "Shard to read, from 0 to NumberOfShards-1",
+                             _shardIndex, static_cast< int >( 0 ) );
+}
+
+EUTelIndexedLCIOReader* EUTelIndexedLCIOReader::newProcessor() {
+  return new EUTelIndexedLCIOReader;
+}
+
+void EUTelIndexedLCIOReader::init() {
+
+  printParameters();
+
+  if ( _nShards < 1 || _shardIndex < 0 || _shardIndex >= _nShards ) {
+    throw InvalidParameterException( "ShardIndex must be between 0 and NumberOfShards-1" );
+  }
+
+  vector<string> collections = _indexCollections;
+  if ( !_requiredCollection.empty() &&
+       find( collections.begin(), collections.end(), _requiredCollection ) == collections.end() ) {
+    collections.push_back( _requiredCollection );
+  }
+
+  _indices.resize( _inputFiles.size() );
+  for ( size_t iFile = 0; iFile < _inputFiles.size(); ++iFile ) {
+    _indices[iFile].load( _inputFiles[iFile], collections, _writeIndex );
+  }
+
+  selectEvents();
+}
+
+void EUTelIndexedLCIOReader::selectEvents() {
+
+  // candidates over the whole chain: file and position in the file
+  vector< pair<size_t, size_t> > candidates;
+  long long totalBytes = 0;
+  int chainPosition = 0;
+
+  for ( size_t iFile = 0; iFile < _indices.size(); ++iFile ) {
+    const EUTelEventIndex& index = _indices[iFile];
+    const int iCol = _requiredCollection.empty() ? -1 : index.getCollectionIndex( _requiredCollection );
+    totalBytes += index.getFileSize();
+
+    for ( size_t i = 0; i < index.size(); ++i ) {
+      if ( index.getEventType( i ) == kEORE ) continue;
+
+      const int position = chainPosition++;
+      if ( position < _firstEvent ) continue;
+      if ( _lastEvent >= 0 && position > _lastEvent ) continue;
+      if ( iCol >= 0 && index.getCollectionSize( i, iCol ) < _minCollectionSize ) continue;
+
+      candidates.push_back( make_pair( iFile, i ) );
+    }
+  }
+
+  // uniform sampling: the centres of equal parts of the selection
+  if ( _sampledEvents > 0 && static_cast< size_t >( _sampledEvents ) < candidates.size() ) {
+    vector< pair<size_t, size_t> > sampled( _sampledEvents );
+    for ( size_t i = 0; i < sampled.size(); ++i ) {
+      sampled[i] = candidates[ ( 2 * i + 1 ) * candidates.size() / ( 2 * sampled.size() ) ];
+    }
+    candidates.swap( sampled );
+  }
+
+  // contiguous shards, so that each job reads as few files as possible
+  const size_t begin = _shardIndex * candidates.size() / _nShards;
+  const size_t end = ( _shardIndex + 1 ) * candidates.size() / _nShards;
+
+  _selected.assign( _indices.size(), vector<size_t>() );
+  long long selectedBytes = 0;
+  for ( size_t i = begin; i < end; ++i ) {
+    _selected[ candidates[i].first ].push_back( candidates[i].second );
+    selectedBytes += max( _indices[ candidates[i].first ].getEventBytes( candidates[i].second ), 0LL );
+  }
+
+  streamlog_out( MESSAGE4 ) << "Selected " << end - begin << " of " << chainPosition << " events in "
+                            << _indices.size() << " files (" << selectedBytes / 1048576 << " of "
+                            << totalBytes / 1048576 << " MB)" << endl;
+}
+
+void EUTelIndexedLCIOReader::readDataSource( int numEvents ) {
+
+  auto_ptr< lcio::LCReader > reader( lcio::LCFactory::getInstance()->createLCReader() );
+
+  int eventCounter = 0;
+  int lastRun = -1;
+  bool firstRun = true;
+
+  for ( size_t iFile = 0; iFile < _selected.size(); ++iFile ) {
+
+    const vector<size_t>& positions = _selected[iFile];
+    if ( positions.empty() ) continue;
+    if ( numEvents > 0 && eventCounter >= numEvents ) break;
+
+    streamlog_out( MESSAGE4 ) << "Reading " << positions.size() << " events from " << _inputFiles[iFile] << endl;
+
+    reader->open( _inputFiles[iFile] );
+
+    // the run header is the first record; if there is none, start over
+    EVENT::LCRunHeader* runHeader = reader->readNextRunHeader();
+    if ( runHeader == NULL ) {
+      reader->close();
+      reader->open( _inputFiles[iFile] );
+    } else if ( firstRun || runHeader->getRunNumber() != lastRun ) {
+      ProcessorMgr::instance()->processRunHeader( runHeader );
+      lastRun = runHeader->getRunNumber();
+      firstRun = false;
+    }
+
+    size_t current = 0;
+    for ( size_t i = 0; i < positions.size(); ++i ) {
+      if ( numEvents > 0 && eventCounter >= numEvents ) break;
+
+      if ( positions[i] > current ) reader->skipNEvents( positions[i] - current );
+      EVENT::LCEvent* event = reader->readNextEvent( lcio::LCIO::UPDATE );
+      current = positions[i] + 1;
+
+      if ( event == NULL ) {
+        throw lcio::IOException( "Event index of " + _inputFiles[iFile] + " does not match the file" );
+      }
+
+      ProcessorMgr::instance()->processEvent( event );
+      ++eventCounter;
+    }
+
+    reader->close();
+  }
+
+  addEORE();
+}
+
+void EUTelIndexedLCIOReader::addEORE() {
+  EUTelEventImpl* event = new EUTelEventImpl;
+  event->setEventType( kEORE );
+  ProcessorMgr::instance()->processEvent( event );
+  delete event;
+}
+
+void EUTelIndexedLCIOReader::end() {
+  streamlog_out( MESSAGE4 ) << "Successfully finished" << endl;
+}
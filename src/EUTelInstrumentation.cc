@@ -0,0 +1,166 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelInstrumentation.h"
+
+// lcio includes <.h>
+#include <EVENT/LCCollection.h>
+
+// system includes <>
+#include <algorithm>
+#include <sys/resource.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace std;
+using namespace eutelescope;
+
+EUTelInstrumentation::ProcessorStats::ProcessorStats() :
+  name(),
+  nEvents( 0 ),
+  nSampled( 0 ),
+  wallTime( 0 ),
+  maxWallTime( 0 ),
+  cpuTime( 0 ),
+  heapGrowth( 0 ),
+  maxHeapGrowth( 0 ),
+  minorFaults( 0 ),
+  peakCollectionSizes() {
+}
+
+EUTelInstrumentation::Scope::Scope( const marlin::Processor* processor, EVENT::LCEvent* event ) :
+  _stats( NULL ),
+  _event( event ),
+  _collectionNames(),
+  _wallStart(),
+  _cpuStart( 0 ),
+  _heapStart( 0 ),
+  _faultsStart( 0 ) {
+
+  EUTelInstrumentation& instrumentation = getInstance();
+  if ( !instrumentation.isEnabled() || event == NULL ) return;
+
+  ProcessorStats& stats = instrumentation.getStats( processor );
+  ++stats.nEvents;
+  if ( event->getEventNumber() % instrumentation._samplingInterval != 0 ) return;
+  _stats = &stats;
+
+  _collectionNames = *event->getCollectionNames();
+  sort( _collectionNames.begin(), _collectionNames.end() );
+
+  // start the clocks last, so that the bookkeeping above is not measured
+  if ( instrumentation._memoryStatistics ) {
+    _faultsStart = getMinorFaults();
+    _heapStart = getHeapInUse();
+  }
+  _cpuStart = clock();
+  _wallStart = chrono::steady_clock::now();
+}
+
+EUTelInstrumentation::Scope::~Scope() {
+
+  if ( _stats == NULL ) return;
+
+  Measurement measurement;
+  measurement.wallTime = chrono::duration<double>( chrono::steady_clock::now() - _wallStart ).count();
+  measurement.cpuTime = static_cast< double >( clock() - _cpuStart ) / CLOCKS_PER_SEC;
+  measurement.heapGrowth = 0;
+
+  EUTelInstrumentation& instrumentation = getInstance();
+  if ( instrumentation._memoryStatistics ) {
+    measurement.heapGrowth = getHeapInUse() - _heapStart;
+    _stats->minorFaults += getMinorFaults() - _faultsStart;
+  }
+
+  ++_stats->nSampled;
+  _stats->wallTime += measurement.wallTime;
+  _stats->maxWallTime = max( _stats->maxWallTime, measurement.wallTime );
+  _stats->cpuTime += measurement.cpuTime;
+  _stats->heapGrowth += measurement.heapGrowth;
+  _stats->maxHeapGrowth = max( _stats->maxHeapGrowth, measurement.heapGrowth );
+
+  // collections added by the processor
+  const vector<string>& names = *_event->getCollectionNames();
+  for ( size_t i = 0; i < names.size(); ++i ) {
+    if ( binary_search( _collectionNames.begin(), _collectionNames.end(), names[i] ) ) continue;
+    const int size = _event->getCollection( names[i] )->getNumberOfElements();
+    int& peak = _stats->peakCollectionSizes[ names[i] ];
+    peak = max( peak, size );
+  }
+
+  measurement.processor = _stats;
+  measurement.runNumber = _event->getRunNumber();
+  measurement.eventNumber = _event->getEventNumber();
+  instrumentation._measurements.push_back( measurement );
+}
+
+EUTelInstrumentation& EUTelInstrumentation::getInstance() {
+  static EUTelInstrumentation instance;
+  return instance;
+}
+
+EUTelInstrumentation::EUTelInstrumentation() :
+  _enabled( false ),
+  _samplingInterval( 1 ),
+  _memoryStatistics( false ),
+  _stats(),
+  _processorOrder(),
+  _measurements() {
+}
+
+void EUTelInstrumentation::enable( int samplingInterval, bool memoryStatistics ) {
+  _enabled = true;
+  _samplingInterval = max( samplingInterval, 1 );
+  _memoryStatistics = memoryStatistics;
+}
+
+void EUTelInstrumentation::takeMeasurements( vector<Measurement>& measurements ) {
+  measurements.clear();
+  measurements.swap( _measurements );
+}
+
+EUTelInstrumentation::ProcessorStats& EUTelInstrumentation::getStats( const marlin::Processor* processor ) {
+  map<const marlin::Processor*, ProcessorStats>::iterator iter = _stats.find( processor );
+  if ( iter != _stats.end() ) return iter->second;
+
+  ProcessorStats& stats = _stats[ processor ];
+  stats.name = processor->name();
+  _processorOrder.push_back( &stats );
+  return stats;
+}
+
+long long EUTelInstrumentation::getHeapInUse() {
+#if defined(__GLIBC__) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+  const struct mallinfo2 info = mallinfo2();
+  return static_cast< long long >( info.uordblks + info.hblkhd );
+#elif defined(__GLIBC__)
+  const struct mallinfo info = mallinfo();
+  return static_cast< long long >( static_cast< unsigned int >( info.uordblks ) ) + static_cast< unsigned int >( info.hblkhd );
+#else
+  return 0;
+#endif
+}
+
+long long EUTelInstrumentation::getMinorFaults() {
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+  return usage.ru_minflt;
+}
+
+long long EUTelInstrumentation::getPeakResidentSize() {
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return static_cast< long long >( usage.ru_maxrss ) * 1024;
+#endif
+}
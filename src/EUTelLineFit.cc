@@ -14,6 +14,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelLineFit.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -189,6 +190,10 @@ void EUTelLineFit::init() {
   _intrResolX = new double[_nPlanes];
   _intrResolY = new double[_nPlanes];
 
+  // fit weights are computed with the first event
+  _fitWeightZ.clear();
+  _fitZbar[0] = _fitZbar[1] = 0.;
+
 }
 
 void EUTelLineFit::processRunHeader (LCRunHeader * rdr) {
@@ -240,6 +245,7 @@ void EUTelLineFit::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelLineFit::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event) ;
@@ -371,87 +377,32 @@ void EUTelLineFit::processEvent (LCEvent * event) {
 
     int counter;
 
-    float S1[2]   = {0,0};
-    float Sx[2]   = {0,0};
-    float Xbar[2] = {0,0};
+    // Weights of the fit only depend on the geometry
 
-    float * Zbar_X = new float[_nPlanes];
-    float * Zbar_Y = new float[_nPlanes];
-    for (counter = 0; counter < _nPlanes; counter++){
-      Zbar_X[counter] = 0.;
-      Zbar_Y[counter] = 0.;
-    }
+    prepareFitWeights();
 
-    float Sy[2]     = {0,0};
-    float Ybar[2]   = {0,0};
-    float Sxybar[2] = {0,0};
-    float Sxxbar[2] = {0,0};
-    float A2[2]     = {0,0};
+    double Xbar[2] = { _fitZbar[0], _fitZbar[1] };
+    double Ybar[2] = {0,0};
+    double A2[2]   = {0,0};
     float Chiquare[2] = {0,0};
     float angle[2] = {0,0};
 
-    // define S1
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      S1[0] = S1[0] + 1/pow(_intrResolX[counter],2);
-      S1[1] = S1[1] + 1/pow(_intrResolY[counter],2);
-    }
-
-    // define Sx
     for( counter = 0; counter < _nPlanes; counter++ ){
-      Sx[0] = Sx[0] + _zPos[counter]/pow(_intrResolX[counter],2);
-      Sx[1] = Sx[1] + _zPos[counter]/pow(_intrResolY[counter],2);
+      Ybar[0] += _meanWeightX[counter]  * _xPos[counter];
+      Ybar[1] += _meanWeightY[counter]  * _yPos[counter];
+      A2[0]   += _slopeWeightX[counter] * _xPos[counter];
+      A2[1]   += _slopeWeightY[counter] * _yPos[counter];
     }
 
-    // define Xbar
-    Xbar[0]=Sx[0]/S1[0];
-    Xbar[1]=Sx[1]/S1[1];
-
-    // coordinate transformation !! -> bar
-    for( counter=0; counter < _nPlanes; counter++ ){
-      Zbar_X[counter] = _zPos[counter]-Xbar[0];
-      Zbar_Y[counter] = _zPos[counter]-Xbar[1];
-    }
-
-    // define Sy
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sy[0] = Sy[0] + _xPos[counter]/pow(_intrResolX[counter],2);
-      Sy[1] = Sy[1] + _yPos[counter]/pow(_intrResolY[counter],2);
-    }
-
-    // define Ybar
-    Ybar[0]=Sy[0]/S1[0];
-    Ybar[1]=Sy[1]/S1[1];
-
-    // define Sxybar
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sxybar[0] = Sxybar[0] + Zbar_X[counter] * _xPos[counter]/pow(_intrResolX[counter],2);
-      Sxybar[1] = Sxybar[1] + Zbar_Y[counter] * _yPos[counter]/pow(_intrResolY[counter],2);
-    }
-
-    // define Sxxbar
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sxxbar[0] = Sxxbar[0] + Zbar_X[counter] * Zbar_X[counter]/pow(_intrResolX[counter],2);
-      Sxxbar[1] = Sxxbar[1] + Zbar_Y[counter] * Zbar_Y[counter]/pow(_intrResolX[counter],2);
-    }
-
-    // define A2
-
-    A2[0]=Sxybar[0]/Sxxbar[0];
-    A2[1]=Sxybar[1]/Sxxbar[1];
-
     // Calculate chi sqaured
     // Chi^2 for X and Y coordinate for hits in all planes
 
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Chiquare[0] += pow(-_zPos[counter]*A2[0]
-                         +_xPos[counter]-Ybar[0]+Xbar[0]*A2[0],2)/pow(_intrResolX[counter],2);
-      Chiquare[1] += pow(-_zPos[counter]*A2[1]
-                         +_yPos[counter]-Ybar[1]+Xbar[1]*A2[1],2)/pow(_intrResolY[counter],2);
-    }
-
     for( counter = 0; counter < _nPlanes; counter++ ){
       _waferResidX[counter] = (Ybar[0]-Xbar[0]*A2[0]+_zPos[counter]*A2[0])-_xPos[counter];
       _waferResidY[counter] = (Ybar[1]-Xbar[1]*A2[1]+_zPos[counter]*A2[1])-_yPos[counter];
+
+      Chiquare[0] += _waferResidX[counter] * _waferResidX[counter] / ( _intrResolX[counter] * _intrResolX[counter] );
+      Chiquare[1] += _waferResidY[counter] * _waferResidY[counter] / ( _intrResolY[counter] * _intrResolY[counter] );
     }
 
     // define angle
@@ -621,10 +572,6 @@ void EUTelLineFit::processEvent (LCEvent * event) {
 
 #endif
 
-    delete [] Zbar_X;
-    delete [] Zbar_Y;
-
-
   } catch (DataNotAvailableException& e) {
 
     streamlog_out  ( WARNING2 ) <<  "No input collection found on event " << event->getEventNumber()
@@ -654,6 +601,61 @@ void EUTelLineFit::end() {
 
 }
 
+void EUTelLineFit::prepareFitWeights() {
+
+  // ++++++++++++ See Blobel Page 226 !!! +++++++++++++++++
+  //
+  // With w = 1/sigma^2 the fitted position at zbar = S(w z)/S(w) is
+  // Ybar = S(w x)/S(w) and the slope is S(w (z-zbar) x)/S(w (z-zbar)^2),
+  // both linear in the hit positions x.
+
+  if ( static_cast< int >( _fitWeightZ.size() ) == _nPlanes &&
+       std::equal( _fitWeightZ.begin(), _fitWeightZ.end(), _zPos ) ) return;
+
+  _fitWeightZ.assign( _zPos, _zPos + _nPlanes );
+  _meanWeightX.assign( _nPlanes, 0. );
+  _meanWeightY.assign( _nPlanes, 0. );
+  _slopeWeightX.assign( _nPlanes, 0. );
+  _slopeWeightY.assign( _nPlanes, 0. );
+
+  double S1[2]     = {0,0};
+  double Sx[2]     = {0,0};
+  double Sxxbar[2] = {0,0};
+
+  for ( int counter = 0; counter < _nPlanes; counter++ ) {
+    const double wX = 1. / ( _intrResolX[counter] * _intrResolX[counter] );
+    const double wY = 1. / ( _intrResolY[counter] * _intrResolY[counter] );
+    S1[0] += wX;
+    S1[1] += wY;
+    Sx[0] += wX * _zPos[counter];
+    Sx[1] += wY * _zPos[counter];
+  }
+
+  _fitZbar[0] = Sx[0] / S1[0];
+  _fitZbar[1] = Sx[1] / S1[1];
+
+  for ( int counter = 0; counter < _nPlanes; counter++ ) {
+    const double wX = 1. / ( _intrResolX[counter] * _intrResolX[counter] );
+    const double wY = 1. / ( _intrResolY[counter] * _intrResolY[counter] );
+    const double zbarX = _zPos[counter] - _fitZbar[0];
+    const double zbarY = _zPos[counter] - _fitZbar[1];
+
+    Sxxbar[0] += wX * zbarX * zbarX;
+    Sxxbar[1] += wY * zbarY * zbarY;
+
+    _meanWeightX[counter]  = wX / S1[0];
+    _meanWeightY[counter]  = wY / S1[1];
+    _slopeWeightX[counter] = wX * zbarX;
+    _slopeWeightY[counter] = wY * zbarY;
+  }
+
+  for ( int counter = 0; counter < _nPlanes; counter++ ) {
+    _slopeWeightX[counter] /= Sxxbar[0];
+    _slopeWeightY[counter] /= Sxxbar[1];
+  }
+
+}
+
 void EUTelLineFit::bookHistos() {
 
 
@@ -14,6 +14,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelMille.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -35,9 +36,6 @@
 #include "marlin/Exceptions.h"
 #include "marlin/AIDAProcessor.h"
 
-// marlin util includes
-#include "mille/Mille.h"
-
 // aida includes <.h>
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 #include <marlin/AIDAProcessor.h>
@@ -186,6 +184,9 @@ EUTelMille::EUTelMille () : Processor("EUTelMille") {
   registerOptionalParameter("AllowedMissingHits","Set how many hits (=planes) can be missing on a track candidate.",
                             _allowedMissingHits, static_cast <int> (0));
 
+  registerOptionalParameter("UseRecursiveTrackFinder","Use the old recursive track candidate search instead of the road search (input modes 0 and 2).",
+                            _useRecursiveTrackFinder, static_cast <bool> (false));
+
   registerOptionalParameter("MimosaClusterChargeMin","Remove Mimosa26 clusters with a charge (i.e. number of fired pixels in cluster) below or equal to this value",
                             _mimosa26ClusterChargeMin,  static_cast <int> (1) );
 
@@ -220,7 +221,13 @@ EUTelMille::EUTelMille () : Processor("EUTelMille") {
   registerOptionalParameter("MaxTrackCandidatesTotal","Stop processor after this maximum number of track candidates (Total) is reached.",_maxTrackCandidatesTotal, static_cast <int> (10000000));
   registerOptionalParameter("MaxTrackCandidates","Maximal number of track candidates in a event.",_maxTrackCandidates, static_cast <int> (2000));
 
-  registerOptionalParameter("BinaryFilename","Name of the Millepede binary file.",_binaryFilename, string ("mille.bin"));
+  registerOptionalParameter("BinaryFilename","Name of the Millepede binary file. With the extension .gz the file is compressed (needs zlib).",_binaryFilename, string ("mille.bin"));
+
+  registerOptionalParameter("BinaryBufferSize","Size of the write blocks of the Millepede binary in MB.",_binaryBufferSize, static_cast <int> (8));
+
+  registerOptionalParameter("BinaryTrackSampling","Write only every n-th track to the Millepede binary.",_binaryTrackSampling, static_cast <int> (1));
+
+  registerOptionalParameter("BinaryMinMeasurements","Write only tracks with at least this number of measurements to the Millepede binary, 0 for all.",_binaryMinMeasurements, static_cast <int> (0));
 
   registerOptionalParameter("TelescopeResolution","(default) Resolution of the telescope for Millepede (sigma_x=sigma_y) used only if plane dependent resolution is set inconsistently.",_telescopeResolution, static_cast <float> (3.0));
 
@@ -542,7 +549,9 @@ void EUTelMille::init() {
   bookHistos();
 
   streamlog_out ( MESSAGE5 ) << "Initialising Mille..." << endl;
-  _mille = new Mille(_binaryFilename.c_str());
+  _mille = new EUTelMilleWriter(_binaryFilename, static_cast< size_t >( std::max(_binaryBufferSize, 1) ) * 1024 * 1024);
+  _mille->setSampling( std::max(_binaryTrackSampling, 1) );
+  _mille->setMinMeasurements( static_cast< unsigned int >( std::max(_binaryMinMeasurements, 0) ) );
 
   _xPos.clear();
   _yPos.clear();
@@ -767,6 +776,146 @@ void EUTelMille::findtracks2(
 
 
 
+bool EUTelMille::isHitOnRoad(
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> >& hitsArray,
+                            const IntVec& candidate,
+                            int lastHitPlane,
+                            unsigned int plane,
+                            int hit
+                            ) const
+{
+  // any hit can seed a road
+  if( lastHitPlane < 0 ) return true;
+
+  const HitsInPlane& last = hitsArray[lastHitPlane][candidate[lastHitPlane]];
+  const HitsInPlane& current = hitsArray[plane][hit];
+  const double residualX = std::fabs(current.measuredX - last.measuredX);
+  const double residualY = std::fabs(current.measuredY - last.measuredY);
+
+  if( lastHitPlane == static_cast<int>(plane) - 1 )
+  {
+    const int e = lastHitPlane;
+    return !( residualX < _residualsXMin[e] || residualX > _residualsXMax[e] ||
+              residualY < _residualsYMin[e] || residualY > _residualsYMax[e] );
+  }
+
+  // omitted planes in between: the road widens by the cut of every gap
+  double maxX = 0.;
+  double maxY = 0.;
+  for( unsigned int e = lastHitPlane; e < plane; e++ )
+  {
+    maxX += _residualsXMax[e];
+    maxY += _residualsYMax[e];
+  }
+  return residualX <= maxX && residualY <= maxY;
+}
+
+void EUTelMille::findTrackCandidates(
+                            std::vector<IntVec >& indexarray,
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> >& hitsArray
+                            )
+{
+  const unsigned int nPlanes = hitsArray.size();
+  if( nPlanes == 0 ) return;
+
+  // sort the hits of every plane by x
+  _sortedHitIndex.resize(nPlanes);
+  _sortedHitX.resize(nPlanes);
+  for( unsigned int plane = 0; plane < nPlanes; plane++ )
+  {
+    IntVec& index = _sortedHitIndex[plane];
+    index.resize(hitsArray[plane].size());
+    for( size_t ihit = 0; ihit < index.size(); ihit++ ) index[ihit] = static_cast<int>(ihit);
+    const std::vector<HitsInPlane>& hits = hitsArray[plane];
+    std::sort( index.begin(), index.end(), [&hits](int a, int b) { return hits[a].measuredX < hits[b].measuredX; } );
+
+    DoubleVec& sortedX = _sortedHitX[plane];
+    sortedX.resize(index.size());
+    for( size_t ihit = 0; ihit < index.size(); ihit++ ) sortedX[ihit] = hits[index[ihit]].measuredX;
+  }
+
+  // depth first search over the planes without recursion: for every
+  // plane we keep the window of sorted hits still to be tried, the
+  // last plane with a hit and the number of omitted planes so far
+  IntVec candidate(nPlanes, -1);
+  std::vector<size_t> next(nPlanes, 0);
+  std::vector<size_t> end(nPlanes, 0);
+  IntVec lastHitPlane(nPlanes + 1, -1);
+  IntVec missingHits(nPlanes + 1, 0);
+  std::vector<bool> foundHit(nPlanes, false);
+  std::vector<bool> omitted(nPlanes, false);
+
+  auto openPlane = [&](unsigned int plane) {
+    foundHit[plane] = false;
+    omitted[plane] = false;
+    const DoubleVec& sortedX = _sortedHitX[plane];
+    const int last = lastHitPlane[plane];
+    if( last < 0 )
+    {
+      next[plane] = 0;
+      end[plane] = sortedX.size();
+      return;
+    }
+    double maxX = 0.;
+    for( int e = last; e < static_cast<int>(plane); e++ ) maxX += _residualsXMax[e];
+    const double x = hitsArray[last][candidate[last]].measuredX;
+    next[plane] = std::lower_bound( sortedX.begin(), sortedX.end(), x - maxX ) - sortedX.begin();
+    end[plane] = std::upper_bound( sortedX.begin(), sortedX.end(), x + maxX ) - sortedX.begin();
+  };
+
+  unsigned int plane = 0;
+  openPlane(plane);
+  while( true )
+  {
+    if( plane == nPlanes )
+    {
+      if( lastHitPlane[nPlanes] >= 0 && static_cast< int >(indexarray.size()) < _maxTrackCandidates ) indexarray.push_back(candidate);
+      if( static_cast< int >(indexarray.size()) >= _maxTrackCandidates )
+      {
+        streamlog_out(DEBUG5) << "Maximal number of track candidates reached, stopping the search" << std::endl;
+        return;
+      }
+      plane--;
+      continue;
+    }
+
+    // try the next hit of this plane inside the road
+    bool descended = false;
+    while( next[plane] < end[plane] )
+    {
+      const int ihit = _sortedHitIndex[plane][next[plane]++];
+      if( !isHitOnRoad(hitsArray, candidate, lastHitPlane[plane], plane, ihit) ) continue;
+
+      foundHit[plane] = true;
+      candidate[plane] = ihit;
+      lastHitPlane[plane + 1] = plane;
+      missingHits[plane + 1] = missingHits[plane];
+      plane++;
+      if( plane < nPlanes ) openPlane(plane);
+      descended = true;
+      break;
+    }
+    if( descended ) continue;
+
+    // no hit of this plane is compatible with the road: omit the plane
+    if( !foundHit[plane] && !omitted[plane] && missingHits[plane] < getAllowedMissingHits() )
+    {
+      omitted[plane] = true;
+      candidate[plane] = -1;
+      lastHitPlane[plane + 1] = lastHitPlane[plane];
+      missingHits[plane + 1] = missingHits[plane] + 1;
+      plane++;
+      if( plane < nPlanes ) openPlane(plane);
+      continue;
+    }
+
+    // this plane is exhausted, step back
+    candidate[plane] = -1;
+    if( plane == 0 ) break;
+    plane--;
+  }
+}
+
 void EUTelMille::findtracks(
                             std::vector<IntVec > &indexarray,
                             IntVec vec,
@@ -1139,6 +1288,7 @@ void  EUTelMille::findMatchedHits(int& _ntrack, Track* TrackHere) {
 }
 
 void EUTelMille::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
 
     if ( isFirstEvent() )
     {
@@ -1183,7 +1333,9 @@ void EUTelMille::processEvent (LCEvent * event) {
     std::vector<std::vector<EUTelMille::HitsInPlane> > _hitsArray(_nPlanes - _nExcludePlanes, std::vector<EUTelMille::HitsInPlane>());
     IntVec indexconverter (_nPlanes,-1);
 
-    std::vector<std::vector<EUTelMille::HitsInPlane> > _allHitsArray(_nPlanes, std::vector<EUTelMille::HitsInPlane>());
+    std::vector<std::vector<EUTelMille::HitsInPlane> >& _allHitsArray = _allHitsArrayBuffer;
+    _allHitsArray.resize(_nPlanes);
+    for(size_t i = 0; i < _allHitsArray.size(); i++) _allHitsArray[i].clear();
 
     //---------------------
     // By Chen
@@ -1297,7 +1449,11 @@ void EUTelMille::processEvent (LCEvent * event) {
         std::vector<IntVec > indexarray;
 
         streamlog_out( DEBUG5 ) << "Event #" << _iEvt << std::endl;
-        findtracks2(0, indexarray, IntVec(), _allHitsArray, 0, 0);
+        if( _useRecursiveTrackFinder ) {
+          findtracks2(0, indexarray, IntVec(), _allHitsArray, 0, 0);
+        } else {
+          findTrackCandidates(indexarray, _allHitsArray);
+        }
         for(size_t i = 0; i < indexarray.size(); i++)
         {
             for(size_t j = 0; j <  _nPlanes; j++)
@@ -2524,6 +2680,8 @@ void EUTelMille::end() {
     }
 
     // close the output file
+    streamlog_out ( MESSAGE1 ) << "Tracks written to the Millepede binary: " << _mille->getNWritten() << endl;
+    _mille->close();
     delete _mille;
 
     // if write the pede steering file
@@ -0,0 +1,203 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelMilleFile.h"
+
+// marlin includes ".h"
+#include "streamlog/streamlog.h"
+
+// lcio includes <.h>
+#include <Exceptions.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+// system includes <>
+#include <cstring>
+
+using namespace std;
+using namespace eutelescope;
+
+EUTelMilleRecord::EUTelMilleRecord() :
+  _floats(),
+  _ints(),
+  _nMeasurements(0) {
+}
+
+void EUTelMilleRecord::clear() {
+  _floats.clear();
+  _ints.clear();
+  _nMeasurements = 0;
+}
+
+void EUTelMilleRecord::addMeasurement( int nLC, const float* derLC, int nGL, const float* derGL,
+                                       const int* label, float residual, float sigma ) {
+
+  // same conventions as Mille: no measurement without error, only
+  // non-zero derivatives and valid labels are stored
+  if ( sigma <= 0. ) return;
+
+  if ( _floats.empty() ) {
+    _floats.push_back( 0. );
+    _ints.push_back( 0 );
+  }
+
+  _floats.push_back( residual );
+  _ints.push_back( 0 );
+
+  for ( int i = 0; i < nLC; ++i ) {
+    if ( derLC[i] != 0. ) {
+      _floats.push_back( derLC[i] );
+      _ints.push_back( i + 1 );
+    }
+  }
+
+  _floats.push_back( sigma );
+  _ints.push_back( 0 );
+
+  for ( int i = 0; i < nGL; ++i ) {
+    if ( derGL[i] != 0. && label[i] > 0 ) {
+      _floats.push_back( derGL[i] );
+      _ints.push_back( label[i] );
+    }
+  }
+
+  ++_nMeasurements;
+}
+
+EUTelMilleWriter::EUTelMilleWriter( const string& fileName, size_t bufferSize ) :
+  _record(),
+  _buffer(),
+  _bufferSize( bufferSize ),
+  _file( NULL ),
+  _compressed( false ),
+  _sampling( 1 ),
+  _minMeasurements( 0 ),
+  _nRecords( 0 ),
+  _nWritten( 0 ) {
+
+  _compressed = fileName.size() > 3 && fileName.compare( fileName.size() - 3, 3, ".gz" ) == 0;
+
+  if ( _compressed ) {
+#ifdef USE_ZLIB
+    gzFile file = gzopen( fileName.c_str(), "wb" );
+    if ( file ) gzbuffer( file, 256*1024 );
+    _file = file;
+#else
+    throw lcio::IOException( "Compressed Millepede binary " + fileName + " requested, but Eutelescope was built without zlib" );
+#endif
+  } else {
+    _file = fopen( fileName.c_str(), "wb" );
+  }
+
+  if ( _file == NULL ) {
+    throw lcio::IOException( "Cannot open Millepede binary " + fileName );
+  }
+
+  _buffer.reserve( _bufferSize + 4096 );
+}
+
+EUTelMilleWriter::~EUTelMilleWriter() {
+  try {
+    close();
+  } catch ( std::exception& e ) {
+    streamlog_out( ERROR5 ) << "Error closing the Millepede binary: " << e.what() << std::endl;
+  }
+}
+
+void EUTelMilleWriter::close() {
+
+  if ( _file == NULL ) return;
+
+  // the file is closed also if the last write fails
+  bool flushed = true;
+  try {
+    flush();
+  } catch ( lcio::IOException& ) {
+    flushed = false;
+  }
+
+  bool closed = false;
+#ifdef USE_ZLIB
+  if ( _compressed ) {
+    closed = gzclose( static_cast< gzFile >( _file ) ) == Z_OK;
+  } else
+#endif
+  {
+    closed = fclose( static_cast< FILE* >( _file ) ) == 0;
+  }
+  _file = NULL;
+
+  if ( !flushed || !closed ) {
+    throw lcio::IOException( "Writing the Millepede binary failed" );
+  }
+}
+
+void EUTelMilleWriter::mille( int nLC, const float* derLC, int nGL, const float* derGL,
+                              const int* label, float residual, float sigma ) {
+  _record.addMeasurement( nLC, derLC, nGL, derGL, label, residual, sigma );
+}
+
+void EUTelMilleWriter::kill() {
+  _record.clear();
+}
+
+void EUTelMilleWriter::end() {
+
+  if ( _record.empty() ) return;
+
+  const bool selected = ( _nRecords % _sampling == 0 ) && _record.getNMeasurements() >= _minMeasurements;
+  ++_nRecords;
+
+  if ( selected ) {
+    // record: number of words, floats, ints
+    const vector<float>& floats = _record.getFloats();
+    const vector<int>& ints = _record.getInts();
+    const int nWords = 2 * floats.size();
+
+    const size_t offset = _buffer.size();
+    _buffer.resize( offset + sizeof( int ) + floats.size() * sizeof( float ) + ints.size() * sizeof( int ) );
+
+    char* out = &_buffer[offset];
+    memcpy( out, &nWords, sizeof( int ) );
+    out += sizeof( int );
+    memcpy( out, &floats[0], floats.size() * sizeof( float ) );
+    out += floats.size() * sizeof( float );
+    memcpy( out, &ints[0], ints.size() * sizeof( int ) );
+
+    ++_nWritten;
+
+    if ( _buffer.size() >= _bufferSize ) flush();
+  }
+
+  _record.clear();
+}
+
+void EUTelMilleWriter::flush() {
+
+  if ( _buffer.empty() || _file == NULL ) return;
+
+  bool written = false;
+#ifdef USE_ZLIB
+  if ( _compressed ) {
+    written = gzwrite( static_cast< gzFile >( _file ), &_buffer[0], _buffer.size() ) == static_cast< int >( _buffer.size() );
+  } else
+#endif
+  {
+    written = fwrite( &_buffer[0], 1, _buffer.size(), static_cast< FILE* >( _file ) ) == _buffer.size();
+  }
+
+  _buffer.clear();
+
+  if ( !written ) {
+    throw lcio::IOException( "Writing the Millepede binary failed" );
+  }
+}
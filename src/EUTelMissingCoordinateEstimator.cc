@@ -10,6 +10,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelMissingCoordinateEstimator.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -31,7 +32,9 @@
 // system includes <>
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <iostream>
 #include <iomanip>
@@ -42,6 +45,33 @@ using namespace marlin;
 using namespace gear;
 using namespace eutelescope;
 
+namespace {
+    
+    //! Hits of one plane sorted by their known coordinate
+    struct SortedPlaneHits {
+        SortedPlaneHits() : zMin(0), zMax(0), hits() {}
+        
+        void add(double known, double z, unsigned int index) {
+            if (hits.empty() || z < zMin) zMin = z;
+            if (hits.empty() || z > zMax) zMax = z;
+            hits.push_back( make_pair(known, index) );
+        }
+        
+        void sort() { std::sort( hits.begin(), hits.end() ); }
+        
+        //! Appends the indices of the hits with lower <= known coordinate <= upper
+        void find(double lower, double upper, vector<unsigned int>& indices) const {
+            vector< pair<double, unsigned int> >::const_iterator it = lower_bound( hits.begin(), hits.end(), make_pair(lower, 0u) );
+            for ( ; it != hits.end() && it->first <= upper; ++it ) indices.push_back( it->second );
+        }
+        
+        double zMin;
+        double zMax;
+        vector< pair<double, unsigned int> > hits;
+    };
+    
+}
+
 // definition of static members mainly used to name histograms
 
 EUTelMissingCoordinateEstimator::EUTelMissingCoordinateEstimator () : Processor("EUTelMissingCoordinateEstimator"),
@@ -51,6 +81,8 @@ _referencePlanes(),
 _dutPlanes(),
 _missingCoordinate(),
 _maxResidual(0),
+_sortedHitSearch(true),
+_maxReferenceSlope(-1),
 _iRun(0),
 _iEvt(0),
 _missingHitPos(0),
@@ -75,6 +107,10 @@ _numberOfCreatedHitPerDUTHit()
     
     registerProcessorParameter("MaxResidual","This processor will look for a closest hits (in known coordinate) to determine if the hits are correlated. The hits will be considered as correlated if the residual is smaller than MaxResidual", _maxResidual, float(0) );
     
+    registerOptionalParameter("SortedHitSearch","If true, the DUT hits are found by binary search in the window around the interpolated position instead of testing all DUT hits for every pair of reference hits. The result is the same.", _sortedHitSearch, true );
+    
+    registerOptionalParameter("MaxReferenceSlope","If positive, only pairs of reference hits whose known coordinates differ by less than MaxReferenceSlope times their distance in z are used", _maxReferenceSlope, float(-1) );
+    
 }
 
 
@@ -154,6 +190,7 @@ void EUTelMissingCoordinateEstimator::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelMissingCoordinateEstimator::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
     
     ++_iEvt;
     
@@ -199,6 +236,7 @@ void EUTelMissingCoordinateEstimator::processEvent (LCEvent * event) {
     vector<int> referencePlaneHits1;
     vector<int> referencePlaneHits2;
     vector<int> dutPlaneHits;
+    vector<int> dutPlaneSensors;
 
     // Here identify which hits come from reference planes or DUT
     for ( int iInputHits = 0; iInputHits < inputHitCollection->getNumberOfElements(); iInputHits++ )
@@ -214,6 +252,7 @@ void EUTelMissingCoordinateEstimator::processEvent (LCEvent * event) {
         for (unsigned int i=0; i<_dutPlanes.size(); i++) {
             if (sensorID == _dutPlanes[i]) {
                 dutPlaneHits.push_back(iInputHits);
+                dutPlaneSensors.push_back(sensorID);
                 isDUTHit = true;
                 _nDutHits++;
             }
@@ -241,60 +280,115 @@ void EUTelMissingCoordinateEstimator::processEvent (LCEvent * event) {
 		countCreatedDutHits.push_back(0);
 	}
  
-    // loop over first reference plane hits
-    for (unsigned int iHitRefPlane1=0; iHitRefPlane1<referencePlaneHits1.size(); iHitRefPlane1++) {
-        TrackerHitImpl * refHit1 = dynamic_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits1[iHitRefPlane1] ) );
-        const double* refHit1Pos = refHit1->getPosition();
-        
-        // loop over second reference plane hits
-        for (unsigned int iHitRefPlane2=0; iHitRefPlane2<referencePlaneHits2.size(); iHitRefPlane2++) {
-            TrackerHitImpl * refHit2 = dynamic_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits2[iHitRefPlane2] ) );
-            const double* refHit2Pos = refHit2->getPosition();
+    if (!_sortedHitSearch) {
+        // loop over first reference plane hits
+        for (unsigned int iHitRefPlane1=0; iHitRefPlane1<referencePlaneHits1.size(); iHitRefPlane1++) {
+            TrackerHitImpl * refHit1 = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits1[iHitRefPlane1] ) );
+            const double* refHit1Pos = refHit1->getPosition();
             
-            // loop over second dut plane hits
-            for (unsigned int iDutHit=0; iDutHit<dutPlaneHits.size(); iDutHit++) {
-                TrackerHitImpl * dutHit = dynamic_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( dutPlaneHits[iDutHit] ) );
-                const double* dutHitPos = dutHit->getPosition();
-                double newDutHitPos[3];
+            // loop over second reference plane hits
+            for (unsigned int iHitRefPlane2=0; iHitRefPlane2<referencePlaneHits2.size(); iHitRefPlane2++) {
+                TrackerHitImpl * refHit2 = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits2[iHitRefPlane2] ) );
+                const double* refHit2Pos = refHit2->getPosition();
                 
-                // find t value of the Z position of DUT
-                // t = (z-z1)/(z2-z1)
-                double t = ( dutHitPos[2] - refHit1Pos[2] ) / ( refHit2Pos[2] - refHit1Pos[2] );
+                if ( _maxReferenceSlope > 0 && !( fabs( refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos] ) < _maxReferenceSlope * fabs( refHit2Pos[2] - refHit1Pos[2] ) ) ) continue;
                 
-                // find the known coordinate value correcponds to that z on the line
-                double knownHitPosOnLine = refHit1Pos[_knownHitPos] + (refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos]) * t;
-                
-                // if knownHitPosOnLine is close to the knownHitPos
-                if ( fabs( knownHitPosOnLine - dutHitPos[_knownHitPos] ) < _maxResidual) {
-                    // first copy old DUT hit position to the new one
-                    newDutHitPos[0] = dutHitPos[0];
-                    newDutHitPos[1] = dutHitPos[1];
-                    newDutHitPos[2] = dutHitPos[2];
+                // loop over dut plane hits
+                for (unsigned int iDutHit=0; iDutHit<dutPlaneHits.size(); iDutHit++) {
+                    TrackerHitImpl * dutHit = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( dutPlaneHits[iDutHit] ) );
+                    const double* dutHitPos = dutHit->getPosition();
                     
-                    // then replace the unknown one with the estimated one
-                    double estimatedHitPos = refHit1Pos[_missingHitPos] + (refHit2Pos[_missingHitPos] - refHit1Pos[_missingHitPos]) * t;
+                    // find t value of the Z position of DUT
+                    // t = (z-z1)/(z2-z1)
+                    double t = ( dutHitPos[2] - refHit1Pos[2] ) / ( refHit2Pos[2] - refHit1Pos[2] );
                     
-                    newDutHitPos[_missingHitPos] = estimatedHitPos;
+                    // find the known coordinate value correcponds to that z on the line
+                    double knownHitPosOnLine = refHit1Pos[_knownHitPos] + (refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos]) * t;
                     
-                    // now store new hit position in the TrackerHit, copy and store in the collection
+                    // if knownHitPosOnLine is close to the knownHitPos
+                    if ( fabs( knownHitPosOnLine - dutHitPos[_knownHitPos] ) < _maxResidual) {
+                        addEstimatedHit( dutHit, refHit1Pos, refHit2Pos, t, outputHitCollection );
+                        countCreatedDutHits[iDutHit] ++;
+                    }
                     
-                    TrackerHitImpl * newHit = cloneHit(dutHit);
-			const double* hitpos = newDutHitPos;
-                    newHit->setPosition( &hitpos[0] );
-                    outputHitCollection->push_back(newHit);
-
-                    // count new created hits
-                    _nDutHitsCreated++;
-
-		    // increase the created DUT hits
-		    countCreatedDutHits[iDutHit] ++;
-                }
+                } // end of loop over dut plane hits
                 
-            } // end of loop over first dut plane hits
+            } // end of loop over second reference plane hits
+        } // end of loop over first reference plane hits
+    } else {
+        // DUT hits of every DUT plane sorted by the known coordinate
+        map<int, SortedPlaneHits> dutPlaneSorted;
+        for (unsigned int iDutHit=0; iDutHit<dutPlaneHits.size(); iDutHit++) {
+            const double* dutHitPos = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( dutPlaneHits[iDutHit] ) )->getPosition();
+            dutPlaneSorted[ dutPlaneSensors[iDutHit] ].add( dutHitPos[_knownHitPos], dutHitPos[2], iDutHit );
+        }
+        for (map<int, SortedPlaneHits>::iterator it = dutPlaneSorted.begin(); it != dutPlaneSorted.end(); ++it) it->second.sort();
+        
+        // and the second reference plane hits, for the reference slope cut
+        SortedPlaneHits refPlane2Sorted;
+        for (unsigned int iHitRefPlane2=0; iHitRefPlane2<referencePlaneHits2.size(); iHitRefPlane2++) {
+            const double* refHit2Pos = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits2[iHitRefPlane2] ) )->getPosition();
+            refPlane2Sorted.add( refHit2Pos[_knownHitPos], refHit2Pos[2], iHitRefPlane2 );
+        }
+        refPlane2Sorted.sort();
+        
+        // tolerance for the rounding of the window borders, the candidates are tested exactly below
+        const double slack = 1E-6;
+        
+        vector<unsigned int> refPlane2Candidates;
+        vector<unsigned int> dutCandidates;
+        
+        for (unsigned int iHitRefPlane1=0; iHitRefPlane1<referencePlaneHits1.size(); iHitRefPlane1++) {
+            TrackerHitImpl * refHit1 = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits1[iHitRefPlane1] ) );
+            const double* refHit1Pos = refHit1->getPosition();
             
+            refPlane2Candidates.clear();
+            if ( _maxReferenceSlope > 0 ) {
+                const double window = _maxReferenceSlope * max( fabs( refPlane2Sorted.zMin - refHit1Pos[2] ), fabs( refPlane2Sorted.zMax - refHit1Pos[2] ) ) + slack;
+                refPlane2Sorted.find( refHit1Pos[_knownHitPos] - window, refHit1Pos[_knownHitPos] + window, refPlane2Candidates );
+                sort( refPlane2Candidates.begin(), refPlane2Candidates.end() );
+            } else {
+                for (unsigned int iHitRefPlane2=0; iHitRefPlane2<referencePlaneHits2.size(); iHitRefPlane2++) refPlane2Candidates.push_back( iHitRefPlane2 );
+            }
             
-        } // end of loop over second reference plane hits
-    } // end of loop over first reference plane hits
+            for (unsigned int iCandidate=0; iCandidate<refPlane2Candidates.size(); iCandidate++) {
+                TrackerHitImpl * refHit2 = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( referencePlaneHits2[ refPlane2Candidates[iCandidate] ] ) );
+                const double* refHit2Pos = refHit2->getPosition();
+                
+                // the line is not defined for two hits at the same z
+                const double dz = refHit2Pos[2] - refHit1Pos[2];
+                if ( dz == 0 ) continue;
+                
+                const double slope = ( refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos] ) / dz;
+                if ( _maxReferenceSlope > 0 && !( fabs( refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos] ) < _maxReferenceSlope * fabs( dz ) ) ) continue;
+                
+                // DUT hits in the window around the line between the z borders of each DUT plane
+                dutCandidates.clear();
+                for (map<int, SortedPlaneHits>::const_iterator it = dutPlaneSorted.begin(); it != dutPlaneSorted.end(); ++it) {
+                    const double knownAtZMin = refHit1Pos[_knownHitPos] + slope * ( it->second.zMin - refHit1Pos[2] );
+                    const double knownAtZMax = refHit1Pos[_knownHitPos] + slope * ( it->second.zMax - refHit1Pos[2] );
+                    it->second.find( min( knownAtZMin, knownAtZMax ) - _maxResidual - slack,
+                                     max( knownAtZMin, knownAtZMax ) + _maxResidual + slack, dutCandidates );
+                }
+                // keep the order of the hits in the output collection
+                sort( dutCandidates.begin(), dutCandidates.end() );
+                
+                for (unsigned int iCandidate2=0; iCandidate2<dutCandidates.size(); iCandidate2++) {
+                    const unsigned int iDutHit = dutCandidates[iCandidate2];
+                    TrackerHitImpl * dutHit = static_cast<TrackerHitImpl*> ( inputHitCollection->getElementAt( dutPlaneHits[iDutHit] ) );
+                    const double* dutHitPos = dutHit->getPosition();
+                    
+                    // same test as above
+                    double t = ( dutHitPos[2] - refHit1Pos[2] ) / dz;
+                    double knownHitPosOnLine = refHit1Pos[_knownHitPos] + (refHit2Pos[_knownHitPos] - refHit1Pos[_knownHitPos]) * t;
+                    if ( fabs( knownHitPosOnLine - dutHitPos[_knownHitPos] ) < _maxResidual) {
+                        addEstimatedHit( dutHit, refHit1Pos, refHit2Pos, t, outputHitCollection );
+                        countCreatedDutHits[iDutHit] ++;
+                    }
+                }
+            }
+        }
+    }
     
     for (unsigned int iDutHit=0; iDutHit<dutPlaneHits.size(); iDutHit++){
 	if(_maxExpectedCreatedHitPerDUTHit < countCreatedDutHits[iDutHit]){
@@ -319,6 +413,27 @@ void EUTelMissingCoordinateEstimator::processEvent (LCEvent * event) {
 }
 
 
+void EUTelMissingCoordinateEstimator::addEstimatedHit(TrackerHitImpl* dutHit, const double* refHit1Pos, const double* refHit2Pos, double t, LCCollectionVec* outputHitCollection) {
+    
+    // first copy old DUT hit position to the new one
+    const double* dutHitPos = dutHit->getPosition();
+    double newDutHitPos[3];
+    newDutHitPos[0] = dutHitPos[0];
+    newDutHitPos[1] = dutHitPos[1];
+    newDutHitPos[2] = dutHitPos[2];
+    
+    // then replace the unknown one with the estimated one
+    newDutHitPos[_missingHitPos] = refHit1Pos[_missingHitPos] + (refHit2Pos[_missingHitPos] - refHit1Pos[_missingHitPos]) * t;
+    
+    // now store new hit position in the TrackerHit, copy and store in the collection
+    TrackerHitImpl * newHit = cloneHit(dutHit);
+    newHit->setPosition( newDutHitPos );
+    outputHitCollection->push_back(newHit);
+    
+    // count new created hits
+    _nDutHitsCreated++;
+}
+
 TrackerHitImpl* EUTelMissingCoordinateEstimator::cloneHit(TrackerHitImpl *inputHit){
     TrackerHitImpl * newHit = new TrackerHitImpl;
     
@@ -0,0 +1,110 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelNZSFrameEngine.h"
+#include "EUTELESCOPE.h"
+#include "EUTelExceptions.h"
+
+// system includes <>
+#include <algorithm>
+#include <sstream>
+
+namespace eutelescope {
+
+  EUTelNZSFrameEngine::EUTelNZSFrameEngine():
+    _candidates(),
+    _indices(),
+    _mask()
+  {}
+
+  size_t EUTelNZSFrameEngine::selectPixels( const float* signal, const float* noise, const short* status, size_t n,
+                                            float cut, unsigned int firstIndex, std::vector<unsigned int>& indices ) {
+    _mask.resize( n );
+    unsigned char* mask = _mask.data();
+
+    //first pass: threshold mask
+    size_t nSelected = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+      const unsigned char isSelected = ( status[i] == EUTELESCOPE::GOODPIXEL ) & ( signal[i] > cut * noise[i] );
+      mask[i] = isSelected;
+      nSelected += isSelected;
+    }
+
+    //second pass: compaction of the selected indices
+    const size_t first = indices.size();
+    indices.resize( first + nSelected );
+    unsigned int* out = indices.data() + first;
+    for ( size_t i = 0, iSelected = 0; i < n && iSelected < nSelected; ++i ) {
+      out[ iSelected ] = firstIndex + static_cast<unsigned int>( i );
+      iSelected += mask[i];
+    }
+    return nSelected;
+  }
+
+  size_t EUTelNZSFrameEngine::findSeeds( const std::vector<float>& signal, const std::vector<float>& noise,
+                                         const std::vector<short>& status, float seedCut ) {
+    const size_t n = signal.size();
+    if ( noise.size() != n || status.size() != n ) {
+      std::stringstream ss;
+      ss << "Frame with " << n << " pixels, but " << noise.size() << " noise and "
+         << status.size() << " status values";
+      throw IncompatibleDataSetException( ss.str() );
+    }
+
+    _indices.clear();
+    const size_t nCandidates = selectPixels( signal.data(), noise.data(), status.data(), n, seedCut, 0, _indices );
+
+    _candidates.resize( nCandidates );
+    for ( size_t iCandidate = 0; iCandidate < nCandidates; ++iCandidate ) {
+      _candidates[ iCandidate ].first  = signal[ _indices[ iCandidate ] ];
+      _candidates[ iCandidate ].second = _indices[ iCandidate ];
+    }
+
+    std::make_heap( _candidates.begin(), _candidates.end() );
+    return nCandidates;
+  }
+
+  bool EUTelNZSFrameEngine::nextSeed( unsigned int& index ) {
+    if ( _candidates.empty() ) return false;
+    std::pop_heap( _candidates.begin(), _candidates.end() );
+    index = _candidates.back().second;
+    _candidates.pop_back();
+    return true;
+  }
+
+  void EUTelNZSFrameEngine::subtractPedestal( const short* raw, const float* pedestal, size_t n, double offset, float* out ) {
+    //the offset is applied in single precision as the output, this
+    //keeps the loop vectorisable
+    const float floatOffset = static_cast<float>( offset );
+    for ( size_t i = 0; i < n; ++i ) {
+      out[i] = raw[i] - pedestal[i] - floatOffset;
+    }
+  }
+
+  void EUTelNZSFrameEngine::commonModeSums( const short* raw, const float* pedestal, const float* noise,
+                                            const short* status, size_t n, double hitCut,
+                                            double& pixelSum, int& nGood, int& nHit ) {
+    double sum = 0.;
+    int good = 0;
+    int hit = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+      const float signal = raw[i] - pedestal[i];
+      const int isHit = signal > hitCut * noise[i];
+      const int isUsed = ( status[i] == EUTELESCOPE::GOODPIXEL ) & !isHit;
+      sum  += isUsed ? signal : 0.;
+      good += isUsed;
+      hit  += isHit;
+    }
+    pixelSum = sum;
+    nGood = good;
+    nHit = hit;
+  }
+
+}
@@ -0,0 +1,152 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelNoisyPixelMask.h"
+#include "EUTelUtility.h"
+#include "EUTELESCOPE.h"
+
+// lcio includes <.h>
+#include <Exceptions.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <UTIL/CellIDDecoder.h>
+
+// system includes <>
+#include <algorithm>
+
+using namespace std;
+using namespace eutelescope;
+
+EUTelNoisyPixelMask::EUTelNoisyPixelMask() :
+  _sensors() {
+}
+
+const EUTelNoisyPixelMask* EUTelNoisyPixelMask::getShared( EVENT::LCEvent* event, const string& collectionName ) {
+
+  static map<string, EUTelNoisyPixelMask> sharedMasks;
+
+  map<string, EUTelNoisyPixelMask>::const_iterator iter = sharedMasks.find( collectionName );
+  if ( iter != sharedMasks.end() ) return &iter->second;
+
+  EVENT::LCCollection* collection = NULL;
+  try {
+    collection = event->getCollection( collectionName );
+  } catch ( lcio::DataNotAvailableException& ) {
+    return NULL;
+  }
+
+  EUTelNoisyPixelMask& mask = sharedMasks[ collectionName ];
+  mask.load( collection );
+  return &mask;
+}
+
+void EUTelNoisyPixelMask::clear() {
+  _sensors.clear();
+}
+
+void EUTelNoisyPixelMask::load( EVENT::LCCollection* collection ) {
+
+  UTIL::CellIDDecoder<IMPL::TrackerDataImpl> cellDecoder( collection );
+
+  for ( int i = 0; i < collection->getNumberOfElements(); ++i ) {
+    IMPL::TrackerDataImpl* noisyPixelData = static_cast< IMPL::TrackerDataImpl* >( collection->getElementAt( i ) );
+    const int sensorID = cellDecoder( noisyPixelData )["sensorID"];
+    const SparsePixelType type = static_cast< SparsePixelType >( static_cast< int >( cellDecoder( noisyPixelData )["sparsePixelType"] ) );
+
+    addPixels( sensorID, noisyPixelData->getChargeValues(), Utility::getSparsePixelNoOfElements( type ) );
+  }
+}
+
+void EUTelNoisyPixelMask::addPixels( int sensorID, const EVENT::FloatVec& data, unsigned int stride ) {
+
+  if ( stride < 2 ) return;
+
+  vector<int> x, y;
+  for ( size_t i = 0; i + 1 < data.size(); i += stride ) {
+    x.push_back( static_cast< int >( data[i] ) );
+    y.push_back( static_cast< int >( data[i + 1] ) );
+  }
+  addPixels( sensorID, x, y );
+}
+
+void EUTelNoisyPixelMask::addPixels( int sensorID, const vector<int>& x, const vector<int>& y ) {
+
+  vector<int> allX, allY;
+
+  // pixels already in the mask
+  const SensorMask* old = getSensorMask( sensorID );
+  if ( old != NULL ) {
+    for ( unsigned int iy = 0; iy < old->height; ++iy ) {
+      for ( unsigned int ix = 0; ix < old->width; ++ix ) {
+        if ( old->test( ix, iy ) ) {
+          allX.push_back( ix );
+          allY.push_back( iy );
+        }
+      }
+    }
+  }
+
+  // negative coordinates can not be stored and are never tested positive
+  for ( size_t i = 0; i < min( x.size(), y.size() ); ++i ) {
+    if ( x[i] < 0 || y[i] < 0 ) continue;
+    allX.push_back( x[i] );
+    allY.push_back( y[i] );
+  }
+  if ( allX.empty() ) return;
+
+  SensorMask mask;
+  mask.width = *max_element( allX.begin(), allX.end() ) + 1;
+  mask.height = *max_element( allY.begin(), allY.end() ) + 1;
+  mask.bits.assign( ( static_cast< size_t >( mask.width ) * mask.height + 63 ) / 64, 0 );
+
+  for ( size_t i = 0; i < allX.size(); ++i ) {
+    const size_t index = static_cast< size_t >( allY[i] ) * mask.width + allX[i];
+    if ( !( ( mask.bits[ index >> 6 ] >> ( index & 63 ) ) & 1 ) ) ++mask.nPixels;
+    mask.bits[ index >> 6 ] |= 1ULL << ( index & 63 );
+  }
+
+  _sensors[ sensorID ] = mask;
+}
+
+size_t EUTelNoisyPixelMask::getNNoisyPixels( int sensorID ) const {
+  const SensorMask* mask = getSensorMask( sensorID );
+  return mask != NULL ? mask->nPixels : 0;
+}
+
+bool EUTelNoisyPixelMask::anyNoisy( int sensorID, const EVENT::FloatVec& data, unsigned int stride ) const {
+
+  const SensorMask* mask = getSensorMask( sensorID );
+  if ( mask == NULL || stride < 2 || data.size() < 2 ) return false;
+
+  const float* values = &data[0];
+  const size_t nPixels = data.size() / stride;
+  unsigned long long noisy = 0;
+  for ( size_t i = 0; i < nPixels; ++i ) {
+    noisy |= mask->test( static_cast< int >( values[ i * stride ] ), static_cast< int >( values[ i * stride + 1 ] ) );
+  }
+  return noisy != 0;
+}
+
+bool EUTelNoisyPixelMask::anyNoisy( int sensorID, int xMin, int xMax, int yMin, int yMax ) const {
+
+  const SensorMask* mask = getSensorMask( sensorID );
+  if ( mask == NULL ) return false;
+
+  // only the part of the window covered by the mask
+  xMin = max( xMin, 0 );
+  yMin = max( yMin, 0 );
+  xMax = min( xMax, static_cast< int >( mask->width ) - 1 );
+  yMax = min( yMax, static_cast< int >( mask->height ) - 1 );
+
+  unsigned long long noisy = 0;
+  for ( int y = yMin; y <= yMax; ++y ) {
+    for ( int x = xMin; x <= xMax; ++x ) noisy |= mask->test( x, y );
+  }
+  return noisy != 0;
+}
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelOutputProcessor.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelEventImpl.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTELESCOPE.h"
@@ -105,6 +106,7 @@ void EUTelOutputProcessor::processRunHeader( LCRunHeader* run) {
 } 
 
 void EUTelOutputProcessor::processEvent( LCEvent * evt ) { 
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 
   EUTelEventImpl * eutelEvt =  static_cast<EUTelEventImpl * > ( evt );
 
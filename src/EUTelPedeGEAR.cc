@@ -9,6 +9,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelPedeGEAR.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
@@ -169,7 +170,8 @@ void EUTelPedeGEAR::processRunHeader(LCRunHeader* rdr) {
 	++_iRun;
 }
 
-void EUTelPedeGEAR::processEvent(LCEvent* /*event*/) {
+void EUTelPedeGEAR::processEvent(LCEvent* event) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	/*NOP NOP NOP*/
 }
 
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelExceptions.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTelPedestalNoiseProcessor.h"
@@ -412,6 +413,7 @@ void EUTelPedestalNoiseProcessor::initializeGeometry( LCEvent * evt ) {
 }
 
 void EUTelPedestalNoiseProcessor::processEvent (LCEvent * evt) {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 
   EUTelEventImpl * eutelEvent = static_cast<EUTelEventImpl*> (evt);
   EventType type              = eutelEvent->getEventType();
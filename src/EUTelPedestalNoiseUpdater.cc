@@ -0,0 +1,113 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelPedestalNoiseUpdater.h"
+#include "EUTelExceptions.h"
+#include "EUTELESCOPE.h"
+
+// system includes <>
+#include <cmath>
+
+using namespace std;
+using namespace eutelescope;
+
+EUTelPedestalNoiseUpdater::EUTelPedestalNoiseUpdater( int fixedWeight ) :
+  _fixedWeight( 0 ),
+  _oldWeight( 0 ),
+  _newWeight( 0 ) {
+  setFixedWeight( fixedWeight );
+}
+
+void EUTelPedestalNoiseUpdater::setFixedWeight( int fixedWeight ) {
+  if ( fixedWeight <= 0 ) {
+    throw InvalidParameterException( "The fixed weight has to be a positive integer number" );
+  }
+  _fixedWeight = fixedWeight;
+  _newWeight = 1.f / fixedWeight;
+  _oldWeight = ( fixedWeight - 1 ) * _newWeight;
+}
+
+void EUTelPedestalNoiseUpdater::update( const short* adc, const short* status, float* pedestal, float* noise, size_t n ) const {
+
+  const float oldWeight = _oldWeight;
+  const float newWeight = _newWeight;
+  const short good = static_cast< short >( EUTELESCOPE::GOODPIXEL );
+
+  for ( size_t i = 0; i < n; ++i ) {
+    const float signal = adc[i];
+    const float newPedestal = oldWeight * pedestal[i] + newWeight * signal;
+    const float diff = signal - newPedestal;
+    const float variance = oldWeight * noise[i] * noise[i] + newWeight * diff * diff;
+    const bool isGood = ( status[i] == good );
+    pedestal[i] = isGood ? newPedestal : pedestal[i];
+    noise[i] = isGood ? sqrt( variance ) : noise[i];
+  }
+}
+
+EUTelPedestalDriftMonitor::EUTelPedestalDriftMonitor( size_t nRegions, size_t capacity ) :
+  _nRegions( nRegions > 0 ? nRegions : 1 ),
+  _capacity( capacity ),
+  _reference(),
+  _history() {
+}
+
+void EUTelPedestalDriftMonitor::fill( int sensorID, int event, const short* status,
+                                      const float* pedestal, const float* noise, size_t n ) {
+
+  vector< EUTelRingBuffer<EUTelPedestalDrift> >& history = _history[ sensorID ];
+  vector<float>& reference = _reference[ sensorID ];
+  const bool first = history.empty();
+  if ( first ) {
+    history.assign( _nRegions, EUTelRingBuffer<EUTelPedestalDrift>( _capacity ) );
+    reference.assign( _nRegions, 0.f );
+  }
+
+  const short good = static_cast< short >( EUTELESCOPE::GOODPIXEL );
+
+  for ( size_t iRegion = 0; iRegion < _nRegions; ++iRegion ) {
+    const size_t begin = iRegion * n / _nRegions;
+    const size_t end = ( iRegion + 1 ) * n / _nRegions;
+
+    float sumPedestal = 0, sumNoise = 0;
+    int nGood = 0;
+    for ( size_t i = begin; i < end; ++i ) {
+      const float weight = ( status[i] == good ) ? 1.f : 0.f;
+      sumPedestal += weight * pedestal[i];
+      sumNoise += weight * noise[i];
+      nGood += ( status[i] == good );
+    }
+
+    const float meanPedestal = nGood > 0 ? sumPedestal / nGood : 0.f;
+    if ( first ) reference[iRegion] = meanPedestal;
+
+    EUTelPedestalDrift drift;
+    drift.event = event;
+    drift.pedestalShift = meanPedestal - reference[iRegion];
+    drift.meanNoise = nGood > 0 ? sumNoise / nGood : 0.f;
+    drift.nGood = nGood;
+    history[iRegion].push( drift );
+  }
+}
+
+void EUTelPedestalDriftMonitor::write( ostream& os ) const {
+
+  os << "# sensorID region event pedestalShift meanNoise nGood\n";
+
+  map< int, vector< EUTelRingBuffer<EUTelPedestalDrift> > >::const_iterator iter;
+  for ( iter = _history.begin(); iter != _history.end(); ++iter ) {
+    for ( size_t iRegion = 0; iRegion < iter->second.size(); ++iRegion ) {
+      const EUTelRingBuffer<EUTelPedestalDrift>& history = iter->second[iRegion];
+      for ( size_t i = 0; i < history.size(); ++i ) {
+        os << iter->first << " " << iRegion << " " << history[i].event << " "
+           << history[i].pedestalShift << " " << history[i].meanNoise << " " << history[i].nGood << "\n";
+      }
+    }
+  }
+}
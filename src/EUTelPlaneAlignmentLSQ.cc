@@ -0,0 +1,350 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelPlaneAlignmentLSQ.h"
+
+// system includes <>
+#include <cmath>
+
+namespace eutelescope {
+
+  namespace {
+    //! Normalisation of the chi2, as in EUTelAlign::Chi2Function
+    const double CHI2SCALE = 100.;
+
+    //! Number of rotation angles
+    const int NANGLES = 3;
+
+    //! Coefficients of the transformation and their angle derivatives
+    /*! x = a X + b Y + off_x, y = c X + d Y + off_y
+     */
+    struct Rotation {
+      double a, b, c, d;
+      double da[NANGLES], db[NANGLES], dc[NANGLES], dd[NANGLES];
+
+      explicit Rotation( const double* par ) {
+        const double sx = sin( par[EUTelPlaneAlignmentLSQ::kThetaX] ), cx = cos( par[EUTelPlaneAlignmentLSQ::kThetaX] );
+        const double sy = sin( par[EUTelPlaneAlignmentLSQ::kThetaY] ), cy = cos( par[EUTelPlaneAlignmentLSQ::kThetaY] );
+        const double sz = sin( par[EUTelPlaneAlignmentLSQ::kThetaZ] ), cz = cos( par[EUTelPlaneAlignmentLSQ::kThetaZ] );
+
+        a =  cy * cz;
+        b = -sx * sy * cz + cx * sz;
+        c = -cy * sz;
+        d =  sx * sy * sz + cx * cz;
+
+        // theta_x
+        da[0] = 0.;
+        db[0] = -cx * sy * cz - sx * sz;
+        dc[0] = 0.;
+        dd[0] =  cx * sy * sz - sx * cz;
+        // theta_y
+        da[1] = -sy * cz;
+        db[1] = -sx * cy * cz;
+        dc[1] =  sy * sz;
+        dd[1] =  sx * cy * sz;
+        // theta_z
+        da[2] = -cy * sz;
+        db[2] =  sx * sy * sz + cx * cz;
+        dc[2] = -cy * cz;
+        dd[2] =  sx * sy * cz - cx * sz;
+      }
+    };
+
+    //! Weighted moments of hit positions and residuals
+    struct Moments {
+      double n, sx, sy, sxx, sxy, syy;
+      double rx, ry, rxx, rxy, ryx, ryy;
+      double chi2;
+    };
+
+    Moments computeMoments( const double* par, const double* mx, const double* my,
+                            const double* px, const double* py, const double* w, size_t n ) {
+      const Rotation rot( par );
+      const double offX = par[EUTelPlaneAlignmentLSQ::kOffX];
+      const double offY = par[EUTelPlaneAlignmentLSQ::kOffY];
+
+      double sn = 0., sx = 0., sy = 0., sxx = 0., sxy = 0., syy = 0.;
+      double rx = 0., ry = 0., rxx = 0., rxy = 0., ryx = 0., ryy = 0.;
+      double chi2 = 0.;
+      for ( size_t i = 0; i < n; ++i ) {
+        const double resX = rot.a * mx[i] + rot.b * my[i] + offX - px[i];
+        const double resY = rot.c * mx[i] + rot.d * my[i] + offY - py[i];
+        const double wx = w[i] * mx[i];
+        const double wy = w[i] * my[i];
+        sn   += w[i];
+        sx   += wx;
+        sy   += wy;
+        sxx  += wx * mx[i];
+        sxy  += wx * my[i];
+        syy  += wy * my[i];
+        rx   += w[i] * resX;
+        ry   += w[i] * resY;
+        rxx  += wx * resX;
+        rxy  += wy * resX;
+        ryx  += wx * resY;
+        ryy  += wy * resY;
+        chi2 += w[i] * ( resX * resX + resY * resY );
+      }
+
+      Moments m;
+      m.n = sn; m.sx = sx; m.sy = sy; m.sxx = sxx; m.sxy = sxy; m.syy = syy;
+      m.rx = rx; m.ry = ry; m.rxx = rxx; m.rxy = rxy; m.ryx = ryx; m.ryy = ryy;
+      m.chi2 = chi2 / CHI2SCALE;
+      return m;
+    }
+
+    //! Normal matrix and gradient of sum( resX^2 + resY^2 )/2
+    void normalEquations( const double* par, const Moments& m,
+                          double normal[][EUTelPlaneAlignmentLSQ::NPARAMETERS],
+                          double* gradient ) {
+      const Rotation rot( par );
+      const int nPar = EUTelPlaneAlignmentLSQ::NPARAMETERS;
+      for ( int i = 0; i < nPar; ++i ) {
+        for ( int j = 0; j < nPar; ++j ) normal[i][j] = 0.;
+      }
+
+      normal[0][0] = m.n;
+      normal[1][1] = m.n;
+      gradient[0] = m.rx;
+      gradient[1] = m.ry;
+      for ( int k = 0; k < NANGLES; ++k ) {
+        normal[0][2 + k] = normal[2 + k][0] = rot.da[k] * m.sx + rot.db[k] * m.sy;
+        normal[1][2 + k] = normal[2 + k][1] = rot.dc[k] * m.sx + rot.dd[k] * m.sy;
+        for ( int l = 0; l <= k; ++l ) {
+          const double value =
+            rot.da[k] * rot.da[l] * m.sxx + ( rot.da[k] * rot.db[l] + rot.db[k] * rot.da[l] ) * m.sxy + rot.db[k] * rot.db[l] * m.syy +
+            rot.dc[k] * rot.dc[l] * m.sxx + ( rot.dc[k] * rot.dd[l] + rot.dd[k] * rot.dc[l] ) * m.sxy + rot.dd[k] * rot.dd[l] * m.syy;
+          normal[2 + k][2 + l] = normal[2 + l][2 + k] = value;
+        }
+        gradient[2 + k] = rot.da[k] * m.rxx + rot.db[k] * m.rxy + rot.dc[k] * m.ryx + rot.dd[k] * m.ryy;
+      }
+    }
+
+    //! Cholesky decomposition of the free part of the normal matrix
+    /*! Parameters whose pivot vanishes compared to their diagonal
+     *  element are removed from the free ones.
+     *
+     *  @return number of free parameters
+     */
+    int decompose( const double normal[][EUTelPlaneAlignmentLSQ::NPARAMETERS], bool* isFree,
+                   int* index, double lower[][EUTelPlaneAlignmentLSQ::NPARAMETERS] ) {
+      const int nPar = EUTelPlaneAlignmentLSQ::NPARAMETERS;
+      bool changed = true;
+      int nFree = 0;
+      while ( changed ) {
+        changed = false;
+        nFree = 0;
+        for ( int i = 0; i < nPar; ++i ) {
+          if ( isFree[i] ) index[ nFree++ ] = i;
+        }
+        for ( int i = 0; i < nFree && !changed; ++i ) {
+          for ( int j = 0; j <= i; ++j ) {
+            double sum = normal[ index[i] ][ index[j] ];
+            for ( int k = 0; k < j; ++k ) sum -= lower[i][k] * lower[j][k];
+            if ( i == j ) {
+              if ( !( sum > 1e-12 * normal[ index[i] ][ index[i] ] ) ) {
+                isFree[ index[i] ] = false;
+                changed = true;
+                break;
+              }
+              lower[i][i] = sqrt( sum );
+            } else {
+              lower[i][j] = sum / lower[j][j];
+            }
+          }
+        }
+      }
+      return nFree;
+    }
+
+    //! Solves L L^T x = rhs in place
+    void solve( const double lower[][EUTelPlaneAlignmentLSQ::NPARAMETERS], int nFree, double* x ) {
+      for ( int i = 0; i < nFree; ++i ) {
+        for ( int k = 0; k < i; ++k ) x[i] -= lower[i][k] * x[k];
+        x[i] /= lower[i][i];
+      }
+      for ( int i = nFree - 1; i >= 0; --i ) {
+        for ( int k = i + 1; k < nFree; ++k ) x[i] -= lower[k][i] * x[k];
+        x[i] /= lower[i][i];
+      }
+    }
+
+    //! Parameters which can be fitted at all with the given moments
+    void constrainedParameters( const double normal[][EUTelPlaneAlignmentLSQ::NPARAMETERS], const Moments& m, bool* isFree ) {
+      const double angleScale = m.sxx + m.syy;
+      isFree[0] = isFree[1] = m.n > 0.;
+      for ( int k = 0; k < NANGLES; ++k ) {
+        isFree[2 + k] = normal[2 + k][2 + k] > 1e-12 * angleScale;
+      }
+    }
+  }
+
+  EUTelPlaneAlignmentLSQ::EUTelPlaneAlignmentLSQ():
+    _measuredX(),
+    _measuredY(),
+    _predictedX(),
+    _predictedY(),
+    _used(),
+    _chi2(0.),
+    _nUsed(0),
+    _nIterations(0)
+  {
+    for ( int i = 0; i < NPARAMETERS; ++i ) _par[i] = _err[i] = 0.;
+    _simpleOffset[0] = _simpleOffset[1] = 0.;
+  }
+
+  void EUTelPlaneAlignmentLSQ::clear() {
+    _measuredX.clear();
+    _measuredY.clear();
+    _predictedX.clear();
+    _predictedY.clear();
+    _used.clear();
+  }
+
+  void EUTelPlaneAlignmentLSQ::addHit( double measuredX, double measuredY, double predictedX, double predictedY ) {
+    _measuredX.push_back( measuredX );
+    _measuredY.push_back( measuredY );
+    _predictedX.push_back( predictedX );
+    _predictedY.push_back( predictedY );
+    _used.push_back( 1. );
+  }
+
+  void EUTelPlaneAlignmentLSQ::transform( const double* par, double measuredX, double measuredY, double& x, double& y ) {
+    const Rotation rot( par );
+    x = rot.a * measuredX + rot.b * measuredY + par[kOffX];
+    y = rot.c * measuredX + rot.d * measuredY + par[kOffY];
+  }
+
+  double EUTelPlaneAlignmentLSQ::chi2( const double* par, double cut ) const {
+    const Rotation rot( par );
+    double sum = 0.;
+    for ( size_t i = 0; i < size(); ++i ) {
+      const double resX = rot.a * _measuredX[i] + rot.b * _measuredY[i] + par[kOffX] - _predictedX[i];
+      const double resY = rot.c * _measuredX[i] + rot.d * _measuredY[i] + par[kOffY] - _predictedY[i];
+      const double distance = ( resX * resX + resY * resY ) / CHI2SCALE;
+      if ( cut == 0. || distance < cut ) sum += distance;
+    }
+    return sum;
+  }
+
+  void EUTelPlaneAlignmentLSQ::fitOffsets( double* par ) const {
+    if ( size() == 0 ) return;
+    const Rotation rot( par );
+    double sumX = 0., sumY = 0.;
+    for ( size_t i = 0; i < size(); ++i ) {
+      sumX += _predictedX[i] - ( rot.a * _measuredX[i] + rot.b * _measuredY[i] );
+      sumY += _predictedY[i] - ( rot.c * _measuredX[i] + rot.d * _measuredY[i] );
+    }
+    par[kOffX] = sumX / size();
+    par[kOffY] = sumY / size();
+  }
+
+  bool EUTelPlaneAlignmentLSQ::fit( const double* start, double cut, int maxIterations ) {
+    for ( int i = 0; i < NPARAMETERS; ++i ) {
+      _par[i] = start[i];
+      _err[i] = 0.;
+    }
+    _nIterations = 0;
+    _used.assign( size(), 1. );
+
+    // first step: only offsets
+    fitOffsets( _par );
+    _simpleOffset[0] = _par[kOffX];
+    _simpleOffset[1] = _par[kOffY];
+
+    // second step: all parameters, all hits
+    bool converged = iterate( maxIterations );
+
+    // third step: with the chi2 cut, until the selection is stable
+    if ( cut > 0. ) {
+      for ( int iSelection = 0; iSelection < maxIterations; ++iSelection ) {
+        if ( !select( cut ) ) break;
+        converged = iterate( maxIterations );
+      }
+    }
+    return converged;
+  }
+
+  bool EUTelPlaneAlignmentLSQ::select( double cut ) {
+    const Rotation rot( _par );
+    bool changed = false;
+    for ( size_t i = 0; i < size(); ++i ) {
+      const double resX = rot.a * _measuredX[i] + rot.b * _measuredY[i] + _par[kOffX] - _predictedX[i];
+      const double resY = rot.c * _measuredX[i] + rot.d * _measuredY[i] + _par[kOffY] - _predictedY[i];
+      const double used = ( resX * resX + resY * resY ) / CHI2SCALE < cut ? 1. : 0.;
+      changed |= ( used != _used[i] );
+      _used[i] = used;
+    }
+    return changed;
+  }
+
+  bool EUTelPlaneAlignmentLSQ::iterate( int maxIterations ) {
+    double normal[NPARAMETERS][NPARAMETERS];
+    double lower[NPARAMETERS][NPARAMETERS];
+    double gradient[NPARAMETERS];
+    double step[NPARAMETERS];
+    bool isFree[NPARAMETERS];
+    int index[NPARAMETERS];
+
+    const size_t n = size();
+    Moments moments = computeMoments( _par, _measuredX.data(), _measuredY.data(),
+                                      _predictedX.data(), _predictedY.data(), _used.data(), n );
+    bool converged = false;
+    for ( int iIteration = 0; iIteration < maxIterations && !converged; ++iIteration ) {
+      ++_nIterations;
+      normalEquations( _par, moments, normal, gradient );
+      constrainedParameters( normal, moments, isFree );
+      const int nFree = decompose( normal, isFree, index, lower );
+      if ( nFree == 0 ) return false;
+
+      for ( int i = 0; i < nFree; ++i ) step[i] = -gradient[ index[i] ];
+      solve( lower, nFree, step );
+
+      // take the step, halve it as long as the chi2 does not decrease
+      double trial[NPARAMETERS];
+      Moments trialMoments = moments;
+      double scale = 1.;
+      bool improved = false;
+      for ( int iHalving = 0; iHalving < 20 && !improved; ++iHalving, scale *= 0.5 ) {
+        for ( int i = 0; i < NPARAMETERS; ++i ) trial[i] = _par[i];
+        for ( int i = 0; i < nFree; ++i ) trial[ index[i] ] += scale * step[i];
+        trialMoments = computeMoments( trial, _measuredX.data(), _measuredY.data(),
+                                       _predictedX.data(), _predictedY.data(), _used.data(), n );
+        improved = trialMoments.chi2 <= moments.chi2;
+      }
+      if ( !improved ) {
+        // no step decreases the chi2 any more, this is the minimum
+        converged = true;
+        break;
+      }
+
+      converged = ( moments.chi2 - trialMoments.chi2 ) <= 1e-10 * ( 1. + moments.chi2 );
+      for ( int i = 0; i < NPARAMETERS; ++i ) _par[i] = trial[i];
+      moments = trialMoments;
+    }
+
+    // errors from the inverse of the normal matrix at the minimum
+    normalEquations( _par, moments, normal, gradient );
+    constrainedParameters( normal, moments, isFree );
+    const int nFree = decompose( normal, isFree, index, lower );
+    for ( int i = 0; i < NPARAMETERS; ++i ) _err[i] = 0.;
+    for ( int i = 0; i < nFree; ++i ) {
+      double column[NPARAMETERS];
+      for ( int k = 0; k < nFree; ++k ) column[k] = ( k == i ) ? 1. : 0.;
+      solve( lower, nFree, column );
+      _err[ index[i] ] = sqrt( CHI2SCALE * column[i] );
+    }
+
+    _chi2 = moments.chi2;
+    _nUsed = static_cast<size_t>( moments.n + 0.5 );
+    return converged;
+  }
+
+}
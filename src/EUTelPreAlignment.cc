@@ -1,5 +1,6 @@
 // eutelescope includes ".h"
 #include "EUTelPreAlignment.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTelAlignmentConstant.h"
@@ -199,6 +200,7 @@ void  EUTelPreAlign::FillHotPixelMap(LCEvent *event)
 
 void EUTelPreAlign::processEvent(LCEvent* event)
 {
+		EUTelInstrumentation::Scope instrumentationScope( this, event );
 		if( isFirstEvent()) FillHotPixelMap(event);
 
 		++_iEvt;
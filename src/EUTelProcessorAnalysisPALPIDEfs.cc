@@ -1,4 +1,5 @@
 #include "EUTelProcessorAnalysisPALPIDEfs.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelHistogramManager.h"
 #include "EUTelAlignmentConstant.h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
@@ -84,7 +85,10 @@ EUTelProcessorAnalysisPALPIDEfs::EUTelProcessorAnalysisPALPIDEfs()
   ySize(0),
   xPixel(0),
   yPixel(0),
-  hotPixelCollectionVec(NULL)
+  hotPixelCollectionVec(NULL),
+  _hotPixelMask(NULL),
+  _hotPixelSensorID(-1),
+  _noiseMask()
 {
   _description="Analysis of the fitted tracks";
   registerInputCollection( LCIO::TRACKERHIT,
@@ -219,6 +223,7 @@ void EUTelProcessorAnalysisPALPIDEfs::init() {
 
 void EUTelProcessorAnalysisPALPIDEfs::processEvent(LCEvent *evt)
 {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
   if (evt->getParameters().getIntVal("FLAG") == 100) return; //Excluding events with too large clusters
   int nTrackPerEvent = 0, nClusterAssociatedToTrackPerEvent = 0, nClusterPerEvent = 0;
   if (evt->getTimeStamp() < _minTimeStamp) return;
@@ -244,6 +249,9 @@ void EUTelProcessorAnalysisPALPIDEfs::processEvent(LCEvent *evt)
     if (_hotpixelAvailable)
     {
       hotData = dynamic_cast< TrackerDataImpl * > ( hotPixelCollectionVec->getElementAt( layerIndex ) );
+      CellIDDecoder<TrackerDataImpl> hotPixelDecoder( hotPixelCollectionVec );
+      _hotPixelSensorID = hotPixelDecoder( hotData )["sensorID"];
+      _hotPixelMask = EUTelNoisyPixelMask::getShared( evt, _hotPixelCollectionName );
       auto_ptr<EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel > >  sparseData(new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel> ( hotData ));
       for ( unsigned int iPixel = 0; iPixel < sparseData->size(); iPixel++ )
       {
@@ -266,6 +274,7 @@ void EUTelProcessorAnalysisPALPIDEfs::processEvent(LCEvent *evt)
         noiseMaskY.push_back(y);
         hotpixelHisto->Fill(x*xPitch+xPitch/2.,y*yPitch+yPitch/2.);
       }
+      _noiseMask.addPixels(layerIndex, noiseMaskX, noiseMaskY);
     }
     else _noiseMaskAvailable = false;
 
@@ -418,36 +427,18 @@ void EUTelProcessorAnalysisPALPIDEfs::processEvent(LCEvent *evt)
           }
         }
         if (index == -1) continue;
-        if (_hotpixelAvailable)
+        // pixels whose centre is closer than limit to the track in x and y
+        const int xPixelMin = static_cast<int>(floor((xposfit-xPitch/2.-limit)/xPitch)) + 1;
+        const int xPixelMax = static_cast<int>(ceil((xposfit-xPitch/2.+limit)/xPitch)) - 1;
+        const int yPixelMin = static_cast<int>(floor((yposfit-yPitch/2.-limit)/yPitch)) + 1;
+        const int yPixelMax = static_cast<int>(ceil((yposfit-yPitch/2.+limit)/yPitch)) - 1;
+        if (_hotpixelAvailable && _hotPixelMask != NULL)
         {
-          auto_ptr<EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel > >  sparseData(new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel> ( hotData ));
-          bool hotpixel = false;
-          for ( unsigned int iPixel = 0; iPixel < sparseData->size(); iPixel++ )
-          {
-            EUTelGenericSparsePixel *sparsePixel =  new EUTelGenericSparsePixel() ;
-            sparseData->getSparsePixelAt( iPixel, sparsePixel );
-            if (abs(xposfit-(sparsePixel->getXCoord()*xPitch+xPitch/2.)) < limit && abs(yposfit-(sparsePixel->getYCoord()*yPitch+yPitch/2.)) < limit)
-            {
-              hotpixel = true;
-              delete sparsePixel;
-              break;
-            }
-            delete sparsePixel;
-          }
-          if (hotpixel) continue;
+          if (_hotPixelMask->anyNoisy(_hotPixelSensorID, xPixelMin, xPixelMax, yPixelMin, yPixelMax)) continue;
         }
         if (_noiseMaskAvailable)
         {
-          bool noisePixel = false;
-          for (unsigned int iNoise=0; iNoise<noiseMaskX.size(); iNoise++)
-          {
-            if (abs(xposfit-(noiseMaskX[iNoise]*xPitch+xPitch/2.)) < limit && abs(yposfit-(noiseMaskY[iNoise]*yPitch+yPitch/2.)) < limit)
-            {
-              noisePixel = true;
-              break;
-            }
-          }
-          if (noisePixel) continue;
+          if (_noiseMask.anyNoisy(layerIndex, xPixelMin, xPixelMax, yPixelMin, yPixelMax)) continue;
         }
         if (_deadColumnAvailable)
         {
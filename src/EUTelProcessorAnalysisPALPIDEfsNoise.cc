@@ -1,4 +1,5 @@
 #include "EUTelProcessorAnalysisPALPIDEfsNoise.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
 #include "EUTelGenericSparsePixel.h"
@@ -75,6 +76,7 @@ void EUTelProcessorAnalysisPALPIDEfsNoise::init() {
 
 void EUTelProcessorAnalysisPALPIDEfsNoise::processEvent(LCEvent *evt)
 {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 //  cerr << evt->getEventNumber() << endl;
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
   if (_isFirstEvent )
@@ -12,6 +12,7 @@
 #ifdef USE_GEAR
 // eutelescope includes ".h"
 #include "EUTelProcessorApplyAlignment.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTelAlignmentConstant.h"
@@ -106,6 +107,7 @@ void EUTelProcessorApplyAlign::processRunHeader (LCRunHeader * rdr) {
 }
 
 void EUTelProcessorApplyAlign::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
   ++_iEvt;
   
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
@@ -10,6 +10,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelProcessorCoordinateTransformHits.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelEventImpl.h"
 #include "EUTELESCOPE.h"
@@ -76,6 +77,7 @@ void EUTelProcessorCoordinateTransformHits::processRunHeader(LCRunHeader* rdr)
 
 void EUTelProcessorCoordinateTransformHits::processEvent(LCEvent* event)
 {
+		EUTelInstrumentation::Scope instrumentationScope( this, event );
 		//Check the event type and if it is the last event.
 		EUTelEventImpl* evt	= static_cast<EUTelEventImpl*>(event);				
 		if( evt->getEventType() == kEORE )
@@ -1,4 +1,5 @@
 #include "EUTelProcessorDeadColumnFinder.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
 #include "EUTelGenericSparsePixel.h"
@@ -51,6 +52,7 @@ void EUTelProcessorDeadColumnFinder::init() {
 
 void EUTelProcessorDeadColumnFinder::processEvent(LCEvent *evt)
 {
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
   _nEvent++;
 //  cerr << evt->getEventNumber() << endl;
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
@@ -1,4 +1,5 @@
 #include "EUTelProcessorFilteringHitFilter.h"
+#include "EUTelInstrumentation.h"
 
 // C++
 #include <vector>
@@ -91,6 +92,7 @@ void EUTelProcessorFilteringHitFilter::processRunHeader( LCRunHeader* /*run*/ )
 }
 
 void EUTelProcessorFilteringHitFilter::processEvent( LCEvent * event ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
 
 //cout << " processEvent : " << endl;
@@ -1,5 +1,6 @@
 
 #include "EUTelProcessorGBLAlign.h"
+#include "EUTelInstrumentation.h"
 
 using namespace eutelescope;
 
@@ -153,6 +154,7 @@ void EUTelProcessorGBLAlign::processRunHeader(LCRunHeader * run) {
 }
 
 void EUTelProcessorGBLAlign::processEvent(LCEvent * evt){
+	EUTelInstrumentation::Scope instrumentationScope( this, evt );
 	try{
 		if(_createBinary){
 			EUTelEventImpl * event = static_cast<EUTelEventImpl*> (evt); ///We change the class so we can use EUTelescope functions
@@ -2,6 +2,7 @@
 //contact alexander.morton975@gmail.com
 #ifdef USE_GBL   
 #include "EUTelProcessorGBLTrackFit.h"
+#include "EUTelInstrumentation.h"
 using namespace eutelescope;
 //TO DO:
 //This way of making histograms makes no sense to me. We should have a class that when called will book any histograms in xml file automatically. So you dont have to book in every processor. It should also return a vector of names to access these histograms. I began this but have not finished. Therefore the silly way of doing the residuals
@@ -135,6 +136,7 @@ void EUTelProcessorGBLTrackFit::processRunHeader(LCRunHeader * run) {
 }
 
 void EUTelProcessorGBLTrackFit::processEvent(LCEvent* evt){
+	EUTelInstrumentation::Scope instrumentationScope( this, evt );
 	try{
 		streamlog_out(DEBUG5) << "Start of event " << _nProcessedEvents << std::endl;
 
@@ -12,6 +12,7 @@
 
 //eutelescope includes
 #include "EUTelProcessorGeometricClustering.h"
+#include "EUTelInstrumentation.h"
 
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
@@ -177,6 +178,7 @@ void EUTelProcessorGeometricClustering::readCollections(LCEvent* event) {
 }
 
 void EUTelProcessorGeometricClustering::processEvent(LCEvent* event) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	//increment event counter
 	++_iEvt;
 
@@ -13,6 +13,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
+#include "EUTelInstrumentation.h"
 
 #include "EUTelProcessorHitMaker.h"
 #include "EUTelRunHeaderImpl.h"
@@ -231,6 +232,7 @@ void EUTelProcessorHitMaker::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
+    EUTelInstrumentation::Scope instrumentationScope( this, event );
 
     ++_iEvt;
 
@@ -0,0 +1,274 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelProcessorInstrumentation.h"
+
+// marlin includes ".h"
+#include "marlin/Global.h"
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+#include "marlin/AIDAProcessor.h"
+#include <AIDA/ITree.h>
+#include <AIDA/IHistogramFactory.h>
+#endif
+
+// lcio includes <.h>
+#include <Exceptions.h>
+#include <EVENT/LCCollection.h>
+#include <EVENT/TrackerData.h>
+#include <EVENT/TrackerHit.h>
+#include <EVENT/TrackerPulse.h>
+#include <EVENT/TrackerRawData.h>
+#include <UTIL/BitField64.h>
+
+// system includes <>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+using namespace lcio;
+using namespace marlin;
+using namespace eutelescope;
+
+namespace {
+
+  //! cellID0 of the tracker objects, 0 for any other object
+  long long getCellID0( EVENT::LCObject* object ) {
+    if ( EVENT::TrackerHit* hit = dynamic_cast< EVENT::TrackerHit* >( object ) ) return hit->getCellID0();
+    if ( EVENT::TrackerPulse* pulse = dynamic_cast< EVENT::TrackerPulse* >( object ) ) return pulse->getCellID0();
+    if ( EVENT::TrackerData* data = dynamic_cast< EVENT::TrackerData* >( object ) ) return data->getCellID0();
+    if ( EVENT::TrackerRawData* rawData = dynamic_cast< EVENT::TrackerRawData* >( object ) ) return rawData->getCellID0();
+    return 0;
+  }
+
+  //! String as JSON string literal
+  string jsonString( const string& value ) {
+    string quoted = "\"";
+    for ( size_t i = 0; i < value.size(); ++i ) {
+      if ( value[i] == '"' || value[i] == '\\' ) quoted += '\\';
+      quoted += value[i];
+    }
+    return quoted + "\"";
+  }
+
+  //! Sampled value scaled to all events
+  double extrapolate( double value, const EUTelInstrumentation::ProcessorStats& stats ) {
+    return stats.nSampled > 0 ? value * stats.nEvents / stats.nSampled : 0.;
+  }
+}
+
+EUTelProcessorInstrumentation::EUTelProcessorInstrumentation() :
+  Processor( "EUTelProcessorInstrumentation" ),
+  _samplingInterval( 1 ),
+  _memoryStatistics( false ),
+  _occupancyCollectionName( "hit" ),
+  _maxOccupancy( 100 ),
+  _summaryFileName( "instrumentation.json" ),
+  _planes(),
+  _eventNumber( 0 ),
+  _occupancy( 0 ),
+  _previousEventNumber( 0 ),
+  _previousOccupancy( 0 ),
+  _loopWallStart(),
+  _loopCpuStart( 0 ),
+  _measurements()
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+  , _wallTimeHistos(),
+  _wallTimeVsOccupancyHistos()
+#endif
+{
+  _description = "EUTelProcessorInstrumentation measures the time and memory used by each EUTelescope processor. "
+    "Put it last in the steering file.";
+
+  registerOptionalParameter( "SamplingInterval", "Measure only events whose number is a multiple of this, 1 measures every event",
+                             _samplingInterval, static_cast< int >( 1 ) );
+
+  registerOptionalParameter( "MemoryStatistics", "Record the heap growth and minor page faults of each processor, "
+                             "costs a few microseconds per processor and event",
+                             _memoryStatistics, static_cast< bool >( false ) );
+
+  registerOptionalParameter( "OccupancyCollectionName", "Collection whose number of elements per plane is the occupancy of an event",
+                             _occupancyCollectionName, string( "hit" ) );
+
+  registerOptionalParameter( "MaxOccupancy", "Upper edge of the occupancy axis of the cost vs. occupancy histograms",
+                             _maxOccupancy, static_cast< float >( 100 ) );
+
+  registerOptionalParameter( "SummaryFileName", "Name of the JSON summary written at the end, empty for none",
+                             _summaryFileName, string( "instrumentation.json" ) );
+}
+
+void EUTelProcessorInstrumentation::init() {
+  printParameters();
+
+  EUTelInstrumentation::getInstance().enable( _samplingInterval, _memoryStatistics );
+
+  _loopCpuStart = clock();
+  _loopWallStart = chrono::steady_clock::now();
+}
+
+void EUTelProcessorInstrumentation::processEvent( LCEvent* evt ) {
+
+  if ( evt->getEventNumber() % max( _samplingInterval, 1 ) == 0 ) {
+    _previousEventNumber = _eventNumber;
+    _previousOccupancy = _occupancy;
+    _eventNumber = evt->getEventNumber();
+    _occupancy = getOccupancy( evt );
+  }
+
+  fillHistograms();
+}
+
+double EUTelProcessorInstrumentation::getOccupancy( LCEvent* evt ) {
+
+  LCCollection* collection = NULL;
+  try {
+    collection = evt->getCollection( _occupancyCollectionName );
+  } catch ( lcio::DataNotAvailableException& ) {
+    return 0.;
+  }
+
+  const int nElements = collection->getNumberOfElements();
+  const string encoding = collection->getParameters().getStringVal( LCIO::CellIDEncoding );
+  if ( encoding.find( "sensorID" ) == string::npos ) {
+    _planes.insert( 0 );
+  } else {
+    UTIL::BitField64 cellID( encoding );
+    for ( int i = 0; i < nElements; ++i ) {
+      cellID.setValue( getCellID0( collection->getElementAt( i ) ) );
+      _planes.insert( static_cast< int >( cellID[ "sensorID" ] ) );
+    }
+  }
+
+  return _planes.empty() ? 0. : static_cast< double >( nElements ) / _planes.size();
+}
+
+void EUTelProcessorInstrumentation::fillHistograms() {
+
+  EUTelInstrumentation::getInstance().takeMeasurements( _measurements );
+
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+  for ( size_t i = 0; i < _measurements.size(); ++i ) {
+    const EUTelInstrumentation::Measurement& measurement = _measurements[i];
+
+    // processors after this one in the steering file measured the previous event
+    double occupancy = _occupancy;
+    if ( measurement.eventNumber != _eventNumber ) {
+      if ( measurement.eventNumber != _previousEventNumber ) continue;
+      occupancy = _previousOccupancy;
+    }
+
+    if ( _wallTimeHistos.find( measurement.processor ) == _wallTimeHistos.end() ) {
+      const string basePath = measurement.processor->name + "/";
+      AIDAProcessor::tree( this )->mkdir( basePath.c_str() );
+
+      AIDA::IHistogram1D* wallTimeHisto =
+        AIDAProcessor::histogramFactory( this )->createHistogram1D( ( basePath + "Log10WallTime" ).c_str(), 160, -7., 1. );
+      wallTimeHisto->setTitle( ( measurement.processor->name + " wall time per event;log_{10}(t / s);events" ).c_str() );
+      _wallTimeHistos[ measurement.processor ] = wallTimeHisto;
+
+      AIDA::IProfile1D* wallTimeVsOccupancyHisto =
+        AIDAProcessor::histogramFactory( this )->createProfile1D( ( basePath + "WallTimeVsOccupancy" ).c_str(), 100, 0., _maxOccupancy );
+      wallTimeVsOccupancyHisto->setTitle( ( measurement.processor->name + " wall time vs. occupancy;elements per plane;t / ms" ).c_str() );
+      _wallTimeVsOccupancyHistos[ measurement.processor ] = wallTimeVsOccupancyHisto;
+    }
+
+    _wallTimeHistos[ measurement.processor ]->fill( log10( max( measurement.wallTime, 1e-9 ) ) );
+    _wallTimeVsOccupancyHistos[ measurement.processor ]->fill( occupancy, 1e3 * measurement.wallTime );
+  }
+#endif
+}
+
+void EUTelProcessorInstrumentation::end() {
+
+  const double loopWallTime = chrono::duration<double>( chrono::steady_clock::now() - _loopWallStart ).count();
+  const double loopCpuTime = static_cast< double >( clock() - _loopCpuStart ) / CLOCKS_PER_SEC;
+
+  fillHistograms();
+
+  const EUTelInstrumentation& instrumentation = EUTelInstrumentation::getInstance();
+  const vector<EUTelInstrumentation::ProcessorStats*>& processors = instrumentation.getProcessorStats();
+
+  double processorsWallTime = 0;
+  streamlog_out( MESSAGE4 ) << "Cost per processor, extrapolated to all events:" << endl
+                            << setw( 40 ) << left << "processor" << right
+                            << setw( 10 ) << "events" << setw( 12 ) << "wall / s" << setw( 12 ) << "cpu / s"
+                            << setw( 14 ) << "wall / ms/evt" << setw( 12 ) << "max / ms";
+  if ( instrumentation.hasMemoryStatistics() ) streamlog_out( MESSAGE4 ) << setw( 14 ) << "heap / kB/evt";
+  streamlog_out( MESSAGE4 ) << endl;
+
+  for ( size_t i = 0; i < processors.size(); ++i ) {
+    const EUTelInstrumentation::ProcessorStats& stats = *processors[i];
+    const double wallTime = extrapolate( stats.wallTime, stats );
+    processorsWallTime += wallTime;
+    streamlog_out( MESSAGE4 ) << setw( 40 ) << left << stats.name << right
+                              << setw( 10 ) << stats.nEvents << fixed << setprecision( 2 )
+                              << setw( 12 ) << wallTime << setw( 12 ) << extrapolate( stats.cpuTime, stats )
+                              << setprecision( 3 )
+                              << setw( 14 ) << ( stats.nSampled > 0 ? 1e3 * stats.wallTime / stats.nSampled : 0. )
+                              << setw( 12 ) << 1e3 * stats.maxWallTime;
+    if ( instrumentation.hasMemoryStatistics() ) {
+      streamlog_out( MESSAGE4 ) << setw( 14 ) << ( stats.nSampled > 0 ? 1e-3 * stats.heapGrowth / stats.nSampled : 0. );
+    }
+    streamlog_out( MESSAGE4 ) << resetiosflags( ios::floatfield ) << setprecision( 6 ) << endl;
+  }
+  streamlog_out( MESSAGE4 ) << "Event loop " << loopWallTime << " s wall, " << loopCpuTime << " s cpu, "
+                            << loopWallTime - processorsWallTime << " s wall outside of the EUTelescope processors, peak RSS "
+                            << EUTelInstrumentation::getPeakResidentSize() / ( 1024 * 1024 ) << " MB" << endl;
+
+  if ( !_summaryFileName.empty() ) writeSummary( loopWallTime, loopCpuTime );
+}
+
+void EUTelProcessorInstrumentation::writeSummary( double loopWallTime, double loopCpuTime ) const {
+
+  ofstream summary( _summaryFileName.c_str() );
+  if ( !summary ) {
+    streamlog_out( ERROR5 ) << "Could not open " << _summaryFileName << ", no instrumentation summary written" << endl;
+    return;
+  }
+
+  const EUTelInstrumentation& instrumentation = EUTelInstrumentation::getInstance();
+  const vector<EUTelInstrumentation::ProcessorStats*>& processors = instrumentation.getProcessorStats();
+
+  summary << setprecision( 9 )
+          << "{" << endl
+          << "  \"samplingInterval\": " << instrumentation.getSamplingInterval() << "," << endl
+          << "  \"memoryStatistics\": " << ( instrumentation.hasMemoryStatistics() ? "true" : "false" ) << "," << endl
+          << "  \"loopWallTime\": " << loopWallTime << "," << endl
+          << "  \"loopCpuTime\": " << loopCpuTime << "," << endl
+          << "  \"peakResidentSize\": " << EUTelInstrumentation::getPeakResidentSize() << "," << endl
+          << "  \"processors\": [";
+
+  for ( size_t i = 0; i < processors.size(); ++i ) {
+    const EUTelInstrumentation::ProcessorStats& stats = *processors[i];
+    summary << ( i == 0 ? "" : "," ) << endl
+            << "    {" << endl
+            << "      \"name\": " << jsonString( stats.name ) << "," << endl
+            << "      \"events\": " << stats.nEvents << "," << endl
+            << "      \"sampledEvents\": " << stats.nSampled << "," << endl
+            << "      \"wallTime\": " << stats.wallTime << "," << endl
+            << "      \"maxWallTime\": " << stats.maxWallTime << "," << endl
+            << "      \"cpuTime\": " << stats.cpuTime << "," << endl
+            << "      \"extrapolatedWallTime\": " << extrapolate( stats.wallTime, stats ) << "," << endl
+            << "      \"extrapolatedCpuTime\": " << extrapolate( stats.cpuTime, stats ) << "," << endl
+            << "      \"heapGrowth\": " << stats.heapGrowth << "," << endl
+            << "      \"maxHeapGrowth\": " << stats.maxHeapGrowth << "," << endl
+            << "      \"minorFaults\": " << stats.minorFaults << "," << endl
+            << "      \"peakCollectionSizes\": {";
+    for ( map<string, int>::const_iterator iter = stats.peakCollectionSizes.begin(); iter != stats.peakCollectionSizes.end(); ++iter ) {
+      summary << ( iter == stats.peakCollectionSizes.begin() ? " " : ", " ) << jsonString( iter->first ) << ": " << iter->second;
+    }
+    summary << " }" << endl
+            << "    }";
+  }
+  summary << endl << "  ]" << endl << "}" << endl;
+
+  streamlog_out( MESSAGE4 ) << "Instrumentation summary written to " << _summaryFileName << endl;
+}
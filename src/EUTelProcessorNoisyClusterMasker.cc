@@ -12,6 +12,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelProcessorNoisyClusterMasker.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
@@ -52,7 +53,9 @@ EUTelProcessorNoisyClusterMasker::EUTelProcessorNoisyClusterMasker():
   _iEvt(0),
   _firstEvent(true),
   _dataFormatChecked(false),
-  _wrongDataFormat(false)
+  _wrongDataFormat(false),
+  _noisyPixelMask(nullptr),
+  _maskedNoisyClusters()
 {
   _description ="EUTelProcessorNoisyClusterMasker masks pulses which contain hot pixels. For this, the quality field of pulses is used to encode the kNoisyCluster enum provided by EUTelescope.";
 
@@ -79,6 +82,7 @@ void EUTelProcessorNoisyClusterMasker::processRunHeader(LCRunHeader* /*rdr*/) {
 }
 
 void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	if(_firstEvent) {
 		//The noisy pixel collection stores all thot pixels in event #1
 		//Thus we have to read it in in that case
@@ -102,6 +106,7 @@ void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event) {
 	std::string encoding = pulseInputCollectionVec->getParameters().getStringVal( LCIO::CellIDEncoding );
 	//and the encoder for the data
 	lcio::UTIL::CellIDReencoder<TrackerPulseImpl> cellReencoder( encoding, pulseInputCollectionVec );
+	CellIDDecoder<TrackerDataImpl> trackerDecoder ( EUTELESCOPE::ZSCLUSTERDEFAULTENCODING );
 	
 	//loop over all the pulses
 	for ( size_t iPulse = 0 ; iPulse < pulseInputCollectionVec->size(); iPulse++ ) {
@@ -109,32 +114,15 @@ void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event) {
         	TrackerPulseImpl* pulseData = dynamic_cast<TrackerPulseImpl*> ( pulseInputCollectionVec->getElementAt( iPulse ) );
 		int sensorID = cellDecoder(pulseData)["sensorID"];		
 	
-	        //get the noise vector for the given plane
-		std::vector<int>* noiseVector = &(_noisyPixelMap[sensorID]);
-		
 		//each pulse has the tracker data attached to it
-		TrackerDataImpl* trackerData = dynamic_cast<TrackerDataImpl*>( pulseData->getTrackerData() );
+		TrackerDataImpl* trackerData = static_cast<TrackerDataImpl*>( pulseData->getTrackerData() );
 		//decoder for tracker data
-		CellIDDecoder<TrackerDataImpl> trackerDecoder ( EUTELESCOPE::ZSCLUSTERDEFAULTENCODING );
 		int pixelType = trackerDecoder(trackerData)["sparsePixelType"];
 
-		//interface to sparsified data
-                auto sparseData = Utility::getSparseData(trackerData, pixelType);
-		bool noisy = false;
-
-		//IMPORTANT: if we pass a nullptr to EUTelBaseSparsePixel* getSparsePixelAt( int index, EUTelBaseSparsePixel* pixel)
-		//where pixel=NULL, this method will return a pointer to a new pixel of derived type. YOU have to delete it!
-		EUTelBaseSparsePixel* pixel = nullptr;
-
-		//Loop over all hits!
-		for ( unsigned int iPixel = 0; iPixel < sparseData->size(); iPixel++ ) {
-			//IF pixel=NULL this yields a new pixel
-		        pixel = sparseData->getSparsePixelAt( iPixel, pixel );
-			if(std::binary_search( noiseVector->begin(), noiseVector->end(), encode(pixel->getXCoord(), pixel->getYCoord()) )) {
-				noisy=true;
-				break;
-			}
-		}
+		//test the pixels directly on the sparse pixel buffer, no pixel objects needed
+		bool noisy = _noisyPixelMask != nullptr &&
+		  _noisyPixelMask->anyNoisy( sensorID, trackerData->getChargeValues(),
+		                             Utility::getSparsePixelNoOfElements( static_cast<SparsePixelType>(pixelType) ) );
 
 		if(noisy) {
 			int quality = cellDecoder(pulseData)["quality"];
@@ -147,7 +135,6 @@ void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event) {
 			cellReencoder.setCellID(pulseData);
 			_maskedNoisyClusters[sensorID]++;
 		}	
-		delete pixel;
         }
 }
 
@@ -164,60 +151,23 @@ void EUTelProcessorNoisyClusterMasker::end()
 	}
 }
 
-int EUTelProcessorNoisyClusterMasker::encode(int X, int Y) {
-	//Cantor pairing function
-	return static_cast<int>( 0.5*(X+Y)*(X+Y+1)+Y );
-} 
-
 void EUTelProcessorNoisyClusterMasker::readNoisyPixelList(LCEvent* event) {
-	//Preapare pointer to hot pixel collection
-	LCCollectionVec* noisyPixelCollectionVec = nullptr;
+	//The mask is loaded once per job and shared by all processors using the collection
+	_noisyPixelMask = EUTelNoisyPixelMask::getShared( event, _noisyPixelCollectionName );
 
-	//Try to obtain the collection
-	try  {
-		noisyPixelCollectionVec = static_cast< LCCollectionVec*>( event->getCollection(_noisyPixelCollectionName) );
-	} catch (...) {
+	if( _noisyPixelMask == nullptr ) {
 		if (!_noisyPixelCollectionName.empty()) {
 			streamlog_out ( WARNING1 ) << "_noisyPixelCollectionName " << _noisyPixelCollectionName.c_str() << " not found" << std::endl;
 			streamlog_out ( WARNING1 ) << "READ CAREFULLY: This means that no noisy pixels will be removed, despite the processor successfully running!" << std::endl;
 		}
 		return;
-    	}
-
-	//Decoder to get sensor ID
-	CellIDDecoder<TrackerDataImpl> cellDecoder( noisyPixelCollectionVec );
-        EUTelBaseSparsePixel* pixel = nullptr;
-
-	//Loop over all hot pixels
-	for(int i=0; i<  noisyPixelCollectionVec->getNumberOfElements(); i++) {
-		//Get the TrackerData for the sensor ID
-		TrackerDataImpl* noisyPixelData = dynamic_cast< TrackerDataImpl *> ( noisyPixelCollectionVec->getElementAt( i ) );
-		int sensorID = cellDecoder( noisyPixelData )["sensorID"];
-		int pixelType = cellDecoder( noisyPixelData )["sparsePixelType"];
-		
-		//And get the corresponding noise vector for that plane
-		std::vector<int>* noiseSensorVector = &(_noisyPixelMap[sensorID]);
-		std::unique_ptr<EUTelTrackerDataInterfacer> noisyPixelDataInterface;
-
-		if( pixelType == kEUTelGenericSparsePixel ) {
-			noisyPixelDataInterface =  std::unique_ptr<EUTelTrackerDataInterfacer>( new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>(noisyPixelData) );
-		} else {
-			streamlog_out( ERROR5 ) << "The noisy pixel collection is corrupted, it does not contain the right pixel type. Something is wrong!" << std::endl;
-		}
-		
-		//Store all the noisy pixels in the noise vector, use the provided encoding to map two int's to an unique int
-		for ( unsigned int iPixel = 0; iPixel < noisyPixelDataInterface->size(); iPixel++ ) {
-			pixel = noisyPixelDataInterface->getSparsePixelAt( iPixel, pixel);
-			noiseSensorVector->push_back( encode(pixel->getXCoord(), pixel->getYCoord()) );
-
-		}
 	}
-	delete pixel;
 
-	for( std::map<int, std::vector<int> >::iterator it = _noisyPixelMap.begin(); it != _noisyPixelMap.end(); ++it) {
-		//Sort the noisy pixel maps
-		std::sort( (it->second).begin(), (it->second).end() );
-		std::cout << "Read in " << (it->second).size() << " hot pixels on plane " << (it->first) << std::endl;
+	LCCollection* noisyPixelCollection = event->getCollection(_noisyPixelCollectionName);
+	CellIDDecoder<TrackerDataImpl> cellDecoder( noisyPixelCollection );
+	for(int i=0; i<  noisyPixelCollection->getNumberOfElements(); i++) {
+		int sensorID = cellDecoder( static_cast<TrackerDataImpl*>( noisyPixelCollection->getElementAt( i ) ) )["sensorID"];
+		streamlog_out ( MESSAGE4 ) << "Read in " << _noisyPixelMask->getNNoisyPixels(sensorID) << " hot pixels on plane " << sensorID << std::endl;
 	}
 }
 
@@ -13,6 +13,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelProcessorNoisyClusterRemover.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
 
 // marlin includes ".h"
@@ -73,6 +74,7 @@ void EUTelProcessorNoisyClusterRemover::processRunHeader(LCRunHeader* rdr){
 }
 
 void EUTelProcessorNoisyClusterRemover::processEvent(LCEvent* event) {
+ 	EUTelInstrumentation::Scope instrumentationScope( this, event );
  	// get the collection of interest from the event.
 	LCCollectionVec* pulseInputCollectionVec = nullptr;
 
@@ -111,7 +113,8 @@ void EUTelProcessorNoisyClusterRemover::processEvent(LCEvent* event) {
 		int quality = cellDecoder(inputPulse)["quality"];
 		int sensorID  = cellDecoder(inputPulse)["sensorID"];
 		
-		//if the kNoisyCluster flag is NOT set, we add the pulse to the output collection
+		//if the kNoisyCluster flag is NOT set, we add the pulse to the output collection,
+		//the noisy pixel lookup itself is done by EUTelProcessorNoisyClusterMasker
 		if(!(quality & kNoisyCluster)) {
 			//TrackerPulseImpl for the output collection
 			std::unique_ptr<TrackerPulseImpl> outputPulse (new TrackerPulseImpl );
@@ -9,6 +9,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelProcessorNoisyPixelFinder.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
@@ -69,6 +70,9 @@ EUTelProcessorNoisyPixelFinder::EUTelProcessorNoisyPixelFinder():
   _iEvt(0),
   _sensorIDVec(),
   _noisyPixelDBFile(""),
+  _checkpointFile(""),
+  _checkpointEveryNEvents(0),
+  _inputCheckpoints(),
   _finished(false)
 {
   //processor description
@@ -90,6 +94,15 @@ EUTelProcessorNoisyPixelFinder::EUTelProcessorNoisyPixelFinder():
 
   registerOptionalParameter("HotPixelCollectionName", "This is the name of the hot pixel collection to be saved into the output slcio file",
                              _noisyPixelCollectionName, std::string("noisyPixel"));
+
+  registerOptionalParameter("CheckpointFile", "Binary file to which the accumulated hit maps are written at the end of the job, empty for none",
+                             _checkpointFile, std::string(""));
+
+  registerOptionalParameter("CheckpointEveryNEvents", "Additionally write the hit map checkpoint every n-th event, 0 to disable",
+                             _checkpointEveryNEvents, static_cast<int>(0) );
+
+  registerOptionalParameter("InputCheckpoints", "Hit map checkpoints of previous run segments to be merged before processing",
+                             _inputCheckpoints, std::vector<std::string>() );
 }
 
 void EUTelProcessorNoisyPixelFinder::initializeHitMaps() {
@@ -113,22 +126,14 @@ void EUTelProcessorNoisyPixelFinder::initializeHitMaps() {
 			thisSensor.offY = minY;
 			thisSensor.sizeY = maxY - minY+1;
 
-			//this is the 2-dimensional array used to store all the pixels, it is implemented as a vector of vectors
-			//first the x-entries-vector
-			std::vector<std::vector<int>> hitVecP = std::vector<std::vector<int>>( thisSensor.sizeX );
-
-			//and the y-entries vector
-			for(auto& i: hitVecP) {
-				//resize it now
-				i.resize(thisSensor.sizeY, 0);
-			}
+			//one contiguous counter array per sensor
+			_hitMaps.addSensor(sensorID, thisSensor.offX, thisSensor.sizeX, thisSensor.offY, thisSensor.sizeY);
 
 			//collection to later hold the hot pixels
 			std::vector<EUTelGenericSparsePixel> noisyPixelMap;
 
 			//store all the collections/pointers in the corresponding maps
 		    	_sensorMap[sensorID] = thisSensor;
-			_hitVecMap[sensorID] = hitVecP;
 			_noisyPixelMap[sensorID] = noisyPixelMap;
 		} catch(std::runtime_error& e) {
 			streamlog_out ( ERROR0 ) << "Noisy pixel masker could not retrieve plane " << sensorID << std::endl;
@@ -136,6 +141,18 @@ void EUTelProcessorNoisyPixelFinder::initializeHitMaps() {
 			throw marlin::StopProcessingException(this);
 		}
 	}
+
+	//add the hit maps of previous run segments
+	for(auto& checkpoint: _inputCheckpoints) {
+		try {
+			_hitMaps.mergeCheckpoint(checkpoint);
+		} catch(lcio::Exception& e) {
+			streamlog_out ( ERROR0 ) << "Could not merge hit map checkpoint " << checkpoint << std::endl;
+			streamlog_out ( ERROR0 ) << e.what() << std::endl;
+			throw marlin::StopProcessingException(this);
+		}
+		streamlog_out ( MESSAGE4 ) << "Merged hit map checkpoint " << checkpoint << ", now at " << _hitMaps.getNEvents() << " events" << std::endl;
+	}
 }
 
 void EUTelProcessorNoisyPixelFinder::init() {
@@ -176,9 +193,6 @@ void EUTelProcessorNoisyPixelFinder::noisyPixelFinder(EUTelEventImpl* evt) {
 			TrackerDataImpl* zsData = dynamic_cast<TrackerDataImpl*>( zsInputCollectionVec->getElementAt(iDetector) );
 			int sensorID            = static_cast<int>( cellDecoder(zsData)["sensorID"] );
 
-			sensor* currentSensor = &_sensorMap[sensorID];
-			std::vector<std::vector<int>>* hitArray = &_hitVecMap[sensorID];
-
 			//if this is an excluded sensor go to the next element
 			bool foundexcludedsensor = false;
 			for(auto i : _excludedPlanes) {
@@ -188,30 +202,21 @@ void EUTelProcessorNoisyPixelFinder::noisyPixelFinder(EUTelEventImpl* evt) {
 			}
 			if(foundexcludedsensor) continue;
 
-			// now prepare the EUTelescope interface to sparsified data.  
-			EUTelBaseSparsePixel* pixel = nullptr;
+			if(!_hitMaps.hasSensor(sensorID)) continue;
+
+			// the sparse pixels are read straight from the charge values, all
+			// pixel types store the x and y index as their first two elements
 			int pixelType = cellDecoder(zsData)["sparsePixelType"];
-			auto sparseData = Utility::getSparseData(zsData, pixelType);
-
-			// loop over all pixels in the sparseData object, these are the hit pixels!
-			for ( size_t iPixel = 0; iPixel < sparseData->size(); iPixel++ ) {
-				//get the pixel
-				pixel = sparseData->getSparsePixelAt( iPixel, pixel );
-
-				//compute the address in the array-like-structure, any offset
-				//has to be substracted (array index starts at 0)
-				int indexX = pixel->getXCoord() - currentSensor->offX;
-				int indexY = pixel->getYCoord() - currentSensor->offY;
-
-				try {
-					//increment the hit counter for this pixel
-					(hitArray->at(indexX)).at(indexY)++;
-				} catch(std::out_of_range& e) {
-					streamlog_out ( ERROR5 )  << "Pixel: " << pixel->getXCoord() << "|" <<  pixel->getYCoord() << " on plane: " << sensorID << " fired." << std::endl 
-						<< "This pixel is out of the range defined by the geometry. Either your data is corrupted or your pixel geometry not specified correctly!" << std::endl;
-				}
+			auto strideIt = _pixelStrideMap.find(pixelType);
+			if(strideIt == _pixelStrideMap.end()) {
+				strideIt = _pixelStrideMap.insert( std::make_pair(pixelType, Utility::getSparsePixelNoOfElements( static_cast<SparsePixelType>(pixelType) )) ).first;
+			}
+
+			size_t nOutOfRange = _hitMaps.fill(sensorID, zsData->getChargeValues(), strideIt->second);
+			if(nOutOfRange > 0) {
+				streamlog_out ( ERROR5 )  << nOutOfRange << " pixel(s) on plane: " << sensorID << " fired outside of the range defined by the geometry." << std::endl 
+					<< "Either your data is corrupted or your pixel geometry not specified correctly!" << std::endl;
 			}
-			delete pixel;
 		}    
 	} catch (lcio::DataNotAvailableException& e ) {
 		streamlog_out ( WARNING2 )  << "Input collection not found in the current event. Skipping..." << e.what() << std::endl;
@@ -220,8 +225,9 @@ void EUTelProcessorNoisyPixelFinder::noisyPixelFinder(EUTelEventImpl* evt) {
 }
 
 void EUTelProcessorNoisyPixelFinder::processEvent (LCEvent * event) {
-	//if we are over the number of events we need we just skip
-	if(_noOfEvents < _iEvt) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
+	//if we are done with the noisy pixel finding we just skip
+	if(_finished) {
 		++_iEvt;
 		return;
 	}
@@ -252,11 +258,22 @@ void EUTelProcessorNoisyPixelFinder::processEvent (LCEvent * event) {
 		return;     
 	}
 
-	//don't forget to increment the event counter
+	//don't forget to increment the event counters
 	++_iEvt;
+	_hitMaps.addEvents();
 }
 
 void EUTelProcessorNoisyPixelFinder::end() {
+	//merged checkpoints might provide enough events without any event read in this job
+	if(!_finished && _hitMaps.getNEvents() >= static_cast<uint64_t>(_noOfEvents) && _hitMaps.getNEvents() > 0) {
+		findNoisyPixels();
+	}
+
+	if(!_checkpointFile.empty()) {
+		_hitMaps.writeCheckpoint(_checkpointFile);
+		streamlog_out ( MESSAGE4 ) << "Hit maps of " << _hitMaps.getNEvents() << " events written to checkpoint " << _checkpointFile << std::endl;
+	}
+
 	if(_finished) {
 		streamlog_out ( MESSAGE4 ) << "Noisy pixel finder has successfully finished!" << std::endl;
 	} else {
@@ -266,55 +283,63 @@ void EUTelProcessorNoisyPixelFinder::end() {
 }
 
 void EUTelProcessorNoisyPixelFinder::check(LCEvent* /*event*/ ) {
-	//only if the eventNo is the amount of events to be processed we analyse the data
-	//since check() runs after the event and we increment the event counter before that
-	//the comparison is valid. If we set _noOfEvents=1 we only want to have processed event
-	//0 before calling this. Since we increment 0++ before calling this function, this 
-	//criteria is fullfilled
-	if( _iEvt == _noOfEvents) {
-		streamlog_out ( MESSAGE4 ) << "Finished determining hot pixels, writing them out..." << std::endl;
-
-		//iterate over all the sensors in our sensorMap
-		for(auto& thisSensor: _sensorMap)
+	//check() runs after the event has been filled, so the accumulated
+	//event count already includes the current event
+	if(_finished) return;
+
+	if(_checkpointEveryNEvents > 0 && !_checkpointFile.empty() && _iEvt % _checkpointEveryNEvents == 0) {
+		_hitMaps.writeCheckpoint(_checkpointFile);
+		streamlog_out ( DEBUG5 ) << "Hit map checkpoint written after " << _hitMaps.getNEvents() << " events" << std::endl;
+	}
+
+	//only if we accumulated the amount of events to be processed we analyse the data
+	if( _hitMaps.getNEvents() >= static_cast<uint64_t>(_noOfEvents) ) {
+		findNoisyPixels();
+	}
+}
+
+void EUTelProcessorNoisyPixelFinder::findNoisyPixels() {
+	streamlog_out ( MESSAGE4 ) << "Finished determining hot pixels, writing them out..." << std::endl;
+
+	const float nEvents = static_cast<float>( _hitMaps.getNEvents() );
+	//a pixel is noisy if count/nEvents > _maxAllowedFiringFreq
+	const uint64_t maxAllowedCount = static_cast<uint64_t>( std::floor(_maxAllowedFiringFreq*nEvents) );
+
+	//iterate over all the sensors in our sensorMap
+	for(auto& thisSensor: _sensorMap)
+	{
+		auto sensorID = thisSensor.first;
+		streamlog_out ( MESSAGE3 ) << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << std::endl;
+		streamlog_out ( MESSAGE3 ) << "Noisy pixels found on plane " << sensorID << " (max. fire freq set to: " << _maxAllowedFiringFreq << ")" << std::endl;
+		streamlog_out ( MESSAGE3 ) << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << std::endl;
+
+		const EUTelHitMapAccumulator::SensorMap& hitMap = _hitMaps.getSensorMap(sensorID);
+
+		//loop over all pixels which fired often enough to be candidates
+		for(auto& index: _hitMaps.getPixelsAbove(sensorID, maxAllowedCount > 0 ? maxAllowedCount - 1 : 0))
 		{
-			auto sensorID = thisSensor.first;
-			streamlog_out ( MESSAGE3 ) << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << std::endl;
-			streamlog_out ( MESSAGE3 ) << "Noisy pixels found on plane " << sensorID << " (max. fire freq set to: " << _maxAllowedFiringFreq << ")" << std::endl;
-			streamlog_out ( MESSAGE3 ) << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << std::endl;
-
-			//get the correpsonding hit array-like vector of vectors
-			std::vector<std::vector<int>>* hitVector =  &_hitVecMap[sensorID];
-			//and the sensor which stores offsets
-			sensor* currentSensor = &_sensorMap[sensorID];
-
-			//loop over all pixels
-			for (std::vector<std::vector<int> >::iterator xIt = hitVector->begin(); xIt != hitVector->end(); ++xIt)
-			{
-				for(std::vector<int>::iterator yIt = xIt->begin(); yIt != xIt->end(); ++yIt)
-				{
-					//compute the firing frequency
-					float fireFreq = (float)*yIt/(float)_iEvt;
-					//if it is larger than the allowed one, we write this pixel into a collection
-					if(fireFreq > _maxAllowedFiringFreq) {
-						streamlog_out ( MESSAGE3 )	<< "Pixel: " << xIt-hitVector->begin() + currentSensor->offX << "|" 
-										<< yIt - xIt->begin() + currentSensor->offY  << " fired " << fireFreq << std::endl;
-						EUTelGenericSparsePixel pixel;
-						pixel.setXCoord(xIt-hitVector->begin() + currentSensor->offX);
-						pixel.setYCoord(yIt - xIt->begin() + currentSensor->offY );
-						pixel.setSignal( fireFreq );
-						//writing out is done here
-						_noisyPixelMap[sensorID].push_back(pixel);
-					}
-				}
+			//compute the firing frequency
+			float fireFreq = static_cast<float>( hitMap.count(index.first, index.second) )/nEvents;
+			//if it is larger than the allowed one, we write this pixel into a collection
+			if(fireFreq > _maxAllowedFiringFreq) {
+				streamlog_out ( MESSAGE3 )	<< "Pixel: " << index.first << "|" << index.second << " fired " << fireFreq << std::endl;
+				EUTelGenericSparsePixel pixel;
+				pixel.setXCoord(index.first);
+				pixel.setYCoord(index.second);
+				pixel.setSignal( fireFreq );
+				//writing out is done here
+				_noisyPixelMap[sensorID].push_back(pixel);
 			}
 		}
-
-		//write out the databases and histograms
-		noisyPixelDBWriter();
-		bookAndFillHistos();
-		//we reached enough events, wrote out noisy pixel db and are done now
-		_finished = true;
 	}
+
+	//write out the databases and histograms
+	noisyPixelDBWriter();
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+	bookAndFillHistos();
+#endif
+	//we reached enough events, wrote out noisy pixel db and are done now
+	_finished = true;
 }
 
 void EUTelProcessorNoisyPixelFinder::noisyPixelDBWriter() {    
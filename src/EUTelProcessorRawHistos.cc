@@ -9,6 +9,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelProcessorRawHistos.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
@@ -62,7 +63,8 @@ EUTelProcessorRawHistos::EUTelProcessorRawHistos():
   _zsDataCollectionName(""),
   _iRun(0),
   _iEvt(0),
-  _sensorIDVec()
+  _sensorIDVec(),
+  _noisyPixelMask(nullptr)
 {
   //processor description
   _description = "EUTelProcessorRawHistos computes the firing frequency of pixels and applies a cut on this value to mask (NOT remove) hot pixels.";
@@ -87,44 +89,6 @@ void EUTelProcessorRawHistos::init() {
 	_treatNoise = true;
 }
 
-int EUTelProcessorRawHistos::cantorEncode(int X, int Y) {
-	//Cantor pairing function
-	return static_cast<int>( 0.5*(X+Y)*(X+Y+1)+Y );
-}
-
-void EUTelProcessorRawHistos::initialiseNoisyPixels( LCCollectionVec* const noisyPixCollectionVec) {
-
-	//Decoder to get sensor ID
-	CellIDDecoder<TrackerDataImpl> cellDecoder( noisyPixCollectionVec );
-        EUTelBaseSparsePixel* pixel = nullptr;
-
-	//Loop over all hot pixels
-	for(int i=0; i<  noisyPixCollectionVec->getNumberOfElements(); i++) {
-		//Get the TrackerData for the sensor ID
-		TrackerDataImpl* noisyTrackerData = dynamic_cast<TrackerDataImpl*>( noisyPixCollectionVec->getElementAt(i) );
-		int sensorID = cellDecoder( noisyTrackerData )["sensorID"];
-		int pixelType = cellDecoder( noisyTrackerData )["sparsePixelType"];
-		//And get the corresponding noise vector for that plane
-		std::vector<int>* noiseSensorVector = &(_noisyPixelVecMap[sensorID]);
-
-		unique_ptr<EUTelTrackerDataInterfacer> noisyPixelData = auto_ptr<EUTelTrackerDataInterfacer>();
-
-		if( pixelType == kEUTelGenericSparsePixel ) {
-			noisyPixelData =  unique_ptr<EUTelTrackerDataInterfacer>( new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>(noisyTrackerData) );
-		}
-		//Store all the noisy pixels in the noise vector, use the provided encoding to map two int's to an unique int
-		for ( unsigned int iPixel = 0; iPixel < noisyPixelData->size(); iPixel++ ) {
-			pixel = noisyPixelData->getSparsePixelAt( iPixel, pixel);
-			noiseSensorVector->push_back( cantorEncode(pixel->getXCoord(), pixel->getYCoord()) );
-		}
-	}
-	delete pixel;
-
-	for(auto& i: _noisyPixelVecMap) {
-		std::sort(i.second.begin(), i.second.end() );
-	}
-}
- 
 void EUTelProcessorRawHistos::processRunHeader(LCRunHeader* rdr) {
 	unique_ptr<EUTelRunHeaderImpl> runHeader( new EUTelRunHeaderImpl(rdr) );
 	runHeader->addProcessor(type());
@@ -135,17 +99,16 @@ void EUTelProcessorRawHistos::processRunHeader(LCRunHeader* rdr) {
 }
 
 void EUTelProcessorRawHistos::processEvent (LCEvent* event) {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	if( event == nullptr ) {
 		streamlog_out ( WARNING2 ) <<  "Event does not exist! Skipping!" <<  std::endl;       
 		return;
 	}
 
 	if( _iEvt == 0 ) {
-		try 
-		{
-			auto noisyPixelCollection = static_cast< LCCollectionVec*>( event->getCollection(_noisyPixCollectionName) );
-			initialiseNoisyPixels( noisyPixelCollection );		
-		} catch (...) {
+		//loaded once per job and shared by all processors using the collection
+		_noisyPixelMask = EUTelNoisyPixelMask::getShared( event, _noisyPixCollectionName );
+		if( _noisyPixelMask == nullptr ) {
 			if (!_noisyPixCollectionName.empty())
 			{
 				streamlog_out( WARNING1 ) << "_noisyPixCollectionName " << _noisyPixCollectionName << " not found" << endl;
@@ -196,9 +159,7 @@ void EUTelProcessorRawHistos::processEvent (LCEvent* event) {
 				
 				int xCo = genericPixel->getXCoord(); 
 				int yCo = genericPixel->getYCoord();
-				int encoded = cantorEncode(xCo, yCo);
-
-				if (_treatNoise) isNoisy = std::binary_search(_noisyPixelVecMap.at(sensorID).begin(), _noisyPixelVecMap.at(sensorID).end(), encoded );
+				if (_treatNoise) isNoisy = _noisyPixelMask->isNoisy(sensorID, xCo, yCo);
 
 
 				rawHitsPerPlane[sensorID]++;
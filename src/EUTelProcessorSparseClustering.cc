@@ -12,6 +12,7 @@
 
 //eutelescope includes
 #include "EUTelProcessorSparseClustering.h"
+#include "EUTelInstrumentation.h"
 
 #include "EUTELESCOPE.h"
 #include "EUTelExceptions.h"
@@ -208,6 +209,7 @@ void EUTelProcessorSparseClustering::readCollections(LCEvent* event)
 
 void EUTelProcessorSparseClustering::processEvent (LCEvent * event) 
 {
+	EUTelInstrumentation::Scope instrumentationScope( this, event );
 	//increment event counter
 	++_iEvt;
 
@@ -5,6 +5,7 @@
  * 3) Now pass the track from this processor to EUTelTrackAnalysis via a function as shown in processEvent below.
  * 4)You now have the trackand histogram. Do the analysis and output to that histogram or anyone oyu want.   */
 #include "EUTelProcessorTrackAnalysis.h"
+#include "EUTelInstrumentation.h"
 
 using namespace eutelescope;
 
@@ -40,6 +41,7 @@ void EUTelProcessorTrackAnalysis::init(){
 }
 
 void EUTelProcessorTrackAnalysis::processEvent(LCEvent * evt){
+	EUTelInstrumentation::Scope instrumentationScope( this, evt );
 	try{
 		EUTelEventImpl * event = static_cast<EUTelEventImpl*> (evt); ///We change the class so we can use EUTelescope functions
 
@@ -51,18 +53,19 @@ void EUTelProcessorTrackAnalysis::processEvent(LCEvent * evt){
 		}
         streamlog_out(DEBUG2) << "Collection contains data! Continue!" << std::endl;
         EUTelReaderGenericLCIO reader = EUTelReaderGenericLCIO();
-        std::vector<EUTelTrack> tracks = reader.getTracks(evt, _trackInputCollectionName);
-        for (size_t iTrack = 0; iTrack < tracks.size(); ++iTrack){
-            EUTelTrack track = tracks.at(iTrack); 
+        reader.getTracks(evt, _trackInputCollectionName, _tracks);
+        _analysis->calculatePValuesForChi2(_tracks, _pValues);
+        for (size_t iTrack = 0; iTrack < _tracks.size(); ++iTrack){
+            const EUTelTrack& track = _tracks.at(iTrack); 
             _analysis->plotResidualVsPosition(track);	
             _analysis->plotIncidenceAngles(track);
             if(track.getChi2()/track.getNdf() < 5.0){
                 _analysis->plotBeamEnergy(track);
-                _analysis->plotPValueVsBeamEnergy(track);
+                _analysis->plotPValueVsBeamEnergy(track, _pValues.at(iTrack));
             }
 
-            _analysis->plotPValueWithPosition(track);
-            _analysis->plotPValueWithIncidenceAngles(track);
+            _analysis->plotPValueWithPosition(track, _pValues.at(iTrack));
+            _analysis->plotPValueWithIncidenceAngles(track, _pValues.at(iTrack));
         }
 
 	}catch(...){	
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelMatrixDecoder.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
 #include "EUTelBaseSparsePixel.h"
 #include "EUTelGenericSparsePixel.h"
@@ -103,6 +104,7 @@ void EUTelRawDataSparsifier::processRunHeader (LCRunHeader * rdr) {
 
 
 void EUTelRawDataSparsifier::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
 
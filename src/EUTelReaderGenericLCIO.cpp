@@ -1,123 +1,267 @@
 #include "EUTelReaderGenericLCIO.h"
+#include "EUTelExceptions.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
 using namespace eutelescope;
 
-EUTelReaderGenericLCIO::EUTelReaderGenericLCIO(){
-} 
-void EUTelReaderGenericLCIO::getColVec(std::vector<EUTelTrack> tracks,LCEvent* evt ,std::string colName ){
-    streamlog_out(DEBUG1)<<"CREATE GENERIC CONTAINER..." <<std::endl;
+EUTelPackedTracks::EUTelPackedTracks():
+_record(NULL),
+_intOffsets(),
+_floatOffsets()
+{}
+
+EUTelPackedTracks::EUTelPackedTracks(const EVENT::LCGenericObject* record):
+_record(record),
+_intOffsets(),
+_floatOffsets()
+{
+    const int nInt = _record->getNInt();
+    if(nInt < 2 || _record->getIntVal(0) != VERSION){
+        std::stringstream ss;
+        ss << "Unsupported packed track record version " << (nInt > 0 ? _record->getIntVal(0) : -1);
+        throw IncompatibleDataSetException(ss.str());
+    }
+    const int nTracks = _record->getIntVal(1);
+    _intOffsets.reserve(nTracks);
+    _floatOffsets.reserve(nTracks);
+    //Only the structure is scanned here, the values are decoded in getTrack.
+    int iInt = 2;
+    int iFloat = 0;
+    for(int i = 0; i < nTracks; i++){
+        if(iInt >= nInt){
+            throw IncompatibleDataSetException("Truncated packed track record");
+        }
+        _intOffsets.push_back(iInt);
+        _floatOffsets.push_back(iFloat);
+        const int nStates = _record->getIntVal(iInt++);
+        iFloat += NTRACKFLOATS;
+        for(int j = 0; j < nStates; j++){
+            if(iInt + NSTATEINTS > nInt){
+                throw IncompatibleDataSetException("Truncated packed track record");
+            }
+            iFloat += NSTATEFLOATS;
+            if(_record->getIntVal(iInt + 2) != 0) iFloat += NHITFLOATS;
+            iInt += NSTATEINTS;
+        }
+    }
+    if(iFloat > _record->getNFloat()){
+        throw IncompatibleDataSetException("Truncated packed track record");
+    }
+}
+
+int EUTelPackedTracks::getNStates(size_t i) const {
+    return _record->getIntVal(_intOffsets.at(i));
+}
+
+EUTelTrack EUTelPackedTracks::getTrack(size_t i) const {
+    EUTelTrack track;
+    getTrack(i, track);
+    return track;
+}
+
+void EUTelPackedTracks::getTrack(size_t i, EUTelTrack& track) const {
+    int iInt = _intOffsets.at(i);
+    int iFloat = _floatOffsets.at(i);
+    const int nStates = _record->getIntVal(iInt++);
+
+    track.clear();
+    track.setChi2(_record->getFloatVal(iFloat));
+    track.setNdf(_record->getFloatVal(iFloat + 1));
+    track.setTotalVariance(_record->getFloatVal(iFloat + 2));
+    iFloat += NTRACKFLOATS;
+    std::vector<EUTelState>& states = track.getStates();
+    states.resize(nStates);
+
+    for(int j = 0; j < nStates; j++){
+        EUTelState& state = states[j];
+        state = EUTelState();
+        state.setLocation(_record->getIntVal(iInt));
+        state.setDimensionSize(_record->getIntVal(iInt + 1));
+        const bool hasHit = _record->getIntVal(iInt + 2) != 0;
+        const int hitID = _record->getIntVal(iInt + 3);
+        iInt += NSTATEINTS;
 
-    LCCollectionVec* colTrackVec = new LCCollectionVec(LCIO::LCGENERICOBJECT);
-    LCCollectionVec* colStateVec = new LCCollectionVec(LCIO::LCGENERICOBJECT);
-    LCCollectionVec* colHitVec = new LCCollectionVec(LCIO::LCGENERICOBJECT);
-    LCCollectionVec* relTrackStateVec = new LCCollectionVec(LCIO::LCRELATION);
-    LCCollectionVec* relStateHitVec = new LCCollectionVec(LCIO::LCRELATION);
+        state.setMomLocalX(_record->getFloatVal(iFloat));
+        state.setMomLocalY(_record->getFloatVal(iFloat + 1));
+        state.setMomLocalZ(_record->getFloatVal(iFloat + 2));
+        state.setArcLengthToNextState(_record->getFloatVal(iFloat + 3));
+        float pos[3] = {_record->getFloatVal(iFloat + 4), _record->getFloatVal(iFloat + 5), _record->getFloatVal(iFloat + 6)};
+        state.setPositionLocal(pos);
+        state.setKinks(_record->getFloatVal(iFloat + 7), _record->getFloatVal(iFloat + 8));
+        state.setRadFrac(_record->getFloatVal(iFloat + 10), _record->getFloatVal(iFloat + 9));
+        state.setKinksMedium1(_record->getFloatVal(iFloat + 11), _record->getFloatVal(iFloat + 12));
+        state.setKinksMedium2(_record->getFloatVal(iFloat + 13), _record->getFloatVal(iFloat + 14));
+        iFloat += NSTATEFLOATS;
+
+        if(hasHit){
+            EUTelHit hit;
+            hit.setID(hitID);
+            const double hitPos[3] = {_record->getFloatVal(iFloat), _record->getFloatVal(iFloat + 1), _record->getFloatVal(iFloat + 2)};
+            hit.setPosition(hitPos);
+            state.setHit(hit);
+            iFloat += NHITFLOATS;
+        }
+    }
+}
 
+EUTelReaderGenericLCIO::EUTelReaderGenericLCIO(){
+}
+void EUTelReaderGenericLCIO::getColVec(const std::vector<EUTelTrack>& tracks,LCEvent* evt ,std::string colName ){
+    streamlog_out(DEBUG1)<<"CREATE PACKED TRACK RECORD..." <<std::endl;
 
+    //Count first so the record is allocated once.
+    int nInt = 2;
+    int nFloat = 0;
     for(size_t i=0 ; i < tracks.size(); i++){
-        IMPL::LCGenericObjectImpl* conTrack = new  IMPL::LCGenericObjectImpl();  
-        //Save everything as double and down cast later.
-        for(size_t j=0; j < tracks.at(i).getLCIOOutput().size(); j++){
-            streamlog_out(DEBUG1)<<"Fill number: " << j << " Value " << tracks.at(i).getLCIOOutput().at(j) <<std::endl;
-            conTrack->setDoubleVal (j, tracks.at(i).getLCIOOutput().at(j));
+        const std::vector<EUTelState>& states = tracks[i].getStates();
+        nInt += 1 + EUTelPackedTracks::NSTATEINTS*states.size();
+        nFloat += EUTelPackedTracks::NTRACKFLOATS;
+        for(size_t j=0 ; j < states.size(); j++){
+            nFloat += EUTelPackedTracks::NSTATEFLOATS;
+            if(states[j].getStateHasHit()) nFloat += EUTelPackedTracks::NHITFLOATS;
         }
-        streamlog_out(DEBUG1)<<"Fill all track information...        Double number: "<< conTrack->getNDouble()  <<std::endl;
-        colTrackVec->push_back(static_cast<EVENT::LCGenericObject*>(conTrack));
-        streamlog_out(DEBUG1)<<"Tracks filled" <<std::endl;
-        std::vector<EUTelState> states = tracks.at(i).getStates();
+    }
+
+    IMPL::LCGenericObjectImpl* record = new IMPL::LCGenericObjectImpl(nInt, nFloat, 0);
+    int iInt = 0;
+    int iFloat = 0;
+    record->setIntVal(iInt++, EUTelPackedTracks::VERSION);
+    record->setIntVal(iInt++, static_cast<int>(tracks.size()));
+    for(size_t i=0 ; i < tracks.size(); i++){
+        const EUTelTrack& track = tracks[i];
+        const std::vector<EUTelState>& states = track.getStates();
+        record->setIntVal(iInt++, static_cast<int>(states.size()));
+        record->setFloatVal(iFloat++, track.getChi2());
+        record->setFloatVal(iFloat++, track.getNdf());
+        record->setFloatVal(iFloat++, track.getTotalVariance());
         for(size_t j=0 ; j < states.size(); j++){
-            streamlog_out(DEBUG1)<<"Fill all state information " << " state location " << states.at(j).getLocation() <<std::endl;
-            IMPL::LCGenericObjectImpl* conState = new  IMPL::LCGenericObjectImpl();  
-            streamlog_out(DEBUG1)<<"Empty state container created" <<std::endl;
-            for(size_t k=0 ; k < states.at(j).getLCIOOutput().size(); k++){
-                streamlog_out(DEBUG1)<<"Fill number: " << k << " Value " << tracks.at(i).getStates().at(j).getLCIOOutput().at(k) <<std::endl;
-                conState->setDoubleVal (k,states.at(j).getLCIOOutput().at(k));
-            }
-            IMPL::LCRelationImpl *relTrackState = new IMPL::LCRelationImpl(conTrack,conState); 
-            colStateVec->push_back(static_cast<EVENT::LCGenericObject*>(conState));
-            relTrackStateVec->push_back(static_cast<EVENT::LCRelation*>(relTrackState));
-            if(states.at(j).getStateHasHit()){
-                IMPL::LCGenericObjectImpl* conHit = new  IMPL::LCGenericObjectImpl();  
-                for(size_t k=0 ; k < states.at(j).getHit().getLCIOOutput().size(); k++){
-                    conHit->setDoubleVal (k, states.at(j).getHit().getLCIOOutput().at(k));
-                }
-                IMPL::LCRelationImpl *relStateHit = new IMPL::LCRelationImpl(conState,conHit); 
-                colHitVec->push_back(static_cast<EVENT::LCGenericObject*>(conHit));
-                relStateHitVec->push_back(static_cast<EVENT::LCRelation*>(relStateHit));
+            const EUTelState& state = states[j];
+            streamlog_out(DEBUG1)<<"Fill all state information " << " state location " << state.getLocation() <<std::endl;
+            record->setIntVal(iInt++, state.getLocation());
+            record->setIntVal(iInt++, state.getDimensionSize());
+            record->setIntVal(iInt++, state.getStateHasHit() ? 1 : 0);
+            record->setIntVal(iInt++, state.getStateHasHit() ? state._hit.getID() : -1);
 
-            }
+            record->setFloatVal(iFloat++, state.getMomLocalX());
+            record->setFloatVal(iFloat++, state.getMomLocalY());
+            record->setFloatVal(iFloat++, state.getMomLocalZ());
+            record->setFloatVal(iFloat++, state.getArcLengthToNextState());
+            record->setFloatVal(iFloat++, state.getPosition()[0]);
+            record->setFloatVal(iFloat++, state.getPosition()[1]);
+            record->setFloatVal(iFloat++, state.getPosition()[2]);
+            record->setFloatVal(iFloat++, state.getKink(0));
+            record->setFloatVal(iFloat++, state.getKink(1));
+            record->setFloatVal(iFloat++, state.getRadFracAir());
+            record->setFloatVal(iFloat++, state.getRadFracSensor());
+            record->setFloatVal(iFloat++, state.getKinkMedium1(0));
+            record->setFloatVal(iFloat++, state.getKinkMedium1(1));
+            record->setFloatVal(iFloat++, state.getKinkMedium2(0));
+            record->setFloatVal(iFloat++, state.getKinkMedium2(1));
 
+            if(state.getStateHasHit()){
+                record->setFloatVal(iFloat++, state._hit.getPosition()[0]);
+                record->setFloatVal(iFloat++, state._hit.getPosition()[1]);
+                record->setFloatVal(iFloat++, state._hit.getPosition()[2]);
+            }
         }
     }
+
+    LCCollectionVec* colRecordVec = new LCCollectionVec(LCIO::LCGENERICOBJECT);
+    colRecordVec->push_back(static_cast<EVENT::LCGenericObject*>(record));
     streamlog_out(DEBUG1)<<"Add collection to event!" <<std::endl;
-    evt->addCollection(colTrackVec,"TrackFOR" + colName   );
-    evt->addCollection(colStateVec,"StatesFOR" + colName);
-    evt->addCollection(colHitVec,"HitsFOR" + colName);
-    evt->addCollection(relTrackStateVec,"TrackStateFOR" + colName);
-    evt->addCollection(relStateHitVec,"StateHitFOR" + colName);
+    evt->addCollection(colRecordVec,"PackedTracksFOR" + colName);
+}
 
-} 
+EUTelPackedTracks EUTelReaderGenericLCIO::getPackedTracks( LCEvent* evt, std::string colName){
+    const std::vector<std::string>* names = evt->getCollectionNames();
+    if(std::find(names->begin(), names->end(), "PackedTracksFOR" + colName) == names->end()){
+        return EUTelPackedTracks();
+    }
+    LCCollection* col = evt->getCollection("PackedTracksFOR" + colName);
+    if(col->getNumberOfElements() == 0){
+        return EUTelPackedTracks();
+    }
+    return EUTelPackedTracks(static_cast<EVENT::LCGenericObject*>(col->getElementAt(0)));
+}
 
 std::vector<EUTelTrack> EUTelReaderGenericLCIO::getTracks( LCEvent* evt, std::string colName){
-    std::vector<EUTelTrack> tracks; 
+    std::vector<EUTelTrack> tracks;
+    getTracks(evt, colName, tracks);
+    return tracks;
+}
+
+void EUTelReaderGenericLCIO::getTracks( LCEvent* evt, std::string colName, std::vector<EUTelTrack>& tracks){
+    const std::vector<std::string>* names = evt->getCollectionNames();
+    if(std::find(names->begin(), names->end(), "PackedTracksFOR" + colName) == names->end()){
+        //Files written before the packed record was introduced.
+        tracks = getTracksFromGenericObjects(evt, colName);
+        return;
+    }
+    EUTelPackedTracks packed = getPackedTracks(evt, colName);
+    //Shrinking keeps the capacity of the remaining tracks.
+    tracks.resize(packed.size());
+    for(size_t i = 0; i < packed.size(); i++){
+        packed.getTrack(i, tracks[i]);
+    }
+    streamlog_out(DEBUG1)<<"Return "<< tracks.size() <<" tracks" <<std::endl;
+}
+
+std::vector<EUTelTrack> EUTelReaderGenericLCIO::getTracksFromGenericObjects( LCEvent* evt, std::string colName){
+    std::vector<EUTelTrack> tracks;
     streamlog_out(DEBUG1)<<"Open Collections... " <<std::endl;
 
     LCCollection* relTrackStates =  evt->getCollection("TrackStateFOR"+ colName);
     LCCollection* relStatesHits =  evt->getCollection("StateHitFOR"+ colName);
     streamlog_out(DEBUG1)<<"Open!" <<std::endl;
 
-    std::vector<int> trackIDVec;
-    //Loop a link between tracks->states. //Remember multiple tracks for each collection 
+    //Hit of every state, by state ID.
+    std::map<int, EVENT::LCGenericObject*> hitOfState;
+    for (int kCol = 0; kCol < relStatesHits->getNumberOfElements(); kCol++) {
+        EVENT::LCRelation* relStateHit = static_cast<EVENT::LCRelation*>(relStatesHits->getElementAt(kCol));
+        hitOfState[relStateHit->getFrom()->id()] = static_cast<EVENT::LCGenericObject*>(relStateHit->getTo());
+    }
+
+    //Loop a link between tracks->states. //Remember multiple tracks for each collection
+    std::map<int, size_t> trackIndex;
     for (int iCol = 0; iCol < relTrackStates->getNumberOfElements(); iCol++) {//Loop through each track->state link
         EVENT::LCRelation* relTrackState = static_cast<EVENT::LCRelation*>(relTrackStates->getElementAt(iCol));
-        EVENT::LCGenericObject* track  =  static_cast<EVENT::LCGenericObject*>(relTrackState->getFrom());
-        int trackID = track->id();
-        if(std::find(trackIDVec.begin(), trackIDVec.end(), trackID) == trackIDVec.end()){//This is a list of tracks already created
-            //If track is new enter here.
-            trackIDVec.push_back(trackID);
+        EVENT::LCGenericObject* trackObject  =  static_cast<EVENT::LCGenericObject*>(relTrackState->getFrom());
+        EVENT::LCGenericObject* stateObject  =  static_cast<EVENT::LCGenericObject*>(relTrackState->getTo());
+
+        std::map<int, size_t>::iterator itTrack = trackIndex.find(trackObject->id());
+        if(itTrack == trackIndex.end()){//If track is new enter here.
             std::vector<double> trackInput;
-            for(int i =0 ; i < track->getNDouble(); i++){
-                trackInput.push_back(track->getDoubleVal(i)); 
+            for(int i =0 ; i < trackObject->getNDouble(); i++){
+                trackInput.push_back(trackObject->getDoubleVal(i));
             }
             EUTelTrack track;
             track.setTrackFromLCIOVec(trackInput);
-            for (int jCol = 0; jCol < relTrackStates->getNumberOfElements(); jCol++) {//Loop through track->state look for state linked to that track
-                EVENT::LCRelation* relTrackState = static_cast<EVENT::LCRelation*>(relTrackStates->getElementAt(jCol));
-                EVENT::LCGenericObject* state  =  static_cast<EVENT::LCGenericObject*>(relTrackState->getTo());
-                EVENT::LCGenericObject* trackCheck  =  static_cast<EVENT::LCGenericObject*>(relTrackState->getFrom());
-                if(trackCheck->id() == trackID){//If this is true then the state must be part of this track.
-                    int stateID = state->id();
-                    std::vector<double> stateInput;
-                    for(int i =0 ; i < state->getNDouble(); i++){
-                        stateInput.push_back(state->getDoubleVal(i)); 
-                    }
-                    EUTelState state;
-                    state.setTrackFromLCIOVec(stateInput);
-                    for (int kCol = 0; kCol < relStatesHits->getNumberOfElements(); kCol++) {//Loop through all state->hit link
-                        EVENT::LCRelation* relStateHit = static_cast<EVENT::LCRelation*>(relStatesHits->getElementAt(kCol));
-                        EVENT::LCGenericObject* stateCheck  =  static_cast<EVENT::LCGenericObject*>(relStateHit->getFrom());
-                        EVENT::LCGenericObject* hit  =  static_cast<EVENT::LCGenericObject*>(relStateHit->getTo());
-                        if(stateCheck->id() == stateID){//If this is true then you have the correct hit.
-                            streamlog_out(DEBUG1)<<"Found correct ID. Add hit now..." <<std::endl;
-                            std::vector<double> hitInput;
-                            for(int i =0 ; i < hit->getNDouble(); i++){
-                                hitInput.push_back(hit->getDoubleVal(i)); 
-                            }
-                            EUTelHit hit;
-                            hit.setTrackFromLCIOVec(hitInput);
-                            state.setHit(hit);
-                            streamlog_out(DEBUG1)<<"Hit added." <<std::endl;
-
-                        }
-                    }
-                    track.setState(state);
-                }
-            }
+            itTrack = trackIndex.insert(std::make_pair(trackObject->id(), tracks.size())).first;
             tracks.push_back(track);
         }
+
+        std::vector<double> stateInput;
+        for(int i =0 ; i < stateObject->getNDouble(); i++){
+            stateInput.push_back(stateObject->getDoubleVal(i));
+        }
+        EUTelState state;
+        state.setTrackFromLCIOVec(stateInput);
+        std::map<int, EVENT::LCGenericObject*>::const_iterator itHit = hitOfState.find(stateObject->id());
+        if(itHit != hitOfState.end()){
+            streamlog_out(DEBUG1)<<"Found correct ID. Add hit now..." <<std::endl;
+            std::vector<double> hitInput;
+            for(int i =0 ; i < itHit->second->getNDouble(); i++){
+                hitInput.push_back(itHit->second->getDoubleVal(i));
+            }
+            EUTelHit hit;
+            hit.setTrackFromLCIOVec(hitInput);
+            state.setHit(hit);
+        }
+        tracks[itTrack->second].setState(state);
     }
     streamlog_out(DEBUG1)<<"Return "<< tracks.size() <<" tracks" <<std::endl;
     return tracks;
 }
-
-
-
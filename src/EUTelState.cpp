@@ -2,30 +2,31 @@
 #include "EUTelNav.h"
 
 using namespace eutelescope;
-EUTelState::EUTelState()
+EUTelState::EUTelState():
+_hit(),
+_dimension(0),
+_location(0),
+_stateHasHit(false),
+_momLocalX(0),
+_momLocalY(0),
+_momLocalZ(0),
+_radFracSensor(0),
+_radFracAir(0),
+_arcLength(0)
 {
-     _kinks.ResizeTo(2);
-    _kinks[0]=0;
-    _kinks[1]=0;
-    _kinksMedium1.ResizeTo(2);
-    _kinksMedium1[0]=0;
-    _kinksMedium1[1]=0;
-    _kinksMedium2.ResizeTo(2);
-    _kinksMedium2[0]=0;
-    _kinksMedium2[1]=0;
-
-
-    _stateHasHit = false;
+    _position[0] = _position[1] = _position[2] = 0;
+    _kinks[0] = _kinks[1] = 0;
+    _kinksMedium1[0] = _kinksMedium1[1] = 0;
+    _kinksMedium2[0] = _kinksMedium2[1] = 0;
+    _covCombinedMatrix[0] = _covCombinedMatrix[1] = _covCombinedMatrix[2] = _covCombinedMatrix[3] = 0;
 } 
 
-EUTelState::EUTelState(EUTelState *state){
-     _kinks.ResizeTo(2);
-     _kinks = state->getKinks();
-    _kinksMedium1.ResizeTo(2);
-    _kinksMedium1 = state->getKinksMedium1();
-    _kinksMedium2.ResizeTo(2);
-    _kinksMedium2 = state->getKinksMedium2();
-    _stateHasHit = false;
+EUTelState::EUTelState(EUTelState *state):
+EUTelState()
+{
+    setKinks(state->getKink(0), state->getKink(1));
+    setKinksMedium1(state->getKinkMedium1(0), state->getKinkMedium1(1));
+    setKinksMedium2(state->getKinkMedium2(0), state->getKinkMedium2(1));
 	setDimensionSize(state->getDimensionSize());
     setArcLengthToNextState(state->getArcLengthToNextState());
 	setLocation(state->getLocation());  
@@ -48,7 +49,7 @@ double EUTelState::getRadFracSensor() const {
     return _radFracSensor;
 }
 
-EUTelHit EUTelState::getHit(){
+const EUTelHit& EUTelState::getHit() const {
 	return _hit;
 }
 int EUTelState::getDimensionSize() const {
@@ -68,7 +69,7 @@ TVector3 EUTelState::getPositionGlobal() const {
 	TVector3 posGlobalVec(posGlobal[0],posGlobal[1],posGlobal[2]);
 	return posGlobalVec;
 }
-TVectorD EUTelState::getStateVec(){ 
+TVectorD EUTelState::getStateVec() const { 
 	streamlog_out( DEBUG1 ) << "EUTelState::getTrackStateVec()------------------------BEGIN" << std::endl;
 	TVectorD stateVec(5);
 	stateVec[0] = -1.0/getMomLocal().Mag();
@@ -84,7 +85,7 @@ TVectorD EUTelState::getStateVec(){
 	streamlog_out( DEBUG1 ) << "EUTelState::getTrackStateVec()------------------------END" << std::endl;
  	return stateVec;
 }
-TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame(){
+TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame() const {
 	streamlog_out( DEBUG1 ) << "EUTelState::getScatteringVarianceInLocalFrame(Sensor)----------------------------BEGIN" << std::endl;
 	streamlog_out(DEBUG1) << "Variance (Sensor):  " << std::scientific << getRadFracSensor() << "  Plane: " << getLocation()  << std::endl;
 	if(getRadFracSensor() == 0){
@@ -105,7 +106,7 @@ TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame(){
 	streamlog_out( DEBUG1 ) << "EUTelState::getScatteringVarianceInLocalFrame(Sensor)----------------------------END" << std::endl;
 	return precisionMatrix;
 }
-TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame(float  variance){
+TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame(float  variance) const {
 	streamlog_out( DEBUG1 ) << "EUTelState::getScatteringVarianceInLocalFrame(Scatter)----------------------------BEGIN" << std::endl;
 	streamlog_out(DEBUG5)<<"Variance (AIR Fraction): " <<std::scientific  <<  variance <<std::endl; 
 	float scatPrecision = 1.0 /variance;
@@ -163,23 +164,23 @@ TMatrixD EUTelState::getProjectionMatrix() const {
 	projection.SetSub(3, 3, proM2l);
 	return proM2l;
 }
-TVector3 EUTelState::getMomLocal(){
+TVector3 EUTelState::getMomLocal() const {
 	TVector3 pVecUnitLocal;
 	pVecUnitLocal[0] = getMomLocalX(); 	pVecUnitLocal[1] = getMomLocalY(); 	pVecUnitLocal[2] = getMomLocalZ(); 
 	return pVecUnitLocal;
 }
 TVectorD EUTelState::getKinks() const {
-	return _kinks;
+	return TVectorD(2, _kinks);
 }
 TVectorD EUTelState::getKinksMedium1() const {
-	return _kinksMedium1;
+	return TVectorD(2, _kinksMedium1);
 }
 TVectorD EUTelState::getKinksMedium2() const {
-	return _kinksMedium2;
+	return TVectorD(2, _kinksMedium2);
 }
 
 //setters
-void EUTelState::setHit(EUTelHit hit){
+void EUTelState::setHit(const EUTelHit& hit){
     _stateHasHit=true;
     _hit = hit;
 }
@@ -211,14 +212,26 @@ void EUTelState::setMomLocalZ(float momZ){
 }
 //This variable is the RESIDUAL (Measurements - Prediction) of the kink angle. 
 //Our measurement is assumed 0 in all cases.
-void EUTelState::setKinks(TVectorD kinks){
-    _kinks = kinks;
+void EUTelState::setKinks(const TVectorD& kinks){
+    setKinks(kinks[0], kinks[1]);
+}
+void EUTelState::setKinksMedium1(const TVectorD& kinks){
+    setKinksMedium1(kinks[0], kinks[1]);
+}
+void EUTelState::setKinksMedium2(const TVectorD& kinks){
+    setKinksMedium2(kinks[0], kinks[1]);
+}
+void EUTelState::setKinks(double kinkX, double kinkY){
+    _kinks[0] = kinkX;
+    _kinks[1] = kinkY;
 }
-void EUTelState::setKinksMedium1(TVectorD kinks){
-    _kinksMedium1 = kinks;
+void EUTelState::setKinksMedium1(double kinkX, double kinkY){
+    _kinksMedium1[0] = kinkX;
+    _kinksMedium1[1] = kinkY;
 }
-void EUTelState::setKinksMedium2(TVectorD kinks){
-    _kinksMedium2 = kinks;
+void EUTelState::setKinksMedium2(double kinkX, double kinkY){
+    _kinksMedium2[0] = kinkX;
+    _kinksMedium2[1] = kinkY;
 }
 
 void EUTelState::setPositionGlobal(float positionGlobal[]){
@@ -232,7 +245,7 @@ void EUTelState::setPositionGlobal(float positionGlobal[]){
 
 
 }
-void EUTelState::setLocalMomentumGlobalMomentum(TVector3 momentumIn){
+void EUTelState::setLocalMomentumGlobalMomentum(const TVector3& momentumIn){
 	//Now calculate the momentum in LOCAL coordinates.
 	const double momentum[]	= {momentumIn[0], momentumIn[1],momentumIn[2]};//Need this since geometry works with const doubles not floats 
 	double localMomentum [3];
@@ -251,7 +264,7 @@ void EUTelState::setCombinedHitAndStateCovMatrixInLocalFrame(double cov[4]){
 	_covCombinedMatrix[3] = cov[3];
 }
 
-void EUTelState::setStateUsingCorrection(TVectorD corrections){
+void EUTelState::setStateUsingCorrection(const TVectorD& corrections){
 	double referencePoint[] = { getPosition()[0]+corrections[3],getPosition()[1]+corrections[4],0};
 	setPositionLocal(referencePoint);
     float charge = -1.0;
@@ -362,7 +375,7 @@ float EUTelState::computeRadLengthsToEnd( std::map<const int,double> & mapSensor
 
 
 //print
-void EUTelState::print(){
+void EUTelState::print() const {
 	streamlog_out(DEBUG1)<< std::scientific << "STATE VECTOR:" << std::endl;
 	streamlog_out(DEBUG1)<< std::scientific <<"State memory location "<< this << " The location  " <<getLocation() <<" Distance to next state: " <<getArcLengthToNextState() <<std::endl;
 	streamlog_out(DEBUG1)<< std::scientific <<"(Radiation fraction of full system)*(track Variance)    Plane: "<< getRadFracSensor() <<" Air:  " <<getRadFracAir() <<std::endl;
@@ -400,18 +413,18 @@ void EUTelState::clear(){
 }
 
 //Overload operators.
-bool EUTelState::operator<(const EUTelState compareState ) const {
+bool EUTelState::operator<(const EUTelState& compareState ) const {
 	return getPosition()[2]<compareState.getPosition()[2];
 }
 
-bool EUTelState::operator==(const EUTelState compareState ) const {
+bool EUTelState::operator==(const EUTelState& compareState ) const {
 	if(getLocation() == compareState.getLocation() and 	getPosition()[0] == compareState.getPosition()[0] and	getPosition()[1] == compareState.getPosition()[1] and 	getPosition()[2] == compareState.getPosition()[2]){
 		return true;
 	}else{
 		return false;
 	}
 }
-bool EUTelState::operator!=(const EUTelState compareState ) const {
+bool EUTelState::operator!=(const EUTelState& compareState ) const {
 	if(getLocation() == compareState.getLocation() and 	getPosition()[0] == compareState.getPosition()[0] and	getPosition()[1] == compareState.getPosition()[1] and 	getPosition()[2] == compareState.getPosition()[2]){
 		return false;
 	}else{
@@ -436,20 +449,20 @@ std::vector<double> EUTelState::getLCIOOutput(){
     }else{
         output.push_back(0);
     }
-    output.push_back(getKinks()[0]);
-    output.push_back(getKinks()[1]);
+    output.push_back(getKink(0));
+    output.push_back(getKink(1));
     output.push_back(getRadFracAir());
     output.push_back(getRadFracSensor());
 		//	TMatrixDSym getStateCov() const;
-    output.push_back(getKinksMedium1()[0]);
-    output.push_back(getKinksMedium1()[1]);
-    output.push_back(getKinksMedium2()[0]);
-    output.push_back(getKinksMedium2()[1]);
+    output.push_back(getKinkMedium1(0));
+    output.push_back(getKinkMedium1(1));
+    output.push_back(getKinkMedium2(0));
+    output.push_back(getKinkMedium2(1));
 
     return output;
 
 }
-void EUTelState::setTrackFromLCIOVec(std::vector<double> input){
+void EUTelState::setTrackFromLCIOVec(const std::vector<double>& input){
     setDimensionSize(input.at(0));
     setLocation(input.at(1));
     setMomLocalX(input.at(2));
@@ -458,18 +471,9 @@ void EUTelState::setTrackFromLCIOVec(std::vector<double> input){
     setArcLengthToNextState(input.at(5)); 
     double pos[3] = {input.at(6),input.at(7),input.at(8)};
     setPositionLocal(pos);
-    TVectorD kinks(2);
-    kinks[0] = input.at(10);
-    kinks[1] = input.at(11);
-    setKinks(kinks);
+    setKinks(input.at(10), input.at(11));
     setRadFrac(input.at(13), input.at(12));
-    TVectorD kinksMedium1(2);
-    kinksMedium1[0] = input.at(14);
-    kinksMedium1[1] = input.at(15);
-    setKinksMedium1(kinksMedium1);
-    TVectorD kinksMedium2(2);
-    kinksMedium2[0] = input.at(16);
-    kinksMedium2[1] = input.at(17);
-    setKinksMedium2(kinksMedium2);
+    setKinksMedium1(input.at(14), input.at(15));
+    setKinksMedium2(input.at(16), input.at(17));
 
 }
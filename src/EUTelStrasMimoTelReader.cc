@@ -31,6 +31,12 @@
 // #include <UTIL/LCTOOLS.h>
 
 // system includes 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdlib>
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -41,6 +47,69 @@ using namespace std;
 using namespace marlin;
 using namespace eutelescope;
 
+namespace {
+
+  //! Read only memory map of a whole file
+  class MappedFile {
+
+  public:
+    MappedFile() : _data(NULL), _size(0) { }
+
+    ~MappedFile() {
+      if ( _data != NULL ) munmap( const_cast<char *>( _data ), _size );
+    }
+
+    //! Maps the file, false if it cannot be opened
+    bool open(const string& fileName) {
+      int fd = ::open( fileName.c_str(), O_RDONLY );
+      if ( fd < 0 ) return false;
+
+      struct stat info;
+      if ( fstat( fd, &info ) != 0 ) {
+        close( fd );
+        return false;
+      }
+      _size = info.st_size;
+
+      if ( _size > 0 ) {
+        void * address = mmap( NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( address == MAP_FAILED ) {
+          close( fd );
+          return false;
+        }
+        _data = static_cast<const char *>( address );
+        // the records are read once from the beginning to the end
+        madvise( address, _size, MADV_SEQUENTIAL );
+      }
+      close( fd );
+      return true;
+    }
+
+    const char * data() const { return _data; }
+    size_t size() const { return _size; }
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char * _data;
+    size_t _size;
+  };
+
+  //! CDS of the pixels begin ... end-1
+  /*! Each word holds frame 0 in the bits 0-11 and frame 1 in the bits
+   *  12-23, the CDS is sign * ( frame 1 - frame 0 ).
+   */
+  void decodeCDS(const int * words, size_t begin, size_t end, short sign, short * cds) {
+    for ( size_t iPixel = begin; iPixel < end; ++iPixel ) {
+      const short f0 = static_cast<short>( words[iPixel] & 0xFFF );
+      const short f1 = static_cast<short>( ( words[iPixel] >> 12 ) & 0xFFF );
+      cds[iPixel] = static_cast<short>( sign * ( f1 - f0 ) );
+    }
+  }
+
+}
+
 string EUTelStrasMimoTelReader::_dataFileBaseName   = "RUN_";
 const string EUTelStrasMimoTelReader::_fileNameExt  = ".rz" ;
 int EUTelStrasMimoTelReader::_noOfSubMatrix =   1;
@@ -72,6 +141,9 @@ EUTelStrasMimoTelReader::EUTelStrasMimoTelReader ():DataSourceProcessor  ("EUTel
   registerOutputCollection(LCIO::TRACKERRAWDATA, "CDSCollectionName",
 			   "Name of the CDS collection",
 			   _cdsCollectionName, string( "cds" ));
+
+  registerOptionalParameter("WriteFrames","Also write the frame 0 and frame 1 collections",
+			    _writeFrames, static_cast<bool> ( false ) );
   
 }
 
@@ -143,10 +215,24 @@ void EUTelStrasMimoTelReader::readDataSource (int numEvents) {
   }
   
   int nFile = _runHeader.TotEvNb / _runHeader.FileEvNb;
-  _dataBuffer   = new int[_runHeader.DataSz / sizeof(int) ];
   int matrixSize   = _noOfXPixel * _noOfYPixel;
-  
-  for ( int iFile = 0; iFile < nFile; iFile++  ) {
+  int nDetector    = _runHeader.VFasPresentNb + 1;
+
+  // each record is made by the event header, the data block and the
+  // event trailer
+  const size_t recordSize = sizeof(StrasEventHeader) + _runHeader.DataSz + sizeof(StrasEventTrailer);
+
+  // this is  because the first matrix contains only rubbish! 
+  const size_t offset = matrixSize;
+  if ( offset + static_cast< size_t >( nDetector ) * matrixSize > _runHeader.DataSz / sizeof(int) ) {
+    message<ERROR5> ( log() << "The data block of " << _runHeader.DataSz << " bytes is too small for "
+                      << nDetector << " detectors. Exiting." );
+    addEORE();
+    exit(-1);
+  }
+
+  bool isFinished = false;
+  for ( int iFile = 0; iFile < nFile && !isFinished; iFile++  ) {
     
     string dataFileName;
     { 
@@ -155,150 +241,140 @@ void EUTelStrasMimoTelReader::readDataSource (int numEvents) {
       dataFileName = ss.str();
     }
     
-    ifstream dataFile;
-    dataFile.exceptions (ifstream::failbit | ifstream::badbit );
-    
-    // try to open the data file
-    try {
-      
-      message<DEBUG5> ( log() << "Opening file " << dataFileName );
-      dataFile.open( dataFileName.c_str(), ios::in | ios::binary );
-      
-      while ( !dataFile.eof() ) {
-	if ( (eventCounter % 10 == 0 ) )
-	  message<MESSAGE5> ( log() << "Converting event " << eventCounter << " (File = " << iFile << ")" );
-	    
-	// get the full record
-	dataFile.read( reinterpret_cast<char *> (&_eventHeader), sizeof(StrasEventHeader) );
-	dataFile.read( reinterpret_cast<char *> (_dataBuffer), _runHeader.DataSz  );
-	dataFile.read( reinterpret_cast<char *> (&_eventTrailer), sizeof(StrasEventTrailer) );
-	
-	// make some checks
-	if ( static_cast< unsigned >(_eventTrailer.Eor) != 0x89ABCDEF ) {
-	  message<ERROR5> ( log() << "Event trailer not found on event " << _eventHeader.EvNo << ". Exiting ");
-	  exit(-1);
-	}
-	
-	if ( _eventHeader.EvNo != static_cast< unsigned >(eventCounter) ) {
-	  message<WARNING> ( log() << "Event number mismatch: expected " << eventCounter << " read " << _eventHeader.EvNo );
-	}
-
-	if ( _eventHeader.VFasCnt < 0 ) {
-	  // the trigger is not accepted. Skip the event
-	  message<WARNING> ( log() << "Trigger not accepted on event " << eventCounter ) ;
-	  
-	} else {
-
-	  EUTelEventImpl * event = new EUTelEventImpl;
-	  event->setRunNumber( _runNumber );
-	  event->setEventNumber( _eventHeader.EvNo );
-	  LCTime * now = new LCTime;
-	  event->setTimeStamp(now->timeStamp());
-	  delete now;
-	  event->setEventType( kDE );
-	  
-	  LCCollectionVec * cdsColl    = new LCCollectionVec( LCIO::TRACKERRAWDATA );
-	  LCCollectionVec * frame0Coll = new LCCollectionVec( LCIO::TRACKERRAWDATA );
-	  LCCollectionVec * frame1Coll = new LCCollectionVec( LCIO::TRACKERRAWDATA );
-	  CellIDEncoder< TrackerRawDataImpl > idEncoderCDS( EUTELESCOPE::MATRIXDEFAULTENCODING, cdsColl );
-	  idEncoderCDS["xMin"] = 0;
-	  idEncoderCDS["xMax"] = _noOfXPixel - 1;
-	  idEncoderCDS["yMin"] = 0;
-	  idEncoderCDS["yMax"] = _noOfYPixel - 1;
-	  CellIDEncoder< TrackerRawDataImpl > idEncoderFrame0( EUTELESCOPE::MATRIXDEFAULTENCODING, frame0Coll );
-	  idEncoderFrame0["xMin"] = 0;
-	  idEncoderFrame0["xMax"] = _noOfXPixel - 1;
-	  idEncoderFrame0["yMin"] = 0;
-	  idEncoderFrame0["yMax"] = _noOfYPixel - 1;
-	  CellIDEncoder< TrackerRawDataImpl > idEncoderFrame1( EUTELESCOPE::MATRIXDEFAULTENCODING, frame1Coll );
-	  idEncoderFrame1["xMin"] = 0;
-	  idEncoderFrame1["xMax"] = _noOfXPixel - 1;
-	  idEncoderFrame1["yMin"] = 0;
-	  idEncoderFrame1["yMax"] = _noOfYPixel - 1;
-	  
-	  // this is  because the first matrix contains only rubbish! 
-	  int offset = matrixSize ;
-	  unsigned int frame0Mask  = 0xFFF;
-	  unsigned int frame0Shift = 0;
-	  unsigned int frame1Mask  = 0xFFF000;
-	  unsigned int frame1Shift = 12;
-
-	  for ( int iDetector = 0; iDetector < _runHeader.VFasPresentNb + 1; iDetector++ ) {
-	    	    
-	    TrackerRawDataImpl * frame1 = new TrackerRawDataImpl;
-	    TrackerRawDataImpl * frame0 = new TrackerRawDataImpl;
-	    idEncoderFrame1["sensorID"] = iDetector;
-	    idEncoderFrame1.setCellID(frame1);
-	    idEncoderFrame0["sensorID"] = iDetector;
-	    idEncoderFrame0.setCellID(frame0);
-	    TrackerRawDataImpl * cds    = new TrackerRawDataImpl;
-	    idEncoderCDS["sensorID"] = iDetector;
-	    idEncoderCDS.setCellID(cds);
-	    
-	    int iPixel =  offset + iDetector * matrixSize;
-	    for ( int y = 0; y < _noOfYPixel; y++ ) {  
-	      for ( int x = 0; x < _noOfXPixel; x++ ) {
-		short f0 = static_cast<short>(( _dataBuffer[iPixel] & frame0Mask ) >> frame0Shift);
-		short f1 = static_cast<short>(( _dataBuffer[iPixel] & frame1Mask ) >> frame1Shift);
-		frame0->adcValues().push_back( f0 );
-		frame1->adcValues().push_back( f1 );
-		cds->adcValues().push_back( f1 - f0 );
-		++iPixel;
-	      }
-	    }
- 	    vector<short > cdsVec = cds->adcValues();
-	    vector<short >::iterator begin, end;
-
-	    //	    cout << iDetector << " before min = " << (*min_element(cdsVec.begin(), cdsVec.end())) 
-	    //		 << " max = " << (*max_element(cdsVec.begin(), cdsVec.end())) << endl;
-
- 	    // correct for the CDS sign
-	    if ( _eventHeader.VFasCnt < matrixSize ) {
-	      begin = cdsVec.begin() + _eventHeader.VFasCnt ;
-	      end   = cdsVec.end();
-	    } else { 
-	      begin = cdsVec.begin();
-	      end   = cdsVec.begin() + _eventHeader.VFasCnt %  matrixSize;
-	    }
-	    transform( begin, end, begin, negate<int>() );
-	    // 	    cout << iDetector << " after min = " << (*min_element(cdsVec.begin(), cdsVec.end())) 
-	    //		 << " max = " << (*max_element(cdsVec.begin(), cdsVec.end())) << endl;
-
-	    frame0Coll->push_back( frame0 ) ;
-	    frame1Coll->push_back( frame1 ) ;
-	    cdsColl->push_back( cds );
-	      
-	  }
-	  
-	  event->addCollection( frame0Coll, _frame0CollectionName );
-	  event->addCollection( frame1Coll, _frame1CollectionName );
-	  event->addCollection( cdsColl,    _cdsCollectionName    );
-	  
-	  ProcessorMgr::instance()->processEvent( event ) ;
-	  delete event;
-	  
-	}  
-	++eventCounter;
-	if ( eventCounter > numEvents ) {
-	  dataFile.close();
-	  break;
-	}
-	
+    // map the data file
+    message<DEBUG5> ( log() << "Opening file " << dataFileName );
+    MappedFile dataFile;
+    if ( !dataFile.open( dataFileName ) ) {
+      message<ERROR5> ( log() << "Unable to open file " << dataFileName << ". Exiting." );
+      addEORE();
+      exit(-1);
+    }
+
+    // an incomplete last record is ignored
+    for ( size_t position = 0; position + recordSize <= dataFile.size(); position += recordSize ) {
+      if ( (eventCounter % 10 == 0 ) )
+        message<MESSAGE5> ( log() << "Converting event " << eventCounter << " (File = " << iFile << ")" );
+
+      // get the full record
+      const char * record = dataFile.data() + position;
+      memcpy( &_eventHeader, record, sizeof(StrasEventHeader) );
+      memcpy( &_eventTrailer, record + sizeof(StrasEventHeader) + _runHeader.DataSz, sizeof(StrasEventTrailer) );
+      const int * dataBlock = reinterpret_cast<const int *> ( record + sizeof(StrasEventHeader) );
+
+      // make some checks
+      if ( static_cast< unsigned >(_eventTrailer.Eor) != 0x89ABCDEF ) {
+        message<ERROR5> ( log() << "Event trailer not found on event " << _eventHeader.EvNo << ". Exiting ");
+        exit(-1);
+      }
+
+      if ( _eventHeader.EvNo != static_cast< unsigned >(eventCounter) ) {
+        message<WARNING> ( log() << "Event number mismatch: expected " << eventCounter << " read " << _eventHeader.EvNo );
       }
-    } catch (ifstream::failure e) {
-      if ( !dataFile.eof() ) {
-	message<ERROR5> ( log() << "Unable to open file " << dataFileName << ". Exiting." );
-	addEORE();
-	exit(-1);
+
+      if ( _eventHeader.VFasCnt < 0 ) {
+        // the trigger is not accepted. Skip the event
+        message<WARNING> ( log() << "Trigger not accepted on event " << eventCounter ) ;
+
       } else {
-	dataFile.close();
-	message<DEBUG5> ( log() << "Closing file " << dataFileName ) ;
+
+        EUTelEventImpl * event = new EUTelEventImpl;
+        event->setRunNumber( _runNumber );
+        event->setEventNumber( _eventHeader.EvNo );
+        LCTime * now = new LCTime;
+        event->setTimeStamp(now->timeStamp());
+        delete now;
+        event->setEventType( kDE );
+
+        LCCollectionVec * cdsColl    = new LCCollectionVec( LCIO::TRACKERRAWDATA );
+        CellIDEncoder< TrackerRawDataImpl > idEncoderCDS( EUTELESCOPE::MATRIXDEFAULTENCODING, cdsColl );
+        idEncoderCDS["xMin"] = 0;
+        idEncoderCDS["xMax"] = _noOfXPixel - 1;
+        idEncoderCDS["yMin"] = 0;
+        idEncoderCDS["yMax"] = _noOfYPixel - 1;
+
+        // the CDS sign is inverted for the pixels read after the
+        // rolling shutter passed the trigger position
+        size_t negateBegin, negateEnd;
+        if ( _eventHeader.VFasCnt < matrixSize ) {
+          negateBegin = _eventHeader.VFasCnt;
+          negateEnd   = matrixSize;
+        } else {
+          negateBegin = 0;
+          negateEnd   = _eventHeader.VFasCnt % matrixSize;
+        }
+
+        for ( int iDetector = 0; iDetector < nDetector; iDetector++ ) {
+
+          TrackerRawDataImpl * cds    = new TrackerRawDataImpl;
+          idEncoderCDS["sensorID"] = iDetector;
+          idEncoderCDS.setCellID(cds);
+
+          const int * words = dataBlock + offset + iDetector * matrixSize;
+          ShortVec& cdsValues = cds->adcValues();
+          cdsValues.resize( matrixSize );
+          decodeCDS( words, 0, negateBegin, 1, &cdsValues[0] );
+          decodeCDS( words, negateBegin, negateEnd, -1, &cdsValues[0] );
+          decodeCDS( words, negateEnd, matrixSize, 1, &cdsValues[0] );
+
+          cdsColl->push_back( cds );
+        }
+        event->addCollection( cdsColl,    _cdsCollectionName    );
+
+        if ( _writeFrames ) {
+          LCCollectionVec * frame0Coll = new LCCollectionVec( LCIO::TRACKERRAWDATA );
+          LCCollectionVec * frame1Coll = new LCCollectionVec( LCIO::TRACKERRAWDATA );
+          CellIDEncoder< TrackerRawDataImpl > idEncoderFrame0( EUTELESCOPE::MATRIXDEFAULTENCODING, frame0Coll );
+          idEncoderFrame0["xMin"] = 0;
+          idEncoderFrame0["xMax"] = _noOfXPixel - 1;
+          idEncoderFrame0["yMin"] = 0;
+          idEncoderFrame0["yMax"] = _noOfYPixel - 1;
+          CellIDEncoder< TrackerRawDataImpl > idEncoderFrame1( EUTELESCOPE::MATRIXDEFAULTENCODING, frame1Coll );
+          idEncoderFrame1["xMin"] = 0;
+          idEncoderFrame1["xMax"] = _noOfXPixel - 1;
+          idEncoderFrame1["yMin"] = 0;
+          idEncoderFrame1["yMax"] = _noOfYPixel - 1;
+
+          for ( int iDetector = 0; iDetector < nDetector; iDetector++ ) {
+
+            TrackerRawDataImpl * frame1 = new TrackerRawDataImpl;
+            TrackerRawDataImpl * frame0 = new TrackerRawDataImpl;
+            idEncoderFrame1["sensorID"] = iDetector;
+            idEncoderFrame1.setCellID(frame1);
+            idEncoderFrame0["sensorID"] = iDetector;
+            idEncoderFrame0.setCellID(frame0);
+
+            const int * words = dataBlock + offset + iDetector * matrixSize;
+            ShortVec& frame0Values = frame0->adcValues();
+            ShortVec& frame1Values = frame1->adcValues();
+            frame0Values.resize( matrixSize );
+            frame1Values.resize( matrixSize );
+            for ( int iPixel = 0; iPixel < matrixSize; ++iPixel ) {
+              frame0Values[iPixel] = static_cast<short>( words[iPixel] & 0xFFF );
+              frame1Values[iPixel] = static_cast<short>( ( words[iPixel] >> 12 ) & 0xFFF );
+            }
+
+            frame0Coll->push_back( frame0 ) ;
+            frame1Coll->push_back( frame1 ) ;
+          }
+
+          event->addCollection( frame0Coll, _frame0CollectionName );
+          event->addCollection( frame1Coll, _frame1CollectionName );
+        }
+
+        ProcessorMgr::instance()->processEvent( event ) ;
+        delete event;
+
       }
-    } 
+      ++eventCounter;
+      // numEvents = 0 means all events of all files
+      if ( numEvents > 0 && eventCounter >= numEvents ) {
+        isFinished = true;
+        break;
+      }
+    }
+    message<DEBUG5> ( log() << "Closing file " << dataFileName ) ;
   }
   
-  delete [] _dataBuffer;
-  
   addEORE();
    
 }
@@ -13,6 +13,7 @@
 
 // eutelescope includes
 #include "EUTelTestFitter.h"
+#include "EUTelInstrumentation.h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
 #include "EUTelRunHeaderImpl.h"
@@ -721,6 +722,11 @@ void EUTelTestFitter::init() {
   _nominalFitArrayY = new double[arrayDim];
   _nominalErrorY = new double[_nTelPlanes];
 
+  _singleFitArrays.clear();
+  _gaussjPivot.resize(_nTelPlanes);
+  _gaussjRow.resize(_nTelPlanes);
+  _gaussjColumn.resize(_nTelPlanes);
+
   // Fill nominal fit matrices and
   // calculate expected precision of track fitting
 
@@ -876,6 +882,7 @@ void EUTelTestFitter::processRunHeader( LCRunHeader* runHeader) {
 }
 
 void EUTelTestFitter::processEvent( LCEvent * event ) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   _nEvt ++ ;
 
@@ -2456,27 +2463,39 @@ double EUTelTestFitter::MatrixFit()
 
 double EUTelTestFitter::SingleFit()
 {
+  const double * fitArray = GetSingleFitArray();
 
-  for(int ipl=0; ipl<_nTelPlanes;ipl++)
-    {
-      _fitX[ipl]=_planeX[ipl];
-      _fitEx[ipl]=_planeEx[ipl];
-    }
-
-  int status = DoAnalFit(_fitX,_fitEx,_beamSlopeX);
+  if(fitArray==NULL)return -1. ;
 
-  if(status)return -1. ;
+  // Same matrix used to solve equations in X and Y
 
-  // Use same matrix to solve equation in Y
+  const double * fitError = fitArray + _nTelPlanes*_nTelPlanes ;
 
   for(int ipl=0; ipl<_nTelPlanes;ipl++)
     {
-      _fitEy[ipl]=_fitEx[ipl];
+      _fitEx[ipl]=fitError[ipl];
+      _fitEy[ipl]=fitError[ipl];
 
+      _fitX[ipl]=0. ;
       _fitY[ipl]=0. ;
+
       for(int jpl=0; jpl<_nTelPlanes;jpl++)
-        if(_planeEy[jpl]>0.)
-          _fitY[ipl]+=_fitArray[ipl+jpl*_nTelPlanes]*_planeY[jpl]/_planeEy[jpl]/_planeEy[jpl];
+        if(_isActive[jpl] && _planeEx[jpl]>0.)
+          {
+            _fitX[ipl]+=fitArray[ipl+jpl*_nTelPlanes]*_planeX[jpl]/_planeEx[jpl]/_planeEx[jpl];
+            _fitY[ipl]+=fitArray[ipl+jpl*_nTelPlanes]*_planeY[jpl]/_planeEy[jpl]/_planeEy[jpl];
+          }
+
+      // Correction for beam slope (same in X and Y)
+
+      if(_useBeamConstraint && _beamSlopeX!=0.)
+        {
+          double correction = ( fitArray[ipl+_nTelPlanes] - fitArray[ipl] )
+            * _beamSlopeX*_planeDist[0]*_planeScat[0];
+
+          _fitX[ipl]+=correction;
+          _fitY[ipl]+=correction;
+        }
     }
 
   double chi2=GetFitChi2();
@@ -2484,6 +2503,47 @@ double EUTelTestFitter::SingleFit()
   return chi2 ;
 }
 
+const double * EUTelTestFitter::GetSingleFitArray()
+{
+  // Planes used in the fit; with nominal errors
+  // nothing else enters the fit matrix
+
+  const bool usePattern = _nTelPlanes <= 32 ;
+
+  unsigned int pattern = 0 ;
+
+  if(usePattern)
+    {
+      for(int ipl=0; ipl<_nTelPlanes;ipl++)
+        if(_isActive[ipl] && _planeEx[ipl]>0.)
+          pattern |= 1u << ipl ;
+
+      std::map<unsigned int, std::vector<double> >::const_iterator found = _singleFitArrays.find(pattern);
+
+      if(found != _singleFitArrays.end())
+        return &found->second[0] ;
+    }
+
+  // New pattern: invert the matrix with empty measurements
+
+  for(int ipl=0; ipl<_nTelPlanes;ipl++)
+    {
+      _fitX[ipl]=0. ;
+      _fitEx[ipl]=_planeEx[ipl];
+    }
+
+  int status = DoAnalFit(_fitX,_fitEx,0.);
+
+  if(status)return NULL ;
+
+  std::vector<double> & fitArray = usePattern ? _singleFitArrays[pattern] : _singleFitArrayBuffer ;
+
+  fitArray.assign(_fitArray, _fitArray + _nTelPlanes*_nTelPlanes);
+  fitArray.insert(fitArray.end(), _fitEx, _fitEx + _nTelPlanes);
+
+  return &fitArray[0] ;
+}
+
 double EUTelTestFitter::NominalFit()
 {
   for(int ipl=0; ipl<_nTelPlanes;ipl++)
@@ -2680,17 +2740,23 @@ double EUTelTestFitter::GetFitChi2()
 
 int EUTelTestFitter::GaussjSolve(double *alfa,double *beta,int n)
 {
-  int *ipiv;
-  int *indxr;
-  int *indxc;
   int i,j,k;
   int irow=0;
   int icol=0;
   double abs,big,help,pivinv;
 
-  ipiv = new int[n];
-  indxr = new int[n];
-  indxc = new int[n];
+  // Work space kept between calls
+
+  if(static_cast<int>(_gaussjPivot.size()) < n)
+    {
+      _gaussjPivot.resize(n);
+      _gaussjRow.resize(n);
+      _gaussjColumn.resize(n);
+    }
+
+  int *ipiv  = &_gaussjPivot[0];
+  int *indxr = &_gaussjRow[0];
+  int *indxc = &_gaussjColumn[0];
 
   for(i=0;i<n;i++)ipiv[i]=0;
 
@@ -2714,13 +2780,7 @@ int EUTelTestFitter::GaussjSolve(double *alfa,double *beta,int n)
         }
       ipiv[icol]++;
 
-      if(ipiv[icol]>1){
-	// first clean up then bail out
-	delete[] ipiv;
-	delete[] indxr;
-	delete[] indxc;
-        return 1;
-      }
+      if(ipiv[icol]>1)return 1;
 
       if(irow!=icol)
         {
@@ -2737,12 +2797,7 @@ int EUTelTestFitter::GaussjSolve(double *alfa,double *beta,int n)
       indxr[i]=irow;
       indxc[i]=icol;
 
-      if(alfa[n*icol+icol]==0.){
-	// first clean up then bail out
-	delete[] ipiv;
-	delete[] indxr;
-	delete[] indxc;
-        return 1;}
+      if(alfa[n*icol+icol]==0.)return 1;
 
       help=alfa[n*icol+icol];
       pivinv=1./help;
@@ -2773,10 +2828,6 @@ int EUTelTestFitter::GaussjSolve(double *alfa,double *beta,int n)
         }
     }
 
-  delete [] ipiv;
-  delete [] indxr;
-  delete [] indxc;
-
   return 0;
 }
 
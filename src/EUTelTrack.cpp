@@ -1,16 +1,41 @@
 #include "EUTelTrack.h"
+#include <utility>
 using namespace eutelescope;
-EUTelTrack::EUTelTrack(){
+EUTelTrack::EUTelTrack():
+_states(),
+_var(0),
+_chi2(0),
+_nDF(0)
+{
 } 
-EUTelTrack::EUTelTrack(const EUTelTrack& track){
-    _chi2=0;
-    _nDF=0;
-    _var=0;
-	setChi2(track.getChi2());
-	setNdf(track.getNdf());
-    setStates(track.getStatesCopy());
-    setTotalVariance(track.getTotalVariance());
-
+EUTelTrack::EUTelTrack(const EUTelTrack& track):
+_states(track._states),
+_var(track._var),
+_chi2(track._chi2),
+_nDF(track._nDF)
+{
+}
+EUTelTrack::EUTelTrack(EUTelTrack&& track):
+_states(std::move(track._states)),
+_var(track._var),
+_chi2(track._chi2),
+_nDF(track._nDF)
+{
+}
+EUTelTrack& EUTelTrack::operator=(const EUTelTrack& track){
+    //Assigning the vector reuses its memory if it is large enough.
+    _states = track._states;
+    _var = track._var;
+    _chi2 = track._chi2;
+    _nDF = track._nDF;
+    return *this;
+}
+EUTelTrack& EUTelTrack::operator=(EUTelTrack&& track){
+    _states = std::move(track._states);
+    _var = track._var;
+    _chi2 = track._chi2;
+    _nDF = track._nDF;
+    return *this;
 }
 EUTelTrack::EUTelTrack(const EUTelTrack& track, bool copyContents){
     _chi2=0;
@@ -33,6 +58,9 @@ float EUTelTrack::getNdf() const {
 std::vector<EUTelState>& EUTelTrack::getStates(){
 	return _states;
 }
+const std::vector<EUTelState>& EUTelTrack::getStates() const {
+	return _states;
+}
 std::vector<EUTelState> EUTelTrack::getStatesCopy() const {
 	return _states;
 }
@@ -50,9 +78,9 @@ unsigned int EUTelTrack::getNumberOfHitsOnTrack() const {
 	return numHits;
 }
 
-void EUTelTrack::print(){
+void EUTelTrack::print() const {
 	streamlog_out(DEBUG1) <<"TRACK==>"<< " Chi: "<<getChi2() <<" ndf: "<<getNdf() <<". Path total variance: " << _var << std::endl; 
-    std::vector<EUTelState> states = getStates();
+    const std::vector<EUTelState>& states = getStates();
 	streamlog_out(DEBUG1) <<"STATES:"<<std::endl;
 	for(unsigned int i=0; i < states.size(); ++i){
         states.at(i).print();
@@ -72,11 +100,20 @@ _var = rad;
 
 }
 
-void EUTelTrack::setState(EUTelState state){
+void EUTelTrack::setState(const EUTelState& state){
     _states.push_back(state);
 }
-void EUTelTrack::setStates(std::vector<EUTelState> states){
-    _states = std::vector<EUTelState>(states);
+void EUTelTrack::setStates(const std::vector<EUTelState>& states){
+    _states = states;
+}
+void EUTelTrack::setStates(std::vector<EUTelState>&& states){
+    _states = std::move(states);
+}
+void EUTelTrack::clear(){
+    _states.clear();
+    _var = 0;
+    _chi2 = 0;
+    _nDF = 0;
 }
 std::vector<double> EUTelTrack::getLCIOOutput(){
     std::vector<double> output;
@@ -87,7 +124,7 @@ std::vector<double> EUTelTrack::getLCIOOutput(){
 
 
 }
-void EUTelTrack::setTrackFromLCIOVec(std::vector<double> input){
+void EUTelTrack::setTrackFromLCIOVec(const std::vector<double>& input){
     setChi2(input.at(0));
     setNdf( input.at(1));
     setTotalVariance(input.at(2));
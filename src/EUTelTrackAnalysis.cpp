@@ -1,4 +1,5 @@
 #include "EUTelTrackAnalysis.h"
+#include "EUTelChi2PValue.h"
 using namespace eutelescope;
 EUTelTrackAnalysis::EUTelTrackAnalysis(std::map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramX, std::map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramY, std::map< int,   AIDA::IHistogram1D *> mapFromSensorIDToKinkXZ,std::map< int,   AIDA::IHistogram1D *> mapFromSensorIDToKinkYZ,  AIDA::IHistogram1D * beamEnergy){
 setSensorIDTo2DResidualHistogramX(mapFromSensorIDToHistogramX);
@@ -9,16 +10,16 @@ setBeamEnergy(beamEnergy);
 
 } 
 
-void EUTelTrackAnalysis::plotResidualVsPosition(EUTelTrack track){
+void EUTelTrackAnalysis::plotResidualVsPosition(const EUTelTrack& track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotResidualVsPosition------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 		if(!state.getStateHasHit()){
 			continue;
 		}
-		EUTelHit hit = state.getHit();	
+		const EUTelHit& hit = state.getHit();	
 		const float* statePosition = state.getPosition();
 		const double* hitPosition = hit.getPosition();
 		float residual[2];
@@ -48,33 +49,35 @@ void EUTelTrackAnalysis::plotResidualVsPosition(EUTelTrack track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotResidualVsPosition------------------------------END"<< std::endl;
 }
 
-void EUTelTrackAnalysis::plotBeamEnergy(EUTelTrack track){
+void EUTelTrackAnalysis::plotBeamEnergy(const EUTelTrack& track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotBeamEnergy------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
-	EUTelState state  = states.at(0);
+	const std::vector<EUTelState>& states = track.getStates();
+	const EUTelState& state  = states.at(0);
 	state.print();
 	float omega = -1.0/state.getMomLocal().Mag();	
 	_beamEnergy-> fill(-1.0/omega );
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotBeamEnergy------------------------------END"<< std::endl;
 }
-void EUTelTrackAnalysis::plotPValueVsBeamEnergy(EUTelTrack track){
+void EUTelTrackAnalysis::plotPValueVsBeamEnergy(const EUTelTrack& track){
+	plotPValueVsBeamEnergy(track, calculatePValueForChi2(track));
+}
+void EUTelTrackAnalysis::plotPValueVsBeamEnergy(const EUTelTrack& track, float pValue){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotPValueVsBeamEnergy------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
-	EUTelState state  = states.at(0);
+	const std::vector<EUTelState>& states = track.getStates();
+	const EUTelState& state  = states.at(0);
 	state.print();
 	float omega = -1.0/state.getMomLocal().Mag();	
-	float pValue = calculatePValueForChi2(track);
 	_pValueVsBeamEnergy->fill(-1.0/omega, pValue);
 
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotPValueVsBeamEnergy------------------------------END"<< std::endl;
 }
 
 
-void EUTelTrackAnalysis::plotIncidenceAngles(EUTelTrack track){
+void EUTelTrackAnalysis::plotIncidenceAngles(const EUTelTrack& track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotIncidenceAngles------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceXZ = stateVec[1];
@@ -88,7 +91,7 @@ void EUTelTrackAnalysis::plotIncidenceAngles(EUTelTrack track){
 		}
 	} 
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceYZ = stateVec[2];
@@ -103,12 +106,14 @@ void EUTelTrackAnalysis::plotIncidenceAngles(EUTelTrack track){
 	}
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotIncidenceAngles------------------------------END"<< std::endl;
 }
-void EUTelTrackAnalysis::plotPValueWithIncidenceAngles(EUTelTrack track){
+void EUTelTrackAnalysis::plotPValueWithIncidenceAngles(const EUTelTrack& track){
+	plotPValueWithIncidenceAngles(track, calculatePValueForChi2(track));
+}
+void EUTelTrackAnalysis::plotPValueWithIncidenceAngles(const EUTelTrack& track, float pValue){
 	streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotPValueWithIncidenceAngles------------------------------BEGIN"<< std::endl;
-	float pValue = calculatePValueForChi2(track);
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceXZ = stateVec[1];
@@ -122,7 +127,7 @@ void EUTelTrackAnalysis::plotPValueWithIncidenceAngles(EUTelTrack track){
 		}
 	} 
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceYZ = stateVec[2];
@@ -139,12 +144,14 @@ void EUTelTrackAnalysis::plotPValueWithIncidenceAngles(EUTelTrack track){
 }
 
 
-void EUTelTrackAnalysis::plotPValueWithPosition(EUTelTrack track){
+void EUTelTrackAnalysis::plotPValueWithPosition(const EUTelTrack& track){
+	plotPValueWithPosition(track, calculatePValueForChi2(track));
+}
+void EUTelTrackAnalysis::plotPValueWithPosition(const EUTelTrack& track, float pValue){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotPValueWithPosition------------------------------BEGIN"<< std::endl;
-	float pValue = calculatePValueForChi2(track);
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
+		const EUTelState& state  = states.at(i);
 		state.print();
 
 		const float* statePosition = state.getPosition();
@@ -160,10 +167,20 @@ void EUTelTrackAnalysis::plotPValueWithPosition(EUTelTrack track){
 	}
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotPValueWithPosition------------------------------END"<< std::endl;
 }
-float EUTelTrackAnalysis::calculatePValueForChi2(EUTelTrack track){
-//    boost::math::chi_squared mydist(track.getNdf());
-//    float pValue = 1 - boost::math::cdf(mydist,track.getChi2());
-    return 1.0;
+float EUTelTrackAnalysis::calculatePValueForChi2(const EUTelTrack& track){
+	return EUTelChi2PValue::getInstance()(track.getChi2(), track.getNdf());
+}
+
+void EUTelTrackAnalysis::calculatePValuesForChi2(const std::vector<EUTelTrack>& tracks, std::vector<float>& pValues){
+	std::vector<float> chi2(tracks.size()), ndf(tracks.size());
+	for(size_t i=0; i<tracks.size();++i){
+		chi2[i] = tracks[i].getChi2();
+		ndf[i] = tracks[i].getNdf();
+	}
+	pValues.resize(tracks.size());
+	if(!tracks.empty()){
+		EUTelChi2PValue::getInstance().evaluate(&chi2[0], &ndf[0], &pValues[0], tracks.size());
+	}
 }
 
 //FLOAT EUTelTrackAnalysis::calculatePValueForChi2(EUTelTrack track){
@@ -0,0 +1,425 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelTupleWriter.h"
+#include "EUTelExceptions.h"
+
+// marlin includes ".h"
+#include "streamlog/streamlog.h"
+
+// ROOT includes <>
+#include <RVersion.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+// system includes <>
+#include <sstream>
+
+namespace eutelescope {
+
+  namespace {
+    //! Number of full blocks which may wait for the writer thread
+    const size_t MAXQUEUEDBLOCKS = 4;
+
+    bool isVector( EUTelTupleWriter::ColumnType type ) {
+      return type == EUTelTupleWriter::kIntVector || type == EUTelTupleWriter::kDoubleVector;
+    }
+  }
+
+  EUTelTupleWriter::EUTelTupleWriter():
+    _trees(),
+    _current(),
+    _compression(-1),
+    _basketSize(0),
+    _rowsPerBlock(1000),
+    _async(true),
+    _isOpen(false),
+    _fileName(""),
+    _queue(),
+    _freeBlocks(),
+    _mutex(),
+    _queueChanged(),
+    _thread(),
+    _closing(false),
+    _error(),
+    _file(NULL),
+    _outputs()
+  {}
+
+  EUTelTupleWriter::~EUTelTupleWriter() {
+    try {
+      close();
+    } catch( std::exception& e ) {
+      streamlog_out( ERROR5 ) << "Error closing n-tuple file " << _fileName << ": " << e.what() << std::endl;
+    } catch( ... ) {
+      streamlog_out( ERROR5 ) << "Unknown error closing n-tuple file " << _fileName << std::endl;
+    }
+  }
+
+  size_t EUTelTupleWriter::bookTree( const std::string& name, const std::string& title ) {
+    if( _isOpen ) throw InvalidParameterException( "Cannot book tree " + name + " after the n-tuple file was opened" );
+    TreeSpec spec;
+    spec.name = name;
+    spec.title = title;
+    spec.nRows = 0;
+    _trees.push_back( spec );
+    return _trees.size() - 1;
+  }
+
+  size_t EUTelTupleWriter::bookColumn( size_t tree, const std::string& name, ColumnType type ) {
+    if( _isOpen ) throw InvalidParameterException( "Cannot book column " + name + " after the n-tuple file was opened" );
+    ColumnSpec spec;
+    spec.name = name;
+    spec.type = type;
+    _trees.at( tree ).columns.push_back( spec );
+    return _trees[tree].columns.size() - 1;
+  }
+
+  void EUTelTupleWriter::addFriend( size_t tree, size_t friendTree ) {
+    if( friendTree >= _trees.size() ) throw InvalidParameterException( "Unknown friend tree" );
+    _trees.at( tree ).friends.push_back( friendTree );
+  }
+
+  void EUTelTupleWriter::setOptions( int compression, int basketSize, size_t rowsPerBlock, bool async ) {
+    _compression = compression;
+    _basketSize = basketSize;
+    _rowsPerBlock = rowsPerBlock > 0 ? rowsPerBlock : 1;
+    _async = async;
+  }
+
+  void EUTelTupleWriter::open( const std::string& fileName ) {
+    if( _isOpen ) throw InvalidParameterException( "N-tuple file " + _fileName + " is already open" );
+
+    _fileName = fileName;
+    _current.clear();
+    _current.resize( _trees.size() );
+    for( size_t tree = 0; tree < _trees.size(); ++tree ) {
+      _current[tree].tree = tree;
+      _current[tree].nRows = 0;
+      _current[tree].columns.resize( _trees[tree].columns.size() );
+      _trees[tree].nRows = 0;
+    }
+    _closing = false;
+    _error = std::exception_ptr();
+    _isOpen = true;
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+    if( _async ) {
+      ROOT::EnableThreadSafety();
+      _thread = std::thread( &EUTelTupleWriter::writeLoop, this );
+      return;
+    }
+#else
+    if( _async ) {
+      streamlog_out( WARNING2 ) << "ROOT " << ROOT_RELEASE << " is not thread safe, writing " << fileName << " synchronously" << std::endl;
+      _async = false;
+    }
+#endif
+    openFile();
+  }
+
+  EUTelTupleWriter::ColumnData& EUTelTupleWriter::columnData( size_t tree, size_t column, ColumnType type ) {
+    rethrowError();
+    if( !_isOpen ) throw InvalidParameterException( "N-tuple file is not open" );
+    const ColumnSpec& spec = _trees.at( tree ).columns.at( column );
+    if( spec.type != type ) {
+      throw InvalidParameterException( "Wrong value type for n-tuple column " + spec.name );
+    }
+    return _current[tree].columns[column];
+  }
+
+  void EUTelTupleWriter::fill( size_t tree, size_t column, int value ) {
+    ColumnData& data = columnData( tree, column, kInt );
+    if( data.ints.size() > _current[tree].nRows ) data.ints.back() = value;
+    else data.ints.push_back( value );
+  }
+
+  void EUTelTupleWriter::fill( size_t tree, size_t column, long long value ) {
+    ColumnData& data = columnData( tree, column, kLong );
+    if( data.longs.size() > _current[tree].nRows ) data.longs.back() = value;
+    else data.longs.push_back( value );
+  }
+
+  void EUTelTupleWriter::fill( size_t tree, size_t column, double value ) {
+    ColumnData& data = columnData( tree, column, kDouble );
+    if( data.doubles.size() > _current[tree].nRows ) data.doubles.back() = value;
+    else data.doubles.push_back( value );
+  }
+
+  void EUTelTupleWriter::fill( size_t tree, size_t column, const std::vector<int>& values ) {
+    ColumnData& data = columnData( tree, column, kIntVector );
+    const size_t nRows = _current[tree].nRows;
+    data.offsets.resize( nRows );
+    data.ints.resize( nRows > 0 ? data.offsets.back() : 0 );
+    data.ints.insert( data.ints.end(), values.begin(), values.end() );
+    data.offsets.push_back( data.ints.size() );
+  }
+
+  void EUTelTupleWriter::fill( size_t tree, size_t column, const std::vector<double>& values ) {
+    ColumnData& data = columnData( tree, column, kDoubleVector );
+    const size_t nRows = _current[tree].nRows;
+    data.offsets.resize( nRows );
+    data.doubles.resize( nRows > 0 ? data.offsets.back() : 0 );
+    data.doubles.insert( data.doubles.end(), values.begin(), values.end() );
+    data.offsets.push_back( data.doubles.size() );
+  }
+
+  void EUTelTupleWriter::padRow( Block& block ) {
+    const std::vector<ColumnSpec>& columns = _trees[block.tree].columns;
+    for( size_t column = 0; column < columns.size(); ++column ) {
+      ColumnData& data = block.columns[column];
+      switch( columns[column].type ) {
+      case kInt:
+        if( data.ints.size() == block.nRows ) data.ints.push_back( 0 );
+        break;
+      case kLong:
+        if( data.longs.size() == block.nRows ) data.longs.push_back( 0 );
+        break;
+      case kDouble:
+        if( data.doubles.size() == block.nRows ) data.doubles.push_back( 0. );
+        break;
+      case kIntVector:
+        if( data.offsets.size() == block.nRows ) data.offsets.push_back( data.ints.size() );
+        break;
+      case kDoubleVector:
+        if( data.offsets.size() == block.nRows ) data.offsets.push_back( data.doubles.size() );
+        break;
+      }
+    }
+  }
+
+  void EUTelTupleWriter::addRow( size_t tree ) {
+    rethrowError();
+    if( !_isOpen ) throw InvalidParameterException( "N-tuple file is not open" );
+    Block& block = _current.at( tree );
+    padRow( block );
+    ++block.nRows;
+    ++_trees[tree].nRows;
+    if( block.nRows >= _rowsPerBlock ) submit( block );
+  }
+
+  unsigned long EUTelTupleWriter::getNRows( size_t tree ) const {
+    return _trees.at( tree ).nRows;
+  }
+
+  void EUTelTupleWriter::submit( Block& block ) {
+    const size_t tree = block.tree;
+
+    if( !_async ) {
+      writeBlock( block );
+    } else {
+      std::unique_lock<std::mutex> lock( _mutex );
+      _queueChanged.wait( lock, [this] { return _error || _queue.size() < MAXQUEUEDBLOCKS; } );
+      if( !_error ) {
+        _queue.push_back( std::move( block ) );
+        _queueChanged.notify_all();
+      }
+      if( !_freeBlocks.empty() ) {
+        block = std::move( _freeBlocks.back() );
+        _freeBlocks.pop_back();
+      }
+    }
+
+    //reset the block, keeping the memory of its arrays
+    block.tree = tree;
+    block.nRows = 0;
+    block.columns.resize( _trees[tree].columns.size() );
+    for( size_t column = 0; column < block.columns.size(); ++column ) {
+      block.columns[column].ints.clear();
+      block.columns[column].longs.clear();
+      block.columns[column].doubles.clear();
+      block.columns[column].offsets.clear();
+    }
+    rethrowError();
+  }
+
+  void EUTelTupleWriter::rethrowError() {
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      error = _error;
+    }
+    if( error ) std::rethrow_exception( error );
+  }
+
+  void EUTelTupleWriter::close() {
+    if( !_isOpen ) return;
+
+    //a failed flush must not keep the writer thread from being joined
+    //and the file from being closed, its error is rethrown afterwards
+    std::exception_ptr flushError;
+    for( size_t tree = 0; tree < _current.size() && !flushError; ++tree ) {
+      if( _current[tree].nRows == 0 ) continue;
+      try {
+        submit( _current[tree] );
+      } catch( ... ) {
+        flushError = std::current_exception();
+      }
+    }
+
+    if( _thread.joinable() ) {
+      {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _closing = true;
+        _queueChanged.notify_all();
+      }
+      _thread.join();
+    }
+    //no-op if the writer thread closed it, otherwise closes what was written before an error
+    closeFile();
+    _isOpen = false;
+    _freeBlocks.clear();
+    if( flushError ) std::rethrow_exception( flushError );
+    rethrowError();
+  }
+
+  void EUTelTupleWriter::writeLoop() {
+    try {
+      openFile();
+      while( true ) {
+        Block block;
+        {
+          std::unique_lock<std::mutex> lock( _mutex );
+          _queueChanged.wait( lock, [this] { return _closing || !_queue.empty(); } );
+          if( _queue.empty() ) break;
+          block = std::move( _queue.front() );
+          _queue.pop_front();
+          _queueChanged.notify_all();
+        }
+
+        writeBlock( block );
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        _freeBlocks.push_back( std::move( block ) );
+      }
+      closeFile();
+    } catch( ... ) {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _error = std::current_exception();
+      _queue.clear();
+      _queueChanged.notify_all();
+    }
+  }
+
+  void EUTelTupleWriter::openFile() {
+    TDirectory* previous = gDirectory;
+    _file = new TFile( _fileName.c_str(), "RECREATE" );
+    if( _file->IsZombie() ) {
+      delete _file;
+      _file = NULL;
+      if( previous ) previous->cd();
+      throw InvalidParameterException( "Unable to open n-tuple file " + _fileName );
+    }
+    if( _compression >= 0 ) _file->SetCompressionSettings( _compression );
+
+    _outputs.resize( _trees.size() );
+    for( size_t tree = 0; tree < _trees.size(); ++tree ) {
+      const TreeSpec& spec = _trees[tree];
+      TreeOutput& output = _outputs[tree];
+      output.tree = new TTree( spec.name.c_str(), spec.title.c_str() );
+      output.tree->SetAutoSave( 1000000000 );
+
+      //every column gets a slot in the buffer of its type, the slot
+      //vectors are sized first so the branch addresses stay valid
+      output.ints.assign( spec.columns.size(), 0 );
+      output.longs.assign( spec.columns.size(), 0 );
+      output.doubles.assign( spec.columns.size(), 0. );
+      output.intVectors.assign( spec.columns.size(), NULL );
+      output.doubleVectors.assign( spec.columns.size(), NULL );
+
+      for( size_t column = 0; column < spec.columns.size(); ++column ) {
+        const char* name = spec.columns[column].name.c_str();
+        switch( spec.columns[column].type ) {
+        case kInt:
+          output.tree->Branch( name, &output.ints[column], ( spec.columns[column].name + "/I" ).c_str() );
+          break;
+        case kLong:
+          output.tree->Branch( name, &output.longs[column], ( spec.columns[column].name + "/L" ).c_str() );
+          break;
+        case kDouble:
+          output.tree->Branch( name, &output.doubles[column], ( spec.columns[column].name + "/D" ).c_str() );
+          break;
+        case kIntVector:
+          output.intVectors[column] = new std::vector<int>();
+          output.tree->Branch( name, &output.intVectors[column] );
+          break;
+        case kDoubleVector:
+          output.doubleVectors[column] = new std::vector<double>();
+          output.tree->Branch( name, &output.doubleVectors[column] );
+          break;
+        }
+      }
+      if( _basketSize > 0 ) output.tree->SetBasketSize( "*", _basketSize );
+    }
+
+    for( size_t tree = 0; tree < _trees.size(); ++tree ) {
+      for( size_t i = 0; i < _trees[tree].friends.size(); ++i ) {
+        _outputs[tree].tree->AddFriend( _outputs[ _trees[tree].friends[i] ].tree );
+      }
+    }
+
+    if( previous ) previous->cd();
+  }
+
+  void EUTelTupleWriter::writeBlock( const Block& block ) {
+    const std::vector<ColumnSpec>& columns = _trees[block.tree].columns;
+    TreeOutput& output = _outputs[block.tree];
+
+    for( size_t row = 0; row < block.nRows; ++row ) {
+      for( size_t column = 0; column < columns.size(); ++column ) {
+        const ColumnData& data = block.columns[column];
+        size_t begin = 0;
+        if( isVector( columns[column].type ) && row > 0 ) begin = data.offsets[row - 1];
+
+        switch( columns[column].type ) {
+        case kInt:
+          output.ints[column] = data.ints[row];
+          break;
+        case kLong:
+          output.longs[column] = data.longs[row];
+          break;
+        case kDouble:
+          output.doubles[column] = data.doubles[row];
+          break;
+        case kIntVector:
+          output.intVectors[column]->assign( data.ints.begin() + begin, data.ints.begin() + data.offsets[row] );
+          break;
+        case kDoubleVector:
+          output.doubleVectors[column]->assign( data.doubles.begin() + begin, data.doubles.begin() + data.offsets[row] );
+          break;
+        }
+      }
+      output.tree->Fill();
+    }
+  }
+
+  void EUTelTupleWriter::closeFile() {
+    if( _file == NULL ) return;
+
+    TDirectory* previous = gDirectory == _file ? NULL : gDirectory;
+    _file->cd();
+    _file->Write();
+    _file->Close();
+    delete _file;
+    _file = NULL;
+    if( previous ) previous->cd();
+
+    for( size_t tree = 0; tree < _outputs.size(); ++tree ) {
+      for( size_t column = 0; column < _outputs[tree].intVectors.size(); ++column ) {
+        delete _outputs[tree].intVectors[column];
+        delete _outputs[tree].doubleVectors[column];
+      }
+    }
+    _outputs.clear();
+  }
+
+}
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelExceptions.h"
+#include "EUTelInstrumentation.h"
 #include "EUTelUpdatePedestalNoiseProcessor.h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
@@ -37,7 +38,8 @@
 #include <UTIL/CellIDDecoder.h>
 
 // system includes <>
-#include <cmath>
+#include <algorithm>
+#include <fstream>
 #include <memory>
 #include <cstdlib>
 
@@ -56,8 +58,14 @@ EUTelUpdatePedestalNoiseProcessor::EUTelUpdatePedestalNoiseProcessor ()
   _statusCollectionName(""),
   _updateAlgo(""),
   _monitoredPixel(),
+  _monitoredPixelIndex(),
   _monitoredPixelPedestal(),
   _monitoredPixelNoise(),
+  _monitorHistoryLength(0),
+  _driftMonitorRegions(0),
+  _driftMonitorFileName(""),
+  _updater(),
+  _driftMonitor(),
   _updateFrequency(0),
   _fixedWeight(0),
   _iRun(0),
@@ -106,6 +114,18 @@ EUTelUpdatePedestalNoiseProcessor::EUTelUpdatePedestalNoiseProcessor ()
                             "A pixel to be monitored (detectorID, xCoord, yCoord). Add as many line as this as you wish",
                             _monitoredPixel, monitorPixelExample );
 
+  registerOptionalParameter("MonitorHistoryLength",
+                            "Number of updates kept per monitored pixel and per drift monitoring region",
+                            _monitorHistoryLength, static_cast<int>(1000));
+
+  registerOptionalParameter("DriftMonitorRegions",
+                            "Number of regions (groups of rows) per sensor for the pedestal drift monitoring",
+                            _driftMonitorRegions, static_cast<int>(4));
+
+  registerOptionalParameter("DriftMonitorFileName",
+                            "Output file of the pedestal drift monitoring, empty for none",
+                            _driftMonitorFileName, string(""));
+
 }
 
 
@@ -118,6 +138,11 @@ void EUTelUpdatePedestalNoiseProcessor::init () {
     if ( _fixedWeight <= 0 ) {
       throw InvalidParameterException("FixedWeightValue has to be a positive integer number");
     }
+    _updater.setFixedWeight( _fixedWeight );
+  }
+
+  if ( _monitorHistoryLength <= 0 ) {
+    throw InvalidParameterException("MonitorHistoryLength has to be a positive integer number");
   }
 
   if ( _updateFrequency <= 0 ) {
@@ -130,8 +155,10 @@ void EUTelUpdatePedestalNoiseProcessor::init () {
   _iEvt = 0;
 
   // reset vectors
+  _monitoredPixelIndex.clear();
   _monitoredPixelPedestal.clear();
   _monitoredPixelNoise.clear();
+  _driftMonitor = EUTelPedestalDriftMonitor( max( _driftMonitorRegions, 1 ), _monitorHistoryLength );
 
 #ifdef MARLINDEBUG
   vector<int >::iterator iter = _monitoredPixel.begin();
@@ -161,6 +188,7 @@ void EUTelUpdatePedestalNoiseProcessor::processRunHeader (LCRunHeader * rdr ) {
 
 
 void EUTelUpdatePedestalNoiseProcessor::processEvent (LCEvent * event) {
+  EUTelInstrumentation::Scope instrumentationScope( this, event );
 
   EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
   if ( evt->getEventType() == kEORE ) {
@@ -180,6 +208,7 @@ void EUTelUpdatePedestalNoiseProcessor::processEvent (LCEvent * event) {
 
         LCCollectionVec * pedestalCollection = dynamic_cast < LCCollectionVec * > (evt->getCollection(_pedestalCollectionName));
         LCCollectionVec * noiseCollection    = dynamic_cast < LCCollectionVec * > (evt->getCollection(_noiseCollectionName));
+        CellIDDecoder<TrackerDataImpl> decoder(pedestalCollection);
 
         unsigned index = 0;
         while ( index < _monitoredPixel.size() ) {
@@ -187,27 +216,25 @@ void EUTelUpdatePedestalNoiseProcessor::processEvent (LCEvent * event) {
           int  xCoord    = _monitoredPixel[index++];
           int  yCoord    = _monitoredPixel[index++];
 
-          TrackerDataImpl * pedestal = dynamic_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
-          TrackerDataImpl * noise    = dynamic_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
+          TrackerDataImpl * pedestal = static_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
+          TrackerDataImpl * noise    = static_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
 
           // I need to find the pixel index, for this I need the number of pixels in the x directions.
-          CellIDDecoder<TrackerDataImpl> decoder(pedestalCollection);
           int xMin = decoder(pedestal)["xMin"];
           int xMax = decoder(pedestal)["xMax"];
           int yMin = decoder(pedestal)["yMin"];
           int noOfXPixel = abs( xMax - xMin ) + 1;
           if (noOfXPixel <= 0) throw InvalidParameterException("The number of pixels along has to be > 0");
           int pixelIndex = ( xCoord - xMin ) + ( yCoord - yMin ) * noOfXPixel;
+          _monitoredPixelIndex.push_back( make_pair( iDetector, pixelIndex ) );
 
           // initialize the pedestal monitor
-          FloatVec pedestalMonitor;
-          pedestalMonitor.push_back(pedestal->chargeValues()[pixelIndex]);
-          _monitoredPixelPedestal.push_back(pedestalMonitor);
+          _monitoredPixelPedestal.push_back( EUTelRingBuffer<float>( _monitorHistoryLength ) );
+          _monitoredPixelPedestal.back().push( pedestal->chargeValues()[pixelIndex] );
 
           // and now the noise one
-          FloatVec noiseMonitor;
-          noiseMonitor.push_back(noise->chargeValues()[pixelIndex]);
-          _monitoredPixelNoise.push_back(noiseMonitor);
+          _monitoredPixelNoise.push_back( EUTelRingBuffer<float>( _monitorHistoryLength ) );
+          _monitoredPixelNoise.back().push( noise->chargeValues()[pixelIndex] );
 
         }
 
@@ -239,28 +266,16 @@ void EUTelUpdatePedestalNoiseProcessor::pixelMonitoring(LCEvent * evt) {
     LCCollectionVec * pedestalCollection = dynamic_cast < LCCollectionVec * > (evt->getCollection(_pedestalCollectionName));
     LCCollectionVec * noiseCollection    = dynamic_cast < LCCollectionVec * > (evt->getCollection(_noiseCollectionName));
 
-    unsigned int index  = 0;
-    unsigned int iPixel = 0;
-    while (index < _monitoredPixel.size() ) {
-      int  iDetector = _monitoredPixel[index++];
-      int  xCoord    = _monitoredPixel[index++];
-      int  yCoord    = _monitoredPixel[index++];
+    // the pixel indices were computed on the first event
+    for ( size_t iPixel = 0; iPixel < _monitoredPixelIndex.size(); ++iPixel ) {
+      int iDetector  = _monitoredPixelIndex[iPixel].first;
+      int pixelIndex = _monitoredPixelIndex[iPixel].second;
 
-      TrackerDataImpl * pedestal = dynamic_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
-      TrackerDataImpl * noise    = dynamic_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
+      TrackerDataImpl * pedestal = static_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
+      TrackerDataImpl * noise    = static_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
 
-      // I need to find the pixel index, for this I need the number of pixels in the x directions.
-      CellIDDecoder<TrackerDataImpl> decoder(pedestalCollection);
-      int xMin = decoder(pedestal)["xMin"];
-      int xMax = decoder(pedestal)["xMax"];
-      int yMin = decoder(pedestal)["yMin"];
-      int noOfXPixel = abs( xMax - xMin ) + 1;
-      if (noOfXPixel <= 0) throw InvalidParameterException("The number of pixels along has to be > 0");
-      int pixelIndex = ( xCoord - xMin ) + ( yCoord - yMin ) * noOfXPixel;
-
-      _monitoredPixelPedestal[iPixel].push_back(pedestal->chargeValues()[pixelIndex]);
-      _monitoredPixelNoise[iPixel].push_back(noise->chargeValues()[pixelIndex]);
-      ++iPixel;
+      _monitoredPixelPedestal[iPixel].push(pedestal->chargeValues()[pixelIndex]);
+      _monitoredPixelNoise[iPixel].push(noise->chargeValues()[pixelIndex]);
     }
   } catch ( DataNotAvailableException& e) {
     message<WARNING> ( log() << "Collection not available in this event" );
@@ -283,23 +298,26 @@ void EUTelUpdatePedestalNoiseProcessor::fixedWeightUpdate(LCEvent * evt) {
 
     for (int i = 0; i < rawDataCollection->getNumberOfElements(); i++) {
 
-      TrackerRawDataImpl * rawData  = dynamic_cast < TrackerRawDataImpl * > (rawDataCollection->getElementAt(i));
+      // the element types are fixed by the registered collection types
+      TrackerRawDataImpl * rawData  = static_cast < TrackerRawDataImpl * > (rawDataCollection->getElementAt(i));
       int iDetector = static_cast<int > ( rawDataDecoder( rawData )["sensorID"] ) ;
 
+      TrackerRawDataImpl * status   = static_cast < TrackerRawDataImpl * > (statusCollection->getElementAt(iDetector));
+      TrackerDataImpl    * noise    = static_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
+      TrackerDataImpl    * pedestal = static_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
 
-      TrackerRawDataImpl * status   = dynamic_cast < TrackerRawDataImpl * > (statusCollection->getElementAt(iDetector));
-      TrackerDataImpl    * noise    = dynamic_cast < TrackerDataImpl * >    (noiseCollection->getElementAt(iDetector));
-      TrackerDataImpl    * pedestal = dynamic_cast < TrackerDataImpl * >    (pedestalCollection->getElementAt(iDetector));
+      const ShortVec& adcValues    = rawData->getADCValues();
+      const ShortVec& statusValues = status->adcValues();
+      FloatVec& pedestalValues     = pedestal->chargeValues();
+      FloatVec& noiseValues        = noise->chargeValues();
 
-      for (unsigned int iPixel = 0; iPixel < status->adcValues().size(); iPixel++) {
+      const size_t nPixel = min( min( adcValues.size(), statusValues.size() ),
+                                 min( pedestalValues.size(), noiseValues.size() ) );
+      if ( nPixel == 0 ) continue;
 
-        if ( status->adcValues()[iPixel] == EUTELESCOPE::GOODPIXEL ) {
-          pedestal->chargeValues()[iPixel] = ( (_fixedWeight - 1) * pedestal->chargeValues()[iPixel] +
-                                               rawData->getADCValues()[iPixel] ) / _fixedWeight;
-          noise->chargeValues()[iPixel]    = sqrt( ( (_fixedWeight - 1) * pow( noise->chargeValues()[iPixel], 2 ) +
-                                                     pow( rawData->getADCValues()[iPixel] - pedestal->chargeValues()[iPixel], 2) ) /
-                                                   _fixedWeight );
-        }
+      _updater.update( &adcValues[0], &statusValues[0], &pedestalValues[0], &noiseValues[0], nPixel );
+      if ( !_driftMonitorFileName.empty() ) {
+        _driftMonitor.fill( iDetector, _iEvt, &statusValues[0], &pedestalValues[0], &noiseValues[0], nPixel );
       }
     }
   }  catch ( DataNotAvailableException& e) {
@@ -318,6 +336,14 @@ void EUTelUpdatePedestalNoiseProcessor::fixedWeightUpdate(LCEvent * evt) {
 
 void EUTelUpdatePedestalNoiseProcessor::end() {
 
+  if ( !_driftMonitorFileName.empty() && _driftMonitor.getNSensors() > 0 ) {
+    ofstream driftFile( _driftMonitorFileName.c_str() );
+    _driftMonitor.write( driftFile );
+    if ( !driftFile ) {
+      streamlog_out( ERROR5 ) << "Cannot write the drift monitoring to " << _driftMonitorFileName << endl;
+    }
+  }
+
   if ( _monitoredPixelPedestal.size() == 0 ) {
     streamlog_out( ERROR5 ) <<  "The update procedure failed." << endl;
   } else {
@@ -349,7 +375,7 @@ void EUTelUpdatePedestalNoiseProcessor::end() {
       //    AIDA::IDataPointSet * noiseDPS =  AIDAProcessor::dataPointSetFactory(this)->create();
 
       message<DEBUG5> ( "Update results" );
-      for (unsigned int count = 0; count < _monitoredPixelPedestal[iPixel].size(); count++) {
+      for (size_t count = 0; count < _monitoredPixelPedestal[iPixel].size(); count++) {
         message<DEBUG5> ( log() << count << " " << _monitoredPixelPedestal[iPixel][count] << " " << _monitoredPixelNoise[iPixel][count] );
         //       pedestalDPS->addPoint();
         //       pedestalDPS->point(count)->coordinate(0)->setValue(_monitoredPixelPedestal[iPixel][count]);
@@ -48,6 +48,21 @@ namespace eutelescope {
 		}
 	}
 
+	unsigned int getSparsePixelNoOfElements(SparsePixelType type) {
+		switch( type ) {
+			case kEUTelSimpleSparsePixel:
+				return EUTelSimpleSparsePixel().getNoOfElements();
+			case kEUTelGenericSparsePixel:
+				return EUTelGenericSparsePixel().getNoOfElements();
+			case kEUTelGeometricPixel:
+				return EUTelGeometricPixel().getNoOfElements();
+			case kEUTelMuPixel:
+				return EUTelMuPixel().getNoOfElements();
+			default:
+				throw UnknownDataTypeException("Unknown sparsified pixel");
+		}
+	}
+
         /** This function will set the  
         * @param mat input with arbitrary precision
         * @param pre precision to set the new matrix to  */
@@ -1,4 +1,5 @@
 #include "EUTelUtilityPrintEventNumber.h"
+#include "EUTelInstrumentation.h"
 
 // C++
 #include <iostream>
@@ -76,6 +77,7 @@ void EUTelUtilityPrintEventNumber::processRunHeader( LCRunHeader* run) {
 } 
     
 void EUTelUtilityPrintEventNumber::processEvent( LCEvent * evt ) { 
+  EUTelInstrumentation::Scope instrumentationScope( this, evt );
 
   // The regular output in case verbosity MESSAGE is set:
   if ( evt->getEventNumber() <= 10 ||
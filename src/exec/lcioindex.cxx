@@ -0,0 +1,80 @@
+// eutelescope includes ""
+#include "anyoption.h"
+#include "EUTelEventIndex.h"
+
+// lcio includes <>
+#include <lcio.h>
+#include <Exceptions.h>
+
+//system includes <>
+#include <glob.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace eutelescope;
+
+int main( int argc, char ** argv ) {
+
+  auto_ptr< AnyOption > option( new AnyOption );
+
+  string usageString =
+    "\n"
+    "This program builds the event index of LCIO files. For each event the index\n"
+    "holds the run and event number, the event type, the position in the file and\n"
+    "the number of elements of the given collections. It is written next to the\n"
+    "data file as file.slcio.idx and used by the EUTelIndexedLCIOReader.\n"
+    "\n"
+    "lcioindex [option] file1.slcio [fileN.slcio]\n"
+    "\n"
+    "-h --help         Print this help\n"
+    "-c --collections  Comma separated list of collections to count\n";
+
+  option->addUsage( usageString.c_str() );
+  option->setFlag( "help", 'h' );
+  option->setOption( "collections", 'c' );
+
+  option->processCommandArgs( argc, argv );
+
+  if ( option->getFlag( 'h' ) || option->getFlag( "help" ) || option->getArgc() == 0 ) {
+    option->printUsage();
+    return 0;
+  }
+
+  vector< string > collections;
+  if ( option->getValue( "collections" ) != NULL ) {
+    stringstream ss( option->getValue( "collections" ) );
+    string name;
+    while ( getline( ss, name, ',' ) ) {
+      if ( !name.empty() ) collections.push_back( name );
+    }
+  }
+
+  // the input files may be using wildcards
+  glob_t globbuf;
+  for ( size_t iArg = 0 ; iArg < static_cast<size_t>(option->getArgc()); ++iArg ) {
+    if ( iArg == 0 ) glob( option->getArgv( iArg ), 0, NULL, &globbuf);
+    else  glob( option->getArgv( iArg ), GLOB_APPEND, NULL, &globbuf);
+  }
+
+  vector< string > inputFileNames( &globbuf.gl_pathv[0], &globbuf.gl_pathv[ globbuf.gl_pathc ] );
+  globfree( &globbuf );
+
+  int status = 0;
+  for ( size_t iFile = 0; iFile < inputFileNames.size(); ++iFile ) {
+    try {
+      EUTelEventIndex index;
+      index.build( inputFileNames[iFile], collections );
+      index.write( EUTelEventIndex::indexFileName( inputFileNames[iFile] ) );
+      cout << inputFileNames[iFile] << ": " << index.size() << " events" << endl;
+    } catch ( lcio::Exception& e ) {
+      cerr << inputFileNames[iFile] << ": " << e.what() << endl;
+      status = 1;
+    }
+  }
+
+  return status;
+}
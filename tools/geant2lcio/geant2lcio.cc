@@ -1,23 +1,40 @@
 // This test program reads GEANT simuation output from text file
 // and write it out in LCIO format
 //
-// Compile with: 
-//  g++ -o geant2lcio geant2lcio.cc -lgsl -lgslcblas -lm -llcio -lsio -lz
+// Compile with:
+//  g++ -std=c++11 -pthread -I../../include -o geant2lcio geant2lcio.cc -lgsl -lgslcblas -lm -llcio -lsio -lz
 //
 // after setting proper include path (for LCIO) and lib paths (for LCIO and GSL)
 //
 // A.F.Zarnecki   March 2007
 // updated January 2008 for use with new simulation results
 // (backside hits only in the ascii input file)
+//
+// Events are simulated in parallel: a reader thread reads the Geant
+// tracks of each event from the input file, worker threads apply the
+// beam spot, smearing, efficiency and noise and build the LCIO
+// event, and the events are written in order by a single writer.
+// The random numbers of each event are drawn from a generator seeded
+// with the event number, so the output does not depend on the number
+// of threads.
 
 // system includes
 
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
 #include <stdlib.h>
+#include <unistd.h>
 #include <math.h>
 
+// eutelescope includes
+
+#include "EUTelEventPipeline.h"
+
 // lcio includes
 
 #include "lcio.h"
@@ -34,468 +51,525 @@
 
 using namespace std;
 using namespace lcio;
+using eutelescope::EUTelEventPipeline;
 
-int main(int argc, char ** argv) {
-
-  // Input parameters are input and putput file names
-
-  if(argc<3){
-    cerr << "Parameters missing: [input file] [output file] {geometry file}"  << endl;
-    return -1;
-  }
-
-  // input, output and geometry file names
-
-  string inputFileName  = argv[1]; 
-  string outputFileName = argv[2];
-  string geometryFileName = (argc>3)?argv[3]:"geant2lcio.geom";
-
-  cerr << "Converting " << inputFileName.c_str()
-       << " to "        <<  outputFileName.c_str() <<  endl;
-
-  cerr << "Using geometry description from " << geometryFileName.c_str() <<  endl;
-
-  // Initialize input stream; exeption handling taken from AB
-
-  ifstream inputFile;
-  inputFile.exceptions(ifstream::failbit | ifstream::badbit);
-  
-  // open the input file
-  try {
-    inputFile.open(inputFileName.c_str(),ios::in);
-  }
-  catch (exception& e) {
-    cerr << "IO exception " << e.what() << " with " 
-	 << inputFileName << ".\nExiting." << endl;
-    return -1;
-  }
-  
-  // Open geometry description file
-
-  ifstream geometryFile;
-  geometryFile.open(geometryFileName.c_str(),ios::in);
-
+namespace {
 
-  // Now prepare the output slcio file.
-  
-  LCWriter * lcWriter = LCFactory::getInstance()->createLCWriter();
+  // Telescope description, read once from the geometry file and
+  // shared read-only by all workers
 
-  // open the file
-  try {
-    lcWriter->open(outputFileName.c_str(),LCIO::WRITE_NEW);
-  }
-  catch (IOException& e) {
-    cerr << e.what() << endl;
-    return -1;
-  }
+  struct Geometry {
+    int Ndet;
+    double pileup, noise, beamspot;
+    int ix, iy, iz;
+    vector<double> zdet, xmin, xmax, ymin, ymax, resol, effi;
+  };
 
-/* create GSL generator chosen by the 
-   environment variable GSL_RNG_TYPE */
+  // One Geant track: generated position on each plane, without beam spot
 
-  const gsl_rng_type * T;
-  gsl_rng * r;
+  struct GeantTrack {
+    vector<double> xgen, ygen, zgen;
+  };
 
-  gsl_rng_env_setup();
-  T = gsl_rng_default;
-  r = gsl_rng_alloc (T);
+  // Input of a worker: all (pileup) tracks of one output event
 
- // Prepare a run header
+  struct GeantEvent {
+    int eventNumber;
+    vector<GeantTrack> tracks;
+  };
 
-  int runNumber       = 1;
-  int eventNumber     = 0;
-  string detectorName = "Eutelescope";
-  string detectorDescription = "EUDET telescope, WN-WW configuration";
+  typedef unique_ptr<LCEventImpl> SimulatedEvent;
 
-  LCRunHeaderImpl * runHeader = new LCRunHeaderImpl();
-  runHeader->setRunNumber(runNumber);
-  runHeader->setDetectorName(detectorName);
-  runHeader->setDescription(detectorDescription);
-
-  // Read detector data from geometry description file
+  // Covariance matrix of the position
+  // (stored as lower triangle matrix, i.e.  cov(xx),cov(y,x),cov(y,y) ).
 
-  int Ndet,beamaxis,ix,iy,iz;
-  double pileup,noise,beamspot;
+  void setCovMatrix(TrackerHitImpl * meshit, const Geometry & geo, int idet) {
 
-  geometryFile >> Ndet >> pileup >> noise >> beamaxis >> beamspot ;
+    float cov[TRKHITNCOVMATRIX];
 
-// set axis directions for decoding input file
-// beamaxis = 1..3
+    cov[geo.ix+geo.ix*geo.ix]=geo.resol[idet]*geo.resol[idet];
+    cov[geo.iy+geo.iy*geo.iy]=geo.resol[idet]*geo.resol[idet];
+    cov[geo.iz+geo.iz*geo.iz]=0.;
 
-  iz=beamaxis-1;
-  ix=(iz+1)%3;
-  iy=(iz+2)%3;
+    cov[1]=cov[3]=cov[4]=0.;
 
-  cerr << "Telescope setup with " << Ndet << " layers" <<  endl;
+    meshit->setCovMatrix(cov);
+  }
 
-  double * zdet = new double[Ndet];
-  double * xmin = new double[Ndet];
-  double * xmax = new double[Ndet];
-  double * ymin = new double[Ndet];
-  double * ymax = new double[Ndet];
-  double * resol = new double[Ndet];
-  double * effi = new double[Ndet];
+  // Simulates the measurement of one event: beam spot, smearing,
+  // efficiency and noise
 
-  for(int idet=0; idet < Ndet; idet++)
-     {
-      string detName;
-      geometryFile >> zdet[idet] >> xmin[idet] >> xmax[idet] 
-                   >> ymin[idet] >> ymax[idet] >> resol[idet] >> effi[idet];
-      
-      // change resolution units to mm
+  void simulateEvent(const Geometry & geo, const string & detectorName, int runNumber,
+                     gsl_rng * r, const GeantEvent & input, SimulatedEvent & output) {
 
-      resol[idet]/=1000.;
+    const int Ndet = geo.Ndet;
 
-      std::getline(geometryFile,detName,'\n');
+    output.reset(new LCEventImpl());
+    LCEventImpl * event = output.get();
 
-     // Add plane names to run header
+    event->setDetectorName(detectorName);
+    event->setRunNumber(runNumber);
+    event->setEventNumber(input.eventNumber);
 
-      runHeader->addActiveSubdetector(detName);
-      }
+    // prepare a collection to store generated points
 
-  // Check subdetector list
+    LCCollectionVec     * simhitvec = new LCCollectionVec(LCIO::SIMTRACKERHIT);
 
-  const std::vector<std::string> * subDets = 
-                               runHeader->getActiveSubdetectors();
+    // prepare a collection to store measured points
 
-  Ndet = subDets->size();
+    LCCollectionVec     * meshitvec = new LCCollectionVec(LCIO::TRACKERHIT);
 
-  cerr << Ndet << " subdetectors defined :" << endl;
-  for(int idet=0;idet<Ndet;idet++)
-    cerr << idet+1 << " : " << subDets->at(idet) << endl;
+    // add hit collections to the event, so that they are deleted
+    // with it
 
-  // write the header to the output file
+    event->addCollection(simhitvec,"simhit");
+    event->addCollection(meshitvec,"meshit");
 
-  lcWriter->writeRunHeader(runHeader);
+    vector<double> xgen(Ndet), ygen(Ndet), zgen(Ndet);
+    vector<double> xmes(Ndet), ymes(Ndet), zmes(Ndet);
+    vector<bool> fired(Ndet);
 
-  // delete the run header since not used anymore
+    for(size_t ipile=0; ipile<input.tracks.size(); ipile++)
+      {
+      const GeantTrack & track = input.tracks[ipile];
 
-  delete runHeader;
+// Beam spot
 
+      double offset[3];
+      offset[0]=gsl_ran_gaussian(r,geo.beamspot);
+      offset[1]=gsl_ran_gaussian(r,geo.beamspot);
+      offset[2]=0.;
 
-// Input form Geant
+      for(int idet=0;idet<Ndet;idet++)
+        {
+        xgen[idet]=offset[0]+track.xgen[idet];
+        ygen[idet]=offset[1]+track.ygen[idet];
+        zgen[idet]=offset[2]+track.zgen[idet];
+        }
 
-//  int Nsub = 2*Ndet+2;  // front and back side for each sensor plane
-  
-  int Nsides = 1;            // back side only
-  int Nsub = Nsides*Ndet+2;   
-  double rawpos[3];
+// calculate measured points
 
-// Beamspot offset
+      for(int idet=0;idet<Ndet;idet++)
+        {
 
-  double offset[3]; 
+       // Apply Gaussian smearing
 
-// MC point tables:
+        xmes[idet]=xgen[idet]+gsl_ran_gaussian(r,geo.resol[idet]);
+        ymes[idet]=ygen[idet]+gsl_ran_gaussian(r,geo.resol[idet]);
+        zmes[idet]=zgen[idet];
 
-  double * xgen = new double[Ndet];
-  double * ygen = new double[Ndet];
-  double * zgen = new double[Ndet];
+        fired[idet]=true;
 
-// Measured points tables:
+        // check detector range
 
-  double * xmes = new double[Ndet];
-  double * ymes = new double[Ndet];
-  double * zmes = new double[Ndet];
-  bool  * fired = new bool[Ndet];
+        if(xmes[idet]<geo.xmin[idet] || xmes[idet]>geo.xmax[idet])fired[idet]=false;
+        if(ymes[idet]<geo.ymin[idet] || ymes[idet]>geo.ymax[idet])fired[idet]=false;
 
-// Event loop
+        // Detector efficiency
 
-  while ( true ) {
-    
+        if(gsl_rng_uniform(r)>geo.effi[idet])fired[idet]=false;
 
+        }
 
-    // Prepare event header and collections 
+// Add generated points to collection
 
-     eventNumber++;
+      for(int idet=0;idet<Ndet;idet++)
+        {
 
-        if (eventNumber%1000 == 0) 
-              cout << "Converting event number " << eventNumber << endl;
+    // Cell ID is just the plane number  ID=1...Ndet
 
-     LCEventImpl * event = new LCEventImpl();
+        SimTrackerHitImpl * simhit = new SimTrackerHitImpl;
+        simhit->setCellID(idet+1);
 
-        event->setDetectorName(detectorName);
+    // Get position, change axis according to the beam direction
 
-        event->setRunNumber(runNumber);
+        double pos[3];
 
-        event->setEventNumber(eventNumber);
+        pos[geo.ix]=xgen[idet];
+        pos[geo.iy]=ygen[idet];
+        pos[geo.iz]=zgen[idet];
 
+        simhit->setPosition(pos);
+        simhitvec->push_back(simhit);
+        }
 
-    // prepare a collection to store generated points 
+// Add measured points to collection
 
-    LCCollectionVec     * simhitvec = new LCCollectionVec(LCIO::SIMTRACKERHIT);
+      for(int idet=0;idet<Ndet;idet++)
+        {
 
-    // prepare a collection to store measured points
+       // take only valid hits:
 
-    LCCollectionVec     * meshitvec = new LCCollectionVec(LCIO::TRACKERHIT);
+        if(!fired[idet]) continue;
 
+       // Store plane number  as hit type:
 
-   // Loop over geant events to simulate pileup
+        TrackerHitImpl * meshit = new TrackerHitImpl;
+        meshit->setType(idet+1);
 
-   // Number of tracks to include
+      // store measured position
 
-    unsigned int npile=1;
+        double pos[3];
 
-    npile += gsl_ran_poisson(r,pileup);
+        pos[geo.ix]=xmes[idet];
+        pos[geo.iy]=ymes[idet];
+        pos[geo.iz]=zmes[idet];
 
-    for(int ipile=0; ipile<npile;ipile++)
-      {
-      int nread=0;
+        meshit->setPosition(pos);
+        setCovMatrix(meshit, geo, idet);
+        meshitvec->push_back(meshit);
+        }    // idet loop
 
-// Beam spot
+      }    // pileup event loop
 
-   offset[0]=gsl_ran_gaussian(r,beamspot);
-   offset[1]=gsl_ran_gaussian(r,beamspot);
-   offset[2]=0.;
 
-// Read one Geant event from file
+// Add noise:
 
     for(int idet=0;idet<Ndet;idet++)
-             {
-             xgen[idet]=offset[0];
-             ygen[idet]=offset[1];
-             zgen[idet]=offset[2];
-             }
-
-    try{ 
-      
-      for(int isub=0 ; isub <  Nsub ; isub++ )
         {
-// Geant4 input: beam along Z axis
-	  inputFile >> rawpos[2] >> rawpos[0] >> rawpos[1] ;
-
-// Input file is in um -> convert to mm
-
-          int idet=(isub-1)/Nsides;
 
-          if(isub>0 && idet<Ndet)
-             {
-             xgen[idet]+=rawpos[0]/1000./Nsides;
-             ygen[idet]+=rawpos[1]/1000./Nsides;
-             zgen[idet]+=rawpos[2]/1000./Nsides;
-             }
+        unsigned int nnoise=gsl_ran_poisson(r,geo.noise);
 
-	  ++nread ;
-	}
-
-    }      
-    catch(exception& e){
+        for(unsigned int inoise=0;inoise<nnoise;inoise++)
+            {
+       // Store plane number  as hit type:
 
-      if( !inputFile.eof() ) 
-	cerr << " a read exception occured : " << e.what() << endl  ;
+             TrackerHitImpl * meshit = new TrackerHitImpl;
+             meshit->setType(idet+1);
 
-      if( nread != 0 && nread != Nsub ){
-	cerr << " less than " << Nsub << " points read - event is incomplete ! " 
-	     << endl ;
-      }
-      break ;
-    }    
+      // noise position : uniform close to true hit
 
-// calculate measured points
+             double pos[3];
 
-    for(int idet=0;idet<Ndet;idet++)
-        {
+             pos[geo.ix]=gsl_rng_uniform(r)*(geo.xmax[idet]-geo.xmin[idet])+geo.xmin[idet];
+             pos[geo.iy]=gsl_rng_uniform(r)*(geo.ymax[idet]-geo.ymin[idet])+geo.ymin[idet];
+             pos[geo.iz]=geo.zdet[idet];
 
-       // Apply Gaussian smearing
+             meshit->setPosition(pos);
+             setCovMatrix(meshit, geo, idet);
+             meshitvec->push_back(meshit);
+             }       // noise loop
 
-        xmes[idet]=xgen[idet]+gsl_ran_gaussian(r,resol[idet]);
-        ymes[idet]=ygen[idet]+gsl_ran_gaussian(r,resol[idet]);
-        zmes[idet]=zgen[idet];
+        }    // idet loop
+  }
 
+  void usage() {
+    cerr << "Usage: geant2lcio [-j threads] [-s seed] [-b] [input file] [output file] {geometry file}\n"
+         << "  -j  number of simulation threads (default: number of cores)\n"
+         << "  -s  random seed (default: GSL_RNG_SEED or the GSL default)\n"
+         << "  -b  benchmark: simulate without writing and report the events/second" << endl;
+  }
 
-        fired[idet]=true;
+}
 
-        // check detector range
+int main(int argc, char ** argv) {
 
-        if(xmes[idet]<xmin[idet] || xmes[idet]>xmax[idet])fired[idet]=false;
-        if(ymes[idet]<ymin[idet] || ymes[idet]>ymax[idet])fired[idet]=false;
+  // Options: number of threads, seed and benchmark mode
+
+  unsigned int nThreads = thread::hardware_concurrency();
+  bool benchmark = false;
+  bool seedGiven = false;
+  unsigned long seed = 0;
+
+  int option;
+  while ( (option = getopt(argc, argv, "j:s:bh")) != -1 ) {
+    switch ( option ) {
+    case 'j': nThreads = atoi(optarg); break;
+    case 's': seed = strtoul(optarg, NULL, 10); seedGiven = true; break;
+    case 'b': benchmark = true; break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+  if ( nThreads == 0 ) nThreads = 1;
 
-        // Detector efficiency
+  // Input parameters are input and putput file names
 
-        if(gsl_rng_uniform(r)>effi[idet])fired[idet]=false;
+  if(argc-optind<2){
+    cerr << "Parameters missing: [input file] [output file] {geometry file}"  << endl;
+    usage();
+    return -1;
+  }
 
-        }
+  // input, output and geometry file names
 
+  string inputFileName  = argv[optind];
+  string outputFileName = argv[optind+1];
+  string geometryFileName = (argc-optind>2)?argv[optind+2]:"geant2lcio.geom";
 
-// Add generated points to collection
+  if ( benchmark )
+    cerr << "Benchmarking the simulation of " << inputFileName.c_str() << " (no output written)" << endl;
+  else
+    cerr << "Converting " << inputFileName.c_str()
+         << " to "        <<  outputFileName.c_str() <<  endl;
 
-    for(int idet=0;idet<Ndet;idet++)
-        {
+  cerr << "Using geometry description from " << geometryFileName.c_str() <<  endl;
+  cerr << "Using " << nThreads << " simulation thread(s)" << endl;
 
-    // Fill and store single MC points 
-    // Each point has to remain in memory until event is written out !
+  // Initialize input stream; exeption handling taken from AB
 
-        SimTrackerHitImpl * simhit = new SimTrackerHitImpl;
+  ifstream inputFile;
+  inputFile.exceptions(ifstream::failbit | ifstream::badbit);
 
-    // Cell ID is just the plane number  ID=1...Ndet
-        
-        simhit->setCellID(idet+1);
+  // open the input file
+  try {
+    inputFile.open(inputFileName.c_str(),ios::in);
+  }
+  catch (exception& e) {
+    cerr << "IO exception " << e.what() << " with "
+	 << inputFileName << ".\nExiting." << endl;
+    return -1;
+  }
 
-    // Get position, change axis according to the beam direction 
+  // Open geometry description file
 
-        double pos[3];
+  ifstream geometryFile;
+  geometryFile.open(geometryFileName.c_str(),ios::in);
 
-        pos[ix]=xgen[idet];
-        pos[iy]=ygen[idet];
-        pos[iz]=zgen[idet];
 
-        simhit->setPosition(pos);
+  // Now prepare the output slcio file.
 
-     // store this hit
+  LCWriter * lcWriter = NULL;
 
-       simhitvec->push_back(simhit);
+  if ( !benchmark ) {
+    lcWriter = LCFactory::getInstance()->createLCWriter();
 
-        }
+    // open the file
+    try {
+      lcWriter->open(outputFileName.c_str(),LCIO::WRITE_NEW);
+    }
+    catch (IOException& e) {
+      cerr << e.what() << endl;
+      return -1;
+    }
+  }
 
-// Add measured points to collection
+/* create GSL generator chosen by the
+   environment variable GSL_RNG_TYPE */
 
-    for(int idet=0;idet<Ndet;idet++)
-        {
+  const gsl_rng_type * T;
+  gsl_rng * r;
 
-       // take only valid hits:
+  gsl_rng_env_setup();
+  T = gsl_rng_default;
+  r = gsl_rng_alloc (T);
+  if ( !seedGiven ) seed = gsl_rng_default_seed;
+  gsl_rng_set(r, seed);
 
-        if(fired[idet])
-            {
-       // Fill and store measured points 
-       // Each point has to remain in memory until event is written out !
+ // Prepare a run header
 
-            TrackerHitImpl * meshit = new TrackerHitImpl;
+  int runNumber       = 1;
+  string detectorName = "Eutelescope";
+  string detectorDescription = "EUDET telescope, WN-WW configuration";
 
-            if(meshit == NULL) 
-                  cerr << "TrackerHitImpl allocation failed" << endl;
+  LCRunHeaderImpl * runHeader = new LCRunHeaderImpl();
+  runHeader->setRunNumber(runNumber);
+  runHeader->setDetectorName(detectorName);
+  runHeader->setDescription(detectorDescription);
 
-       // Store plane number  as hit type:
+  // Read detector data from geometry description file
 
-             meshit->setType(idet+1);
+  Geometry geo;
+  int beamaxis;
 
-      // store measured position
+  geometryFile >> geo.Ndet >> geo.pileup >> geo.noise >> beamaxis >> geo.beamspot ;
 
-             double pos[3];
+// set axis directions for decoding input file
+// beamaxis = 1..3
 
-             pos[ix]=xmes[idet];
-             pos[iy]=ymes[idet];
-             pos[iz]=zmes[idet];
+  geo.iz=beamaxis-1;
+  geo.ix=(geo.iz+1)%3;
+  geo.iy=(geo.iz+2)%3;
 
-             meshit->setPosition(pos);
+  cerr << "Telescope setup with " << geo.Ndet << " layers" <<  endl;
 
-      // Covariance matrix of the position 
-      // (stored as lower triangle matrix, i.e.  cov(xx),cov(y,x),cov(y,y) ).
+  geo.zdet.resize(geo.Ndet);
+  geo.xmin.resize(geo.Ndet);
+  geo.xmax.resize(geo.Ndet);
+  geo.ymin.resize(geo.Ndet);
+  geo.ymax.resize(geo.Ndet);
+  geo.resol.resize(geo.Ndet);
+  geo.effi.resize(geo.Ndet);
 
-            float cov[TRKHITNCOVMATRIX];
+  for(int idet=0; idet < geo.Ndet; idet++)
+     {
+      string detName;
+      geometryFile >> geo.zdet[idet] >> geo.xmin[idet] >> geo.xmax[idet]
+                   >> geo.ymin[idet] >> geo.ymax[idet] >> geo.resol[idet] >> geo.effi[idet];
 
-            cov[ix+ix*ix]=resol[idet]*resol[idet];
-            cov[iy+iy*iy]=resol[idet]*resol[idet];
-            cov[iz+iz*iz]=0.;
+      // change resolution units to mm
 
-            cov[1]=cov[3]=cov[4]=0.;
+      geo.resol[idet]/=1000.;
 
-            meshit->setCovMatrix(cov);
+      std::getline(geometryFile,detName,'\n');
 
+     // Add plane names to run header
 
-      // store measured hit 
+      runHeader->addActiveSubdetector(detName);
+      }
 
-             meshitvec->push_back(meshit);
+  // Check subdetector list
 
-             }       // if(fired[idet])
-       }    // idet loop
+  const std::vector<std::string> * subDets =
+                               runHeader->getActiveSubdetectors();
 
+  geo.Ndet = subDets->size();
+  const int Ndet = geo.Ndet;
 
-// Just in case of EOF
+  cerr << Ndet << " subdetectors defined :" << endl;
+  for(int idet=0;idet<Ndet;idet++)
+    cerr << idet+1 << " : " << subDets->at(idet) << endl;
 
-  if (inputFile.eof()) break;
+  // write the header to the output file
 
-      }    // pileup event loop
+  if ( lcWriter ) lcWriter->writeRunHeader(runHeader);
 
+  // delete the run header since not used anymore
 
-// Add noise:
+  delete runHeader;
 
-    for(int idet=0;idet<Ndet;idet++)
-        {
 
-        unsigned int nnoise=gsl_ran_poisson(r,noise);
+// Input form Geant
 
-        for(int inoise=0;inoise<nnoise;inoise++)
-            {
-       // Fill and store noise points 
+//  int Nsub = 2*Ndet+2;  // front and back side for each sensor plane
 
-             TrackerHitImpl * meshit = new TrackerHitImpl;
+  const int Nsides = 1;            // back side only
+  const int Nsub = Nsides*Ndet+2;
 
-       // Store plane number  as hit type:
+// Reader: the number of pileup tracks is drawn here, so that the
+// tracks are taken from the input file in the same order for any
+// number of threads
 
-             meshit->setType(idet+1);
+  int eventNumber = 0;
+  bool endOfInput = false;
 
-      // noise position : uniform close to true hit
+  EUTelEventPipeline<GeantEvent, SimulatedEvent>::Reader reader = [&] (GeantEvent & event) -> bool {
 
-             double pos[3];
+    if ( endOfInput ) return false;
 
-             pos[ix]=gsl_rng_uniform(r)*(xmax[idet]-xmin[idet])+xmin[idet];
-             pos[iy]=gsl_rng_uniform(r)*(ymax[idet]-ymin[idet])+ymin[idet];
-             pos[iz]=zdet[idet];
+    event.eventNumber = eventNumber + 1;
 
-             meshit->setPosition(pos);
+    // Number of tracks to include
 
-      // Covariance matrix of the position 
-      // (stored as lower triangle matrix, i.e.  cov(xx),cov(y,x),cov(y,y) ).
+    unsigned int npile=1;
+    npile += gsl_ran_poisson(r,geo.pileup);
 
-            float cov[TRKHITNCOVMATRIX];
+    for(unsigned int ipile=0; ipile<npile;ipile++)
+      {
+      int nread=0;
+      double rawpos[3];
 
-            cov[ix+ix*ix]=resol[idet]*resol[idet];
-            cov[iy+iy*iy]=resol[idet]*resol[idet];
-            cov[iz+iz*iz]=0.;
+      GeantTrack track;
+      track.xgen.assign(Ndet, 0.);
+      track.ygen.assign(Ndet, 0.);
+      track.zgen.assign(Ndet, 0.);
 
-            cov[1]=cov[3]=cov[4]=0.;
+// Read one Geant event from file
 
-            meshit->setCovMatrix(cov);
+      try{
+        for(int isub=0 ; isub <  Nsub ; isub++ )
+          {
+// Geant4 input: beam along Z axis
+            inputFile >> rawpos[2] >> rawpos[0] >> rawpos[1] ;
 
+// Input file is in um -> convert to mm
 
-      // store measured hit 
+            int idet=(isub-1)/Nsides;
 
-             meshitvec->push_back(meshit);
+            if(isub>0 && idet<Ndet)
+               {
+               track.xgen[idet]+=rawpos[0]/1000./Nsides;
+               track.ygen[idet]+=rawpos[1]/1000./Nsides;
+               track.zgen[idet]+=rawpos[2]/1000./Nsides;
+               }
 
-             }       // noise loop
+            ++nread ;
+          }
+      }
+      catch(exception& e){
 
-        }    // idet loop
+        if( !inputFile.eof() )
+          cerr << " a read exception occured : " << e.what() << endl  ;
 
+        if( nread != 0 && nread != Nsub ){
+          cerr << " less than " << Nsub << " points read - event is incomplete ! "
+               << endl ;
+        }
+        endOfInput = true;
+        break ;
+      }
 
+      event.tracks.push_back(track);
 
+// Just in case of EOF
 
-    //  if(npile>2)cerr << "Pileup of " << npile << " MC particles in event " << eventNumber << endl;
+      if (inputFile.eof()) {
+        endOfInput = true;
+        break;
+      }
+      }    // pileup event loop
 
+    if ( event.tracks.empty() ) return false;
 
-// add hit collections to an event
+    ++eventNumber;
+    return true;
+  };
 
-    event->addCollection(simhitvec,"simhit");
+// Workers: one generator per worker, seeded with the event number
 
+  vector<gsl_rng *> workerRng(nThreads);
+  for ( unsigned int iThread = 0; iThread < nThreads; ++iThread ) workerRng[iThread] = gsl_rng_alloc (T);
 
-// add measured hit collection to an event
+  EUTelEventPipeline<GeantEvent, SimulatedEvent>::Worker worker =
+    [&] (size_t iThread, GeantEvent & input, SimulatedEvent & output) {
+      gsl_rng_set(workerRng[iThread], seed + input.eventNumber);
+      simulateEvent(geo, detectorName, runNumber, workerRng[iThread], input, output);
+    };
 
-    event->addCollection(meshitvec,"meshit");
+// Writer: events are written in order, deleting an event also
+// deletes everything what was put into this event...
 
+  unsigned long nWritten = 0;
 
-    // write event out
+  EUTelEventPipeline<GeantEvent, SimulatedEvent>::Writer writer = [&] (SimulatedEvent & event) {
+    if ( lcWriter ) lcWriter->writeEvent(event.get());
+    event.reset();
 
-    lcWriter->writeEvent(event);
-    
-    // clean
-    // deleting an event also delets everything what was put into this event...
+    if (++nWritten%1000 == 0)
+      cout << "Converting event number " << nWritten << endl;
+  };
 
-    delete event;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-   // if the file is at the end ... break the loop!
+  EUTelEventPipeline<GeantEvent, SimulatedEvent> pipeline(nThreads);
+  try {
+    pipeline.run(reader, worker, writer);
+  }
+  catch (exception& e) {
+    cerr << "Conversion failed: " << e.what() << endl;
+    return -1;
+  }
 
-  if (inputFile.eof()) break;
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-// End of event loop
-}
+  cerr << nWritten << " events " << ( benchmark ? "simulated" : "converted" ) << " in " << seconds << " s";
+  if ( seconds > 0 ) cerr << " (" << nWritten / seconds << " events/s)";
+  cerr << endl;
 
 
 // That is all! Close all streams...
 
+  for ( unsigned int iThread = 0; iThread < nThreads; ++iThread ) gsl_rng_free (workerRng[iThread]);
   gsl_rng_free (r);
-  
-  lcWriter->close();
+
+  if ( lcWriter ) {
+    lcWriter->close();
+    delete lcWriter;
+  }
   inputFile.close();
   geometryFile.close();
 
- 
+
   return 0;
 }
-